@@ -0,0 +1,319 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include "playful_kinematics/solver_profile.h"
+
+
+/**
+ * Capture of the calls to the C interface of the library (the functions used by the python
+ * wrapper: ik_ndofs, forward_kinematics, handle_ik, and the functions setting the configuration),
+ * to be replayed by pepper_capture_replay (src/capture_replay.cpp) against any build of the library,
+ * which compares the results and durations of the calls.
+ *
+ * While capturing, each call appends a record (inputs, outputs, begin time and duration) to the
+ * buffer of its thread (CAPTURE_BUFFER_SIZE bytes, single producer / single consumer, no lock, no
+ * allocation). A background thread flushes the buffers to the capture file. Records which do not
+ * fit in the buffer of their thread are dropped (see get_nb_dropped_capture_records).
+ * When not capturing, a call costs one atomic load.
+ *
+ * Capture is started by start_capture, or at load time if the environment variable
+ * PLAYFUL_KINEMATICS_CAPTURE is set to a file path (and then stopped at exit).
+ * The current global configuration is recorded when the capture starts, the configuration of a
+ * handle the first time it is used during the capture.
+ *
+ * File format (native endianness): CAPTURE_MAGIC (int64), CAPTURE_VERSION (int64), then records:
+ * a capture_record_header followed by the payload of the record (see capture_type).
+ * Records of different threads are interleaved in any order: replay sorts them by sequence.
+ */
+
+
+namespace playful_kinematics {
+
+
+  static const int64_t CAPTURE_MAGIC = 0x3150414350504b; // "KPPCAP1"
+  static const int64_t CAPTURE_VERSION = 2;
+
+  /*! bytes of the buffer of each thread */
+  static const int CAPTURE_BUFFER_SIZE = 1<<20;
+
+  /*! maximal size of a record, larger records (e.g. chains of hundreds of joints) are dropped */
+  static const int CAPTURE_RECORD_SIZE = 2048;
+
+
+  /*
+   * payloads (bool: 1 byte, int: int32, float and double, arrays preceded by their size as int32
+   * unless fixed). Outputs follow the inputs.
+   */
+  enum capture_type {
+    /*! side, line search, reference posture[], mask[6], min joints indexes[] and values[],
+        max joints indexes[] and values[], minimization priority joints indexes[] and values[],
+        solver profile */
+    CAPTURE_CONFIG_SNAPSHOT = 1,
+    /*! index, priority */
+    CAPTURE_SET_MINIMIZATION_PRIORITY = 2,
+    /*! left */
+    CAPTURE_SET_KINEMATICS_SIDE = 3,
+    /*! mask[6] */
+    CAPTURE_SET_KINEMATICS_MASK = 4,
+    /*! index, min, max */
+    CAPTURE_SET_KINEMATICS_JOINT_LIMIT = 5,
+    CAPTURE_BEGIN_CONFIG_UPDATE = 6,
+    CAPTURE_END_CONFIG_UPDATE = 7,
+    /*! search */
+    CAPTURE_SET_KINEMATICS_LINE_SEARCH = 8,
+    /*! reference posture[] */
+    CAPTURE_SET_KINEMATICS_JOINTS = 9,
+    /*! left, target[6], mask[6] (as set by set_mask), posture[] ; success, score, posture[] */
+    CAPTURE_IK_NDOFS = 10,
+    /*! left, q[] (double) ; success, pose[6] (double) */
+    CAPTURE_FORWARD_KINEMATICS = 11,
+    /*! handle (uint64) */
+    CAPTURE_CREATE_HANDLE = 12,
+    /*! handle */
+    CAPTURE_DELETE_HANDLE = 13,
+    /*! handle, then per side (right, left): line search, min[], max[], minimization priority[] */
+    CAPTURE_HANDLE_SNAPSHOT = 14,
+    /*! handle, left, index, min, max */
+    CAPTURE_HANDLE_SET_JOINT_LIMIT = 15,
+    /*! handle, left, index, priority */
+    CAPTURE_HANDLE_SET_MINIMIZATION_PRIORITY = 16,
+    /*! handle, left, search */
+    CAPTURE_HANDLE_SET_LINE_SEARCH = 17,
+    /*! handle, left, target[6], mask[6], posture[] ; success, score, posture[] */
+    CAPTURE_HANDLE_IK = 18,
+    /*! solver profile */
+    CAPTURE_SET_KINEMATICS_SOLVER_PROFILE = 19
+  };
+
+
+  class capture_record_header {
+  public:
+    /*! bytes of the record, header included */
+    uint32_t size;
+    uint32_t type;
+    /*! order of the calls, over all threads */
+    uint64_t sequence;
+    /*! nano seconds (steady clock) */
+    int64_t begin;
+    int64_t duration;
+    uint32_t thread;
+    uint32_t padding;
+  };
+
+
+  /*! starts capturing to the file (overwritten). false if already capturing or if the file
+      could not be opened */
+  bool start_capture(const std::string &path);
+
+  /*! flushes the buffers, and closes the capture file */
+  void stop_capture();
+
+  /*! number of the current capture (0 before the first capture), incremented by start_capture */
+  unsigned long get_capture_session();
+
+  /*! number of records dropped because the buffer of their thread was full, or too large */
+  long get_nb_dropped_capture_records();
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+  namespace capture_internal {
+
+    extern std::atomic<bool> capturing;
+
+    /*! appends the record to the buffer of the calling thread */
+    void push(const char *record, int size);
+
+    uint64_t next_sequence();
+
+    int64_t now();
+
+  }
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  inline bool is_capturing(){
+    return capture_internal::capturing.load(std::memory_order_relaxed);
+  }
+
+
+  /**
+   * record of a call, built on the stack while capturing, does nothing otherwise:
+   *   capture_record record(CAPTURE_IK_NDOFS);
+   *   record.add(left); record.add(nb_dofs,posture); ...
+   *   (call)
+   *   record.add(success); ...
+   *   record.commit();
+   * The duration is the time between the construction and commit.
+   */
+  class capture_record {
+
+  public:
+
+    capture_record(capture_type type)
+      : active(is_capturing()), size(sizeof(capture_record_header)) {
+      if(!this->active) return;
+      capture_record_header header;
+      std::memset(&header,0,sizeof(header));
+      header.type = type;
+      header.sequence = capture_internal::next_sequence();
+      std::memcpy(this->data,&header,sizeof(header));
+      this->begin = capture_internal::now();
+    }
+
+    bool is_active() const {
+      return this->active;
+    }
+
+    template<class T>
+    void add(const T &value){
+      if(!this->active) return;
+      this->_add(&value,sizeof(T));
+    }
+
+    /*! array preceded by its size */
+    template<class T>
+    void add(int nb, const T *values){
+      if(!this->active) return;
+      this->_add(&nb,sizeof(int32_t));
+      if(nb>0) this->_add(values,nb*sizeof(T));
+    }
+
+    /*! array of known size (e.g. target[6]) */
+    template<class T>
+    void add_fixed(int nb, const T *values){
+      if(!this->active) return;
+      this->_add(values,nb*sizeof(T));
+    }
+
+    void commit(){
+      if(!this->active) return;
+      capture_record_header *header = reinterpret_cast<capture_record_header*>(this->data);
+      header->begin = this->begin;
+      header->duration = capture_internal::now()-this->begin;
+      header->size = this->size;
+      capture_internal::push(this->data,this->size);
+      this->active = false;
+    }
+
+  private:
+
+    void _add(const void *value, int bytes){
+      // too large: size set above the maximum, the record is dropped by push
+      if(this->size+bytes>CAPTURE_RECORD_SIZE){
+	this->size = CAPTURE_RECORD_SIZE+1;
+	return;
+      }
+      std::memcpy(this->data+this->size,value,bytes);
+      this->size += bytes;
+    }
+
+    bool active;
+    int size;
+    int64_t begin;
+    char data[CAPTURE_RECORD_SIZE];
+
+  };
+
+
+  /*! call read from a capture file */
+  class captured_call {
+  public:
+    capture_record_header header;
+    std::vector<char> payload;
+  };
+
+  /*! reads the records of the capture file, sorted by sequence */
+  bool read_capture(const std::string &path, std::vector<captured_call> &get_calls);
+
+
+  /*! reads the payload of a captured call, in the order it was written */
+  class capture_payload {
+
+  public:
+
+    capture_payload(const captured_call &call)
+      : payload(call.payload), position(0), valid(true) {}
+
+    template<class T>
+    T get(){
+      T value = T();
+      this->_get(&value,sizeof(T));
+      return value;
+    }
+
+    /*! array preceded by its size */
+    template<class T>
+    std::vector<T> get_array(){
+      int32_t nb = this->get<int32_t>();
+      if(nb<0 || nb*sizeof(T)>this->payload.size()-this->position){
+	this->valid = false;
+	return std::vector<T>();
+      }
+      std::vector<T> values(nb);
+      if(nb>0) this->_get(values.data(),nb*sizeof(T));
+      return values;
+    }
+
+    template<class T>
+    void get_fixed(int nb, T *get_values){
+      this->_get(get_values,nb*sizeof(T));
+    }
+
+    /*! false if the payload was shorter than read */
+    bool is_valid() const {
+      return this->valid;
+    }
+
+  private:
+
+    void _get(void *value, size_t bytes){
+      if(!this->valid || this->position+bytes>this->payload.size()){
+	this->valid = false;
+	return;
+      }
+      std::memcpy(value,this->payload.data()+this->position,bytes);
+      this->position += bytes;
+    }
+
+    const std::vector<char> &payload;
+    size_t position;
+    bool valid;
+
+  };
+
+
+
+
+  /*! solver profile in a payload: engine, target score, max step, min step, max iteration,
+      CMA-ES population, sigma, max generations, seed (uint64) and number of threads */
+  void add_solver_profile(capture_record &record, const solver_profile &profile);
+
+  /*! see add_solver_profile */
+  solver_profile get_solver_profile(capture_payload &payload);
+
+
+}
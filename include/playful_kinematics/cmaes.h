@@ -0,0 +1,146 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "playful_kinematics/soma.h"
+
+
+namespace playful_kinematics {
+
+
+  /*! configuration of the CMA-ES minimization (see minimize below) */
+  class cmaes_parameters {
+
+  public:
+
+    cmaes_parameters()
+      : population(0), sigma(0.3), max_generations(200), seed(0), nb_threads(1) {}
+
+    /*! candidate postures per generation. 0: 4+3*ln(number of dimensions), rounded up
+        to a multiple of the number of SIMD lanes (see get_simd_lanes in fk_simd.h) */
+    int population;
+
+    /*! initial step size, as a fraction of the range (max-min) of each dimension */
+    float sigma;
+
+    int max_generations;
+
+    /*! seed of the sampling: same seed, same postures */
+    uint64_t seed;
+
+    /*! threads scoring each generation: 1 for the calling thread only, 0 for the number of
+        cores. Each thread scores with its own copy of the score, which must be copyable */
+    int nb_threads;
+
+  };
+
+
+  /**
+   * Minimizes the score with CMA-ES (covariance matrix adaptation evolution strategy),
+   * an alternative to the coordinate descent of SOMA (see soma.h) for scores which are
+   * not smooth (e.g. collision penalties), on which coordinate descent stalls.
+   * The search runs in coordinates normalized by the range of each dimension, candidates
+   * being clamped to [min,max]. Dimensions with equal min and max are frozen.
+   * Each generation is scored as one batch: split over parameters.nb_threads threads and,
+   * if the score provides
+   *   void evaluate_batch(int nb, const double *q, float *get_scores)
+   * (q: nb postures in structure of arrays layout, value j of posture i at q[j*nb+i],
+   * see cartesian_score in score_functions.h), scored over the SIMD lanes. Otherwise the
+   * score is called as score(posture), as for the SOMA minimize functions.
+   * Score evaluations are counted in get_soma_counters().nb_evaluations.
+   * @param posture start posture (the mean of the first generation), replaced by the best posture found
+   * @param min min acceptable for each dimension of the posture
+   * @param max max acceptable for each dimension of the posture
+   * @param target_score the algorithm will exit once the score below this value
+   * @param score scoring function, see the SOMA minimize functions of soma.h
+   * @param final_score score of the posture found
+   * @return true if the target score was reached
+   */
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const Posture &min,
+		const Posture &max,
+		float target_score,
+		Score &&score,
+		float &final_score,
+		const cmaes_parameters &parameters);
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+  namespace cmaes_internal {
+
+    /*! eigen decomposition of the symmetric matrix C (n*n, row major, destroyed) by Jacobi
+        rotations: C = B*diag(get_eigenvalues)*B^T, eigenvectors as columns of get_B */
+    void symmetric_eigen(int n, std::vector<double> &C,
+			 std::vector<double> &get_B, std::vector<double> &get_eigenvalues);
+
+    /*! threads running a job on a generation, the calling thread being thread 0 */
+    class workers {
+
+    public:
+
+      workers(int nb_threads);
+      ~workers();
+
+      int get_nb_threads() const;
+
+      /*! runs job(thread index) on each thread, returns once all are done */
+      template<class Job>
+      void run(Job &job){
+	this->_run(&_call<Job>,&job);
+      }
+
+    private:
+
+      template<class Job>
+      static void _call(void *job, int thread){
+	(*static_cast<Job*>(job))(thread);
+      }
+
+      void _run(void (*call)(void*,int), void *job);
+      void _work(int thread);
+
+      std::vector<std::thread> threads;
+      std::mutex mutex;
+      std::condition_variable start;
+      std::condition_variable done;
+      // incremented for each job
+      unsigned long generation;
+      int nb_running;
+      bool stop;
+      void (*call)(void*,int);
+      void *job;
+
+    };
+
+  }
+
+  /* END OF BACK END FUNCTIONS */
+
+
+}
+
+
+#include "playful_kinematics/cmaes_template.h"
@@ -0,0 +1,290 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// implementation of the templated minimize function declared in cmaes.h.
+// do not include directly, include cmaes.h
+
+
+#pragma once
+
+#include <random>
+#include "playful_kinematics/fk_simd.h"
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  namespace cmaes_internal {
+
+
+    // true if the score provides evaluate_batch (see minimize in cmaes.h)
+    template<class Score>
+    class has_batch {
+      template<class S>
+      static auto test(int) -> decltype(std::declval<S&>().evaluate_batch(0,(const double*)NULL,(float*)NULL),
+					std::true_type());
+      template<class S>
+      static std::false_type test(...);
+    public:
+      static const bool value = decltype(test<Score>(0))::value;
+    };
+
+
+    // scores of the candidates [begin,end) (nb_dims values each, contiguous), by a batch
+    template<class Posture, class Score>
+    void _score(Score &score, const double *candidates, int nb_dims, int begin, int end,
+		Posture &, std::vector<double> &batch, float *get_scores,
+		std::true_type){
+      int nb = end-begin;
+      if(nb<=0) return;
+      batch.resize(nb*nb_dims);
+      for(int i=0;i<nb;i++){
+	for(int j=0;j<nb_dims;j++) batch[j*nb+i] = candidates[(begin+i)*nb_dims+j];
+      }
+      score.evaluate_batch(nb,batch.data(),get_scores+begin);
+    }
+
+
+    // same, one posture at a time
+    template<class Posture, class Score>
+    void _score(Score &score, const double *candidates, int nb_dims, int begin, int end,
+		Posture &posture, std::vector<double> &, float *get_scores,
+		std::false_type){
+      for(int i=begin;i<end;i++){
+	for(int j=0;j<nb_dims;j++) posture[j] = candidates[i*nb_dims+j];
+	get_scores[i] = score(posture);
+      }
+    }
+
+
+    // scoring of the generations: one copy of the score and of the posture per thread
+    template<class Posture, class Score>
+    class generation_scoring {
+
+    public:
+
+      generation_scoring(const Score &score, const Posture &posture, int nb_threads, int nb_lanes)
+	: scores(nb_threads,score), postures(nb_threads,posture), batches(nb_threads),
+	  nb_lanes(nb_lanes), candidates(NULL), nb_candidates(0), get_scores(NULL) {}
+
+      // scores of the part of the generation of the thread
+      void operator()(int thread){
+	int nb_threads = this->scores.size();
+	// shares as multiples of the number of SIMD lanes
+	int share = (this->nb_candidates+nb_threads-1)/nb_threads;
+	share = ((share+this->nb_lanes-1)/this->nb_lanes)*this->nb_lanes;
+	int begin = std::min(this->nb_candidates,thread*share);
+	int end = std::min(this->nb_candidates,begin+share);
+	_score(this->scores[thread],this->candidates,this->postures[thread].size(),begin,end,
+	       this->postures[thread],this->batches[thread],this->get_scores,
+	       std::integral_constant<bool,has_batch<Score>::value>());
+      }
+
+      std::vector<Score> scores;
+      std::vector<Posture> postures;
+      std::vector< std::vector<double> > batches;
+      int nb_lanes;
+
+      // generation being scored
+      const double *candidates;
+      int nb_candidates;
+      float *get_scores;
+
+    };
+
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const Posture &min,
+		const Posture &max,
+		float target_score,
+		Score &&score,
+		float &final_score,
+		const cmaes_parameters &parameters){
+
+    PLAYFUL_KINEMATICS_TRACE("cmaes");
+
+    typedef typename std::decay<Score>::type score_type;
+    using namespace cmaes_internal;
+
+    get_soma_counters().nb_minimizations++;
+
+    const int nb_dims = posture.size();
+
+    // searched dimensions, frozen ones are set to their limit
+    std::vector<int> free;
+    for(int i=0;i<nb_dims;i++){
+      if(min[i]!=max[i]) free.push_back(i);
+      posture[i] = std::min(max[i],std::max(min[i],posture[i]));
+    }
+    const int n = free.size();
+
+    final_score = score(posture);
+    get_soma_counters().nb_evaluations++;
+    if(n==0 || final_score<=target_score) return final_score<=target_score;
+
+    // strategy parameters (Hansen, The CMA Evolution Strategy: A Tutorial)
+    int nb_lanes = get_simd_lanes(get_simd_level());
+    int lambda = parameters.population;
+    if(lambda<=0){
+      lambda = 4+(int)(3*log((double)n));
+      lambda = ((lambda+nb_lanes-1)/nb_lanes)*nb_lanes;
+    }
+    lambda = std::max(lambda,2);
+    int mu = lambda/2;
+    std::vector<double> weights(mu);
+    double sum = 0, sum_squares = 0;
+    for(int i=0;i<mu;i++){
+      weights[i] = log(mu+0.5)-log(i+1.0);
+      sum += weights[i];
+    }
+    for(int i=0;i<mu;i++){
+      weights[i] /= sum;
+      sum_squares += weights[i]*weights[i];
+    }
+    double mueff = 1.0/sum_squares;
+    double cc = (4+mueff/n)/(n+4+2*mueff/n);
+    double cs = (mueff+2)/(n+mueff+5);
+    double c1 = 2/((n+1.3)*(n+1.3)+mueff);
+    double cmu = std::min(1-c1,2*(mueff-2+1/mueff)/((n+2)*(n+2)+mueff));
+    double damps = 1+2*std::max(0.0,sqrt((mueff-1)/(n+1))-1)+cs;
+    double chin = sqrt((double)n)*(1-1.0/(4*n)+1.0/(21.0*n*n));
+
+    // state, in coordinates normalized by the range of each dimension
+    std::vector<double> mean(n), previous_mean(n);
+    for(int k=0;k<n;k++) mean[k] = (posture[free[k]]-min[free[k]])/(max[free[k]]-min[free[k]]);
+    double sigma = parameters.sigma;
+    std::vector<double> C(n*n,0), B(n*n,0), D(n,1), pc(n,0), ps(n,0);
+    for(int k=0;k<n;k++) C[k*n+k] = B[k*n+k] = 1;
+
+    // candidates: normalized (y, for the update) and in posture coordinates (for the scores)
+    std::vector<double> z(n), y(lambda*n), candidates(lambda*nb_dims);
+    std::vector<float> scores(lambda);
+    std::vector<int> order(lambda);
+    std::vector<double> eigen_work;
+
+    int nb_threads = parameters.nb_threads>0 ? parameters.nb_threads : std::max(1u,std::thread::hardware_concurrency());
+    nb_threads = std::min(nb_threads,(lambda+nb_lanes-1)/nb_lanes);
+    generation_scoring<Posture,score_type> scoring(score,posture,nb_threads,nb_lanes);
+    workers pool(nb_threads);
+
+    std::mt19937_64 generator(parameters.seed);
+    std::normal_distribution<double> normal(0.0,1.0);
+
+    Posture best(posture);
+
+    for(int generation=0;generation<parameters.max_generations;generation++){
+
+      // sampling: y = B*D*z, candidate mean+sigma*y clamped to the limits
+      for(int c=0;c<lambda;c++){
+	for(int k=0;k<n;k++) z[k] = D[k]*normal(generator);
+	double *candidate = &candidates[c*nb_dims];
+	for(int i=0;i<nb_dims;i++) candidate[i] = posture[i];
+	for(int k=0;k<n;k++){
+	  double yk = 0;
+	  for(int l=0;l<n;l++) yk += B[k*n+l]*z[l];
+	  double x = std::min(1.0,std::max(0.0,mean[k]+sigma*yk));
+	  // step of the clamped candidate, used by the update
+	  y[c*n+k] = (x-mean[k])/sigma;
+	  candidate[free[k]] = min[free[k]]+x*(max[free[k]]-min[free[k]]);
+	}
+      }
+
+      scoring.candidates = candidates.data();
+      scoring.nb_candidates = lambda;
+      scoring.get_scores = scores.data();
+      pool.run(scoring);
+      get_soma_counters().nb_evaluations += lambda;
+
+      for(int c=0;c<lambda;c++) order[c]=c;
+      std::sort(order.begin(),order.end(),[&scores](int a, int b){ return scores[a]<scores[b]; });
+
+      if(scores[order[0]]<final_score){
+	final_score = scores[order[0]];
+	for(int i=0;i<nb_dims;i++) best[i] = candidates[order[0]*nb_dims+i];
+	if(final_score<=target_score) break;
+      }
+
+      // mean: weighted mean of the mu best
+      previous_mean = mean;
+      std::vector<double> yw(n,0);
+      for(int i=0;i<mu;i++){
+	for(int k=0;k<n;k++) yw[k] += weights[i]*y[order[i]*n+k];
+      }
+      for(int k=0;k<n;k++) mean[k] = previous_mean[k]+sigma*yw[k];
+
+      // evolution paths. C^(-1/2)*yw = B*D^-1*B^T*yw
+      std::vector<double> bt(n,0);
+      for(int k=0;k<n;k++){
+	for(int l=0;l<n;l++) bt[k] += B[l*n+k]*yw[l];
+	bt[k] /= D[k];
+      }
+      double norm_ps = 0;
+      for(int k=0;k<n;k++){
+	double c_yw = 0;
+	for(int l=0;l<n;l++) c_yw += B[k*n+l]*bt[l];
+	ps[k] = (1-cs)*ps[k]+sqrt(cs*(2-cs)*mueff)*c_yw;
+	norm_ps += ps[k]*ps[k];
+      }
+      norm_ps = sqrt(norm_ps);
+      bool hsig = norm_ps/sqrt(1-pow(1-cs,2.0*(generation+1)))/chin < 1.4+2.0/(n+1);
+      for(int k=0;k<n;k++) pc[k] = (1-cc)*pc[k]+(hsig ? sqrt(cc*(2-cc)*mueff) : 0)*yw[k];
+
+      // covariance: rank one and rank mu updates
+      for(int k=0;k<n;k++){
+	for(int l=0;l<=k;l++){
+	  double rank_mu = 0;
+	  for(int i=0;i<mu;i++) rank_mu += weights[i]*y[order[i]*n+k]*y[order[i]*n+l];
+	  double value = (1-c1-cmu)*C[k*n+l]
+	    + c1*(pc[k]*pc[l]+(hsig ? 0 : cc*(2-cc)*C[k*n+l]))
+	    + cmu*rank_mu;
+	  C[k*n+l] = C[l*n+k] = value;
+	}
+      }
+
+      sigma *= exp((cs/damps)*(norm_ps/chin-1));
+
+      eigen_work = C;
+      symmetric_eigen(n,eigen_work,B,D);
+      double max_d = 0;
+      for(int k=0;k<n;k++){
+	D[k] = sqrt(std::max(D[k],1e-20));
+	max_d = std::max(max_d,D[k]);
+      }
+
+      // steps below the resolution of the limits
+      if(sigma*max_d<1e-7) break;
+
+    }
+
+    posture = best;
+    return final_score<=target_score;
+
+  }
+
+
+}
@@ -0,0 +1,78 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace playful_kinematics {
+
+
+  /*! largest number of joints for which the fixed size functions are instantiated
+      (forward_kinematics in fk_simd.h, ik in ik.h) */
+  static const int MAX_FIXED_DOFS = 12;
+
+
+  /**
+   * Posture of N joints, with a size known at compile time: it lives on the stack
+   * (or in registers) rather than on the heap as a std::vector<float>, and loops over
+   * its joints have a constant bound, which the compiler may unroll. Aligned on 32 bytes
+   * (one AVX register holds 8 joints).
+   * Provides size() and operator[], as expected by the templated minimize functions
+   * of soma.h.
+   */
+  template<int N>
+  class alignas(32) fixed_posture {
+
+  public:
+
+    static constexpr int size(){ return N; }
+
+    float& operator[](int index){ return this->values[index]; }
+    const float& operator[](int index) const { return this->values[index]; }
+
+    float* data(){ return this->values; }
+    const float* data() const { return this->values; }
+
+    float values[N];
+
+  };
+
+
+  /*! number of joints of the posture type if known at compile time, 0 otherwise */
+  template<class Posture>
+  class posture_size {
+  public:
+    static const int value = 0;
+  };
+
+  template<int N>
+  class posture_size< fixed_posture<N> > {
+  public:
+    static const int value = N;
+  };
+
+  template<class T, size_t N>
+  class posture_size< std::array<T,N> > {
+  public:
+    static const int value = N;
+  };
+
+
+}
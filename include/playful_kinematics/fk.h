@@ -29,10 +29,66 @@
 #include <vector>
 #include <kdl_parser/kdl_parser.hpp>
 #include <cstdlib>
+#include <boost/shared_ptr.hpp>
+#include "playful_kinematics/fk_simd.h"
 
 namespace playful_kinematics {
 
 
+  class robot_kinematics;
+
+
+  /**
+   * Immutable kinematic model of the robot: the kinematic chains of both end
+   * effectors, as parsed from the urdf specified in the CMakeLists.txt.
+   * The urdf is parsed once per process and the model is shared by all
+   * threads and all robot instances (see robot_instance.h): forward kinematics
+   * does not modify it.
+   */
+  class robot_model {
+
+  public:
+
+    /*! number of joints of the kinematic chain of the end effector */
+    int get_nb_joints(bool left) const;
+
+    /*! kinematic chain of the end effector (e.g. to build a flat_chain, see fk_simd.h) */
+    const KDL::Chain& get_chain(bool left) const;
+
+    /*! kinematic chain of the end effector as a flat_chain, built when the urdf is parsed */
+    const flat_chain& get_flat_chain(bool left) const;
+
+    /**
+     * kinematic chain between two links of the urdf, e.g. from the base to the head
+     * for a gaze task (see multi_task.h), in addition to the chains of the end effectors.
+     * The chain is extracted from the tree parsed from the urdf and belongs to the caller.
+     * @return false (reason printed on std::cerr) if the urdf has no chain between the links
+     */
+    bool get_chain(const std::string &first_link, const std::string &last_link,
+		   KDL::Chain &get_chain) const;
+
+    /*! same as above, as a flat_chain */
+    bool get_flat_chain(const std::string &first_link, const std::string &last_link,
+			flat_chain &get_chain) const;
+
+    /*! forward kinematics of the end effector, see forward_kinematics below */
+    bool forward_kinematics(bool left, const double *q,
+			    double *x, double *y, double *z,
+			    double *alpha, double *beta, double *gamma) const;
+
+  private:
+
+    friend boost::shared_ptr<const robot_model> get_robot_model();
+    robot_model(robot_kinematics *robot);
+    robot_kinematics *robot;
+
+  };
+
+
+  /*! the model of the robot, parsed on first call */
+  boost::shared_ptr<const robot_model> get_robot_model();
+
+
 
   /**
    * performs forward kinematics for the specified end effector
@@ -49,4 +105,10 @@ namespace playful_kinematics {
 			  double *x, double *y, double *z,
 			  double *alpha, double *beta, double *gamma);
 
+  /**
+   * returns the number of joints of the kinematic chain of the specified end effector
+   * @param left left end effector if true, right end effector otherwise
+   */
+  int get_nb_joints(bool left);
+
 }
@@ -0,0 +1,49 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <string>
+#include <iostream>
+#include "playful_kinematics/fk_simd.h"
+
+namespace playful_kinematics {
+
+
+  /**
+   * Writes a C++ header with the forward kinematics of the chain fully unrolled:
+   * no loop, the fixed transforms of the urdf folded into literal constants, terms
+   * multiplied by 0 removed (i.e. joints with an axis along x, y or z only compute
+   * the 4 non trivial entries of their rotation). The header defines, in the namespace
+   * playful_kinematics::generated::name:
+   *  constexpr int NB_DOFS
+   *  void forward_kinematics(const double *q, double *get_position, double *get_rotation)
+   *  void jacobian(const double *q, double *get_position, double *get_rotation, double *get_jacobian)
+   * (rotation row major, jacobian 6*NB_DOFS row major: linear velocity of the end
+   * effector then angular velocity, in the base frame, as KDL::ChainJntToJacSolver).
+   * Used at build time by playful_kinematics_fk_code_generator (see the
+   * playful_kinematics_generate_fk function of CMakeLists.txt).
+   * @param name namespace of the generated functions, a C++ identifier
+   * @param source written in the header comment (e.g. urdf and links)
+   * @param jacobian if false, the jacobian function is not generated
+   */
+  bool generate_fk_header(const flat_chain &chain, const std::string &name,
+			  const std::string &source, bool jacobian, std::ostream &out);
+
+
+}
@@ -0,0 +1,130 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "playful_kinematics/fk.h"
+
+namespace playful_kinematics {
+
+
+  enum posture_sampling {
+    UNIFORM_SAMPLING = 0,
+    SOBOL_SAMPLING = 1,
+    HALTON_SAMPLING = 2
+  };
+
+
+  /**
+   * Samples postures within joint limits. The posture of a given index
+   * does not depend on previously sampled postures, so that several threads
+   * may sample disjoint ranges of indexes (and the result does not depend on
+   * the number of threads).
+   * Sobol and Halton sampling are supported up to 16 joints.
+   */
+  class posture_sampler {
+
+  public:
+
+    posture_sampler(posture_sampling sampling,
+		    const std::vector<double> &min,
+		    const std::vector<double> &max,
+		    uint64_t seed=0);
+
+    /*! writes posture number index in get_posture (nb joints values) */
+    void sample(uint64_t index, double *get_posture) const;
+
+    int get_nb_joints() const;
+    posture_sampling get_sampling() const;
+    uint64_t get_seed() const;
+    const std::vector<double>& get_min() const;
+    const std::vector<double>& get_max() const;
+
+  private:
+
+    double _unit(uint64_t index, int dimension) const;
+
+    posture_sampling sampling;
+    std::vector<double> min;
+    std::vector<double> max;
+    uint64_t seed;
+    std::vector< std::vector<uint32_t> > sobol_directions;
+
+  };
+
+
+  /*
+   * Dataset file format, meant to be memory mapped (e.g. numpy.memmap)
+   * without parsing:
+   *  - header of FK_DATASET_DATA_OFFSET bytes: the fk_dataset_header (little endian int64),
+   *    followed at byte 128 by the min then max joint limits (float64, nb_joints each)
+   *  - data: nb_chunks chunks of nb_columns*chunk_size float32. Chunks are columnar:
+   *    the chunk_size values of column 0, then of column 1, etc.
+   *    Columns are the nb_joints joints values, then x, y, z, alpha, beta, gamma.
+   *    i.e. data is a float32 array of shape (nb_chunks, nb_columns, chunk_size).
+   *    Only the first nb_samples samples are valid (the last chunk is padded).
+   *    Failed forward kinematics are stored as NaN.
+   * scripts/playful_kinematics/fk_dataset.py loads such files.
+   */
+
+  static const int64_t FK_DATASET_MAGIC = 0x315344464b50; // "PKFDS1"
+  static const int64_t FK_DATASET_DATA_OFFSET = 4096;
+
+  struct fk_dataset_header {
+    int64_t magic;
+    int64_t version;
+    int64_t nb_samples;
+    int64_t nb_joints;
+    int64_t nb_columns;
+    int64_t chunk_size;
+    int64_t nb_chunks;
+    int64_t data_offset;
+    int64_t left;
+    int64_t sampling;
+    int64_t seed;
+  };
+
+
+  /*! called regularly by generate_fk_dataset. returning false cancels the generation */
+  typedef bool (*fk_dataset_progress)(long nb_written, long nb_samples, void *user_data);
+
+
+  /**
+   * samples nb_samples postures, computes their forward kinematics in parallel and
+   * streams them to the file at path (see format above). Memory usage is bounded to
+   * one chunk per thread, whatever the number of samples.
+   * @param path file to write (overwritten)
+   * @param left left end effector if true, right end effector otherwise
+   * @param sampler posture sampler
+   * @param nb_samples number of samples
+   * @param chunk_size number of samples per chunk
+   * @param nb_threads 0 for the number of cores
+   * @param progress if not NULL, called after each chunk written
+   * @param user_data passed to progress
+   * @return false if the file could not be written, or the generation was cancelled
+   */
+  bool generate_fk_dataset(const std::string &path, bool left,
+			   const posture_sampler &sampler,
+			   long nb_samples, int chunk_size=65536,
+			   int nb_threads=0,
+			   fk_dataset_progress progress=NULL, void *user_data=NULL);
+
+}
@@ -0,0 +1,42 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+namespace playful_kinematics {
+
+
+  /**
+   * Forward kinematics with the code generated at build time from the urdf and the
+   * links specified in the CMakeLists.txt (see fk_codegen.h): same parameters and
+   * results as forward_kinematics of fk.h, without walking the KDL chain.
+   * (the number of joints of the generated code is checked against NB_JOINTS at compile time)
+   */
+  bool generated_forward_kinematics(bool left, const double *q,
+				    double *x, double *y, double *z,
+				    double *alpha, double *beta, double *gamma);
+
+  /**
+   * Jacobian of the end effector at the posture q, with the generated code.
+   * @param get_jacobian 6*NB_JOINTS values, row major: linear velocity (x,y,z) then
+   *        angular velocity, in the base frame (as KDL::ChainJntToJacSolver)
+   */
+  bool generated_jacobian(bool left, const double *q, double *get_jacobian);
+
+
+}
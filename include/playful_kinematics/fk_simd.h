@@ -0,0 +1,185 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <kdl/chain.hpp>
+#include "playful_kinematics/fixed_posture.h"
+
+namespace playful_kinematics {
+
+
+  enum flat_joint_type {
+    REVOLUTE_JOINT = 0,
+    PRISMATIC_JOINT = 1
+  };
+
+
+  /**
+   * joint of a flat chain, followed by the fixed transform to the next joint
+   * (the frames of fixed segments are merged into the transform).
+   * Transform of the joint at position q (as KDL::Joint::pose):
+   *  revolute: rotation of q around the axis (unit), then translation by origin
+   *  prismatic: translation by origin + q*axis
+   */
+  class flat_joint {
+
+  public:
+
+    int type;
+    double axis[3];
+    double origin[3];
+    /*! fixed transform to the next joint, rotation row major */
+    double rotation[9];
+    double position[3];
+
+  };
+
+
+  /**
+   * Kinematic chain as a flat array of joints, evaluated without the KDL frame
+   * and segment objects, for several postures at once (see forward_kinematics_lanes).
+   * Joints are assumed to have a scale of 1 and no offset, as created by kdl_parser.
+   */
+  class flat_chain {
+
+  public:
+
+    /*! empty chain (identity) */
+    flat_chain();
+
+    flat_chain(const KDL::Chain &chain);
+
+    /*! appends a joint at the end of the chain, see flat_joint */
+    void add_joint(int type, const double *axis, const double *origin);
+
+    /*! appends a fixed transform (rotation row major) at the end of the chain */
+    void add_fixed(const double *rotation, const double *position);
+
+    int get_nb_joints() const;
+
+    /**
+     * same chain, the joints j for which fold[j] is true being replaced by the
+     * constant transform of their position q[j] (e.g. joints which are not moved
+     * by inverse kinematics). The joints of the returned chain are the other ones,
+     * in the same order.
+     */
+    flat_chain fold_joints(const std::vector<bool> &fold, const double *q) const;
+
+    /*! base transform, fixed segments before the first joint */
+    double base_rotation[9];
+    double base_position[3];
+
+    /*! to be modified via add_joint and add_fixed only (coefficients are updated) */
+    std::vector<flat_joint> joints;
+
+    /**
+     * per joint, the transform of the segment (joint and fixed transform) as
+     * constant + cos(q)*c1 + sin(q)*c2 (revolute) or constant + q*c1 (prismatic):
+     * 3 rotations then 3 positions, see fk_simd_kernel.h
+     */
+    std::vector<double> coefficients;
+    static const int NB_COEFFICIENTS = 36;
+
+  private:
+
+    void _update_coefficients(int index);
+
+  };
+
+
+  /*! instruction sets of forward_kinematics_lanes */
+  enum simd_level {
+    SIMD_SCALAR = 0,
+    SIMD_AVX2 = 1,
+    SIMD_AVX512 = 2,
+    SIMD_AUTO = 3
+  };
+
+
+  /*! the best instruction set supported by the running machine (and the build) */
+  simd_level get_simd_level();
+
+  /*! number of postures evaluated together by the instruction set */
+  int get_simd_lanes(simd_level level);
+
+  std::string get_simd_name(simd_level level);
+
+
+  /**
+   * forward kinematics of nb_postures postures of the chain, each SIMD lane
+   * evaluating a different posture (4 postures at once for AVX2, 8 for AVX-512,
+   * with double precision). Arrays are in structure of arrays layout: value v of
+   * posture i at [v*nb_postures+i].
+   * @param q nb_joints values per posture
+   * @param get_positions 3 values (x,y,z) per posture
+   * @param get_rotations 9 values (rotation matrix, row major) per posture
+   * @param level SIMD_AUTO for get_simd_level(). Falls back to the best supported
+   *        instruction set if not supported.
+   */
+  void forward_kinematics_lanes(const flat_chain &chain, int nb_postures,
+				const double *q,
+				double *get_positions, double *get_rotations,
+				simd_level level=SIMD_AUTO);
+
+
+  /**
+   * forward kinematics of one posture of a chain of N joints, the loop over the joints
+   * having a constant bound (see fixed_posture.h). Instantiated for N from 1 to MAX_FIXED_DOFS.
+   * @param q N values
+   * @param get_position x,y,z
+   * @param get_rotation rotation matrix, row major
+   */
+  template<int N>
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation);
+
+
+  /*! same as above, for a chain of any number of joints (uses forward_kinematics<N>
+      for the number of joints of the chain if it is instantiated) */
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation);
+
+
+  /**
+   * same as forward_kinematics<N>, also writing the position of the frame at the end of
+   * each segment (the link moved by joint j, up to the next joint, fixed transforms included),
+   * computed by the same pass, e.g. the position of the elbow of an arm.
+   * Instantiated for N from 1 to MAX_FIXED_DOFS.
+   * @param get_frame_positions 3*N values, x,y,z of the frame of segment j at [j*3]
+   *        (the frame of the last segment being the end effector)
+   */
+  template<int N>
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation,
+			  double *get_frame_positions);
+
+
+  /*! same as above, for a chain of any number of joints */
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation,
+			  double *get_frame_positions);
+
+
+  /*! roll, pitch, yaw of the rotation (row major), as KDL::Rotation::GetRPY */
+  void get_rpy(const double *rotation, double *roll, double *pitch, double *yaw);
+
+
+}
@@ -0,0 +1,207 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Kernel of forward_kinematics_lanes (fk_simd.h), templated over the lane type:
+// double for the scalar path, GCC vectors of 4 or 8 doubles for the AVX2 and
+// AVX-512 paths. Each instance is compiled in its own translation unit with
+// the corresponding instruction set (see CMakeLists.txt), and selected at run time.
+// Not part of the interface.
+
+
+#pragma once
+
+#include <cstring>
+#include "playful_kinematics/fk_simd.h"
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  // internal linkage: each translation unit keeps the instances compiled
+  // with its own instruction set
+  namespace {
+
+
+  typedef double v4d __attribute__((vector_size(32)));
+  typedef double v8d __attribute__((vector_size(64)));
+
+
+  template<class V, int W>
+  class lanes {
+  public:
+    static inline V set(double d){ V v; for(int i=0;i<W;i++) v[i]=d; return v; }
+    static inline V load(const double *d){ V v; memcpy(&v,d,sizeof(V)); return v; }
+    static inline void store(double *d, const V &v){ memcpy(d,&v,sizeof(V)); }
+  };
+
+  template<>
+  class lanes<double,1> {
+  public:
+    static inline double set(double d){ return d; }
+    static inline double load(const double *d){ return *d; }
+    static inline void store(double *d, const double &v){ *d=v; }
+  };
+
+
+  // round to nearest integer (|x|<2^51), without branches nor conversions
+  template<class V>
+  static inline V _round(const V &x){
+    const double magic = 6755399441055744.0;
+    return (x+magic)-magic;
+  }
+
+
+  // sine and cosine of each lane, without branches. Reduction to [-pi/4,pi/4]
+  // with pi/2 in two parts (exact for |x|<2^20), and minimax polynomials of cephes.
+  // About 1 ulp on the range of joint angles.
+  template<class V, int W>
+  static inline void _sincos(const V &x, V &get_sin, V &get_cos){
+
+    const double two_over_pi = 6.36619772367581382433e-01;
+    const double pio2_1 = 1.57079632673412561417e+00;
+    const double pio2_1t = 6.07710050650619224932e-11;
+
+    V k = _round(x*two_over_pi);
+    V r = (x-k*pio2_1)-k*pio2_1t;
+    V z = r*r;
+
+    V s = r + r*z*(((((1.58962301576546568060e-10*z
+		       -2.50507477628578072866e-8)*z
+		      +2.75573136213857245213e-6)*z
+		     -1.98412698295895385996e-4)*z
+		    +8.33333333332211858878e-3)*z
+		   -1.66666666666666307295e-1);
+
+    V c = 1.0 - 0.5*z + z*z*(((((-1.13585365213876817300e-11*z
+				 +2.08757008419747316778e-9)*z
+				-2.75573141792967388112e-7)*z
+			       +2.48015872888517045348e-5)*z
+			      -1.38888888888730564116e-3)*z
+			     +4.16666666666665929218e-2);
+
+    // quadrant q = k mod 4, as hi*2+odd
+    V q = k - 4.0*_round(k*0.25-0.375);
+    V hi = _round(q*0.5-0.25);
+    V odd = q-2.0*hi;
+    V even = 1.0-odd;
+
+    get_sin = (1.0-2.0*hi) * (odd*c+even*s);
+    get_cos = (1.0-2.0*(hi+odd-2.0*hi*odd)) * (odd*s+even*c);
+
+  }
+
+
+  // forward kinematics of W postures (posture i of the lane group at q[j*stride+i]).
+  // NB: number of joints of the chain if known at compile time, 0 otherwise.
+  // FRAMES: the position of the frame at the end of each segment j is also written,
+  // at get_frames[(j*3+k)*stride+i]
+  template<class V, int W, int NB=0, bool FRAMES=false>
+  static inline void _forward_kinematics_lanes(const flat_chain &chain, int stride,
+					       const double *q,
+					       double *get_positions, double *get_rotations,
+					       double *get_frames=NULL){
+
+    typedef lanes<V,W> L;
+
+    V R[9];
+    V p[3];
+    for(int i=0;i<9;i++) R[i] = L::set(chain.base_rotation[i]);
+    for(int i=0;i<3;i++) p[i] = L::set(chain.base_position[i]);
+
+    const double *coefficients = chain.coefficients.data();
+
+    const int nb_joints = NB>0 ? NB : chain.joints.size();
+
+    for(int j=0;j<nb_joints;j++){
+
+      const double *m = coefficients+j*flat_chain::NB_COEFFICIENTS;
+      V qj = L::load(q+j*stride);
+
+      // transform of the segment: rotation Rs and position ps
+      V Rs[9];
+      V ps[3];
+
+      if(chain.joints[j].type==REVOLUTE_JOINT){
+	V s,c;
+	_sincos<V,W>(qj,s,c);
+	for(int i=0;i<9;i++) Rs[i] = m[i] + c*m[9+i] + s*m[18+i];
+	for(int i=0;i<3;i++) ps[i] = m[27+i] + c*m[30+i] + s*m[33+i];
+      } else {
+	for(int i=0;i<9;i++) Rs[i] = L::set(m[i]);
+	for(int i=0;i<3;i++) ps[i] = m[27+i] + qj*m[30+i];
+      }
+
+      // (R,p) <- (R*Rs, R*ps+p)
+      V Rn[9];
+      for(int r=0;r<3;r++){
+	for(int c=0;c<3;c++){
+	  Rn[r*3+c] = R[r*3]*Rs[c] + R[r*3+1]*Rs[3+c] + R[r*3+2]*Rs[6+c];
+	}
+	p[r] = p[r] + R[r*3]*ps[0] + R[r*3+1]*ps[1] + R[r*3+2]*ps[2];
+      }
+      for(int i=0;i<9;i++) R[i]=Rn[i];
+
+      if(FRAMES){
+	for(int i=0;i<3;i++) L::store(get_frames+(j*3+i)*stride,p[i]);
+      }
+
+    }
+
+    for(int i=0;i<3;i++) L::store(get_positions+i*stride,p[i]);
+    for(int i=0;i<9;i++) L::store(get_rotations+i*stride,R[i]);
+
+  }
+
+
+  // forward kinematics of all postures, by groups of W, the remaining postures
+  // one by one
+  template<class V, int W>
+  static inline void _forward_kinematics_all(const flat_chain &chain, int nb_postures,
+					     const double *q,
+					     double *get_positions, double *get_rotations){
+
+    int i=0;
+    for(;i+W<=nb_postures;i+=W){
+      _forward_kinematics_lanes<V,W>(chain,nb_postures,q+i,get_positions+i,get_rotations+i);
+    }
+    for(;i<nb_postures;i++){
+      _forward_kinematics_lanes<double,1>(chain,nb_postures,q+i,get_positions+i,get_rotations+i);
+    }
+
+  }
+
+
+  }
+
+
+  // instances compiled with the corresponding instruction set (fk_simd_avx2.cpp, fk_simd_avx512.cpp)
+  void _forward_kinematics_avx2(const flat_chain &chain, int nb_postures,
+				const double *q,
+				double *get_positions, double *get_rotations);
+
+  void _forward_kinematics_avx512(const flat_chain &chain, int nb_postures,
+				  const double *q,
+				  double *get_positions, double *get_rotations);
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+}
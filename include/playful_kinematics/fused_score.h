@@ -0,0 +1,368 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <iostream>
+#include "playful_kinematics/fk_simd.h"
+#include "playful_kinematics/score_functions.h"
+#include "playful_kinematics/kinematic_config.h"
+#include "playful_kinematics/soma.h"
+
+
+namespace playful_kinematics {
+
+
+  /**
+   * terms of fused_score, combined as its TERMS template parameter,
+   * e.g. POSE_TERM|POSTURE_TERM
+   */
+  enum score_term {
+    /*! masked distance of the end effector to the target, as at_desired_cartesian_position */
+    POSE_TERM = 1,
+    /*! squared distance of the posture to a reference posture */
+    POSTURE_TERM = 2,
+    /*! penalty of the joints closer to their limits than a margin */
+    LIMIT_TERM = 4,
+    /*! penalty of the links closer to a segment (e.g. the axis of the body) than a distance */
+    LINK_TERM = 8
+  };
+
+
+  /**
+   * penalty of the frame at the end of the segment of joint `joint` (see the frames
+   * of forward_kinematics in fk_simd.h, e.g. the elbow of an arm) when closer than
+   * min_distance to the segment [a,b] (a point if a==b): weight*((min_distance-d)/min_distance)^2
+   */
+  class link_penalty {
+  public:
+    int joint;
+    double a[3];
+    double b[3];
+    double min_distance;
+    float weight;
+  };
+
+
+  /*! values of each term of fused_score (weighted), see fused_score::get_terms */
+  class fused_score_terms {
+  public:
+    fused_score_terms() : pose(0), posture(0), limit(0), link(0) {}
+    float pose;
+    float posture;
+    float limit;
+    float link;
+  };
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+  // forward kinematics of fused_score, for chains of NB joints (0: any number of joints),
+  // the frames being computed if get_frames is not NULL
+  template<int NB>
+  class _fused_forward_kinematics {
+  public:
+    static inline void run(const flat_chain &chain, const double *q,
+			   double *get_position, double *get_rotation, double *get_frames){
+      if(get_frames) forward_kinematics<NB>(chain,q,get_position,get_rotation,get_frames);
+      else forward_kinematics<NB>(chain,q,get_position,get_rotation);
+    }
+  };
+
+  template<>
+  class _fused_forward_kinematics<0> {
+  public:
+    static inline void run(const flat_chain &chain, const double *q,
+			   double *get_position, double *get_rotation, double *get_frames){
+      if(get_frames) forward_kinematics(chain,q,get_position,get_rotation,get_frames);
+      else forward_kinematics(chain,q,get_position,get_rotation);
+    }
+  };
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  /**
+   * Score with secondary objectives, as the weighted sum of the terms TERMS (see score_term):
+   *   pose_weight * (masked distance to the target, as cartesian_score)
+   *   + posture_weight * sum_i (q_i-reference_i)^2
+   *   + limit_weight * sum_i ((margin-d_i)/margin)^2, d_i distance of joint i to its closest limit (if < margin)
+   *   + link penalties (see link_penalty)
+   * All terms share one forward kinematics pass of the flat chain of the end effector per
+   * posture (the frames of the links being computed by the same pass, LINK_TERM only).
+   * Terms not in TERMS are not compiled in the score, and their setters do not compile.
+   * As cartesian_score, to be used with the templated minimize functions (see soma.h) or with
+   * ik below. The weights of the secondary terms should be small compared to the pose weight,
+   * the minimization trading pose accuracy for the secondary objectives otherwise.
+   * Postures of fixed size (fixed_posture<N>) are scored without heap allocation.
+   */
+  template<int TERMS=POSE_TERM>
+  class fused_score {
+
+  public:
+
+    fused_score(bool left, const std::vector<bool> &mask,
+		float x, float y, float z,
+		float alpha, float beta, float gamma)
+      : pose(left,mask,x,y,z,alpha,beta,gamma),
+	chain(&get_robot_model()->get_flat_chain(left)),
+	pose_weight(1), posture_weight(0), limit_margin(0), limit_weight(0) {}
+
+    /*! changes side, mask and target. The chain is set back to the chain of the end effector */
+    void set_target(bool left, const std::vector<bool> &mask,
+		    float x, float y, float z,
+		    float alpha, float beta, float gamma){
+      this->pose.set_target(left,mask,x,y,z,alpha,beta,gamma);
+      this->chain = &get_robot_model()->get_flat_chain(left);
+    }
+
+    /*! scores postures with the forward kinematics of this chain (not copied) rather than the
+        one of the end effector, e.g. a chain built with flat_chain::add_joint */
+    void set_chain(const flat_chain *chain){
+      this->chain = chain;
+    }
+
+    void set_pose_weight(float weight){
+      this->pose_weight = weight;
+    }
+
+    void set_posture_term(const std::vector<float> &reference, float weight){
+      static_assert(TERMS & POSTURE_TERM,"playful kinematics: fused_score without POSTURE_TERM");
+      this->reference = reference;
+      this->posture_weight = weight;
+    }
+
+    /*! joints with min>=max (frozen or not limited) are not penalized */
+    void set_limit_term(const std::vector<float> &min, const std::vector<float> &max,
+			float margin, float weight){
+      static_assert(TERMS & LIMIT_TERM,"playful kinematics: fused_score without LIMIT_TERM");
+      this->min = min;
+      this->max = max;
+      this->limit_margin = margin;
+      this->limit_weight = weight;
+    }
+
+    void add_link_penalty(const link_penalty &penalty){
+      static_assert(TERMS & LINK_TERM,"playful kinematics: fused_score without LINK_TERM");
+      this->links.push_back(penalty);
+    }
+
+    void clear_link_penalties(){
+      this->links.clear();
+    }
+
+    template<class Posture>
+    float operator()(const Posture &posture){
+      fused_score_terms terms;
+      return this->get_terms(posture,terms);
+    }
+
+    /*! score of the posture, and the value of each (weighted) term */
+    template<class Posture>
+    float get_terms(const Posture &posture, fused_score_terms &get_terms){
+      int nb_joints = posture.size();
+      if(this->q.size()!=nb_joints) this->q.resize(nb_joints);
+      for(int i=0;i<nb_joints;i++) this->q[i]=posture[i];
+      if(TERMS & LINK_TERM){
+	if(this->frames.size()!=3*nb_joints) this->frames.resize(3*nb_joints);
+      }
+      return this->_evaluate<0>(this->q.data(),nb_joints,this->frames.data(),get_terms);
+    }
+
+    template<int N>
+    float get_terms(const fixed_posture<N> &posture, fused_score_terms &get_terms){
+      double q[N];
+      double frames[(TERMS & LINK_TERM) ? 3*N : 1];
+      for(int i=0;i<N;i++) q[i]=posture[i];
+      return this->_evaluate<N>(q,N,frames,get_terms);
+    }
+
+    /*! masked distance of the end effector to the target, regardless of the other terms
+        (e.g. to check if the posture found by a minimization reaches the target) */
+    template<class Posture>
+    float get_pose_error(const Posture &posture){
+      int nb_joints = posture.size();
+      if(this->chain==NULL || this->chain->get_nb_joints()!=nb_joints) return std::numeric_limits<float>::max();
+      if(this->q.size()!=nb_joints) this->q.resize(nb_joints);
+      for(int i=0;i<nb_joints;i++) this->q[i]=posture[i];
+      double position[3];
+      double rotation[9];
+      forward_kinematics(*this->chain,this->q.data(),position,rotation);
+      return this->pose.evaluate(position,rotation);
+    }
+
+    /*! bytes allocated on the heap by the score */
+    size_t get_heap_footprint() const {
+      return this->pose.get_heap_footprint()
+	+ (this->reference.capacity()+this->min.capacity()+this->max.capacity())*sizeof(float)
+	+ this->links.capacity()*sizeof(link_penalty)
+	+ (this->q.capacity()+this->frames.capacity())*sizeof(double);
+    }
+
+  private:
+
+    // NB: number of joints if known at compile time, 0 otherwise
+    template<int NB>
+    float _evaluate(const double *q, int nb_joints, double *frames, fused_score_terms &get_terms){
+
+      if(this->chain==NULL || this->chain->get_nb_joints()!=nb_joints){
+	std::cerr << "playful kinematics: fused_score: posture of " << nb_joints << " joints for a chain of "
+		  << (this->chain ? this->chain->get_nb_joints() : 0) << " joints" << std::endl;
+	return std::numeric_limits<float>::max();
+      }
+
+      double position[3];
+      double rotation[9];
+
+      // frames of the links: computed by the same pass, LINK_TERM only
+      _fused_forward_kinematics<NB>::run(*this->chain,q,position,rotation,
+					 (TERMS & LINK_TERM) ? frames : NULL);
+
+      float score = 0;
+
+      if(TERMS & POSE_TERM){
+	get_terms.pose = this->pose_weight*this->pose.evaluate(position,rotation);
+	score += get_terms.pose;
+      }
+
+      if(TERMS & POSTURE_TERM){
+	float sum = 0;
+	for(int i=0;i<nb_joints && i<this->reference.size();i++){
+	  float d = q[i]-this->reference[i];
+	  sum += d*d;
+	}
+	get_terms.posture = this->posture_weight*sum;
+	score += get_terms.posture;
+      }
+
+      if(TERMS & LIMIT_TERM){
+	float sum = 0;
+	for(int i=0;i<nb_joints && i<this->min.size() && i<this->max.size();i++){
+	  if(this->min[i]>=this->max[i]) continue;
+	  float d = std::min(q[i]-this->min[i],this->max[i]-q[i]);
+	  if(d<this->limit_margin){
+	    float r = (this->limit_margin-std::max(d,0.0f))/this->limit_margin;
+	    sum += r*r;
+	  }
+	}
+	get_terms.limit = this->limit_weight*sum;
+	score += get_terms.limit;
+      }
+
+      if(TERMS & LINK_TERM){
+	float sum = 0;
+	for(int l=0;l<this->links.size();l++){
+	  const link_penalty &link = this->links[l];
+	  if(link.joint<0 || link.joint>=nb_joints) continue;
+	  double d = _distance_to_segment(frames+3*link.joint,link.a,link.b);
+	  if(d<link.min_distance){
+	    double r = (link.min_distance-d)/link.min_distance;
+	    sum += link.weight*r*r;
+	  }
+	}
+	get_terms.link = sum;
+	score += get_terms.link;
+      }
+
+      return score;
+
+    }
+
+    static double _distance_to_segment(const double *p, const double *a, const double *b){
+      double ab[3], ap[3];
+      double ab2 = 0, t = 0;
+      for(int i=0;i<3;i++){
+	ab[i] = b[i]-a[i];
+	ap[i] = p[i]-a[i];
+	ab2 += ab[i]*ab[i];
+	t += ab[i]*ap[i];
+      }
+      t = ab2>0 ? std::min(1.0,std::max(0.0,t/ab2)) : 0;
+      double d2 = 0;
+      for(int i=0;i<3;i++){
+	double d = ap[i]-t*ab[i];
+	d2 += d*d;
+      }
+      return sqrt(d2);
+    }
+
+    cartesian_score pose;
+    const flat_chain *chain;
+    float pose_weight;
+    std::vector<float> reference;
+    float posture_weight;
+    std::vector<float> min;
+    std::vector<float> max;
+    float limit_margin;
+    float limit_weight;
+    std::vector<link_penalty> links;
+    std::vector<double> q;
+    std::vector<double> frames;
+
+  };
+
+
+  /**
+   * inverse kinematics with a fused score (its target set by the caller), the posture
+   * starting from the reference posture of the plan, with the limits, minimization
+   * order, line search and SOMA parameters of the solver profile of the plan (the mask
+   * and target of the plan are not used, the minimization always uses SOMA).
+   * As the secondary terms keep the score above 0, the minimization runs until its steps
+   * are exhausted rather than stopping once the target is reached.
+   * @param get_posture std::vector<float> or fixed_posture<N> of the number of joints of the plan
+   * @param get_score score of the posture found (all terms)
+   * @return true if the pose error of the posture found (see fused_score::get_pose_error)
+   *         is below the target score of the profile, as ik in ik.h
+   */
+  template<int TERMS, class Posture>
+  bool ik(const ik_plan &plan, fused_score<TERMS> &score,
+	  Posture &get_posture, float &get_score){
+
+    PLAYFUL_KINEMATICS_TRACE("ik");
+
+    if(get_posture.size()!=plan.reference_posture.size()){
+      std::cerr << "playful kinematics: inverse kinematics for " << get_posture.size()
+		<< " joints called with a plan for " << plan.reference_posture.size() << " joints" << std::endl;
+      get_score = std::numeric_limits<float>::max();
+      return false;
+    }
+
+    Posture min(get_posture);
+    Posture max(get_posture);
+    for(int i=0;i<get_posture.size();i++){
+      get_posture[i] = is_frozen(plan,i) ? plan.min[i] : plan.reference_posture[i];
+      min[i] = plan.min[i];
+      max[i] = plan.max[i];
+    }
+
+    const solver_profile &profile = plan.profile;
+    playful_kinematics::minimize(get_posture,
+				 plan.minimization_order,
+				 min,max,
+				 profile.target_score,profile.max_step,profile.min_step,
+				 profile.max_iteration,score,get_score,plan.search);
+
+    return score.get_pose_error(get_posture)<=profile.target_score;
+
+  }
+
+
+}
@@ -19,6 +19,7 @@
 #pragma once
 #include "playful_kinematics/soma.h"
 #include "playful_kinematics/score_functions.h"
+#include "playful_kinematics/posture_atlas.h"
 
 
 namespace playful_kinematics {
@@ -61,4 +62,127 @@ namespace playful_kinematics {
 	  float target_yaw, float target_pitch, float target_roll, 
 	  std::vector<float> &get_posture,float &get_score);
 
+  /**
+   * performs inverse kinematics for the specified end effector, using
+   * the configuration passed as arguments rather than the one set via
+   * the functions of kinematic_config.h. This function does not read
+   * or modify any shared configuration, so several threads may call
+   * it concurrently.
+   * If an atlas has been set for the end effector (see posture_atlas.h), minimization
+   * starts from the best of the reference posture and of the closest postures of the atlas.
+   * @param left left end effector if true, right end effector otherwise
+   * @param mask dimensions (x,y,z,alpha,beta,gamma) taken into account
+   * @param reference_posture posture from which minimization will be performed
+   * @param minimization_priority priority of each joint, see set_minimization_priority
+   * @param min min limit of the joints
+   * @param max max limit of the joints
+   * @param target_x x position the end effector should reach
+   * @param target_y y position the end effector should reach
+   * @param target_z z position the end effector should reach
+   * @param target_alpha first orientation angle the end effector should reach
+   * @param target_beta second orientation angle the end effector should reach
+   * @param target_gamma third orientation angle the end effector should reach
+   * @param get_posture joint positions corresponding of the end-effector reaching the desired cartesian position
+   * @param get_score how close the end effector is to the desired position. The lower the score the better.
+   * @param search line search used by the minimization, see soma.h
+   * @param profile engine and parameters of the minimization, see solver_profile.h. The
+   *        CMA-ES engine searching within limits, joints without min or max are then kept
+   *        at their reference value
+   */
+  bool ik(bool left, const std::vector<bool> &mask,
+	  const std::vector<float> &reference_posture,
+	  const std::vector<int> &minimization_priority,
+	  const std::map<int,float> &min,
+	  const std::map<int,float> &max,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  std::vector<float> &get_posture,float &get_score,
+	  line_search search=FIXED_STEP_LINE_SEARCH,
+	  const solver_profile &profile=get_default_solver_profile());
+
+
+  /**
+   * performs inverse kinematics for the end effector and with the configuration
+   * of the plan (see get_ik_plan in kinematic_config.h). The plan carrying the
+   * minimization order and the limits already computed, no setup is performed
+   * per call. As the plan is immutable, several threads may use it concurrently.
+   * The minimization runs with the solver profile of the plan (see solver_profile.h):
+   * to solve one call with other parameters, solve with a copy of the plan with another profile.
+   * @param plan compiled configuration
+   * @param get_posture joint positions corresponding of the end-effector reaching the desired cartesian position
+   * @param get_score how close the end effector is to the desired position. The lower the score the better.
+   */
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  std::vector<float> &get_posture,float &get_score);
+
+  /**
+   * same as above, using workspace as score (its target is set by this function)
+   * rather than allocating a new one, e.g. to keep one workspace per robot
+   * instance (see robot_instance.h)
+   */
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  cartesian_score &workspace,
+	  std::vector<float> &get_posture,float &get_score);
+
+
+  /**
+   * same as above, for end effectors of N joints: the posture, its limits and the cache
+   * of scores of the minimization are on the stack (see fixed_posture.h), and scores are
+   * computed with forward_kinematics<N> (see fk_simd.h). Instantiated for 1 to MAX_FIXED_DOFS
+   * joints. Returns false if the plan is not for N joints.
+   */
+  template<int N>
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  fixed_posture<N> &get_posture,float &get_score);
+
+  /*! see above */
+  template<int N>
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  cartesian_score &workspace,
+	  fixed_posture<N> &get_posture,float &get_score);
+
+
+  /**
+   * performs inverse kinematics with the plan, the posture being an array of as
+   * many joints as the plan: uses the fixed size ik above for plans of up to MAX_FIXED_DOFS
+   * joints, and the std::vector one for larger plans.
+   * @param get_posture array of plan.reference_posture.size() joint positions
+   */
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  float *get_posture,float &get_score);
+
+  /*! see above */
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  cartesian_score &workspace,
+	  float *get_posture,float &get_score);
+
+
+  /**
+   * performs inverse kinematics with the plan, the minimization starting from start_posture
+   * (e.g. the posture solving a close target, to track a path, see ik_path.h) rather than from
+   * the reference posture of the plan or the postures of the atlas. Frozen joints are set to
+   * their value, the other joints are clamped to their limits.
+   * Uses fixed size postures for plans of up to MAX_FIXED_DOFS joints, as above.
+   * @param start_posture array of plan.reference_posture.size() joint positions,
+   *        may be the same array as get_posture
+   */
+  bool ik_from(const ik_plan &plan,
+	       float target_x, float target_y, float target_z, 
+	       float target_alpha, float target_beta, float target_gamma, 
+	       cartesian_score &workspace,
+	       const float *start_posture,
+	       float *get_posture,float &get_score);
+
 }
@@ -0,0 +1,99 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <map>
+#include "playful_kinematics/ik.h"
+
+namespace playful_kinematics {
+
+
+  /*! configuration shared by all the targets of a batch (see ik.h) */
+  class ik_batch_configuration {
+  public:
+    bool left;
+    std::vector<bool> mask;
+    std::vector<float> reference_posture;
+    std::vector<int> minimization_priority;
+    std::map<int,float> min;
+    std::map<int,float> max;
+  };
+
+
+  /*! called regularly from the thread running the batch.
+      returning false cancels the batch */
+  typedef bool (*ik_batch_progress)(long nb_solved, long nb_targets, void *user_data);
+
+
+  /**
+   * Solves a (large) batch of inverse kinematics targets over a pool of threads.
+   * Solve times vary a lot between targets, so each thread starts with a contiguous
+   * share of the targets and, once done, steals half of the remaining targets of the
+   * busiest thread (work stealing).
+   * Each thread runs its own solver context, i.e. solves do not share any state.
+   */
+  class ik_batch {
+
+  public:
+
+    /*! nb_threads: 0 for the number of cores.
+        work_stealing: if false, targets are statically split between threads */
+    ik_batch(const ik_batch_configuration &configuration,
+	     int nb_threads=0, bool work_stealing=true);
+
+    /*! same as above, with an already compiled configuration (see kinematic_config.h) */
+    ik_batch(boost::shared_ptr<const ik_plan> plan,
+	     int nb_threads=0, bool work_stealing=true);
+
+    /**
+     * solves all targets (blocking). Results are written in input order.
+     * @param targets 6 values (x,y,z,alpha,beta,gamma) per target
+     * @param get_postures nb joints values per target
+     * @param get_scores one score per target
+     * @param get_success one flag per target
+     * @param progress if not NULL, called about every progress_period_ms milliseconds
+     * @param user_data passed to progress
+     * @return number of targets solved (lower than the number of targets if cancelled)
+     */
+    long solve(const std::vector<float> &targets,
+	       std::vector<float> &get_postures,
+	       std::vector<float> &get_scores,
+	       std::vector<bool> &get_success,
+	       ik_batch_progress progress=NULL, void *user_data=NULL,
+	       int progress_period_ms=500);
+
+    /*! may be called from any thread. solve returns once the solves in progress are done */
+    void cancel();
+
+    int get_nb_threads() const;
+
+  private:
+
+    // configuration compiled once for all solves
+    boost::shared_ptr<const ik_plan> plan;
+    int nb_threads;
+    bool work_stealing;
+    std::atomic<bool> cancelled;
+
+  };
+
+
+}
@@ -0,0 +1,191 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "playful_kinematics/stats.h"
+#include "playful_kinematics/solver_profile.h"
+
+namespace playful_kinematics {
+
+
+  /**
+   * Regression corpus of inverse kinematics: seeded targets (reachable, borderline and
+   * unreachable, with various masks) together with their golden solutions (posture,
+   * score and number of score evaluations). Replaying the corpus through ik (or through
+   * KDL's ChainIkSolverPos_NR_JL, as a baseline) and comparing the report to the report of
+   * the golden solutions detects losses of accuracy and growths of the number of evaluations.
+   * See pepper_ik_corpus (src/ik_corpus_tool.cpp) and tests/ik_corpus_unit_tests.cpp.
+   */
+
+
+  /*! to be incremented when the generation of targets or the file format changes */
+  static const int IK_CORPUS_VERSION = 1;
+
+
+  enum ik_target_kind {
+    /*! forward kinematics of a posture within the joint limits */
+    REACHABLE_TARGET = 0,
+    /*! forward kinematics of a posture with all joints at a limit, pushed 1 cm further from the base */
+    BORDERLINE_TARGET = 1,
+    /*! forward kinematics of a posture within the joint limits, pushed 1 m further from the base */
+    UNREACHABLE_TARGET = 2
+  };
+
+  static const int NB_IK_TARGET_KINDS = 3;
+
+
+  /*! configuration of the inverse kinematics of one end effector */
+  class ik_corpus_side {
+  public:
+    std::vector<float> reference_posture;
+    std::vector<float> min;
+    std::vector<float> max;
+  };
+
+
+  /*! solution of a target */
+  class ik_corpus_result {
+  public:
+    ik_corpus_result() : success(false), score(0), nb_evaluations(0), latency(0) {}
+    bool success;
+    /*! NaN if the target was not solved (e.g. not supported by the KDL baseline) */
+    float score;
+    long nb_evaluations;
+    std::vector<float> posture;
+    /*! nano seconds. Machine dependent: not written in corpus files */
+    double latency;
+  };
+
+
+  class ik_corpus_entry {
+  public:
+    int kind;
+    bool left;
+    std::vector<bool> mask;
+    float target[6];
+    ik_corpus_result golden;
+  };
+
+
+  class ik_corpus {
+  public:
+    int version;
+    uint64_t seed;
+    std::vector<int> minimization_priority;
+    /*! index 1: left end effector, index 0: right end effector */
+    ik_corpus_side sides[2];
+    std::vector<ik_corpus_entry> entries;
+  };
+
+
+  /**
+   * replaces the entries of the corpus by nb_targets targets generated from seed, using
+   * the joint limits of the sides of the corpus (to be set beforehand). The golden results
+   * are not set (see replay_ik_corpus). Targets alternate kinds, end effectors and masks
+   * (all, position only, position and alpha).
+   */
+  void generate_ik_corpus(int nb_targets, uint64_t seed, ik_corpus &corpus);
+
+  /*! text file, floats written with enough digits to be read back exactly */
+  bool write_ik_corpus(const std::string &path, const ik_corpus &corpus);
+
+  bool read_ik_corpus(const std::string &path, ik_corpus &get_corpus);
+
+  /*! solves all targets with ik (see ik.h) from the reference posture of their end effector,
+      with the line search and solver profile (see solver_profile.h) */
+  void replay_ik_corpus(const ik_corpus &corpus, std::vector<ik_corpus_result> &get_results,
+			line_search search=FIXED_STEP_LINE_SEARCH,
+			const solver_profile &profile=get_default_solver_profile());
+
+  /**
+   * solves the targets of the corpus with KDL's ChainIkSolverPos_NR_JL, starting from the
+   * reference posture of their end effector. Only targets with a full mask are solved (the
+   * solver does not support masks), the others get a NaN score. Scores are cartesian scores
+   * (see score_functions.h), a target being solved if its score is below the target score of ik.
+   */
+  void replay_ik_corpus_kdl(const ik_corpus &corpus, std::vector<ik_corpus_result> &get_results,
+			    int max_iterations=100, double eps=1e-5);
+
+  /*! the golden results of the entries of the corpus */
+  void get_ik_corpus_golden(const ik_corpus &corpus, std::vector<ik_corpus_result> &get_results);
+
+  /*! sets the golden results of the entries of the corpus */
+  void set_ik_corpus_golden(const std::vector<ik_corpus_result> &results, ik_corpus &corpus);
+
+
+  class ik_corpus_report {
+
+  public:
+
+    ik_corpus_report();
+
+    /*! number of targets solved (score not NaN) */
+    int nb_solved;
+    int nb_success;
+    int nb_solved_per_kind[NB_IK_TARGET_KINDS];
+    int nb_success_per_kind[NB_IK_TARGET_KINDS];
+    /*! golden success, not anymore */
+    int nb_lost;
+    /*! score above the golden score plus the score tolerance */
+    int nb_worse;
+    sample_stats scores;
+    /*! micro seconds */
+    sample_stats latencies;
+    sample_stats evaluations;
+
+    double get_success_rate() const;
+    double get_success_rate(int kind) const;
+
+    /*! prints success rates, score, latency and evaluation distributions */
+    void print(const std::string &label);
+
+  };
+
+
+  class ik_corpus_tolerance {
+  public:
+    ik_corpus_tolerance()
+      : success_rate(0.005), score(1e-3), worse_rate(0.01), evaluations(0.1), check_evaluations(true) {}
+    /*! maximal drop of the success rate (overall and per kind) */
+    double success_rate;
+    /*! a score is worse if above the golden score plus this tolerance */
+    float score;
+    /*! maximal ratio of worse scores */
+    double worse_rate;
+    /*! maximal relative growth of the median and 99th percentile of evaluations */
+    double evaluations;
+    /*! if false, evaluations are only reported (e.g. golden results computed with
+        another build of the kinematic model, see golden_corpus in the unit tests) */
+    bool check_evaluations;
+  };
+
+
+  /*! report of the results of the entries of the corpus, compared to their golden results */
+  ik_corpus_report get_ik_corpus_report(const ik_corpus &corpus,
+					const std::vector<ik_corpus_result> &results,
+					const ik_corpus_tolerance &tolerance=ik_corpus_tolerance());
+
+  /*! false (reasons printed on std::cerr) if the report regressed compared to the golden report */
+  bool check_ik_corpus_report(ik_corpus_report &report, ik_corpus_report &golden,
+			      const ik_corpus_tolerance &tolerance=ik_corpus_tolerance());
+
+}
@@ -0,0 +1,122 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include "playful_kinematics/ik.h"
+
+namespace playful_kinematics {
+
+
+  /*! parameters of solve_ik_path */
+  class ik_path_parameters {
+
+  public:
+
+    ik_path_parameters()
+      : nb_threads(0), nb_segments(0), min_segment_length(32),
+	max_joint_step(0.05), warm_start_max_step(0.01) {}
+
+    /*! 0 for the number of cores */
+    int nb_threads;
+
+    /*! number of segments the path is split into, 0 for 4 per thread */
+    int nb_segments;
+
+    /*! segments are not shorter (fewer segments than nb_segments for short paths) */
+    int min_segment_length;
+
+    /*! largest change of a joint (radians) between two successive waypoints of a continuous
+        trajectory: larger changes are discontinuities */
+    float max_joint_step;
+
+    /*! SOMA: first step of the line search of the solves started from the posture of the
+        previous waypoint (if smaller than the max_step of the profile of the plan), so that
+        the posture moves no more than needed to follow the path */
+    float warm_start_max_step;
+
+  };
+
+
+  /*! what solve_ik_path did */
+  class ik_path_statistics {
+
+  public:
+
+    ik_path_statistics()
+      : nb_threads(0), nb_segments(0), nb_repaired_boundaries(0),
+	nb_blended_waypoints(0), nb_failures(0), nb_discontinuities(0) {}
+
+    int nb_threads;
+    int nb_segments;
+
+    /*! boundaries between segments at which the postures were discontinuous */
+    int nb_repaired_boundaries;
+
+    /*! waypoints solved again by the repair of the boundaries */
+    long nb_blended_waypoints;
+
+    /*! waypoints whose target was not reached */
+    long nb_failures;
+
+    /*! steps of the trajectory larger than max_joint_step, after repair */
+    long nb_discontinuities;
+
+  };
+
+
+  /**
+   * Inverse kinematics of a path of waypoints (e.g. the trajectory of a hand), as a continuous
+   * joint trajectory. Solving each waypoint from the posture of the previous one keeps the
+   * trajectory continuous but is serial: the path is instead split into segments solved in
+   * parallel. The first waypoint of each segment is solved as ik in ik.h (from the reference
+   * posture of the plan, or the atlas of the end effector if set, see posture_atlas.h), the other
+   * waypoints from the posture of the previous one (see ik_from in ik.h).
+   * Segments starting from another posture than the one the previous segment ends with, a repair
+   * pass then removes the discontinuities at the boundaries (in parallel, the boundaries being
+   * independent): the posture of the first waypoint of the segment is solved again from the last
+   * posture of the previous segment, and its difference with the posture found by the segment is
+   * reduced over the next waypoints, each one being solved again from its posture in the segment
+   * plus what is left of the difference, until the trajectory joins the postures of the segment.
+   * Differences a segment is too short to absorb are then reduced serially over the following
+   * segments. Continuity is not guaranteed (e.g. a solve jumping to another branch of the
+   * solutions): the steps larger than max_joint_step left are counted in the statistics.
+   * The plan is not modified, several paths may be solved concurrently.
+   * @param waypoints 6 values (x,y,z,alpha,beta,gamma) per waypoint, in path order
+   * @param get_postures nb joints values per waypoint
+   * @param get_scores one score per waypoint
+   * @param get_success one flag per waypoint
+   * @param get_statistics if not NULL, see ik_path_statistics
+   * @return true if all waypoints were reached with a continuous trajectory
+   */
+  bool solve_ik_path(const ik_plan &plan,
+		     const std::vector<float> &waypoints,
+		     std::vector<float> &get_postures,
+		     std::vector<float> &get_scores,
+		     std::vector<bool> &get_success,
+		     const ik_path_parameters &parameters=ik_path_parameters(),
+		     ik_path_statistics *get_statistics=NULL);
+
+
+  /*! number of steps between successive postures (nb_joints values each) in which a joint
+      changes by more than max_joint_step */
+  long count_discontinuities(const std::vector<float> &postures, int nb_joints, float max_joint_step);
+
+
+}
@@ -0,0 +1,180 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <stdint.h>
+#include "playful_kinematics/server_protocol.h"
+#include "playful_kinematics/soma.h"
+
+namespace playful_kinematics {
+
+
+  /**
+   * Single producer / single consumer lock free ring buffer.
+   * push and pop are wait free and never allocate. Items are copied
+   * in and out of the ring, so T should be a plain struct. The ring
+   * does not hold any pointer, so it may be placed in shared memory.
+   * SIZE must be a power of 2.
+   */
+  template<class T, int SIZE>
+  class spsc_ring {
+
+  public:
+
+    /*! to be called once, before the first push or pop */
+    void init(){
+      this->head.store(0);
+      this->tail.store(0);
+    }
+
+    /*! returns false (and does nothing) if the ring is full */
+    bool push(const T &item){
+      uint32_t tail = this->tail.load(std::memory_order_relaxed);
+      if (tail - this->head.load(std::memory_order_acquire) >= (uint32_t)SIZE) return false;
+      this->slots[tail & (SIZE-1)] = item;
+      this->tail.store(tail+1,std::memory_order_release);
+      return true;
+    }
+
+    /*! returns false (and does nothing) if the ring is empty */
+    bool pop(T &get){
+      uint32_t head = this->head.load(std::memory_order_relaxed);
+      if (head == this->tail.load(std::memory_order_acquire)) return false;
+      get = this->slots[head & (SIZE-1)];
+      this->head.store(head+1,std::memory_order_release);
+      return true;
+    }
+
+    int size() const {
+      return (int)(this->tail.load(std::memory_order_acquire)-this->head.load(std::memory_order_acquire));
+    }
+
+  private:
+
+    static_assert( SIZE>0 && (SIZE & (SIZE-1))==0, "spsc_ring size must be a power of 2");
+
+    // head and tail on their own cache lines, so that producer and
+    // consumer do not invalidate each other's cache
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    alignas(64) T slots[SIZE];
+
+  };
+
+
+  static const int IK_RING_SIZE = 64;
+
+  typedef server_protocol::request ik_ring_target;
+  typedef server_protocol::reply ik_ring_posture;
+
+  /*! memory layout of an ik ring, in process or in shared memory */
+  struct ik_ring_buffer {
+    uint32_t magic;
+    spsc_ring<ik_ring_target,IK_RING_SIZE> targets;
+    spsc_ring<ik_ring_posture,IK_RING_SIZE> postures;
+  };
+
+
+  /**
+   * Pair of lock free rings allowing a (real time) control thread to
+   * post inverse kinematics targets and poll the corresponding postures,
+   * while a worker (see ik_ring_worker) runs the solver.
+   * post and poll are wait free and never allocate.
+   * The rings may be local to the process, or in shared memory (shm_open/mmap),
+   * in which case the worker may run in another process.
+   * Only one thread may post/poll, and only one worker may take/give.
+   */
+  class ik_ring {
+
+  public:
+
+    /*! rings local to this process */
+    ik_ring();
+
+    /*! rings in the shared memory object "name" (see shm_open), created
+        (and unlinked on destruction) if create is true, opened otherwise */
+    ik_ring(const std::string &name, bool create);
+
+    ~ik_ring();
+
+    /*! false if the rings could not be allocated or the shared memory opened */
+    bool is_valid() const;
+
+    /*! control thread: queues an ik target. returns false if the ring is full */
+    bool post(const ik_ring_target &target);
+
+    /*! control thread: returns false if no posture has been computed since last call */
+    bool poll(ik_ring_posture &get_posture);
+
+    /*! worker: returns false if no target is pending */
+    bool take(ik_ring_target &get_target);
+
+    /*! worker: returns false if the posture ring is full */
+    bool give(const ik_ring_posture &posture);
+
+  private:
+
+    ik_ring_buffer *buffer;
+    std::string name;
+    bool owner;
+
+  };
+
+
+  /**
+   * Background thread draining an ik_ring with the solver (see ik.h)
+   */
+  class ik_ring_worker {
+
+  public:
+
+    /*! starts the thread */
+    ik_ring_worker(ik_ring &ring);
+
+    /*! stops and joins the thread */
+    ~ik_ring_worker();
+
+    void stop();
+
+    /*! drains the ring until running is set to false, e.g. in a dedicated
+        process attached to a shared memory ring */
+    static void run(ik_ring &ring, std::atomic<bool> &running);
+
+  private:
+
+    std::atomic<bool> running;
+    std::thread thread;
+
+  };
+
+
+  /*! fills (without allocating) an ik target to be posted to an ik_ring.
+      see ik.h for the meaning of the arguments. min, max and priority may be NULL.
+      Returns false (target not filled) if nb_joints is above server_protocol::MAX_JOINTS */
+  bool set_ik_ring_target(ik_ring_target &target, uint32_t id, bool left,
+			  const bool mask[6], const float cartesian_target[6],
+			  int nb_joints, const float *reference_posture,
+			  const float *min, const float *max,
+			  const int *minimization_priority,
+			  line_search search=FIXED_STEP_LINE_SEARCH);
+
+}
@@ -21,9 +21,82 @@
 #include <vector>
 #include <map>
 #include <boost/shared_ptr.hpp>
+#include "playful_kinematics/soma.h"
+#include "playful_kinematics/fk_simd.h"
+#include "playful_kinematics/solver_profile.h"
 
 namespace playful_kinematics {
 
+
+  /**
+   * The configuration set by the functions below, compiled into the
+   * structures used by the inverse kinematics solves (see ik.h):
+   * minimization order, limits of all joints, reference posture and
+   * parameters of the minimization.
+   * A plan is immutable: it is compiled again (see get_ik_plan)
+   * only when a setter changed the configuration.
+   */
+  class ik_plan {
+
+  public:
+
+    /*! version of the configuration this plan was compiled from */
+    unsigned long version;
+
+    bool left;
+    std::vector<bool> mask;
+    std::vector<float> reference_posture;
+    /*! indexes of the joints grouped by minimization priority (see soma.h), frozen joints excluded */
+    std::vector< std::vector<int> > minimization_order;
+    /*! min and max of each joint (0 if not set). A joint with equal min and max is frozen: it is
+        set to this value and is not moved by the minimization */
+    std::vector<float> min;
+    std::vector<float> max;
+    line_search search;
+    /*! engine and parameters of the minimization. May be changed on a copy of the plan
+        to solve a call with other parameters */
+    solver_profile profile;
+    /*! indexes of the joints which are not frozen */
+    std::vector<int> free_joints;
+    /*! chain of the end effector with the frozen joints folded into constant transforms, its
+        joints being the free joints (see flat_chain::fold_joints). Not set if no joint is frozen */
+    boost::shared_ptr<const flat_chain> free_chain;
+
+  };
+
+
+  /*! sets the minimization order, free joints and free chain of the plan from its
+      limits and the minimization priority of its joints. chain: chain of the end effector,
+      the free chain is not set if NULL or if it does not have as many joints as the plan */
+  void compile_frozen_joints(ik_plan &plan, const std::vector<int> &minimization_priority,
+			     const flat_chain *chain);
+
+  /*! true if the joint has equal min and max */
+  inline bool is_frozen(const ik_plan &plan, int index){
+    return plan.min[index]==plan.max[index];
+  }
+
+
+  /*
+   * The functions below may be called from any thread, including while
+   * inverse kinematics jobs are running: each job uses the configuration
+   * published when it started (see get_ik_plan). Setters never block the
+   * jobs; concurrent setters are serialized.
+   */
+
+
+  /*! the setters called until the matching end_kinematics_config_update
+      (by the same thread) are published at once, so that no job uses a
+      partially updated configuration. Other threads calling setters
+      wait for end_kinematics_config_update. May be nested.
+   */
+  void begin_kinematics_config_update();
+
+
+  /*! see begin_kinematics_config_update
+   */
+  void end_kinematics_config_update();
+
   
   /*! set for the next inverse kinematics jobs the posture from 
       which minimization will be performed
@@ -58,7 +131,31 @@ namespace playful_kinematics {
    */
   void set_minimization_priority(std::vector<int> minimization_priority);
 
+
+  /*! set the minimization priority of the joint at the specified index
+      (1 if not set)
+   */
+  void set_minimization_priority(int index, int priority);
+
+
+  /*! line search used by the next inverse kinematics jobs
+      (FIXED_STEP_LINE_SEARCH by default, see soma.h)
+   */
+  void set_kinematics_line_search(line_search search);
+
   
+  /*! solver profile used by the next inverse kinematics jobs
+      (get_default_solver_profile() by default, see solver_profile.h)
+   */
+  void set_kinematics_solver_profile(const solver_profile &profile);
+
+
+  /*! reads the solver profile file (see read_solver_profile) and sets it
+      for the next inverse kinematics jobs. false if the file could not be read
+   */
+  bool load_kinematics_solver_profile(const std::string &path);
+
+
   /*! returns the joint position as last set by "set_reference_posture" 
    */
   void get_kinematics_joints(std::vector<float> &get);
@@ -76,19 +173,29 @@ namespace playful_kinematics {
   std::vector<int> get_minimization_priority(int size);
 
   
+  /*! returns the line search as last set by "set_kinematics_line_search"
+   */
+  line_search get_kinematics_line_search();
+
+
+  /*! returns the solver profile as last set by "set_kinematics_solver_profile"
+   */
+  solver_profile get_kinematics_solver_profile();
+
+
   /*! returns mask as last set by "set_kinematics_mask"
    */
-  std::vector<bool>& get_kinematics_mask();
+  std::vector<bool> get_kinematics_mask();
 
   
   /*! returns min joint limits as last set by 
     "set_kinematics_joint_limit" */
-  std::map<int,float>& get_kinematics_joint_min_limit();
+  std::map<int,float> get_kinematics_joint_min_limit();
 
   
   /*! returns max joint limits as last set by 
     "set_kinematics_joint_limit" */
-  std::map<int,float>& get_kinematics_joint_max_limit();
+  std::map<int,float> get_kinematics_joint_max_limit();
 
   
   /*! returns the number of joints used for inverse and 
@@ -97,4 +204,41 @@ namespace playful_kinematics {
    */
   int get_kinematics_nb_joints();
 
+
+  /*! incremented each time a setter above changes the configuration
+      (setting an identical value does not)
+   */
+  unsigned long get_kinematics_config_version();
+
+
+  /*! returns the current configuration compiled into a plan. The
+      plan is compiled when a setter changes the configuration, and
+      is not affected by later changes: a solve using it sees one
+      consistent configuration. Never blocks.
+   */
+  boost::shared_ptr<const ik_plan> get_ik_plan();
+
+
+  /*! compiles a plan from the configuration passed as arguments rather
+      than from the one set by the functions above (version 0).
+      Joints without priority have priority 1.
+   */
+  boost::shared_ptr<const ik_plan> make_ik_plan(bool left, const std::vector<bool> &mask,
+						const std::vector<float> &reference_posture,
+						const std::vector<int> &minimization_priority,
+						const std::map<int,float> &min,
+						const std::map<int,float> &max,
+						line_search search=FIXED_STEP_LINE_SEARCH,
+						const solver_profile &profile=get_default_solver_profile());
+
+
+  /*! plan of the current configuration (pinned once, see get_ik_plan) for another side,
+      mask and reference posture, e.g. the posture passed with a call. The configuration
+      is not changed. Version of the configuration. With as many joints as the chain of
+      the side, a copy of the plan compiled when the configuration was published (only
+      mask and reference posture differ), otherwise compiled at each call.
+   */
+  boost::shared_ptr<const ik_plan> make_ik_plan(bool left, const std::vector<bool> &mask,
+						const std::vector<float> &reference_posture);
+
 }
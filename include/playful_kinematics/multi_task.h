@@ -0,0 +1,207 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <iostream>
+#include "playful_kinematics/fk_simd.h"
+#include "playful_kinematics/score_functions.h"
+#include "playful_kinematics/solver_profile.h"
+#include "playful_kinematics/soma.h"
+#include "playful_kinematics/cmaes.h"
+#include "playful_kinematics/trace.h"
+
+
+namespace playful_kinematics {
+
+
+  /**
+   * Score of several end effectors at once (e.g. both hands and the gaze of the head):
+   * sqrt(sum_t weight_t*d_t^2), d_t masked distance of the end effector of task t to its
+   * target (as cartesian_score), i.e. the distance of cartesian_score for a single task of
+   * weight 1. Unlike a sum of distances, the score stays smooth when a task is reached,
+   * which the coordinate descent of SOMA needs to trade the tasks against each other. Each task has its own chain, e.g. a chain of the urdf between
+   * any two links (see robot_model::get_flat_chain in fk.h), all chains starting from
+   * the same link. The first joints common to all chains (e.g. the base joints of Pepper)
+   * are shared: they are one dimension of the postures scored, and their forward
+   * kinematics is computed once per posture, the chain of each task being evaluated
+   * from the frame of the shared joints.
+   * Postures have get_nb_joints() values: the shared joints, then the other joints of
+   * each task, in the order of the tasks (see get_task_joints).
+   * To be used with the templated minimize functions (see soma.h and cmaes.h) or with
+   * ik below.
+   */
+  class multi_task_score {
+
+  public:
+
+    multi_task_score();
+
+    /**
+     * adds a task for the end effector of the chain (copied). As the shared joints may
+     * change, the layout of the postures (see get_task_joints) is updated
+     * @param mask and target: as cartesian_score, e.g. the orientation only for a gaze
+     * @param weight factor of the squared distance of this end effector in the score
+     * @return index of the task
+     */
+    int add_task(const flat_chain &chain, const std::vector<bool> &mask,
+		 float x, float y, float z,
+		 float alpha, float beta, float gamma,
+		 float weight=1);
+
+    /*! changes the mask and the target of the task, the posture layout is kept */
+    void set_target(int task, const std::vector<bool> &mask,
+		    float x, float y, float z,
+		    float alpha, float beta, float gamma);
+
+    void set_weight(int task, float weight);
+
+    int get_nb_tasks() const;
+
+    /*! number of values of the postures scored */
+    int get_nb_joints() const;
+
+    /*! number of first joints common to the chains of all tasks (first values of the postures) */
+    int get_nb_shared_joints() const;
+
+    /*! indexes in the postures of the joints of the chain of the task, in the order of the chain
+        (e.g. to get the posture of an arm from a posture found by ik) */
+    const std::vector<int>& get_task_joints(int task) const;
+
+    template<class Posture>
+    float operator()(const Posture &posture){
+      if(posture.size()!=this->nb_joints){
+	std::cerr << "playful kinematics: multi_task_score: posture of " << posture.size()
+		  << " joints for " << this->nb_joints << " joints" << std::endl;
+	return std::numeric_limits<float>::max();
+      }
+      if(this->q.size()!=this->nb_joints) this->q.resize(this->nb_joints);
+      for(int i=0;i<this->nb_joints;i++) this->q[i]=posture[i];
+      return this->evaluate(this->q.data());
+    }
+
+    /*! masked distance of each end effector to its target (not weighted) */
+    template<class Posture>
+    void get_errors(const Posture &posture, std::vector<float> &get_errors){
+      get_errors.assign(this->tasks.size(),std::numeric_limits<float>::max());
+      if(posture.size()!=this->nb_joints) return;
+      if(this->q.size()!=this->nb_joints) this->q.resize(this->nb_joints);
+      for(int i=0;i<this->nb_joints;i++) this->q[i]=posture[i];
+      this->evaluate(this->q.data(),get_errors.data());
+    }
+
+    /**
+     * score of the posture of get_nb_joints() values: one forward kinematics pass of the
+     * shared joints, then one per task for its other joints
+     * @param get_errors if not NULL, the (not weighted) distance of each task
+     */
+    float evaluate(const double *q, float *get_errors=NULL) const;
+
+    /*! pose of the end effector of the task (rotation row major), as the forward kinematics
+        of its chain with the joints get_task_joints(task) of the posture */
+    void get_pose(int task, const double *q, double *get_position, double *get_rotation) const;
+
+  private:
+
+    class task {
+    public:
+      flat_chain chain;
+      // chain after the shared joints, from the frame of the last shared joint
+      flat_chain suffix;
+      bool mask[6];
+      float target[6];
+      float weight;
+      // index of the first joint of the suffix in the postures
+      int offset;
+      std::vector<int> joints;
+    };
+
+    void _update_layout();
+
+    std::vector<task> tasks;
+    flat_chain prefix;
+    int nb_joints;
+    std::vector<double> q;
+
+  };
+
+
+  /**
+   * inverse kinematics of all the tasks of the score at once, with the solver profile
+   * (SOMA or CMA-ES, see solver_profile.h), rather than one ik per end effector
+   * (each one computing the forward kinematics of the shared joints)
+   * @param minimization_priority per joint of the postures, as set_kinematics_minimization_priority
+   *        in kinematic_config.h (SOMA only). Empty: the same priority for all joints
+   * @param min, max limits of each joint of the postures, a joint being frozen if min==max
+   * @param get_posture starting posture (e.g. the reference postures of the chains), then the
+   *        posture found: std::vector<float> or fixed_posture<N> of score.get_nb_joints() values
+   * @param get_score score of the posture found
+   * @return true if get_score is below the target score of the profile
+   */
+  template<class Posture>
+  bool ik(multi_task_score &score,
+	  const std::vector<int> &minimization_priority,
+	  const Posture &min, const Posture &max,
+	  Posture &get_posture, float &get_score,
+	  const solver_profile &profile=get_default_solver_profile(),
+	  line_search search=FIXED_STEP_LINE_SEARCH){
+
+    PLAYFUL_KINEMATICS_TRACE("multi_task_ik");
+
+    int nb_joints = score.get_nb_joints();
+    if(get_posture.size()!=nb_joints || min.size()!=nb_joints || max.size()!=nb_joints){
+      std::cerr << "playful kinematics: multi task inverse kinematics for " << nb_joints
+		<< " joints called with a posture of " << get_posture.size() << " joints" << std::endl;
+      get_score = std::numeric_limits<float>::max();
+      return false;
+    }
+
+    for(int i=0;i<nb_joints;i++){
+      if(min[i]>=max[i]) get_posture[i] = min[i];
+    }
+
+    if(profile.engine==CMAES_ENGINE){
+      return playful_kinematics::minimize(get_posture,min,max,
+					  profile.target_score,score,get_score,profile.cmaes);
+    }
+
+    // frozen joints are not minimized (as in the plans of kinematic_config.h)
+    std::vector<int> priority(minimization_priority);
+    if(priority.size()!=nb_joints) priority.assign(nb_joints,1);
+    std::vector< std::vector<int> > minimization_order;
+    std::vector< std::vector<int> > order = get_minimization_order(priority);
+    for(int g=0;g<order.size();g++){
+      std::vector<int> group;
+      for(int i=0;i<order[g].size();i++){
+	if(min[order[g][i]]<max[order[g][i]]) group.push_back(order[g][i]);
+      }
+      if(!group.empty()) minimization_order.push_back(group);
+    }
+
+    return playful_kinematics::minimize(get_posture,
+					minimization_order,
+					min,max,
+					profile.target_score,profile.max_step,profile.min_step,
+					profile.max_iteration,score,get_score,search);
+
+  }
+
+
+}
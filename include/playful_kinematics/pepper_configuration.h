@@ -0,0 +1,48 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#pragma once
+
+namespace playful_kinematics {
+
+  /*
+   * Default configuration of Pepper's arms, as set by
+   * scripts/playful_kinematics/set_ik_for_pepper.py
+   * (joints: KneePitch, HipPitch, HipRoll, ShoulderPitch,
+   *  ShoulderRoll, ElbowYaw, ElbowRoll, WristYaw).
+   * Used by the tools and benchmarks, which do not go through python.
+   */
+
+  namespace pepper {
+
+    static const int NB_DOFS = 8;
+
+    static const float LEFT_MIN[NB_DOFS] = {-1.0385,-0.5149,-0.5149,-2.0857, 0.0087,-2.0857,-1.562 ,-1.8239};
+    static const float LEFT_MAX[NB_DOFS] = { 1.0385, 0.5149, 0.5149, 2.0857, 1.562 , 2.0857,-0.0087, 1.8239};
+
+    static const float RIGHT_MIN[NB_DOFS] = {-1.0385,-0.5149,-0.5149,-2.0857,-1.562 ,-2.0857, 0.0087,-1.8239};
+    static const float RIGHT_MAX[NB_DOFS] = { 1.0385, 0.5149, 0.5149, 2.0857,-0.0087, 2.0857, 1.562 , 1.8239};
+
+    static const int MINIMIZATION_PRIORITY[NB_DOFS] = {2,2,2,1,1,1,1,1};
+
+    /*! reference posture used in the usage example of README.md */
+    static const float LEFT_REFERENCE[NB_DOFS] = {0.0,0.0,0.0,0.0,0.78535,0.0,-0.78535,0.0};
+    static const float RIGHT_REFERENCE[NB_DOFS] = {0.0,0.0,0.0,0.0,-0.78535,0.0,0.78535,0.0};
+
+  }
+
+}
@@ -0,0 +1,45 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include "playful_kinematics/ik_corpus.h"
+#include "playful_kinematics/pepper_configuration.h"
+
+namespace playful_kinematics {
+
+
+  /*! sets the reference postures, joint limits and minimization priority of the corpus
+      to the default configuration of Pepper's arms (see pepper_configuration.h) */
+  inline void configure_pepper_ik_corpus(ik_corpus &corpus){
+
+    const float *references[2] = {pepper::RIGHT_REFERENCE,pepper::LEFT_REFERENCE};
+    const float *mins[2] = {pepper::RIGHT_MIN,pepper::LEFT_MIN};
+    const float *maxs[2] = {pepper::RIGHT_MAX,pepper::LEFT_MAX};
+
+    corpus.minimization_priority.assign(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+    for(int side=0;side<2;side++){
+      corpus.sides[side].reference_posture.assign(references[side],references[side]+pepper::NB_DOFS);
+      corpus.sides[side].min.assign(mins[side],mins[side]+pepper::NB_DOFS);
+      corpus.sides[side].max.assign(maxs[side],maxs[side]+pepper::NB_DOFS);
+    }
+
+  }
+
+
+}
@@ -0,0 +1,121 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <mutex>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include "playful_kinematics/fk_dataset.h"
+
+namespace playful_kinematics {
+
+
+  /**
+   * k-d tree over the samples of an atlas, restricted to the cartesian dimensions
+   * of a mask. The tree is implicit (balanced, stored as a flat array: the node of the
+   * range [begin,end) is at (begin+end)/2), so that queries walk contiguous memory.
+   */
+  class posture_atlas_index {
+
+  public:
+
+    /*! sample indexes, in tree order */
+    std::vector<uint32_t> order;
+
+    /*! split dimension of the node at the same position in order */
+    std::vector<uint8_t> split;
+
+    uint8_t mask;
+
+  };
+
+
+  /**
+   * Set of (cartesian pose -> posture) samples of an end effector, used to
+   * find postures close to a target, from which to start inverse kinematics.
+   * Distances between poses are the same as the ones used by the score
+   * function (score_functions.h), restricted to a mask.
+   */
+  class posture_atlas {
+
+  public:
+
+    /*! empty atlas */
+    posture_atlas();
+
+    /*! samples nb_samples postures (see fk_dataset.h) and computes their
+        cartesian pose via forward kinematics of the specified end effector */
+    posture_atlas(bool left, const posture_sampler &sampler, long nb_samples);
+
+    /*! atlas of already computed samples: postures (nb_joints values per sample)
+        and their cartesian poses (x,y,z,alpha,beta,gamma per sample) */
+    posture_atlas(bool left, int nb_joints,
+		  const std::vector<float> &postures,
+		  const std::vector<float> &poses);
+
+    /*! writes the samples and all indexes built so far to path */
+    bool save(const std::string &path);
+
+    /*! reads an atlas written by save */
+    bool load(const std::string &path);
+
+    /**
+     * writes in get_postures (nb_joints values each) up to k postures which
+     * cartesian poses are the closest to target, closest first.
+     * @param target x,y,z,alpha,beta,gamma
+     * @param mask cartesian dimensions taken into account
+     * @param k number of postures
+     * @return number of postures found
+     */
+    int query(const float *target, const std::vector<bool> &mask, int k,
+	      std::vector<float> &get_postures);
+
+    /*! builds (if not done yet) the index for this mask */
+    void build_index(const std::vector<bool> &mask);
+
+    bool get_side() const;
+    int get_nb_joints() const;
+    long get_nb_samples() const;
+
+  private:
+
+    boost::shared_ptr<posture_atlas_index> _get_index(uint8_t mask);
+
+    bool left;
+    int nb_joints;
+    std::vector<float> postures;
+    std::vector<float> poses;
+    std::map< uint8_t, boost::shared_ptr<posture_atlas_index> > indexes;
+    std::mutex mutex;
+
+  };
+
+
+  /*! inverse kinematics (see ik.h) of the specified end effector will start from the
+      best of the reference posture and the nb_seeds closest postures found in the atlas.
+      A NULL atlas disables seeding. */
+  void set_ik_atlas(bool left, boost::shared_ptr<posture_atlas> atlas, int nb_seeds=4);
+
+  /*! returns the atlas set for the end effector (NULL if none), and the number of seeds */
+  boost::shared_ptr<posture_atlas> get_ik_atlas(bool left, int &get_nb_seeds);
+
+}
@@ -0,0 +1,99 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "playful_kinematics/ik.h"
+
+namespace playful_kinematics {
+
+
+  /**
+   * One (virtual) robot among possibly thousands in the same process.
+   * The kinematic model (urdf, chains) is shared by all instances (see robot_model
+   * in fk.h); an instance only holds its own configuration of inverse kinematics
+   * for each end effector (reference posture, limits, priorities, mask, line search,
+   * solver profile, as a plan, see kinematic_config.h) and the workspace of its score function.
+   * Instances do not use the configuration of kinematic_config.h, and do not share
+   * any mutable state (the atlas of posture_atlas.h, if set, is used by all instances):
+   * several threads may solve for different instances concurrently. An instance must
+   * not be used by several threads at the same time.
+   *
+   * Footprint (get_footprint), with 8 joints per end effector (Pepper): about 900 bytes
+   * per instance once a solve has been performed (i.e. about 9 mega bytes for 10000
+   * instances), the model being shared. Each solve also allocates the score cache
+   * of the minimization (see soma_template.h, about 2.3 kilo bytes for 8 joints),
+   * released when the solve returns.
+   */
+  class robot_instance {
+
+  public:
+
+    /*! reference postures are 0, limits are 0 (i.e. joints do not move), all
+        priorities are 1 and the solver profile is get_default_solver_profile() until set */
+    robot_instance(boost::shared_ptr<const robot_model> model=get_robot_model());
+
+    void set_reference_posture(bool left, const std::vector<float> &posture);
+    void set_joint_limit(bool left, int index, float min, float max);
+    void set_minimization_priority(bool left, int index, int priority);
+    void set_mask(bool left, const std::vector<bool> &mask);
+    void set_line_search(bool left, line_search search);
+    void set_solver_profile(bool left, const solver_profile &profile);
+
+    /*! configuration of the end effector */
+    const ik_plan& get_plan(bool left) const;
+
+    const robot_model& get_model() const;
+
+    /*! minimization priority of each joint of the end effector */
+    const std::vector<int>& get_minimization_priority(bool left) const;
+
+    /**
+     * inverse kinematics of the end effector, using the configuration of this instance.
+     * @see ik in ik.h for the parameters
+     */
+    bool ik(bool left,
+	    float target_x, float target_y, float target_z,
+	    float target_alpha, float target_beta, float target_gamma,
+	    std::vector<float> &get_posture, float &get_score);
+
+    /*! same as above, get_posture being an array of the number of joints of the end
+        effector (fixed size inverse kinematics up to MAX_FIXED_DOFS joints, see ik.h) */
+    bool ik(bool left,
+	    float target_x, float target_y, float target_z,
+	    float target_alpha, float target_beta, float target_gamma,
+	    float *get_posture, float &get_score);
+
+    /*! bytes used by this instance (including its heap allocations, excluding the shared model) */
+    size_t get_footprint() const;
+
+  private:
+
+    ik_plan& _plan(bool left);
+
+    boost::shared_ptr<const robot_model> model;
+    ik_plan plans[2];
+    std::vector<int> priorities[2];
+    cartesian_score workspace;
+
+  };
+
+
+}
@@ -27,14 +27,120 @@
 namespace playful_kinematics {
 
   /*! set the desired target cartesian position, 
-      to be used before calling at_desired_cartesian_position */
+      to be used before calling at_desired_cartesian_position.
+      The target applies to the calling thread only */
   void set_target_cartesian_position(float x, float y, float z, float alpha, float beta, float gamma);
 
   /*! set configuration: use of left arm or right arm, position mask (x,y,z,alpha,beta,gamma)
-    e.g. [true,true,true,false,false,false] if orientation if irrelevant */
+    e.g. [true,true,true,false,false,false] if orientation if irrelevant.
+    The configuration applies to the calling thread only. If not called, the side and mask
+    set by set_kinematics_side and set_kinematics_mask (see kinematic_config.h) are used */
   void set_configuration(bool left,std::vector<bool> mask);
 
-  /*! score function, call set_target_cartesian_position and set_configuration first */
+  /*! score function, call set_target_cartesian_position (and optionally set_configuration) first.
+      max float if no target was set on the calling thread */
   float at_desired_cartesian_position(std::vector<float> &posture);
 
+  /**
+   * Same score as at_desired_cartesian_position, but carrying its own target,
+   * configuration and forward kinematics workspace rather than using the ones
+   * set by set_target_cartesian_position and set_configuration, to be used
+   * with the templated minimize functions (see soma.h).
+   * Postures of fixed size (fixed_posture<N>) are scored with the forward kinematics
+   * of the flat chain of the end effector (see forward_kinematics<N> in fk_simd.h),
+   * without heap allocation; other postures with the forward kinematics of KDL.
+   */
+  class cartesian_score {
+
+  public:
+
+    cartesian_score(bool left, const std::vector<bool> &mask,
+		    float x, float y, float z,
+		    float alpha, float beta, float gamma);
+
+    template<class Posture>
+    float operator()(const Posture &posture){
+      if(this->q.size()!=posture.size()) this->q.resize(posture.size());
+      for(int i=0;i<posture.size();i++) this->q[i]=posture[i];
+      return this->evaluate();
+    }
+
+    template<int N>
+    float operator()(const fixed_posture<N> &posture){
+      double q[N];
+      for(int i=0;i<N;i++) q[i]=posture[i];
+      return this->evaluate<N>(q);
+    }
+
+    /*! score of the posture currently in the workspace */
+    float evaluate();
+
+    /*! score of the posture of N joints. Uses the forward kinematics of KDL if the
+        flat chain of the end effector does not have N joints */
+    template<int N>
+    float evaluate(const double *q){
+      double position[3];
+      double rotation[9];
+      if(this->free_joints){
+	double free_q[N];
+	for(int i=0;i<this->free_joints->size();i++) free_q[i]=q[(*this->free_joints)[i]];
+	forward_kinematics(*this->chain,free_q,position,rotation);
+	return this->evaluate(position,rotation);
+      }
+      if(this->chain==NULL || this->chain->get_nb_joints()!=N){
+	this->q.assign(q,q+N);
+	return this->evaluate();
+      }
+      forward_kinematics<N>(*this->chain,q,position,rotation);
+      return this->evaluate(position,rotation);
+    }
+
+    /*! score of the pose of the end effector (rotation row major) */
+    float evaluate(const double *position, const double *rotation);
+
+    /*! scores of nb postures in structure of arrays layout (value j of posture i at q[j*nb+i]),
+        with the forward kinematics of the flat chain over the SIMD lanes (see forward_kinematics_lanes
+        in fk_simd.h). Used by the CMA-ES minimize of cmaes.h */
+    void evaluate_batch(int nb, const double *q, float *get_scores);
+
+    /*! changes side, mask and target, reusing the workspace */
+    void set_target(bool left, const std::vector<bool> &mask,
+		    float x, float y, float z,
+		    float alpha, float beta, float gamma);
+
+    /*! postures of fixed size are then scored with the forward kinematics of chain, whose joints
+        are the joints free_joints of the posture, the other joints being folded into the chain
+        (see the free chain of ik_plan in kinematic_config.h). Until the next call to set_target.
+        chain and free_joints are not copied */
+    void set_free_chain(const flat_chain *chain, const std::vector<int> &free_joints);
+
+    /*! bytes allocated on the heap by the workspace */
+    size_t get_heap_footprint() const;
+
+  private:
+
+    bool left;
+    bool mask[6];
+    float target[6];
+    const flat_chain *chain;
+    const std::vector<int> *free_joints;
+    std::vector<double> q;
+    // workspace of evaluate_batch
+    std::vector<double> batch_q;
+    std::vector<double> batch_positions;
+    std::vector<double> batch_rotations;
+
+  };
+
+  /*! masked distance of a pose (rotation row major) to the target x,y,z,alpha,beta,gamma,
+      as scored by cartesian_score (not counted by get_nb_score_evaluations) */
+  float get_cartesian_distance(const double *position, const double *rotation,
+			       const float *target, const bool *mask);
+
+  /*! number of scores (at_desired_cartesian_position or cartesian_score) computed by the calling thread */
+  long get_nb_score_evaluations();
+
+  /*! resets the number of score evaluations of the calling thread */
+  void reset_nb_score_evaluations();
+
 }
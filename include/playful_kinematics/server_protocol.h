@@ -0,0 +1,94 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <cstdlib>
+
+namespace playful_kinematics {
+
+  /*
+   * Binary protocol spoken between the kinematics server (src/kinematics_server.cpp)
+   * and its client library (src/kinematics_client.cpp).
+   * Server and clients run on the same host, so messages are plain structs
+   * in native byte order, exchanged over a SOCK_SEQPACKET unix domain socket
+   * (one request or reply per packet).
+   * The client library keeps the configuration (reference posture, limits, priorities, mask, line search)
+   * on its side and sends it along each inverse kinematics request, so that the
+   * server does not hold any per client state.
+   */
+
+  namespace server_protocol {
+
+    static const uint32_t MAGIC = 0x504b5331; // "PKS1"
+
+    static const int MAX_JOINTS = 16;
+
+    static const char * const DEFAULT_SOCKET = "/tmp/playful_kinematics.sock";
+
+    static const char * const SOCKET_ENV = "PLAYFUL_KINEMATICS_SOCKET";
+
+    enum request_type {
+      NB_JOINTS_REQUEST = 0,
+      FK_REQUEST = 1,
+      IK_REQUEST = 2
+    };
+
+    struct request {
+      uint32_t magic;
+      uint32_t id;
+      uint8_t type;
+      uint8_t left;
+      uint8_t nb_joints;
+      uint8_t line_search;
+      uint8_t mask[6];
+      uint8_t has_limit[MAX_JOINTS];
+      float target[6];
+      double posture[MAX_JOINTS];
+      float min[MAX_JOINTS];
+      float max[MAX_JOINTS];
+      int32_t priority[MAX_JOINTS];
+    };
+
+    struct reply {
+      uint32_t magic;
+      uint32_t id;
+      uint8_t success;
+      uint8_t nb_joints;
+      float score;
+      double cartesian[6];
+      double posture[MAX_JOINTS];
+    };
+
+    /*! runs the forward or inverse kinematics job described by the request
+        (using the kinematics library) and writes its outcome to get_reply */
+    void process(const request &job, reply &get_reply);
+
+    /*! path of the unix domain socket, as set by the environment
+        variable PLAYFUL_KINEMATICS_SOCKET, or DEFAULT_SOCKET */
+    inline std::string get_socket_path(){
+      const char *path = std::getenv(SOCKET_ENV);
+      if(path) return std::string(path);
+      return std::string(DEFAULT_SOCKET);
+    }
+
+  }
+
+}
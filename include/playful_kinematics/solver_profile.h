@@ -0,0 +1,97 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <string>
+#include "playful_kinematics/cmaes.h"
+
+namespace playful_kinematics {
+
+
+  /*! environment variable: path of the solver profile loaded at startup (see get_default_solver_profile) */
+  static const char * const SOLVER_PROFILE_ENV = "PLAYFUL_KINEMATICS_SOLVER_PROFILE";
+
+  /*! first word of solver profile files */
+  static const char * const SOLVER_PROFILE_HEADER = "playful_kinematics_solver_profile";
+
+  /*! to be incremented when the file format changes */
+  static const int SOLVER_PROFILE_VERSION = 1;
+
+
+  /*! minimization used by the inverse kinematics */
+  enum solver_engine {
+    /*! coordinate descent, see soma.h */
+    SOMA_ENGINE = 0,
+    /*! covariance matrix adaptation evolution strategy, see cmaes.h */
+    CMAES_ENGINE = 1
+  };
+
+
+  /**
+   * Parameters of the minimization run by the inverse kinematics (see ik.h), part of
+   * the configuration (set_kinematics_solver_profile in kinematic_config.h) and of
+   * the plans compiled from it. The default values are the ones ik always used.
+   * pepper_solver_tuner (src/solver_tuner.cpp) searches the profiles over a set of
+   * targets and writes the one to use to a file.
+   */
+  class solver_profile {
+
+  public:
+
+    solver_profile()
+      : engine(SOMA_ENGINE), target_score(0.001), max_step(0.1), min_step(0.001), max_iteration(15) {}
+
+    solver_engine engine;
+
+    /*! the minimization stops once the score is below, ik then succeeds */
+    float target_score;
+
+    /*! SOMA: first and last steps of the line search, and maximal number of passes over
+        the joints (see the minimize functions of soma.h) */
+    float max_step;
+    float min_step;
+    int max_iteration;
+
+    /*! CMA-ES: the nb_threads, population, sigma, max_generations and seed of cmaes.h */
+    cmaes_parameters cmaes;
+
+    bool operator==(const solver_profile &other) const;
+    bool operator!=(const solver_profile &other) const;
+
+  };
+
+
+  /**
+   * Writes the profile as a text file: the header and the version, then one
+   * "name value" line per parameter. comment: written first, each line prefixed by '#'.
+   * Floats are written with enough digits to be read back exactly.
+   */
+  bool write_solver_profile(const std::string &path, const solver_profile &profile,
+			    const std::string &comment="");
+
+  /*! reads a file written by write_solver_profile. Lines starting with '#' are ignored,
+      parameters not in the file keep their default value. false (reason printed on std::cerr)
+      if the file can not be read or has an unknown parameter */
+  bool read_solver_profile(const std::string &path, solver_profile &get_profile);
+
+  /*! the profile of the file SOLVER_PROFILE_ENV if set (read once, at first call),
+      otherwise solver_profile(). Initial profile of the configuration and of robot instances */
+  const solver_profile& get_default_solver_profile();
+
+}
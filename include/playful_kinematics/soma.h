@@ -16,6 +16,8 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 
+#pragma once
+
 #include <limits>
 #include <vector>
 #include <map>
@@ -23,14 +25,80 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include "playful_kinematics/fixed_posture.h"
+#include "playful_kinematics/trace.h"
 
 
 namespace playful_kinematics {
 
 
+  /**
+   * Score computations of the minimizations run by the calling thread.
+   * nb_requests() is the number of score computations minimize would perform
+   * without keeping track of the current score and without memoization.
+   */
+  class soma_counters {
+
+  public:
+
+    soma_counters(){
+      this->reset();
+    }
+
+    void reset(){
+      this->nb_minimizations = 0;
+      this->nb_evaluations = 0;
+      this->nb_memo_hits = 0;
+      this->nb_reused = 0;
+    }
+
+    long nb_requests() const {
+      return this->nb_evaluations+this->nb_memo_hits+this->nb_reused;
+    }
+
+    long nb_minimizations;
+
+    /*! calls to the score function */
+    long nb_evaluations;
+
+    /*! scores of postures already scored (exact same joint values) */
+    long nb_memo_hits;
+
+    /*! scores of the current posture, known by the minimizer */
+    long nb_reused;
+
+  };
+
+
+  /**
+   * FIXED_STEP_LINE_SEARCH: the posture moves along the selected joint by increments
+   * of the current step, the step starting at max_step and being divided by 10 down to
+   * min_step.
+   * ADAPTIVE_LINE_SEARCH: each joint has its own step, doubled along the selected joint
+   * until the score stops improving, then refined by golden section search down to min_step.
+   * Requires O(log(distance/min_step)) score evaluations per move rather than O(distance/step).
+   */
+  enum line_search {
+    FIXED_STEP_LINE_SEARCH = 0,
+    ADAPTIVE_LINE_SEARCH = 1
+  };
+
+
+  /*! counters of the calling thread */
+  inline soma_counters& get_soma_counters(){
+    static thread_local soma_counters counters;
+    return counters;
+  }
+
+
   /**
    * Minimize the input posture such as minimizing the scoring function
-   * using gradient descent.
+   * using gradient descent. Dimensions with equal min and max are frozen,
+   * i.e. not minimized.
    * @param posture posture to be mimized
    * @param min min acceptable for the minimized posture
    * @param max max acceptable for the minimized posture
@@ -57,7 +125,8 @@ namespace playful_kinematics {
    * Minimize the input posture such as minimizing the scoring function
    * using gradient descent. The "minimization_priority" parameter allows
    * to specify which dimension of the posture should be minimized first,
-   * which has an impact in which solution will be found
+   * which has an impact in which solution will be found. Dimensions with
+   * equal min and max are frozen, i.e. not minimized.
    * @param posture posture to be mimized
    * @param mimimization_priority, e.g [1,2,2,2] will favor changing the value of the first dimension
    * @param min min acceptable for the minimized posture
@@ -81,4 +150,82 @@ namespace playful_kinematics {
 		float &final_score
 		);
 
+
+  /**
+   * Same as above, for any posture type and any score callable.
+   * The posture type may be std::vector<float> or a fixed size type such as
+   * fixed_posture<N> or std::array<float,N> (anything providing size() and operator[]).
+   * For fixed size types, the score cache of the minimization is on the stack. The score
+   * may be a function, a lambda or a functor carrying its own state (e.g.
+   * target and workspace, see cartesian_score in score_functions.h), called as
+   * score(posture) and returning a float. As the score is a template parameter,
+   * it may be inlined in the minimization loops.
+   * The score must only depend on the posture: scores of postures already
+   * scored during the minimization are not computed again.
+   * @param search see line_search
+   */
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const std::vector<int> &minimization_priority,
+		const std::map<int,float> &min,
+		const std::map<int,float> &max,
+		float target_score,
+		float max_step,
+		float min_step,
+		int max_iteration,
+		Score &&score,
+		float &final_score,
+		line_search search=FIXED_STEP_LINE_SEARCH
+		);
+
+
+  /**
+   * Same as above, all dimensions having the same priority.
+   */
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const std::map<int,float> &min,
+		const std::map<int,float> &max,
+		float target_score,
+		float max_step,
+		float min_step,
+		int max_iteration,
+		Score &&score,
+		float &final_score,
+		line_search search=FIXED_STEP_LINE_SEARCH
+		);
+
+
+  /**
+   * Same as above, with the minimization order and the limits already computed
+   * (see ik_plan in kinematic_config.h), so that no setup is performed per call.
+   * @param minimization_order indexes of the dimensions grouped by priority, higher
+   *        priority first (see get_minimization_order)
+   * @param min min acceptable for each dimension of the posture
+   * @param max max acceptable for each dimension of the posture
+   */
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const std::vector< std::vector<int> > &minimization_order,
+		const Posture &min,
+		const Posture &max,
+		float target_score,
+		float max_step,
+		float min_step,
+		int max_iteration,
+		Score &&score,
+		float &final_score,
+		line_search search=FIXED_STEP_LINE_SEARCH
+		);
+
+
+  /*! indexes of the dimensions grouped by minimization priority, higher priority
+      first, e.g. [[0],[1,2,3]] for the priority [1,2,2,2]
+   */
+  std::vector< std::vector<int> > get_minimization_order(const std::vector<int> &minimization_priority);
+
 }
+
+
+#include "playful_kinematics/soma_template.h"
+
@@ -0,0 +1,661 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// implementation of the templated minimize functions declared in soma.h.
+// do not include directly, include soma.h
+
+
+#pragma once
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  namespace soma_internal {
+
+
+    // limits as flat arrays, indexed like the posture.
+    // dimensions missing from the maps get 0 as limit.
+    template<class Posture>
+    void _limits(const std::map<int,float> &limits, Posture &get_limits){
+      for(int i=0;i<get_limits.size();i++){
+	std::map<int,float>::const_iterator it = limits.find(i);
+	if(it==limits.end()) get_limits[i]=0;
+	else get_limits[i]=it->second;
+      }
+    }
+
+
+    // removes from the minimization order the dimensions with equal min and max (frozen)
+    template<class Posture>
+    void _drop_frozen(const Posture &min, const Posture &max,
+		      std::vector< std::vector<int> > &minimization_order){
+      std::vector< std::vector<int> > order;
+      for(int g=0;g<minimization_order.size();g++){
+	std::vector<int> group;
+	for(int i=0;i<minimization_order[g].size();i++){
+	  int index = minimization_order[g][i];
+	  if(index>=min.size() || min[index]!=max[index]) group.push_back(index);
+	}
+	if(!group.empty()) order.push_back(group);
+      }
+      minimization_order.swap(order);
+    }
+
+
+    static const int MEMO_SIZE = 64;
+
+
+    // storage of score_memo: on the stack for postures of fixed size (see fixed_posture.h),
+    // on the heap otherwise
+    template<int N>
+    class memo_storage {
+
+    public:
+
+      memo_storage(int){
+	for(int i=0;i<MEMO_SIZE;i++) this->valid[i]=false;
+      }
+
+      int nb_dims() const { return N; }
+
+      float postures[MEMO_SIZE*N];
+      float scores[MEMO_SIZE];
+      bool valid[MEMO_SIZE];
+
+    };
+
+
+    template<>
+    class memo_storage<0> {
+
+    public:
+
+      memo_storage(int nb_dims)
+	: postures(MEMO_SIZE*nb_dims), scores(MEMO_SIZE), valid(MEMO_SIZE,false), size(nb_dims) {}
+
+      int nb_dims() const { return this->size; }
+
+      std::vector<float> postures;
+      std::vector<float> scores;
+      std::vector<bool> valid;
+
+    private:
+
+      int size;
+
+    };
+
+
+    // small direct mapped cache of (posture -> score), exact match on the posture values.
+    // Catches the probes of _select_best which _minimize then steps to, and the postures
+    // revisited when the step decreases.
+    // N: number of dimensions if known at compile time (see posture_size), 0 otherwise
+    template<class Score, int N>
+    class score_memo {
+
+    public:
+
+      score_memo(Score &score, int nb_dims)
+	: score(score), storage(nb_dims) {}
+
+      template<class Posture>
+      float operator()(Posture &posture){
+
+	const int nb_dims = this->storage.nb_dims();
+
+	uint32_t hash = 2166136261u;
+	for(int i=0;i<nb_dims;i++){
+	  uint32_t bits;
+	  memcpy(&bits,&posture[i],sizeof(bits));
+	  hash = (hash ^ bits) * 16777619u;
+	}
+	int slot = (hash ^ (hash>>16)) & (MEMO_SIZE-1);
+
+	float *memo_posture = &this->storage.postures[slot*nb_dims];
+
+	if(this->storage.valid[slot]){
+	  bool same = true;
+	  for(int i=0;i<nb_dims && same;i++) same = (memo_posture[i]==posture[i]);
+	  if(same){
+	    get_soma_counters().nb_memo_hits++;
+	    return this->storage.scores[slot];
+	  }
+	}
+
+	get_soma_counters().nb_evaluations++;
+	float s = this->score(posture);
+
+	for(int i=0;i<nb_dims;i++) memo_posture[i]=posture[i];
+	this->storage.scores[slot] = s;
+	this->storage.valid[slot] = true;
+
+	return s;
+
+      }
+
+    private:
+
+      Score &score;
+      memo_storage<N> storage;
+
+    };
+
+
+    // current score is NaN when unknown, i.e. when posture changed without being scored
+    template<class Posture, class Score>
+    inline float _current_score(Posture &posture, Score &score, float current_score){
+      if(current_score!=current_score) return score(posture);
+      get_soma_counters().nb_reused++;
+      return current_score;
+    }
+
+
+    template<class Posture, class Score>
+    inline float _get_score(Posture &posture, int index, float step, Score &score){
+
+      float value = posture[index];
+      posture[index] = value+step;
+      float s = score(posture);
+      posture[index] = value;
+      return s;
+
+    }
+
+
+    // current_score: score of posture, kept up to date
+    template<class Posture, class Score>
+    bool _minimize(Posture &posture, int index,
+		   float min, float max, float step,
+		   float target_score, Score &score,
+		   float &current_score){
+
+      float new_score;
+      current_score = _current_score(posture,score,current_score);
+
+      while(true){
+
+	float previous = posture[index];
+
+	posture[index]+=step;
+
+	bool rejected = (posture[index]>max) || (posture[index]<min);
+
+	if(!rejected){
+	  new_score = score(posture);
+	  rejected = (new_score>current_score);
+	}
+
+	if(rejected){
+	  posture[index]-=step;
+	  // undoing the step may not restore exactly the previous value
+	  if(posture[index]!=previous) current_score = std::numeric_limits<float>::quiet_NaN();
+	  return false;
+	}
+
+	current_score = new_score;
+
+	if (current_score<=target_score) {
+	  return true;
+	}
+
+      }
+
+    }
+
+
+    template<class Posture, class Score>
+    bool _select_best(Posture &posture,
+		      const std::vector<int> &indexes,
+		      const Posture &min,
+		      const Posture &max,
+		      float step,
+		      float target_score,
+		      Score &score,
+		      float &current_score,
+		      int &get_index,
+		      float &get_sign){
+
+      PLAYFUL_KINEMATICS_TRACE("select_best");
+
+      current_score = _current_score(posture,score,current_score);
+      float start_score = current_score;
+      float best_score = current_score;
+      get_index = 0;
+      float score_plus,score_minus;
+
+      for(int i=0;i<indexes.size();i++){
+
+	int index = indexes[i];
+
+	score_plus = std::numeric_limits<float>::max();
+	score_minus = std::numeric_limits<float>::max();
+
+	if ( (posture[index]+step) < max[index] ){
+	  score_plus = _get_score(posture,index,+step,score);
+	}
+
+	if ( (posture[index]-step) > min[index] ) {
+	  score_minus = _get_score(posture,index,-step,score);
+	}
+
+	if (score_plus<best_score) {
+	  best_score = score_plus;
+	  get_index = index;
+	  get_sign = +1.0;
+	}
+
+	if(score_minus<best_score && score_minus<score_plus){
+	  best_score=score_minus;
+	  get_index=index;
+	  get_sign = -1.0;
+	}
+
+      }
+
+      if (std::abs(best_score-start_score)>(target_score/10.0)) {
+	return true;
+      }
+
+      return false;
+
+    }
+
+
+    // current_score: score of posture, kept up to date
+    template<class Posture, class Score>
+    bool _minimize_step(Posture &posture,
+			const std::vector< std::vector<int> > &minimization_order,
+			const Posture &min,
+			const Posture &max,
+			float target_score,
+			float step,
+			int max_iterations,
+			Score &score,
+			float &current_score){
+
+      PLAYFUL_KINEMATICS_TRACE("minimize_step");
+
+      int iteration = 0;
+      float sign = +1.0;
+      int index;
+      bool success;
+      bool found_better=false;
+      int minimization_index = 0;
+      int starting_minimization_index = minimization_index;
+
+      current_score = _current_score(posture,score,current_score);
+
+      // e.g. starting from the solution of a close target (as the adaptive search)
+      if(current_score<=target_score) return true;
+
+      while (true) {
+
+	while (!found_better){
+
+	  found_better = _select_best(posture, minimization_order[minimization_index],
+				      min, max,
+				      step, target_score, score, current_score, index, sign);
+
+	  if(!found_better){
+	    minimization_index++;
+	    if(minimization_index>=minimization_order.size()){
+	      minimization_index=0;
+	    }
+	    if(minimization_index==starting_minimization_index){
+	      return false;
+	    }
+	  }
+
+	}
+
+	found_better = false;
+	minimization_index=0;
+	starting_minimization_index = minimization_index;
+
+	success = _minimize(posture,index,min[index],max[index],sign*step,target_score,score,current_score);
+	if (success) {
+	  current_score = _current_score(posture,score,current_score);
+	  return true;
+	}
+
+	iteration++;
+
+	if (iteration>=(max_iterations*posture.size())) {
+	  return false;
+	}
+
+	current_score = _current_score(posture,score,current_score);
+
+      }
+
+    }
+
+
+    inline std::vector< std::vector<int> > _minimization_order(const std::vector<int> &minimization_priority){
+
+      std::map< int , std::vector<int> > priority_indexes;
+
+      for (int i=0;i<minimization_priority.size();i++){
+	priority_indexes[minimization_priority[i]].push_back(i);
+      }
+
+      // std::map: priorities are sorted
+      std::vector< std::vector<int> > minimization_order;
+      for(std::map< int, std::vector<int> >::iterator it = priority_indexes.begin(); it != priority_indexes.end(); ++it) {
+	minimization_order.push_back(it->second);
+      }
+
+      return minimization_order;
+
+    }
+
+
+    // ADAPTIVE_LINE_SEARCH: line search along one joint, in direction sign.
+    // The score at distance step is known to be better than the current score.
+    // The step is doubled until the score stops improving (or the joint limit is reached),
+    // then the minimum is refined by golden section search down to min_step.
+    // Returns the distance moved.
+    template<class Posture, class Score>
+    float _line_search(Posture &posture, int index, float sign,
+		       float min, float max, float step, float step_score,
+		       float min_step, float target_score,
+		       Score &score, float &current_score){
+
+      PLAYFUL_KINEMATICS_TRACE("line_search");
+
+      const float golden = 0.381966;
+
+      float origin = posture[index];
+      float limit = sign>0 ? max-origin : origin-min;
+
+      // bracketing: a < b < c, with score(b) lower than score(a) and score(c)
+      float a = 0, b = step, c = step;
+      float score_b = step_score;
+      float score_c = step_score;
+      bool bracketed = false;
+
+      while(score_b>target_score){
+	c = std::min(2*b,limit);
+	if(c<=b) break;
+	posture[index] = std::max(min,std::min(max,origin+sign*c));
+	score_c = score(posture);
+	if(score_c>=score_b){
+	  bracketed = true;
+	  break;
+	}
+	a = b;
+	b = c;
+	score_b = score_c;
+      }
+
+      // golden section
+      while(bracketed && score_b>target_score && (c-a)>min_step){
+	float x;
+	if((c-b)>(b-a)) x = b+golden*(c-b);
+	else x = b-golden*(b-a);
+	posture[index] = std::max(min,std::min(max,origin+sign*x));
+	float score_x = score(posture);
+	if(score_x<score_b){
+	  if(x>b) a = b;
+	  else c = b;
+	  b = x;
+	  score_b = score_x;
+	} else {
+	  if(x>b) c = x;
+	  else a = x;
+	}
+      }
+
+      posture[index] = std::max(min,std::min(max,origin+sign*b));
+      current_score = score_b;
+
+      return b;
+
+    }
+
+
+    // ADAPTIVE_LINE_SEARCH: each joint has its own step, which persists over rounds.
+    // Each round probes (at +/- their step) the joints of the priority groups, in order of
+    // priority, and runs a line search along the best joint of the first group that improves.
+    // The step of a joint is set to the distance last moved along it, and halved when its probes
+    // do not improve. Fails once no joint improves with all steps at min_step.
+    template<class Posture, class Score>
+    bool _minimize_adaptive(Posture &posture,
+			    const std::vector< std::vector<int> > &minimization_order,
+			    const Posture &min,
+			    const Posture &max,
+			    float target_score,
+			    float max_step,
+			    float min_step,
+			    int max_iterations,
+			    Score &score,
+			    float &current_score){
+
+      PLAYFUL_KINEMATICS_TRACE("minimize_adaptive");
+
+      Posture steps(posture);
+      for(int i=0;i<steps.size();i++) steps[i]=max_step;
+
+      // same budget as the fixed step search: max_iterations per joint per decade
+      int nb_levels = 0;
+      for(float step=max_step; step>=(min_step/2.0); step/=10.0) nb_levels++;
+      long max_rounds = (long)max_iterations*posture.size()*std::max(nb_levels,1);
+
+      current_score = _current_score(posture,score,current_score);
+      if(current_score<=target_score) return true;
+
+      for(long round=0; round<max_rounds; round++){
+
+	bool improved = false;
+	bool converged = true;
+
+	for(int g=0; g<minimization_order.size() && !improved; g++){
+
+	  const std::vector<int> &indexes = minimization_order[g];
+
+	  float best_score = current_score;
+	  int best_index = -1;
+	  float best_sign = 0;
+
+	  for(int i=0;i<indexes.size();i++){
+	    int index = indexes[i];
+	    float step = steps[index];
+	    if ( (posture[index]+step) < max[index] ){
+	      float s = _get_score(posture,index,+step,score);
+	      if(s<best_score){
+		best_score = s;
+		best_index = index;
+		best_sign = +1.0;
+	      }
+	    }
+	    if ( (posture[index]-step) > min[index] ) {
+	      float s = _get_score(posture,index,-step,score);
+	      if(s<best_score){
+		best_score = s;
+		best_index = index;
+		best_sign = -1.0;
+	      }
+	    }
+	  }
+
+	  if(best_index>=0 && std::abs(best_score-current_score)>(target_score/10.0)){
+	    float moved = _line_search(posture,best_index,best_sign,
+				       min[best_index],max[best_index],
+				       steps[best_index],best_score,
+				       min_step,target_score,score,current_score);
+	    steps[best_index] = std::max(min_step,std::min(max_step,moved));
+	    improved = true;
+	    continue;
+	  }
+
+	  for(int i=0;i<indexes.size();i++){
+	    int index = indexes[i];
+	    if(steps[index]>min_step){
+	      steps[index] = std::max(min_step,steps[index]/2.0f);
+	      converged = false;
+	    }
+	  }
+
+	}
+
+	if(current_score<=target_score) return true;
+	if(!improved && converged) return false;
+
+      }
+
+      return false;
+
+    }
+
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const std::vector<int> &minimization_priority,
+		const std::map<int,float> &min,
+		const std::map<int,float> &max,
+		float target_score,
+		float max_step,
+		float min_step,
+		int max_iterations,
+		Score &&score,
+		float &final_score,
+		line_search search){
+
+    std::vector< std::vector<int> > minimization_order = soma_internal::_minimization_order(minimization_priority);
+
+    Posture min_limits(posture);
+    Posture max_limits(posture);
+    soma_internal::_limits(min,min_limits);
+    soma_internal::_limits(max,max_limits);
+    soma_internal::_drop_frozen(min_limits,max_limits,minimization_order);
+
+    return minimize(posture,
+		    minimization_order,
+		    min_limits,max_limits,
+		    target_score,
+		    max_step,min_step,
+		    max_iterations,
+		    std::forward<Score>(score),
+		    final_score,
+		    search);
+
+  }
+
+
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const std::vector< std::vector<int> > &minimization_order,
+		const Posture &min_limits,
+		const Posture &max_limits,
+		float target_score,
+		float max_step,
+		float min_step,
+		int max_iterations,
+		Score &&score,
+		float &final_score,
+		line_search search){
+
+    PLAYFUL_KINEMATICS_TRACE("minimize");
+
+    typedef typename std::remove_reference<Score>::type score_type;
+    soma_internal::score_memo<score_type,posture_size<Posture>::value> memo(score,posture.size());
+
+    get_soma_counters().nb_minimizations++;
+
+    // score of the current posture, kept up to date by the functions above
+    final_score = std::numeric_limits<float>::quiet_NaN();
+
+    // all dimensions frozen: nothing to minimize
+    if(minimization_order.empty()){
+      final_score = memo(posture);
+      return final_score<=target_score;
+    }
+
+    if(search==ADAPTIVE_LINE_SEARCH){
+      bool success = soma_internal::_minimize_adaptive(posture, minimization_order,
+						       min_limits, max_limits,
+						       target_score,
+						       max_step, min_step,
+						       max_iterations, memo, final_score);
+      if(final_score!=final_score) final_score = memo(posture);
+      return success;
+    }
+
+    bool success;
+    float step = max_step;
+
+    while (step>=(min_step/2.0)){
+
+      success = soma_internal::_minimize_step(posture, minimization_order,
+					      min_limits, max_limits,
+					      target_score, step,
+					      max_iterations, memo, final_score);
+
+      if (success) {
+	return true;
+      }
+
+      step = step/10.0;
+
+    }
+
+    if(final_score!=final_score) final_score = memo(posture);
+
+    return false;
+
+  }
+
+
+  template<class Posture, class Score>
+  bool minimize(Posture &posture,
+		const std::map<int,float> &min,
+		const std::map<int,float> &max,
+		float target_score,
+		float max_step,
+		float min_step,
+		int max_iterations,
+		Score &&score,
+		float &final_score,
+		line_search search){
+
+    std::vector<int> minimization_priority(posture.size(),1);
+
+    return minimize(posture,
+		    minimization_priority,
+		    min,max,
+		    target_score,
+		    max_step,min_step,
+		    max_iterations,
+		    score,
+		    final_score,
+		    search);
+
+  }
+
+
+}
@@ -0,0 +1,189 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <stdint.h>
+
+namespace playful_kinematics {
+
+  /**
+   * Collects samples (e.g. latencies) and reports their distribution.
+   * Used by the tools and benchmarks.
+   */
+  class sample_stats {
+
+  public:
+
+    /*! reserves memory for nb samples, so that add does not allocate */
+    void reserve(int nb){
+      this->samples.reserve(nb);
+    }
+
+    void add(double value){
+      this->samples.push_back(value);
+    }
+
+    int size() const {
+      return this->samples.size();
+    }
+
+    /*! p in [0,1], e.g. 0.99 for the 99th percentile */
+    double percentile(double p){
+      if(this->samples.empty()) return 0;
+      std::sort(this->samples.begin(),this->samples.end());
+      int index = (int)(p*(this->samples.size()-1)+0.5);
+      return this->samples[index];
+    }
+
+    double mean() const {
+      if(this->samples.empty()) return 0;
+      double sum = 0;
+      for(int i=0;i<this->samples.size();i++) sum+=this->samples[i];
+      return sum/this->samples.size();
+    }
+
+    /*! prints: label, number of samples, mean, min, p50, p99, p99.9, max */
+    void print(const std::string &label, const std::string &unit){
+      std::cout << std::setw(24) << std::left << label << std::right
+		<< " n=" << this->size()
+		<< std::fixed << std::setprecision(3)
+		<< "  mean=" << this->mean()
+		<< "  min=" << this->percentile(0.0)
+		<< "  p50=" << this->percentile(0.5)
+		<< "  p99=" << this->percentile(0.99)
+		<< "  p99.9=" << this->percentile(0.999)
+		<< "  max=" << this->percentile(1.0)
+		<< " (" << unit << ")" << std::endl;
+    }
+
+  private:
+
+    std::vector<double> samples;
+
+  };
+
+
+  /**
+   * Histogram of latencies (nano seconds) with buckets of constant relative width
+   * (as HdrHistogram): values below 2^SUB_BUCKET_BITS are exact, larger values are
+   * recorded with a relative error below 1/2^SUB_BUCKET_BITS (3 %).
+   * Memory is allocated by the constructor only: record does not allocate, and
+   * recording millions of values uses a few kilo bytes. Histograms of several threads
+   * are combined with merge.
+   */
+  class latency_histogram {
+
+  public:
+
+    static const int SUB_BUCKET_BITS = 5;
+    static const int NB_SUB_BUCKETS = 1<<SUB_BUCKET_BITS;
+    static const int NB_BUCKETS = (64-SUB_BUCKET_BITS)*NB_SUB_BUCKETS;
+
+    latency_histogram()
+      : counts(NB_BUCKETS,0), nb_values(0), sum(0), max(0) {}
+
+    void record(int64_t nanoseconds){
+      if(nanoseconds<0) nanoseconds = 0;
+      this->counts[_index(nanoseconds)]++;
+      this->nb_values++;
+      this->sum += nanoseconds;
+      if(nanoseconds>this->max) this->max = nanoseconds;
+    }
+
+    void merge(const latency_histogram &other){
+      for(int i=0;i<NB_BUCKETS;i++) this->counts[i] += other.counts[i];
+      this->nb_values += other.nb_values;
+      this->sum += other.sum;
+      if(other.max>this->max) this->max = other.max;
+    }
+
+    void reset(){
+      std::fill(this->counts.begin(),this->counts.end(),0);
+      this->nb_values = 0;
+      this->sum = 0;
+      this->max = 0;
+    }
+
+    int64_t size() const {
+      return this->nb_values;
+    }
+
+    /*! nano seconds */
+    double mean() const {
+      if(this->nb_values==0) return 0;
+      return (double)this->sum/this->nb_values;
+    }
+
+    /*! nano seconds, p in [0,1] (e.g. 0.999 for the 99.9th percentile) */
+    double percentile(double p) const {
+      if(this->nb_values==0) return 0;
+      if(p>=1.0) return this->max;
+      int64_t rank = (int64_t)(p*(this->nb_values-1))+1;
+      int64_t nb = 0;
+      for(int i=0;i<NB_BUCKETS;i++){
+	nb += this->counts[i];
+	if(nb>=rank) return std::min((double)this->max,_value(i));
+      }
+      return this->max;
+    }
+
+    /*! prints: label, number of values, mean, p50, p90, p99, p99.9, p99.99, max (micro seconds) */
+    void print(const std::string &label) const {
+      std::cout << std::setw(24) << std::left << label << std::right
+		<< " n=" << this->size()
+		<< std::fixed << std::setprecision(3)
+		<< "  mean=" << this->mean()/1000.0
+		<< "  p50=" << this->percentile(0.5)/1000.0
+		<< "  p90=" << this->percentile(0.9)/1000.0
+		<< "  p99=" << this->percentile(0.99)/1000.0
+		<< "  p99.9=" << this->percentile(0.999)/1000.0
+		<< "  p99.99=" << this->percentile(0.9999)/1000.0
+		<< "  max=" << this->max/1000.0
+		<< " (us)" << std::endl;
+    }
+
+  private:
+
+    static int _index(int64_t value){
+      if(value<NB_SUB_BUCKETS) return value;
+      int exponent = 63-__builtin_clzll(value);
+      int shift = exponent-SUB_BUCKET_BITS;
+      return ((shift+1)<<SUB_BUCKET_BITS) + (int)((value>>shift)-NB_SUB_BUCKETS);
+    }
+
+    // middle of the bucket
+    static double _value(int index){
+      if(index<NB_SUB_BUCKETS) return index;
+      int shift = (index>>SUB_BUCKET_BITS)-1;
+      int64_t lower = (int64_t)(NB_SUB_BUCKETS+(index&(NB_SUB_BUCKETS-1)))<<shift;
+      return lower+0.5*((int64_t)1<<shift);
+    }
+
+    std::vector<int64_t> counts;
+    int64_t nb_values;
+    int64_t sum;
+    int64_t max;
+
+  };
+
+}
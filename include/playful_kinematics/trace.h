@@ -0,0 +1,109 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Author : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <stdint.h>
+
+
+/**
+ * Scoped tracing of the phases of inverse kinematics (ik, minimize, _minimize_step,
+ * _select_best, _line_search, forward kinematics).
+ *
+ * Tracing is compiled in only if the CMake option PLAYFUL_KINEMATICS_TRACING is ON
+ * (which defines the macro of the same name). Otherwise PLAYFUL_KINEMATICS_TRACE
+ * expands to nothing, and tracing has no cost.
+ *
+ * Each thread records its events in its own buffer of TRACE_BUFFER_SIZE events
+ * (single producer / single consumer, no lock, no allocation once the buffer of
+ * the thread exists). Events recorded while the buffer is full are dropped.
+ * write_trace drains the buffers of all threads into a Chrome trace file (json,
+ * opened by chrome://tracing or https://ui.perfetto.dev).
+ * If the environment variable PLAYFUL_KINEMATICS_TRACE is set to a file path, the
+ * events not yet written are written to this file at exit.
+ */
+
+
+#ifdef PLAYFUL_KINEMATICS_TRACING
+#define PLAYFUL_KINEMATICS_TRACE_CONCAT_(a,b) a##b
+#define PLAYFUL_KINEMATICS_TRACE_CONCAT(a,b) PLAYFUL_KINEMATICS_TRACE_CONCAT_(a,b)
+/*! records the time spent until the end of the enclosing scope, name being a string literal */
+#define PLAYFUL_KINEMATICS_TRACE(name)					\
+  playful_kinematics::trace_internal::trace_scope PLAYFUL_KINEMATICS_TRACE_CONCAT(_trace_scope_,__LINE__)(name)
+#else
+#define PLAYFUL_KINEMATICS_TRACE(name)
+#endif
+
+
+namespace playful_kinematics {
+
+
+  /*! number of events each thread may record between two calls to write_trace */
+  static const int TRACE_BUFFER_SIZE = 1<<16;
+
+
+  /*! true if tracing has been compiled in (see PLAYFUL_KINEMATICS_TRACING) */
+  bool is_tracing_enabled();
+
+  /*! writes the events recorded since the previous call (by all threads) to
+      a Chrome trace file, and removes them from the buffers */
+  bool write_trace(const std::string &path);
+
+  /*! removes the events recorded so far */
+  void clear_trace();
+
+  /*! number of events dropped because the buffer of their thread was full */
+  long get_nb_dropped_trace_events();
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+  namespace trace_internal {
+
+    inline int64_t now(){
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /*! adds the event to the buffer of the calling thread */
+    void record(const char *name, int64_t begin, int64_t end);
+
+    class trace_scope {
+
+    public:
+
+      trace_scope(const char *name)
+	: name(name), begin(now()) {}
+
+      ~trace_scope(){
+	record(this->name,this->begin,now());
+      }
+
+    private:
+
+      const char *name;
+      int64_t begin;
+
+    };
+
+  }
+
+  /* END OF BACK END FUNCTIONS */
+
+}
@@ -0,0 +1,80 @@
+# Copyright  (C)  2018 Max Planck Gesellschaft
+# Author : Vincent Berenz
+
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+# loads datasets written by <robot>_fk_dataset_generator (see include/playful_kinematics/fk_dataset.h)
+# without parsing nor copying: data is memory mapped.
+
+
+_MAGIC = 0x315344464b50
+
+_HEADER_FIELDS = ["magic","version","nb_samples","nb_joints","nb_columns",
+                  "chunk_size","nb_chunks","data_offset","left","sampling","seed"]
+
+_CARTESIAN = ["x","y","z","alpha","beta","gamma"]
+
+
+class FK_dataset:
+
+    ##
+    # @param path file written by <robot>_fk_dataset_generator
+    def __init__(self,path):
+
+        import numpy
+
+        values = numpy.fromfile(path,dtype="<i8",count=len(_HEADER_FIELDS))
+        self.header = dict(zip(_HEADER_FIELDS,[int(v) for v in values]))
+
+        if self.header["magic"]!=_MAGIC:
+            raise Exception("not a playful kinematics fk dataset: "+str(path))
+
+        nb_joints = self.header["nb_joints"]
+        limits = numpy.fromfile(path,dtype="<f8",count=2*nb_joints,offset=128) if nb_joints else []
+        self.min = list(limits[:nb_joints])
+        self.max = list(limits[nb_joints:])
+
+        self.nb_samples = self.header["nb_samples"]
+
+        # shape (nb_chunks, nb_columns, chunk_size)
+        self.chunks = numpy.memmap(path,dtype="<f4",mode="r",
+                                   offset=self.header["data_offset"],
+                                   shape=(self.header["nb_chunks"],
+                                          self.header["nb_columns"],
+                                          self.header["chunk_size"]))
+
+    ##
+    # @param index column index: joints first, then x,y,z,alpha,beta,gamma
+    # @return 1d array of nb_samples values (copied in memory)
+    def column(self,index):
+        return self.chunks[:,index,:].reshape(-1)[:self.nb_samples]
+
+    ##
+    # @param name one of x,y,z,alpha,beta,gamma
+    # @return 1d array of nb_samples values (copied in memory)
+    def cartesian(self,name):
+        return self.column(self.header["nb_joints"]+_CARTESIAN.index(name))
+
+    ##
+    # iterates over chunks without loading the full dataset in memory
+    # @return tuples (postures, poses) of shapes (n,nb_joints) and (n,6)
+    def iterate(self):
+        nb_joints = self.header["nb_joints"]
+        chunk_size = self.header["chunk_size"]
+        for chunk_index in range(self.header["nb_chunks"]):
+            n = min(chunk_size,self.nb_samples-chunk_index*chunk_size)
+            chunk = self.chunks[chunk_index]
+            yield chunk[:nb_joints,:n].T, chunk[nb_joints:,:n].T
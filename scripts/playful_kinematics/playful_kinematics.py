@@ -91,6 +91,73 @@ class IK:
     
 
 
+    ##
+    # inverse kinematics will start from the best of the reference posture and
+    # of the closest postures found in the atlas (see pepper_posture_atlas)
+    # @param left if true, left end-effector, otherwise right end-effector
+    # @param path atlas file, or None to stop using an atlas
+    # @param nb_seeds number of postures of the atlas tried
+    # @return True if the atlas could be loaded
+    def set_atlas(self,left,path,nb_seeds=4):
+
+        return self._playful_ik.set_atlas(left,path,nb_seeds)
+
+
+    ##
+    # by default, the minimization moves joints by fixed steps (divided by 10 down to
+    # the minimal step). The adaptive line search doubles the step along a joint as long
+    # as the score improves, then refines by golden section, requiring fewer score
+    # evaluations for long moves.
+    # @param left if true, left end-effector, otherwise right end-effector
+    # @param adaptive if true, adaptive line search, otherwise fixed steps
+    def set_line_search(self,left,adaptive):
+
+        self._playful_ik.set_line_search(left,adaptive)
+
+
+    ##
+    # writes the phases of the inverse kinematics jobs run since the previous call
+    # to a Chrome trace file (chrome://tracing or https://ui.perfetto.dev). Requires
+    # the library to be compiled with the cmake option PLAYFUL_KINEMATICS_TRACING
+    # @param path trace file (json)
+    # @return True if the file could be written
+    def write_trace(self,path):
+
+        return self._playful_ik.write_trace(path)
+
+
+    ##
+    # starts recording the calls to the library (inverse and forward kinematics, configuration),
+    # with their inputs, results and durations, to a capture file which can be replayed
+    # against another build of the library by pepper_capture_replay. Capture can also be
+    # started when the library is loaded, by setting the environment variable
+    # PLAYFUL_KINEMATICS_CAPTURE to the path of the capture file
+    # @param path capture file (overwritten)
+    # @return True if the capture started
+    def start_capture(self,path):
+
+        return self._playful_ik.start_capture(path)
+
+
+    ##
+    # stops the capture started by start_capture, and closes the capture file
+    def stop_capture(self):
+
+        self._playful_ik.stop_capture()
+
+
+    ##
+    # sets the solver profile (minimization engine and parameters, e.g. written by
+    # pepper_solver_tuner) used by the next inverse kinematics jobs of both end effectors.
+    # A profile can also be loaded when the library is loaded, by setting the environment
+    # variable PLAYFUL_KINEMATICS_SOLVER_PROFILE to the path of the profile file
+    # @param path solver profile file
+    # @return True if the file could be read
+    def load_solver_profile(self,path):
+
+        return self._playful_ik.load_solver_profile(path)
+
+
     ##
     # Inverse kinematics job, using current configuration
     # @param left if true, left end-effector, otherwise right end-effector
@@ -39,6 +39,7 @@ class _Configuration:
         self.nb_dofs = len(joints)
         self.__class__.configurations[robot_name]=self
         self.blocked_joints = {}
+        self.handle = None
         self.minimization_priority = {}
         try :
             max_priority = max(minimization_priority.values())
@@ -82,24 +83,65 @@ class _Configuration:
                                                 ctypes.c_bool,
                                                 ctypes.c_bool)
 
-        c_floats = [ctypes.POINTER(ctypes.c_float)]*(self.nb_dofs+1)
-
-        
-        if self.nb_dofs==5 : self.kinematics_function = self.kinematics_lib.ik_5dofs
-        elif self.nb_dofs==6 : self.kinematics_function = self.kinematics_lib.ik_6dofs
-        elif self.nb_dofs==7 : self.kinematics_function = self.kinematics_lib.ik_7dofs
-        elif self.nb_dofs==8 : self.kinematics_function = self.kinematics_lib.ik_8dofs
-        else :
-            raise Exception("playful kinematics supports only 5 to 8 dofs")
+        # any number of dofs, the posture being passed as an array
+        self.kinematics_function = self.kinematics_lib.ik_ndofs
 
         self.kinematics_function.argtypes = (ctypes.c_bool,
                                              ctypes.c_float,ctypes.c_float,ctypes.c_float,
-                                             ctypes.c_float,ctypes.c_float,ctypes.c_float) + tuple(c_floats)
+                                             ctypes.c_float,ctypes.c_float,ctypes.c_float,
+                                             ctypes.c_int,
+                                             ctypes.POINTER(ctypes.c_float),
+                                             ctypes.POINTER(ctypes.c_float))
 
 
         self.kinematics_lib.set_kinematics_joint_limit.argtypes = (ctypes.c_int,ctypes.c_float,ctypes.c_float)
 
         self.kinematics_lib.set_minimization_priority.argtypes = (ctypes.c_int,ctypes.c_int)
+
+        # resident configuration of this end effector in the library (not provided by the
+        # server client library, which then uses the shared configuration). Only the
+        # priorities and limits which changed are pushed to it.
+        self._set_handle()
+
+
+    def _set_handle(self):
+
+        lib = self.kinematics_lib
+
+        if getattr(self,"handle",None):
+            self.handle_lib.delete_kinematics_handle(self.handle)
+        self.handle = None
+        self.handle_lib = None
+        self.pushed = {}
+
+        if not hasattr(lib,"create_kinematics_handle"):
+            return
+
+        lib.create_kinematics_handle.restype = ctypes.c_void_p
+        lib.delete_kinematics_handle.argtypes = (ctypes.c_void_p,)
+        lib.handle_set_joint_limit.argtypes = (ctypes.c_void_p,ctypes.c_bool,
+                                               ctypes.c_int,ctypes.c_float,ctypes.c_float)
+        lib.handle_set_minimization_priority.argtypes = (ctypes.c_void_p,ctypes.c_bool,
+                                                         ctypes.c_int,ctypes.c_int)
+        lib.handle_set_line_search.argtypes = (ctypes.c_void_p,ctypes.c_bool,ctypes.c_int)
+        lib.handle_ik.argtypes = (ctypes.c_void_p,ctypes.c_bool,
+                                  ctypes.c_float,ctypes.c_float,ctypes.c_float,
+                                  ctypes.c_float,ctypes.c_float,ctypes.c_float,
+                                  ctypes.POINTER(ctypes.c_bool),
+                                  ctypes.c_int,
+                                  ctypes.POINTER(ctypes.c_float),
+                                  ctypes.POINTER(ctypes.c_float))
+
+        self.handle = lib.create_kinematics_handle()
+        self.handle_lib = lib
+        self.mask = (ctypes.c_bool*6)(*([True]*6))
+        self._update()
+
+
+    def __del__(self):
+
+        if getattr(self,"handle",None):
+            self.handle_lib.delete_kinematics_handle(self.handle)
         
         
 
@@ -147,33 +189,94 @@ class _Configuration:
         
     def set_ik_mask(self,mask):
 
+        if self.handle:
+            self.mask = (ctypes.c_bool*6)(*mask)
+            return
+
         mask_  = [ctypes.c_bool(m) for m in mask]
         self.kinematics_lib.set_mask(*mask_)
 
 
-    def _update(self):
+    def set_line_search(self,adaptive):
 
-        for index,joint in enumerate(self.joints):
+        search = ctypes.c_int(1 if adaptive else 0)
+
+        if self.handle:
+            self.kinematics_lib.handle_set_line_search(self.handle,self.left,search)
+            return
+
+        self.kinematics_lib.set_kinematics_line_search(search)
 
-            index_ = ctypes.c_int(index)
-            priority = ctypes.c_int(self.minimization_priority[joint])
 
-            self.kinematics_lib.set_minimization_priority(index_,priority)
+    # priority, min and max of each joint
+    def _joints_configuration(self):
+
+        for index,joint in enumerate(self.joints):
 
             min_,max_ = self.joints_limits[joint]
-            try :
-                value = self.blocked_joints[joint]
-                min_ = value
-                max_ = value
-            except:
-                pass
+            if joint in self.blocked_joints:
+                min_ = self.blocked_joints[joint]
+                max_ = min_
+
+            yield index,self.minimization_priority[joint],float(min_),float(max_)
+
 
-            min_ = ctypes.c_float(min_)
-            max_ = ctypes.c_float(max_)
-            self.kinematics_lib.set_kinematics_joint_limit(index_,min_,max_)
+    # pushes to the handle the priorities and limits which changed
+    def _update_handle(self):
 
+        for index,priority,min_,max_ in self._joints_configuration():
 
+            pushed = self.pushed.get(index)
+
+            if pushed is None or pushed[0]!=priority:
+                self.kinematics_lib.handle_set_minimization_priority(self.handle,self.left,
+                                                                     index,priority)
+            if pushed is None or pushed[1:]!=(min_,max_):
+                self.kinematics_lib.handle_set_joint_limit(self.handle,self.left,
+                                                           index,min_,max_)
+
+            self.pushed[index] = (priority,min_,max_)
+
+
+    # all priorities and limits are published at once: inverse kinematics
+    # running concurrently never uses a partially updated configuration
+    def _update(self):
+
+        if self.handle:
+            self._update_handle()
+            return
+
+        self.kinematics_lib.begin_kinematics_config_update()
+
+        try :
+
+            for index,joint in enumerate(self.joints):
+
+                index_ = ctypes.c_int(index)
+                priority = ctypes.c_int(self.minimization_priority[joint])
+
+                self.kinematics_lib.set_minimization_priority(index_,priority)
+
+                min_,max_ = self.joints_limits[joint]
+                try :
+                    value = self.blocked_joints[joint]
+                    min_ = value
+                    max_ = value
+                except:
+                    pass
+
+                min_ = ctypes.c_float(min_)
+                max_ = ctypes.c_float(max_)
+                self.kinematics_lib.set_kinematics_joint_limit(index_,min_,max_)
+
+        finally :
+
+            self.kinematics_lib.end_kinematics_config_update()
+
+
+    # with a handle, the configuration is already resident in the library
     def prepare_ik(self,mask):
         self.set_ik_mask(mask)
-        self._update()
+        if not self.handle:
+            self._update()
         
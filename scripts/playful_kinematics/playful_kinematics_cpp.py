@@ -23,6 +23,9 @@ from playful_kinematics_configuration import _Configuration
 # goes up directories until finding devel, then finding
 # the c++ libraries from there.
 # assumes things have been compiled using "catkin_make"
+# if the environment variable PLAYFUL_KINEMATICS_SERVER is set,
+# the client library is used, i.e. forward and inverse kinematics
+# are computed by <robot_name>_kinematics_server
 
 def _find_library(robot_name):
 
@@ -53,6 +56,8 @@ def _find_library(robot_name):
     devel = find_devel_folder(path)
 
     lib = devel+"/lib/lib"+robot_name+"_kinematics.so"
+    if os.environ.get("PLAYFUL_KINEMATICS_SERVER"):
+        lib = devel+"/lib/lib"+robot_name+"_kinematics_client.so"
 
     if not os.path.isfile(lib):
         raise Exception("failed to find the library "+lib)
@@ -165,6 +170,68 @@ class _Playful_ik:
         return self._fk(left,current_posture)
 
 
+    # function of the kinematics library which the client library of the
+    # kinematics server (see _find_library) does not provide
+    def _library_function(self,name):
+
+        lib = self.left_config.kinematics_lib
+        if not hasattr(lib,name):
+            raise Exception(name+" is not supported when kinematics are computed by the "+
+                            "kinematics server (environment variable PLAYFUL_KINEMATICS_SERVER set)")
+
+        return getattr(lib,name)
+
+
+    def set_atlas(self,left,path,nb_seeds=4):
+
+        if left:
+            config = self.left_config
+        else :
+            config = self.right_config
+
+        if path is None:
+            self._library_function("clear_ik_atlas")(ctypes.c_bool(left))
+            return True
+
+        return self._library_function("set_ik_atlas_file")(ctypes.c_bool(left),
+                                                           ctypes.c_char_p(path.encode()),
+                                                           ctypes.c_int(nb_seeds))
+
+
+    def set_line_search(self,left,adaptive):
+
+        if left:
+            config = self.left_config
+        else :
+            config = self.right_config
+
+        config.set_line_search(adaptive)
+
+
+    def write_trace(self,path):
+
+        return self._library_function("write_kinematics_trace")(ctypes.c_char_p(path.encode()))
+
+
+    def start_capture(self,path):
+
+        start_capture = self._library_function("start_kinematics_capture")
+        start_capture.restype = ctypes.c_bool
+        return start_capture(ctypes.c_char_p(path.encode()))
+
+
+    def stop_capture(self):
+
+        self._library_function("stop_kinematics_capture")()
+
+
+    def load_solver_profile(self,path):
+
+        load_profile = self._library_function("load_kinematics_solver_profile")
+        load_profile.restype = ctypes.c_bool
+        return load_profile(ctypes.c_char_p(path.encode()))
+
+
     def block_joints(self,left,joints_values):
         
         if left:
@@ -204,17 +271,25 @@ class _Playful_ik:
         x,y,z = [0 if v is None else ctypes.c_float(v) for v in target_xyz]
         alpha,beta,gamma = [0 if v is None else ctypes.c_float(v) for v in target_abg]
 
-        joints = [ctypes.c_float(reference_posture[joint]) for joint in config.joints]
-        byrefs = [ctypes.byref(joint) for joint in joints]
+        nb_dofs = len(config.joints)
+        joints = (ctypes.c_float*nb_dofs)(*[reference_posture[joint] for joint in config.joints])
         score = ctypes.c_float(0)
-        score_ = ctypes.byref(score)
-        byrefs.append(score_)
 
-        success = config.kinematics_function(left,
-                                             x,y,z,
-                                             alpha,beta,gamma,
-                                             *byrefs)
+        if config.handle:
+            # single call, the configuration being resident in the library
+            success = config.kinematics_lib.handle_ik(config.handle,left,
+                                                      x,y,z,
+                                                      alpha,beta,gamma,
+                                                      config.mask,
+                                                      nb_dofs,joints,
+                                                      ctypes.byref(score))
+        else:
+            success = config.kinematics_function(left,
+                                                 x,y,z,
+                                                 alpha,beta,gamma,
+                                                 nb_dofs,joints,
+                                                 ctypes.byref(score))
 
         
-        return success,score.value,[joint.value for joint in joints]
+        return success,score.value,[joint for joint in joints]
 
@@ -0,0 +1,442 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/capture.h"
+#include "playful_kinematics/kinematic_config.h"
+#include <boost/shared_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static const char *CAPTURE_ENV = "PLAYFUL_KINEMATICS_CAPTURE";
+
+  // period of the flushes of the buffers to the file
+  static const int CAPTURE_FLUSH_PERIOD = 20; // milliseconds
+
+
+  std::atomic<bool> capture_internal::capturing(false);
+
+
+  // records of one thread: written by this thread (head), flushed by the flush thread (tail)
+  class capture_buffer {
+
+  public:
+
+    capture_buffer(uint32_t thread)
+      : thread(thread), bytes(CAPTURE_BUFFER_SIZE), head(0), tail(0), finished(false) {}
+
+    uint32_t thread;
+    std::vector<char> bytes;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    // set when the thread exits, the buffer is then removed once flushed
+    std::atomic<bool> finished;
+
+  };
+
+
+  class capture_registry {
+
+  public:
+
+    capture_registry() : nb_threads(0), session(0), stop(true), sequence(0), nb_dropped(0) {}
+
+    // protects buffers and file
+    std::mutex mutex;
+    std::vector< boost::shared_ptr<capture_buffer> > buffers;
+    uint32_t nb_threads;
+    std::ofstream file;
+
+    // protects session and stop
+    std::mutex flush_mutex;
+    std::condition_variable flush_condition;
+    std::thread flush_thread;
+    unsigned long session;
+    bool stop;
+
+    std::atomic<uint64_t> sequence;
+    std::atomic<long> nb_dropped;
+
+  };
+
+
+  static capture_registry& _get_registry(){
+    static capture_registry registry;
+    return registry;
+  }
+
+
+  // buffer of the calling thread, created and registered on first use
+  class capture_buffer_handle {
+
+  public:
+
+    ~capture_buffer_handle(){
+      if(this->buffer) this->buffer->finished.store(true,std::memory_order_release);
+    }
+
+    capture_buffer& get(){
+      if(!this->buffer){
+	capture_registry &registry = _get_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	this->buffer.reset(new capture_buffer(registry.nb_threads++));
+	registry.buffers.push_back(this->buffer);
+      }
+      return *this->buffer;
+    }
+
+  private:
+
+    boost::shared_ptr<capture_buffer> buffer;
+
+  };
+
+
+  // writes size bytes in the ring at position (wrapping around)
+  static void _ring_write(std::vector<char> &ring, uint64_t position, const char *data, uint64_t size){
+    uint64_t begin = position & (CAPTURE_BUFFER_SIZE-1);
+    uint64_t first = std::min(size,(uint64_t)CAPTURE_BUFFER_SIZE-begin);
+    std::memcpy(&ring[begin],data,first);
+    std::memcpy(&ring[0],data+first,size-first);
+  }
+
+
+  // writes size bytes of the ring from position (wrapping around) to out
+  static void _ring_read(const std::vector<char> &ring, uint64_t position, uint64_t size, std::ostream &out){
+    uint64_t begin = position & (CAPTURE_BUFFER_SIZE-1);
+    uint64_t first = std::min(size,(uint64_t)CAPTURE_BUFFER_SIZE-begin);
+    out.write(&ring[begin],first);
+    out.write(&ring[0],size-first);
+  }
+
+
+  void capture_internal::push(const char *record, int size){
+
+    capture_registry &registry = _get_registry();
+
+    if(size>CAPTURE_RECORD_SIZE){
+      registry.nb_dropped.fetch_add(1,std::memory_order_relaxed);
+      return;
+    }
+
+    static thread_local capture_buffer_handle handle;
+    capture_buffer &buffer = handle.get();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if(head+size-buffer.tail.load(std::memory_order_acquire) > CAPTURE_BUFFER_SIZE){
+      registry.nb_dropped.fetch_add(1,std::memory_order_relaxed);
+      return;
+    }
+
+    // the index of the thread is known once its buffer exists
+    capture_record_header header;
+    std::memcpy(&header,record,sizeof(header));
+    header.thread = buffer.thread;
+    _ring_write(buffer.bytes,head,reinterpret_cast<const char*>(&header),sizeof(header));
+    _ring_write(buffer.bytes,head+sizeof(header),record+sizeof(header),size-sizeof(header));
+
+    buffer.head.store(head+size,std::memory_order_release);
+
+  }
+
+
+  uint64_t capture_internal::next_sequence(){
+    return _get_registry().sequence.fetch_add(1,std::memory_order_relaxed);
+  }
+
+
+  int64_t capture_internal::now(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+
+  // writes the records of all buffers to the file (if open). Buffers of exited threads
+  // are removed once flushed
+  static void _flush(capture_registry &registry){
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    bool open = registry.file.is_open();
+
+    for(int b=registry.buffers.size()-1;b>=0;b--){
+
+      capture_buffer &buffer = *registry.buffers[b];
+      bool finished = buffer.finished.load(std::memory_order_acquire);
+      uint64_t head = buffer.head.load(std::memory_order_acquire);
+      uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+
+      if(open) _ring_read(buffer.bytes,tail,head-tail,registry.file);
+      buffer.tail.store(head,std::memory_order_release);
+
+      if(finished) registry.buffers.erase(registry.buffers.begin()+b);
+
+    }
+
+    if(open) registry.file.flush();
+
+  }
+
+
+  static void _flush_periodically(){
+    capture_registry &registry = _get_registry();
+    std::unique_lock<std::mutex> lock(registry.flush_mutex);
+    while(!registry.stop){
+      registry.flush_condition.wait_for(lock,std::chrono::milliseconds(CAPTURE_FLUSH_PERIOD));
+      lock.unlock();
+      _flush(registry);
+      lock.lock();
+    }
+  }
+
+
+  template<class T>
+  static void _add_map(capture_record &record, const std::map<int,T> &map){
+    std::vector<int32_t> indexes;
+    std::vector<T> values;
+    for(typename std::map<int,T>::const_iterator it=map.begin();it!=map.end();it++){
+      indexes.push_back(it->first);
+      values.push_back(it->second);
+    }
+    record.add(indexes.size(),indexes.data());
+    record.add(values.size(),values.data());
+  }
+
+
+  // current global configuration, recorded when the capture starts
+  static void _snapshot(){
+
+    capture_record record(CAPTURE_CONFIG_SNAPSHOT);
+
+    std::vector<float> reference;
+    get_kinematics_joints(reference);
+    std::vector<bool> mask = get_kinematics_mask();
+    bool bool_mask[6];
+    for(int i=0;i<6;i++) bool_mask[i] = i<mask.size() ? mask[i] : true;
+    std::map<int,int> priorities;
+    std::vector<int> priority = get_minimization_priority(get_kinematics_nb_joints());
+    for(int i=0;i<priority.size();i++) priorities[i] = priority[i];
+
+    record.add(get_kinematics_side());
+    record.add((int32_t)get_kinematics_line_search());
+    record.add(reference.size(),reference.data());
+    record.add_fixed(6,bool_mask);
+    _add_map(record,get_kinematics_joint_min_limit());
+    _add_map(record,get_kinematics_joint_max_limit());
+    _add_map(record,priorities);
+    add_solver_profile(record,get_kinematics_solver_profile());
+    record.commit();
+
+  }
+
+
+  static void _stop_capture_at_exit(){
+    stop_capture();
+  }
+
+
+  static bool _start_from_environment(){
+    const char *path = std::getenv(CAPTURE_ENV);
+    return path && start_capture(path);
+  }
+
+  static bool started_from_environment = _start_from_environment();
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  bool start_capture(const std::string &path){
+
+    capture_registry &registry = _get_registry();
+    // the flush thread is joined before the registry is destroyed
+    static bool at_exit = (std::atexit(_stop_capture_at_exit)==0);
+    (void)at_exit;
+    std::lock_guard<std::mutex> lock(registry.flush_mutex);
+
+    if(!registry.stop){
+      std::cerr << "playful kinematics: capture already running" << std::endl;
+      return false;
+    }
+
+    // records of calls which ended after the previous capture stopped are discarded
+    _flush(registry);
+
+    {
+      std::lock_guard<std::mutex> file_lock(registry.mutex);
+      registry.file.open(path.c_str(),std::ios::binary | std::ios::trunc);
+      if(!registry.file){
+	std::cerr << "playful kinematics: failed to open capture file " << path << std::endl;
+	registry.file.close();
+	return false;
+      }
+      registry.file.write(reinterpret_cast<const char*>(&CAPTURE_MAGIC),sizeof(int64_t));
+      registry.file.write(reinterpret_cast<const char*>(&CAPTURE_VERSION),sizeof(int64_t));
+    }
+
+    registry.session++;
+    registry.stop = false;
+    capture_internal::capturing.store(true,std::memory_order_release);
+    registry.flush_thread = std::thread(_flush_periodically);
+
+    _snapshot();
+
+    return true;
+
+  }
+
+
+  void stop_capture(){
+
+    capture_registry &registry = _get_registry();
+
+    {
+      std::lock_guard<std::mutex> lock(registry.flush_mutex);
+      if(registry.stop) return;
+      capture_internal::capturing.store(false,std::memory_order_release);
+      registry.stop = true;
+    }
+
+    registry.flush_condition.notify_all();
+    registry.flush_thread.join();
+
+    // records of calls which started before the capture stopped
+    _flush(registry);
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.file.close();
+
+  }
+
+
+  unsigned long get_capture_session(){
+    capture_registry &registry = _get_registry();
+    std::lock_guard<std::mutex> lock(registry.flush_mutex);
+    return registry.session;
+  }
+
+
+  long get_nb_dropped_capture_records(){
+    return _get_registry().nb_dropped.load(std::memory_order_relaxed);
+  }
+
+
+  static bool _sequence_order(const captured_call &a, const captured_call &b){
+    return a.header.sequence<b.header.sequence;
+  }
+
+
+  void add_solver_profile(capture_record &record, const solver_profile &profile){
+    record.add((int32_t)profile.engine);
+    record.add(profile.target_score);
+    record.add(profile.max_step);
+    record.add(profile.min_step);
+    record.add((int32_t)profile.max_iteration);
+    record.add((int32_t)profile.cmaes.population);
+    record.add(profile.cmaes.sigma);
+    record.add((int32_t)profile.cmaes.max_generations);
+    record.add(profile.cmaes.seed);
+    record.add((int32_t)profile.cmaes.nb_threads);
+  }
+
+
+  solver_profile get_solver_profile(capture_payload &payload){
+    solver_profile profile;
+    profile.engine = (solver_engine)payload.get<int32_t>();
+    profile.target_score = payload.get<float>();
+    profile.max_step = payload.get<float>();
+    profile.min_step = payload.get<float>();
+    profile.max_iteration = payload.get<int32_t>();
+    profile.cmaes.population = payload.get<int32_t>();
+    profile.cmaes.sigma = payload.get<float>();
+    profile.cmaes.max_generations = payload.get<int32_t>();
+    profile.cmaes.seed = payload.get<uint64_t>();
+    profile.cmaes.nb_threads = payload.get<int32_t>();
+    return profile;
+  }
+
+
+  bool read_capture(const std::string &path, std::vector<captured_call> &get_calls){
+
+    std::ifstream in(path.c_str(),std::ios::binary);
+    if(!in){
+      std::cerr << "playful kinematics: failed to open capture file " << path << std::endl;
+      return false;
+    }
+
+    int64_t magic = 0, version = 0;
+    in.read(reinterpret_cast<char*>(&magic),sizeof(int64_t));
+    in.read(reinterpret_cast<char*>(&version),sizeof(int64_t));
+    if(!in || magic!=CAPTURE_MAGIC || version!=CAPTURE_VERSION){
+      std::cerr << "playful kinematics: " << path << " is not a capture file of version "
+		<< CAPTURE_VERSION << std::endl;
+      return false;
+    }
+
+    get_calls.clear();
+    capture_record_header header;
+    while(in.read(reinterpret_cast<char*>(&header),sizeof(header))){
+      if(header.size<sizeof(header) || header.size>CAPTURE_RECORD_SIZE){
+	std::cerr << "playful kinematics: corrupted capture file " << path << std::endl;
+	return false;
+      }
+      get_calls.push_back(captured_call());
+      captured_call &call = get_calls.back();
+      call.header = header;
+      call.payload.resize(header.size-sizeof(header));
+      if(!call.payload.empty() && !in.read(call.payload.data(),call.payload.size())){
+	std::cerr << "playful kinematics: truncated capture file " << path << std::endl;
+	return false;
+      }
+    }
+
+    std::stable_sort(get_calls.begin(),get_calls.end(),_sequence_order);
+
+    return true;
+
+  }
+
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+  bool start_kinematics_capture(char *path){
+    return playful_kinematics::start_capture(path);
+  }
+
+  void stop_kinematics_capture(){
+    playful_kinematics::stop_capture();
+  }
+
+}
@@ -0,0 +1,464 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Replays a capture of the calls to the C interface of the library (see capture.h), e.g.
+// recorded from the python wrapper with PLAYFUL_KINEMATICS_CAPTURE=/tmp/session.cap,
+// against this build of the library. Calls are replayed in the order they were made
+// (threads of the capture are serialized), through the same C interface.
+// Reports, for each type of call, the number of calls, the differences between the recorded
+// and replayed results (success, score, posture or pose), and the p50 / p99 durations of the
+// recorded and replayed calls.
+// Exits with 1 if the capture could not be read, or if a success differs.
+//
+// usage: pepper_capture_replay capture_file
+
+
+#include "playful_kinematics/capture.h"
+#include "playful_kinematics/stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+
+// interface for the python wrapper (kinematic_config.cpp, ik.cpp, fk.cpp, robot_instance.cpp)
+extern "C" {
+  void set_minimization_priority(int index, int priority);
+  void set_kinematics_side(bool left);
+  void set_kinematics_mask(bool *mask);
+  void set_kinematics_joint_limit(int index, float min, float max);
+  void begin_kinematics_config_update();
+  void end_kinematics_config_update();
+  void set_kinematics_line_search(int search);
+  void set_kinematics_joints(int nb_joints, float *reference_ik_joints);
+  void set_mask(bool x, bool y, bool z, bool alpha, bool beta, bool gamma);
+  bool ik_ndofs(bool left,
+		float target_x, float target_y, float target_z,
+		float target_alpha, float target_beta, float target_gamma,
+		int nb_dofs, float *posture, float *get_score);
+  bool forward_kinematics(bool left, double *q,
+			  double *x, double *y, double *z,
+			  double *alpha, double *beta, double *gamma);
+  void* create_kinematics_handle();
+  void delete_kinematics_handle(void *handle);
+  void handle_set_joint_limit(void *handle, bool left, int index, float min, float max);
+  void handle_set_minimization_priority(void *handle, bool left, int index, int priority);
+  void handle_set_line_search(void *handle, bool left, int search);
+  bool handle_ik(void *handle, bool left,
+		 float target_x, float target_y, float target_z,
+		 float target_alpha, float target_beta, float target_gamma,
+		 bool *mask, int nb_dofs, float *posture, float *get_score);
+}
+
+// kinematic_config.h is not included, its setters having the names of the C interface.
+// The solver profile is set as recorded, including the CMA-ES parameters the C interface does not set
+namespace playful_kinematics {
+  void set_kinematics_solver_profile(const solver_profile &profile);
+}
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static const char* _name(uint32_t type){
+  using namespace playful_kinematics;
+  switch(type){
+  case CAPTURE_CONFIG_SNAPSHOT: return "config snapshot";
+  case CAPTURE_SET_MINIMIZATION_PRIORITY: return "set priority";
+  case CAPTURE_SET_KINEMATICS_SIDE: return "set side";
+  case CAPTURE_SET_KINEMATICS_MASK: return "set mask";
+  case CAPTURE_SET_KINEMATICS_JOINT_LIMIT: return "set joint limit";
+  case CAPTURE_BEGIN_CONFIG_UPDATE: return "begin config update";
+  case CAPTURE_END_CONFIG_UPDATE: return "end config update";
+  case CAPTURE_SET_KINEMATICS_LINE_SEARCH: return "set line search";
+  case CAPTURE_SET_KINEMATICS_JOINTS: return "set joints";
+  case CAPTURE_IK_NDOFS: return "ik_ndofs";
+  case CAPTURE_FORWARD_KINEMATICS: return "forward_kinematics";
+  case CAPTURE_CREATE_HANDLE: return "create handle";
+  case CAPTURE_DELETE_HANDLE: return "delete handle";
+  case CAPTURE_HANDLE_SNAPSHOT: return "handle snapshot";
+  case CAPTURE_HANDLE_SET_JOINT_LIMIT: return "handle set joint limit";
+  case CAPTURE_HANDLE_SET_MINIMIZATION_PRIORITY: return "handle set priority";
+  case CAPTURE_HANDLE_SET_LINE_SEARCH: return "handle set line search";
+  case CAPTURE_HANDLE_IK: return "handle_ik";
+  case CAPTURE_SET_KINEMATICS_SOLVER_PROFILE: return "set solver profile";
+  }
+  return "unknown";
+}
+
+
+// recorded and replayed results of the calls of one type
+class replay_report {
+
+public:
+
+  replay_report() : nb_calls(0), nb_success_differs(0), max_score_difference(0), max_difference(0) {}
+
+  void compare(bool recorded_success, bool replayed_success,
+	       double recorded_score, double replayed_score){
+    if(recorded_success!=replayed_success) this->nb_success_differs++;
+    if(std::isfinite(recorded_score) && std::isfinite(replayed_score)){
+      this->max_score_difference = std::max(this->max_score_difference,std::fabs(recorded_score-replayed_score));
+    }
+  }
+
+  template<class T>
+  void compare(const std::vector<T> &recorded, const std::vector<T> &replayed){
+    for(int i=0;i<recorded.size() && i<replayed.size();i++){
+      this->max_difference = std::max(this->max_difference,(double)std::fabs(recorded[i]-replayed[i]));
+    }
+  }
+
+  int nb_calls;
+  int nb_success_differs;
+  double max_score_difference;
+  // posture (ik) or pose (forward kinematics)
+  double max_difference;
+  playful_kinematics::sample_stats recorded;
+  playful_kinematics::sample_stats replayed;
+
+};
+
+
+static void _apply_map(playful_kinematics::capture_payload &payload, std::map<int,float> &get_map){
+  std::vector<int32_t> indexes = payload.get_array<int32_t>();
+  std::vector<float> values = payload.get_array<float>();
+  for(int i=0;i<indexes.size() && i<values.size();i++) get_map[indexes[i]] = values[i];
+}
+
+
+static void _snapshot(playful_kinematics::capture_payload &payload){
+
+  bool left = payload.get<bool>();
+  int32_t search = payload.get<int32_t>();
+  std::vector<float> reference = payload.get_array<float>();
+  bool mask[6];
+  payload.get_fixed(6,mask);
+  std::map<int,float> min, max;
+  _apply_map(payload,min);
+  _apply_map(payload,max);
+  std::vector<int32_t> indexes = payload.get_array<int32_t>();
+  std::vector<int32_t> priorities = payload.get_array<int32_t>();
+  playful_kinematics::solver_profile profile = playful_kinematics::get_solver_profile(payload);
+  if(!payload.is_valid()) return;
+
+  begin_kinematics_config_update();
+  set_kinematics_side(left);
+  set_kinematics_line_search(search);
+  set_kinematics_joints(reference.size(),reference.data());
+  set_kinematics_mask(mask);
+  for(std::map<int,float>::iterator it=min.begin();it!=min.end();it++){
+    if(max.count(it->first)) set_kinematics_joint_limit(it->first,it->second,max[it->first]);
+  }
+  for(int i=0;i<indexes.size() && i<priorities.size();i++) set_minimization_priority(indexes[i],priorities[i]);
+  playful_kinematics::set_kinematics_solver_profile(profile);
+  end_kinematics_config_update();
+
+}
+
+
+static void _handle_snapshot(playful_kinematics::capture_payload &payload, void *handle){
+
+  for(int side=0;side<2;side++){
+    bool left = (side==1);
+    int32_t search = payload.get<int32_t>();
+    std::vector<float> min = payload.get_array<float>();
+    std::vector<float> max = payload.get_array<float>();
+    std::vector<int32_t> priorities = payload.get_array<int32_t>();
+    if(!payload.is_valid()) return;
+    handle_set_line_search(handle,left,search);
+    for(int i=0;i<min.size() && i<max.size();i++) handle_set_joint_limit(handle,left,i,min[i],max[i]);
+    for(int i=0;i<priorities.size();i++) handle_set_minimization_priority(handle,left,i,priorities[i]);
+  }
+
+}
+
+
+// replays the call, returns false if its payload could not be read
+static bool _replay(const playful_kinematics::captured_call &call,
+		    std::map<uint64_t,void*> &handles,
+		    replay_report &report){
+
+  using namespace playful_kinematics;
+
+  capture_payload payload(call);
+  clock_type::time_point start = clock_type::now();
+
+  switch(call.header.type){
+
+  case CAPTURE_CONFIG_SNAPSHOT:
+    _snapshot(payload);
+    break;
+
+  case CAPTURE_SET_MINIMIZATION_PRIORITY: {
+    int32_t index = payload.get<int32_t>();
+    int32_t priority = payload.get<int32_t>();
+    if(payload.is_valid()) set_minimization_priority(index,priority);
+    break;
+  }
+
+  case CAPTURE_SET_KINEMATICS_SIDE: {
+    bool left = payload.get<bool>();
+    if(payload.is_valid()) set_kinematics_side(left);
+    break;
+  }
+
+  case CAPTURE_SET_KINEMATICS_MASK: {
+    bool mask[6];
+    payload.get_fixed(6,mask);
+    if(payload.is_valid()) set_kinematics_mask(mask);
+    break;
+  }
+
+  case CAPTURE_SET_KINEMATICS_JOINT_LIMIT: {
+    int32_t index = payload.get<int32_t>();
+    float min = payload.get<float>();
+    float max = payload.get<float>();
+    if(payload.is_valid()) set_kinematics_joint_limit(index,min,max);
+    break;
+  }
+
+  case CAPTURE_BEGIN_CONFIG_UPDATE:
+    begin_kinematics_config_update();
+    break;
+
+  case CAPTURE_END_CONFIG_UPDATE:
+    end_kinematics_config_update();
+    break;
+
+  case CAPTURE_SET_KINEMATICS_LINE_SEARCH: {
+    int32_t search = payload.get<int32_t>();
+    if(payload.is_valid()) set_kinematics_line_search(search);
+    break;
+  }
+
+  case CAPTURE_SET_KINEMATICS_SOLVER_PROFILE: {
+    solver_profile profile = get_solver_profile(payload);
+    if(payload.is_valid()) playful_kinematics::set_kinematics_solver_profile(profile);
+    break;
+  }
+
+  case CAPTURE_SET_KINEMATICS_JOINTS: {
+    std::vector<float> reference = payload.get_array<float>();
+    if(payload.is_valid()) set_kinematics_joints(reference.size(),reference.data());
+    break;
+  }
+
+  case CAPTURE_IK_NDOFS: {
+    bool left = payload.get<bool>();
+    float target[6];
+    bool mask[6] = {false,false,false,false,false,false};
+    payload.get_fixed(6,target);
+    payload.get_fixed(6,mask);
+    std::vector<float> posture = payload.get_array<float>();
+    bool recorded_success = payload.get<bool>();
+    float recorded_score = payload.get<float>();
+    std::vector<float> recorded_posture = payload.get_array<float>();
+    if(!payload.is_valid()) return false;
+    start = clock_type::now();
+    set_mask(mask[0],mask[1],mask[2],mask[3],mask[4],mask[5]);
+    float score;
+    bool success = ik_ndofs(left,target[0],target[1],target[2],target[3],target[4],target[5],
+			    posture.size(),posture.data(),&score);
+    report.recorded.add(call.header.duration);
+    report.replayed.add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now()-start).count());
+    report.compare(recorded_success,success,recorded_score,score);
+    report.compare(recorded_posture,posture);
+    report.nb_calls++;
+    return true;
+  }
+
+  case CAPTURE_FORWARD_KINEMATICS: {
+    bool left = payload.get<bool>();
+    std::vector<double> q = payload.get_array<double>();
+    bool recorded_success = payload.get<bool>();
+    std::vector<double> recorded_pose(6);
+    payload.get_fixed(6,recorded_pose.data());
+    if(!payload.is_valid()) return false;
+    std::vector<double> pose(6);
+    start = clock_type::now();
+    bool success = forward_kinematics(left,q.data(),&pose[0],&pose[1],&pose[2],&pose[3],&pose[4],&pose[5]);
+    report.recorded.add(call.header.duration);
+    report.replayed.add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now()-start).count());
+    report.compare(recorded_success,success,0,0);
+    report.compare(recorded_pose,pose);
+    report.nb_calls++;
+    return true;
+  }
+
+  case CAPTURE_CREATE_HANDLE: {
+    uint64_t id = payload.get<uint64_t>();
+    if(payload.is_valid()) handles[id] = create_kinematics_handle();
+    break;
+  }
+
+  case CAPTURE_DELETE_HANDLE: {
+    uint64_t id = payload.get<uint64_t>();
+    if(payload.is_valid() && handles.count(id)){
+      delete_kinematics_handle(handles[id]);
+      handles.erase(id);
+    }
+    break;
+  }
+
+  case CAPTURE_HANDLE_SNAPSHOT: {
+    // handle created before the capture started
+    uint64_t id = payload.get<uint64_t>();
+    if(!payload.is_valid()) return false;
+    if(!handles.count(id)) handles[id] = create_kinematics_handle();
+    _handle_snapshot(payload,handles[id]);
+    break;
+  }
+
+  case CAPTURE_HANDLE_SET_JOINT_LIMIT: {
+    uint64_t id = payload.get<uint64_t>();
+    bool left = payload.get<bool>();
+    int32_t index = payload.get<int32_t>();
+    float min = payload.get<float>();
+    float max = payload.get<float>();
+    if(payload.is_valid() && handles.count(id)) handle_set_joint_limit(handles[id],left,index,min,max);
+    break;
+  }
+
+  case CAPTURE_HANDLE_SET_MINIMIZATION_PRIORITY: {
+    uint64_t id = payload.get<uint64_t>();
+    bool left = payload.get<bool>();
+    int32_t index = payload.get<int32_t>();
+    int32_t priority = payload.get<int32_t>();
+    if(payload.is_valid() && handles.count(id)) handle_set_minimization_priority(handles[id],left,index,priority);
+    break;
+  }
+
+  case CAPTURE_HANDLE_SET_LINE_SEARCH: {
+    uint64_t id = payload.get<uint64_t>();
+    bool left = payload.get<bool>();
+    int32_t search = payload.get<int32_t>();
+    if(payload.is_valid() && handles.count(id)) handle_set_line_search(handles[id],left,search);
+    break;
+  }
+
+  case CAPTURE_HANDLE_IK: {
+    uint64_t id = payload.get<uint64_t>();
+    bool left = payload.get<bool>();
+    float target[6];
+    bool mask[6];
+    payload.get_fixed(6,target);
+    payload.get_fixed(6,mask);
+    std::vector<float> posture = payload.get_array<float>();
+    bool recorded_success = payload.get<bool>();
+    float recorded_score = payload.get<float>();
+    std::vector<float> recorded_posture = payload.get_array<float>();
+    if(!payload.is_valid()) return false;
+    if(!handles.count(id)) handles[id] = create_kinematics_handle();
+    float score;
+    start = clock_type::now();
+    bool success = handle_ik(handles[id],left,target[0],target[1],target[2],target[3],target[4],target[5],
+			     mask,posture.size(),posture.data(),&score);
+    report.recorded.add(call.header.duration);
+    report.replayed.add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now()-start).count());
+    report.compare(recorded_success,success,recorded_score,score);
+    report.compare(recorded_posture,posture);
+    report.nb_calls++;
+    return true;
+  }
+
+  default:
+    return false;
+
+  }
+
+  if(!payload.is_valid()) return false;
+
+  report.recorded.add(call.header.duration);
+  report.replayed.add(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now()-start).count());
+  report.nb_calls++;
+
+  return true;
+
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  if(argc<2){
+    std::cerr << "usage: " << argv[0] << " capture_file" << std::endl;
+    return 1;
+  }
+
+  std::vector<captured_call> calls;
+  if(!read_capture(argv[1],calls)) return 1;
+
+  std::map<uint64_t,void*> handles;
+  std::map<uint32_t,replay_report> reports;
+  std::map<uint32_t,int> threads;
+  int nb_invalid = 0;
+
+  for(int c=0;c<calls.size();c++){
+    threads[calls[c].header.thread]++;
+    if(!_replay(calls[c],handles,reports[calls[c].header.type])) nb_invalid++;
+  }
+
+  for(std::map<uint64_t,void*>::iterator it=handles.begin();it!=handles.end();it++){
+    delete_kinematics_handle(it->second);
+  }
+
+  std::cout << calls.size() << " calls from " << threads.size() << " threads replayed";
+  if(nb_invalid) std::cout << ", " << nb_invalid << " invalid records skipped";
+  std::cout << std::endl << std::endl;
+
+  std::cout << std::setw(24) << std::left << "call" << std::right
+	    << std::setw(8) << "calls" << std::setw(10) << "success"
+	    << std::setw(12) << "score" << std::setw(12) << "posture"
+	    << std::setw(14) << "p50 (us)" << std::setw(14) << "p99 (us)"
+	    << std::setw(10) << "p50 x" << std::endl;
+  std::cout << std::setw(48) << "" << std::setw(28) << "max differences"
+	    << std::setw(28) << "recorded / replayed" << std::endl;
+
+  int nb_success_differs = 0;
+  for(std::map<uint32_t,replay_report>::iterator it=reports.begin();it!=reports.end();it++){
+    replay_report &report = it->second;
+    if(report.nb_calls==0) continue;
+    nb_success_differs += report.nb_success_differs;
+    double recorded_p50 = report.recorded.percentile(0.5)/1000.0;
+    double replayed_p50 = report.replayed.percentile(0.5)/1000.0;
+    std::ostringstream p50, p99;
+    p50 << std::fixed << std::setprecision(1) << recorded_p50 << "/" << replayed_p50;
+    p99 << std::fixed << std::setprecision(1) << report.recorded.percentile(0.99)/1000.0
+	<< "/" << report.replayed.percentile(0.99)/1000.0;
+    std::cout << std::setw(24) << std::left << _name(it->first) << std::right
+	      << std::setw(8) << report.nb_calls << std::setw(10) << report.nb_success_differs
+	      << std::scientific << std::setprecision(2)
+	      << std::setw(12) << report.max_score_difference << std::setw(12) << report.max_difference
+	      << std::fixed << std::setw(14) << p50.str() << std::setw(14) << p99.str()
+	      << std::setw(10) << (recorded_p50>0 ? replayed_p50/recorded_p50 : 0) << std::endl;
+  }
+
+  if(nb_success_differs){
+    std::cout << std::endl << nb_success_differs << " calls succeeded or failed differently" << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,150 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/cmaes.h"
+
+
+namespace playful_kinematics {
+
+  namespace cmaes_internal {
+
+
+    void symmetric_eigen(int n, std::vector<double> &C,
+			 std::vector<double> &get_B, std::vector<double> &get_eigenvalues){
+
+      get_B.assign(n*n,0);
+      for(int i=0;i<n;i++) get_B[i*n+i]=1;
+
+      // cyclic Jacobi: rotations zeroing each off diagonal value in turn,
+      // until the off diagonal values are negligible
+      for(int sweep=0;sweep<50;sweep++){
+
+	double off = 0, diagonal = 0;
+	for(int p=0;p<n;p++){
+	  diagonal += C[p*n+p]*C[p*n+p];
+	  for(int q=p+1;q<n;q++) off += C[p*n+q]*C[p*n+q];
+	}
+	if(off<=1e-30*diagonal) break;
+
+	for(int p=0;p<n;p++){
+	  for(int q=p+1;q<n;q++){
+
+	    double cpq = C[p*n+q];
+	    if(cpq==0) continue;
+
+	    double theta = (C[q*n+q]-C[p*n+p])/(2*cpq);
+	    double t = (theta>=0 ? 1 : -1)/(fabs(theta)+sqrt(theta*theta+1));
+	    double c = 1/sqrt(t*t+1);
+	    double s = t*c;
+
+	    for(int k=0;k<n;k++){
+	      double ckp = C[k*n+p], ckq = C[k*n+q];
+	      C[k*n+p] = c*ckp-s*ckq;
+	      C[k*n+q] = s*ckp+c*ckq;
+	    }
+	    for(int k=0;k<n;k++){
+	      double cpk = C[p*n+k], cqk = C[q*n+k];
+	      C[p*n+k] = c*cpk-s*cqk;
+	      C[q*n+k] = s*cpk+c*cqk;
+	    }
+	    for(int k=0;k<n;k++){
+	      double bkp = get_B[k*n+p], bkq = get_B[k*n+q];
+	      get_B[k*n+p] = c*bkp-s*bkq;
+	      get_B[k*n+q] = s*bkp+c*bkq;
+	    }
+
+	  }
+	}
+
+      }
+
+      get_eigenvalues.resize(n);
+      for(int i=0;i<n;i++) get_eigenvalues[i] = C[i*n+i];
+
+    }
+
+
+    workers::workers(int nb_threads)
+      : generation(0), nb_running(0), stop(false), call(NULL), job(NULL) {
+      for(int t=1;t<nb_threads;t++){
+	this->threads.push_back(std::thread(&workers::_work,this,t));
+      }
+    }
+
+
+    workers::~workers(){
+      {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stop = true;
+      }
+      this->start.notify_all();
+      for(std::thread &thread: this->threads) thread.join();
+    }
+
+
+    int workers::get_nb_threads() const {
+      return this->threads.size()+1;
+    }
+
+
+    void workers::_run(void (*call)(void*,int), void *job){
+      if(this->threads.empty()){
+	call(job,0);
+	return;
+      }
+      {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->call = call;
+	this->job = job;
+	this->nb_running = this->threads.size();
+	this->generation++;
+      }
+      this->start.notify_all();
+      call(job,0);
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->done.wait(lock,[this](){ return this->nb_running==0; });
+    }
+
+
+    void workers::_work(int thread){
+      unsigned long generation = 0;
+      while(true){
+	void (*call)(void*,int);
+	void *job;
+	{
+	  std::unique_lock<std::mutex> lock(this->mutex);
+	  this->start.wait(lock,[this,generation](){ return this->stop || this->generation!=generation; });
+	  if(this->stop) return;
+	  generation = this->generation;
+	  call = this->call;
+	  job = this->job;
+	}
+	call(job,thread);
+	{
+	  std::lock_guard<std::mutex> lock(this->mutex);
+	  this->nb_running--;
+	}
+	this->done.notify_one();
+      }
+    }
+
+
+  }
+
+}
@@ -0,0 +1,231 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Compares how quickly SOMA (coordinate descent, soma.h) and CMA-ES (cmaes.h, on one
+// thread and on all cores) improve the score over wall clock time, for random reachable
+// targets (position only) solved from the reference posture. Two scores: the (smooth)
+// inverse kinematics score, and the same score plus a step penalty when the shoulder
+// pitch is in a forbidden band containing the reference posture, standing for a
+// collision penalty.
+// For each solver, prints the median and 90th percentile of the best score found
+// after each time checkpoint, the success rate and the median time to success.
+//
+// usage: pepper_cmaes_benchmark [number of runs]
+
+
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/cmaes.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+// microseconds
+static const double CHECKPOINTS[] = {50,100,200,500,1000,2000,5000,10000,20000};
+static const int NB_CHECKPOINTS = sizeof(CHECKPOINTS)/sizeof(double);
+
+static const float TARGET_SCORE = 0.001;
+
+// band of the shoulder pitch penalized by the non smooth score
+static const int BAND_JOINT = 3;
+static const float BAND_MIN = -0.3;
+static const float BAND_MAX = 0.5;
+static const float BAND_PENALTY = 0.2;
+
+
+// best score found over time by a minimization, shared by the copies of the score
+class anytime_record {
+
+public:
+
+  void start(){
+    this->begin = clock_type::now();
+    this->best = std::numeric_limits<float>::max();
+    this->success_time = -1;
+    this->checkpoint = 0;
+    this->bests.assign(NB_CHECKPOINTS,std::numeric_limits<float>::max());
+  }
+
+  void add(float score){
+    std::lock_guard<std::mutex> lock(this->mutex);
+    double time = std::chrono::duration<double,std::micro>(clock_type::now()-this->begin).count();
+    while(this->checkpoint<NB_CHECKPOINTS && CHECKPOINTS[this->checkpoint]<time){
+      this->bests[this->checkpoint++] = this->best;
+    }
+    this->best = std::min(this->best,score);
+    if(this->success_time<0 && this->best<=TARGET_SCORE) this->success_time = time;
+  }
+
+  void stop(){
+    while(this->checkpoint<NB_CHECKPOINTS) this->bests[this->checkpoint++] = this->best;
+  }
+
+  std::vector<float> bests;
+  double success_time;
+
+private:
+
+  std::mutex mutex;
+  clock_type::time_point begin;
+  float best;
+  int checkpoint;
+
+};
+
+
+// inverse kinematics score, optionally with the band penalty, recording its values
+class recorded_score {
+
+public:
+
+  recorded_score(const playful_kinematics::cartesian_score &score, bool penalized, anytime_record *record)
+    : score(score), penalized(penalized), record(record) {}
+
+  template<class Posture>
+  float operator()(const Posture &posture){
+    float value = this->score(posture);
+    if(this->penalized && posture[BAND_JOINT]>BAND_MIN && posture[BAND_JOINT]<BAND_MAX) value += BAND_PENALTY;
+    this->record->add(value);
+    return value;
+  }
+
+  void evaluate_batch(int nb, const double *q, float *get_scores){
+    this->score.evaluate_batch(nb,q,get_scores);
+    for(int i=0;i<nb;i++){
+      double joint = q[BAND_JOINT*nb+i];
+      if(this->penalized && joint>BAND_MIN && joint<BAND_MAX) get_scores[i] += BAND_PENALTY;
+      this->record->add(get_scores[i]);
+    }
+  }
+
+private:
+
+  playful_kinematics::cartesian_score score;
+  bool penalized;
+  anytime_record *record;
+
+};
+
+
+enum solver { SOMA, CMAES, CMAES_THREADS };
+
+
+static void _run(solver solver, bool penalized, const std::vector<float> &targets, int nb_runs){
+
+  using namespace playful_kinematics;
+
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<float> min(pepper::LEFT_MIN,pepper::LEFT_MIN+pepper::NB_DOFS);
+  std::vector<float> max(pepper::LEFT_MAX,pepper::LEFT_MAX+pepper::NB_DOFS);
+  std::vector<int> priority(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+  std::map<int,float> min_map,max_map;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    min_map[i]=min[i];
+    max_map[i]=max[i];
+  }
+  std::vector<bool> mask(6,false);
+  for(int i=0;i<3;i++) mask[i]=true;
+
+  cmaes_parameters parameters;
+  parameters.nb_threads = solver==CMAES_THREADS ? 0 : 1;
+
+  std::vector<sample_stats> bests(NB_CHECKPOINTS);
+  sample_stats success_times;
+  int nb_success = 0;
+  anytime_record record;
+
+  for(int r=0;r<nb_runs;r++){
+
+    const float *t = &targets[6*r];
+    cartesian_score cartesian(true,mask,t[0],t[1],t[2],t[3],t[4],t[5]);
+    recorded_score score(cartesian,penalized,&record);
+    std::vector<float> posture(reference);
+    float final_score;
+
+    parameters.seed = r;
+    record.start();
+    if(solver==SOMA){
+      minimize(posture,priority,min_map,max_map,TARGET_SCORE,0.1,0.001,15,score,final_score);
+    } else {
+      minimize(posture,min,max,TARGET_SCORE,score,final_score,parameters);
+    }
+    record.stop();
+
+    for(int c=0;c<NB_CHECKPOINTS;c++) bests[c].add(record.bests[c]);
+    if(record.success_time>=0){
+      nb_success++;
+      success_times.add(record.success_time);
+    }
+
+  }
+
+  const char *labels[] = {"SOMA","CMA-ES, 1 thread","CMA-ES, all cores"};
+  std::cout << labels[solver] << std::endl << "  best score (median / p90) after" << std::endl;
+  for(int c=0;c<NB_CHECKPOINTS;c++){
+    std::cout << "    " << std::setw(6) << CHECKPOINTS[c] << " us: "
+	      << std::setw(10) << bests[c].percentile(0.5) << " / "
+	      << std::setw(10) << bests[c].percentile(0.9) << std::endl;
+  }
+  std::cout << "  success: " << nb_success << "/" << nb_runs;
+  if(nb_success) std::cout << ", median time to success: " << success_times.percentile(0.5) << " us";
+  std::cout << std::endl;
+
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_runs = 100;
+  if(argc>1) nb_runs = atoi(argv[1]);
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  std::vector<float> targets;
+  for(int r=0;r<nb_runs;r++){
+    double q[pepper::NB_DOFS];
+    for(int i=0;i<pepper::NB_DOFS;i++){
+      q[i] = pepper::LEFT_MIN[i]+uniform(generator)*(pepper::LEFT_MAX[i]-pepper::LEFT_MIN[i]);
+    }
+    double c[6];
+    forward_kinematics(true,q,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    for(int i=0;i<6;i++) targets.push_back(c[i]);
+  }
+
+  std::cout << nb_runs << " targets, target score " << TARGET_SCORE << ", "
+	    << std::thread::hardware_concurrency() << " cores, "
+	    << get_simd_name(get_simd_level()) << std::endl;
+
+  for(int penalized=0;penalized<2;penalized++){
+    std::cout << std::endl
+	      << (penalized ? "inverse kinematics score with band penalty" : "inverse kinematics score")
+	      << std::endl;
+    _run(SOMA,penalized,targets,nb_runs);
+    _run(CMAES,penalized,targets,nb_runs);
+    _run(CMAES_THREADS,penalized,targets,nb_runs);
+  }
+
+}
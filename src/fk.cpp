@@ -18,6 +18,8 @@
 
 
 #include "playful_kinematics/fk.h"
+#include "playful_kinematics/trace.h"
+#include "playful_kinematics/capture.h"
 
  
 using namespace KDL;
@@ -41,11 +43,13 @@ namespace playful_kinematics{
     RobotChain(std::string first_link, std::string last_link, KDL::Tree &tree);
     ~RobotChain();
     KDL::Chain arm;
+    flat_chain flat;
     ChainFkSolverPos_recursive *fksolver;
   };
 
   RobotChain::RobotChain(std::string first_link, std::string last_link,KDL::Tree &tree){
     tree.getChain(first_link,last_link,this->arm);
+    this->flat = flat_chain(this->arm);
     this->fksolver = new ChainFkSolverPos_recursive(this->arm);
   }
 
@@ -68,6 +72,10 @@ namespace playful_kinematics{
     robot_kinematics();
     ~robot_kinematics();
     int get_nb_joints(const bool left);
+    const KDL::Chain& get_chain(const bool left);
+    const flat_chain& get_flat_chain(const bool left);
+    bool get_tree_chain(const std::string &first_link, const std::string &last_link,
+			KDL::Chain &get_chain) const;
     std::string get_joint_name(bool left, int index);
     void print_segments();
     void print_segments(bool left);
@@ -113,6 +121,38 @@ namespace playful_kinematics{
   }
 
 
+  const KDL::Chain& robot_kinematics::get_chain(const bool left) {
+
+    if(left) return this->left_arm->arm;
+    return this->right_arm->arm;
+
+  }
+
+
+  const flat_chain& robot_kinematics::get_flat_chain(const bool left) {
+
+    if(left) return this->left_arm->flat;
+    return this->right_arm->flat;
+
+  }
+
+
+  bool robot_kinematics::get_tree_chain(const std::string &first_link, const std::string &last_link,
+					KDL::Chain &get_chain) const {
+
+    KDL::Chain chain;
+    if(!this->tree.getChain(first_link,last_link,chain)){
+      std::cerr << "playful kinematics: no chain from " << first_link << " to " << last_link
+		<< " in " << this->urdf << std::endl;
+      return false;
+    }
+
+    get_chain = chain;
+    return true;
+
+  }
+
+
   void robot_kinematics::print_segments() {
 
     SegmentMap sm = this->tree.getSegments();
@@ -165,7 +205,9 @@ namespace playful_kinematics{
   
   bool robot_kinematics::run_forward_kinematics(const bool left, const double *joints, double *translation, double *euler_rotation){
 
-    static KDL::Frame cartesian;    
+    PLAYFUL_KINEMATICS_TRACE("forward_kinematics");
+
+    KDL::Frame cartesian;    
 
     int nb = this->get_nb_joints(left);
     JntArray q(nb);
@@ -196,8 +238,8 @@ namespace playful_kinematics{
 						double *x, double *y, double *z,
 						double *alpha, double *beta, double *gamma){
 
-    static double xyz[3];
-    static double euler[3];
+    double xyz[3];
+    double euler[3];
 
     xyz[0]=*x;
     xyz[1]=*y;
@@ -221,6 +263,61 @@ namespace playful_kinematics{
 
   }
 
+
+  // the urdf is parsed once per process, and the same instance
+  // is used by all threads (forward kinematics is reentrant)
+  static robot_kinematics& get_robot(){
+    static robot_kinematics robot;
+    return robot;
+  }
+
+
+  robot_model::robot_model(robot_kinematics *robot)
+    : robot(robot) {}
+
+
+  int robot_model::get_nb_joints(bool left) const {
+    return this->robot->get_nb_joints(left);
+  }
+
+
+  const KDL::Chain& robot_model::get_chain(bool left) const {
+    return this->robot->get_chain(left);
+  }
+
+
+  const flat_chain& robot_model::get_flat_chain(bool left) const {
+    return this->robot->get_flat_chain(left);
+  }
+
+
+  bool robot_model::get_chain(const std::string &first_link, const std::string &last_link,
+			     KDL::Chain &get_chain) const {
+    return this->robot->get_tree_chain(first_link,last_link,get_chain);
+  }
+
+
+  bool robot_model::get_flat_chain(const std::string &first_link, const std::string &last_link,
+				  flat_chain &get_chain) const {
+    KDL::Chain chain;
+    if(!this->get_chain(first_link,last_link,chain)) return false;
+    get_chain = flat_chain(chain);
+    return true;
+  }
+
+
+  bool robot_model::forward_kinematics(bool left, const double *q,
+				       double *x, double *y, double *z,
+				       double *alpha, double *beta, double *gamma) const {
+    return this->robot->run_forward_kinematics(left,q,x,y,z,alpha,beta,gamma);
+  }
+
+
+  boost::shared_ptr<const robot_model> get_robot_model(){
+    static boost::shared_ptr<const robot_model> model(new robot_model(&get_robot()));
+    return model;
+  }
+  
   /* END OF BACK END FUNCTIONS */
   
 
@@ -232,14 +329,13 @@ namespace playful_kinematics{
 			  std::vector<float> &get_position,
 			  std::vector<float> &get_orientation){
 
-    static robot_kinematics robot; 
-    static double q[NB_JOINTS];
+    double q[NB_JOINTS];
     
     double x,y,z,alpha,beta,gamma;
 
     for(int i=0;i<NB_JOINTS;i++) q[i]=(double)posture[i];
 
-    bool success = robot.run_forward_kinematics(left,q,&x,&y,&z,&alpha,&beta,&gamma);
+    bool success = get_robot().run_forward_kinematics(left,q,&x,&y,&z,&alpha,&beta,&gamma);
 
     get_position.push_back((float)x);
     get_position.push_back((float)y);
@@ -258,8 +354,14 @@ namespace playful_kinematics{
 			  double *x, double *y, double *z,
 			  double *alpha, double *beta, double *gamma){
 
-    static robot_kinematics robot;
-    return robot.run_forward_kinematics(left,q,x,y,z,alpha,beta,gamma);
+    return get_robot().run_forward_kinematics(left,q,x,y,z,alpha,beta,gamma);
+
+  }
+
+
+  int get_nb_joints(bool left){
+
+    return get_robot().get_nb_joints(left);
 
   }
 
@@ -277,8 +379,7 @@ extern "C" {
 
   int get_nb_joints(bool left){
 
-    playful_kinematics:: robot_kinematics robot;
-    return robot.get_nb_joints(left);
+    return playful_kinematics::get_nb_joints(left);
 
   }
 
@@ -286,8 +387,21 @@ extern "C" {
 			  double *x, double *y, double *z,
 			  double *alpha, double *beta, double *gamma){
 
-    static playful_kinematics::robot_kinematics robot; 
-    return robot.run_forward_kinematics(left,q,x,y,z,alpha,beta,gamma);
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_FORWARD_KINEMATICS);
+    int nb_joints = record.is_active() ? playful_kinematics::get_nb_joints(left) : 0;
+    record.add(left);
+    record.add(nb_joints,q);
+
+    bool success = playful_kinematics::forward_kinematics(left,q,x,y,z,alpha,beta,gamma);
+
+    if(record.is_active()){
+      double pose[6] = {*x,*y,*z,*alpha,*beta,*gamma};
+      record.add(success);
+      record.add_fixed(6,pose);
+      record.commit();
+    }
+
+    return success;
 
   }
 
@@ -0,0 +1,83 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Build time tool: parses the urdf, extracts the kinematic chain between two links,
+// and writes a header with the unrolled forward kinematics (and jacobian) of the
+// chain, see fk_codegen.h. Called by the playful_kinematics_generate_fk function
+// of CMakeLists.txt.
+//
+// usage: playful_kinematics_fk_code_generator urdf first_link last_link name output_header [jacobian (1|0)]
+
+
+#include "playful_kinematics/fk_codegen.h"
+#include <kdl_parser/kdl_parser.hpp>
+#include <kdl/tree.hpp>
+#include <fstream>
+#include <cstdlib>
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  if(argc<6){
+    std::cerr << "usage: " << argv[0] << " urdf first_link last_link name output_header [jacobian (1|0)]" << std::endl;
+    return 1;
+  }
+
+  std::string urdf = argv[1];
+  std::string first_link = argv[2];
+  std::string last_link = argv[3];
+  std::string name = argv[4];
+  std::string path = argv[5];
+  bool jacobian = !(argc>6 && atoi(argv[6])==0);
+
+  KDL::Tree tree;
+  if(!kdl_parser::treeFromFile(urdf,tree)){
+    std::cerr << "playful kinematics: fk code generator: failed to parse " << urdf << std::endl;
+    return 1;
+  }
+
+  KDL::Chain kdl_chain;
+  if(!tree.getChain(first_link,last_link,kdl_chain)){
+    std::cerr << "playful kinematics: fk code generator: no chain from " << first_link
+	      << " to " << last_link << " in " << urdf << std::endl;
+    return 1;
+  }
+
+  flat_chain chain(kdl_chain);
+  if(chain.get_nb_joints()!=kdl_chain.getNrOfJoints()){
+    std::cerr << "playful kinematics: fk code generator: unsupported joint type in the chain from "
+	      << first_link << " to " << last_link << std::endl;
+    return 1;
+  }
+
+  std::ofstream out(path.c_str());
+  if(!out){
+    std::cerr << "playful kinematics: fk code generator: failed to open " << path << std::endl;
+    return 1;
+  }
+
+  std::string source = urdf+", from "+first_link+" to "+last_link;
+  if(!generate_fk_header(chain,name,source,jacobian,out)) return 1;
+
+  std::cout << "playful kinematics: generated " << path << " (" << chain.get_nb_joints() << " joints)" << std::endl;
+
+  return 0;
+
+}
@@ -0,0 +1,398 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/fk_codegen.h"
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cctype>
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  // coefficients smaller than this are considered 0
+  // (e.g. cos(pi/2) in the rotations of the urdf)
+  static const double ZERO = 1e-15;
+
+
+  // coefficient * variable, or constant if the variable is empty
+  // (variable may be a product of variables, e.g. "r1_0*c2")
+  class term {
+  public:
+    term(double coefficient, const std::string &variable)
+      : coefficient(coefficient), variable(variable) {}
+    double coefficient;
+    std::string variable;
+  };
+
+
+  // sum of terms, 0 if empty
+  typedef std::vector<term> expression;
+
+
+  static expression _constant(double value){
+    expression e;
+    if(std::abs(value)>ZERO) e.push_back(term(value,""));
+    return e;
+  }
+
+
+  static expression _variable(const std::string &name){
+    return expression(1,term(1,name));
+  }
+
+
+  // merges the terms of the same variable, removes the terms multiplied by 0
+  static expression _simplify(const expression &e){
+    expression result;
+    for(int i=0;i<e.size();i++){
+      bool merged = false;
+      for(int j=0;j<result.size() && !merged;j++){
+	if(result[j].variable==e[i].variable){
+	  result[j].coefficient += e[i].coefficient;
+	  merged = true;
+	}
+      }
+      if(!merged) result.push_back(e[i]);
+    }
+    expression nonzero;
+    for(int i=0;i<result.size();i++){
+      if(std::abs(result[i].coefficient)>ZERO) nonzero.push_back(result[i]);
+    }
+    return nonzero;
+  }
+
+
+  static expression _sum(const expression &a, const expression &b){
+    expression e(a);
+    e.insert(e.end(),b.begin(),b.end());
+    return _simplify(e);
+  }
+
+
+  static expression _product(const expression &a, const expression &b){
+    expression e;
+    for(int i=0;i<a.size();i++){
+      for(int j=0;j<b.size();j++){
+	std::string variable;
+	if(a[i].variable.empty()) variable = b[j].variable;
+	else if(b[j].variable.empty()) variable = a[i].variable;
+	else variable = a[i].variable+"*"+b[j].variable;
+	e.push_back(term(a[i].coefficient*b[j].coefficient,variable));
+      }
+    }
+    return _simplify(e);
+  }
+
+
+  static std::string _number(double value){
+    std::ostringstream s;
+    s << std::setprecision(17) << value;
+    return s.str();
+  }
+
+
+  static std::string _to_string(const expression &e){
+
+    if(e.empty()) return "0";
+
+    std::ostringstream s;
+    for(int i=0;i<e.size();i++){
+      double coefficient = e[i].coefficient;
+      if(i==0) { if(coefficient<0) s << "-"; }
+      else s << (coefficient<0 ? " - " : " + ");
+      coefficient = std::abs(coefficient);
+      if(e[i].variable.empty()) s << _number(coefficient);
+      else if(coefficient==1) s << e[i].variable;
+      else s << _number(coefficient) << "*" << e[i].variable;
+    }
+    return s.str();
+
+  }
+
+
+  // writes the C++ statements, keeping track of the entries of the current frame
+  class code_writer {
+
+  public:
+
+    code_writer(std::ostream &out)
+      : out(out), step(0) {
+      for(int i=0;i<9;i++) this->rotation[i] = _constant(i%4==0 ? 1 : 0);
+      for(int i=0;i<3;i++) this->position[i] = expression();
+    }
+
+    // declares a variable for the expression, unless it is a constant or a single variable
+    expression declare(const std::string &name, const expression &e){
+      if(e.empty()) return e;
+      if(e.size()==1 && (e[0].variable.empty() ||
+			 (e[0].coefficient==1 && e[0].variable.find('*')==std::string::npos))) return e;
+      this->out << "    const double " << name << " = " << _to_string(e) << ";" << std::endl;
+      return _variable(name);
+    }
+
+    // frame <- frame * (r,p), r and p constants
+    void compose(const double *r, const double *p){
+      expression R[9];
+      for(int i=0;i<9;i++) R[i] = _constant(r[i]);
+      expression P[3];
+      for(int i=0;i<3;i++) P[i] = _constant(p[i]);
+      this->compose(R,P);
+    }
+
+    // frame <- frame * (r,p)
+    void compose(const expression *r, const expression *p){
+      this->step++;
+      expression R[9];
+      expression P[3];
+      for(int i=0;i<3;i++){
+	for(int j=0;j<3;j++){
+	  expression e;
+	  for(int k=0;k<3;k++) e = _sum(e,_product(this->rotation[i*3+k],r[k*3+j]));
+	  R[i*3+j] = this->declare(this->_name("r",i*3+j),e);
+	}
+	expression e = this->position[i];
+	for(int k=0;k<3;k++) e = _sum(e,_product(this->rotation[i*3+k],p[k]));
+	P[i] = this->declare(this->_name("p",i),e);
+      }
+      for(int i=0;i<9;i++) this->rotation[i]=R[i];
+      for(int i=0;i<3;i++) this->position[i]=P[i];
+    }
+
+    // rotation*v, v constant
+    void rotate(const double *v, const std::string &name, expression *get){
+      for(int i=0;i<3;i++){
+	expression e;
+	for(int k=0;k<3;k++) e = _sum(e,_product(this->rotation[i*3+k],_constant(v[k])));
+	get[i] = this->declare(name+"_"+_number(i),e);
+      }
+    }
+
+    std::ostream &out;
+    expression rotation[9];
+    expression position[3];
+
+  private:
+
+    std::string _name(const std::string &prefix, int index){
+      std::ostringstream s;
+      s << prefix << this->step << "_" << index;
+      return s.str();
+    }
+
+    int step;
+
+  };
+
+
+  static void _identity(double *rotation, double *position){
+    for(int i=0;i<9;i++) rotation[i] = (i%4==0) ? 1 : 0;
+    for(int i=0;i<3;i++) position[i] = 0;
+  }
+
+
+  // (rotation,position) <- (rotation,position)*(r,p), constants
+  static void _compose(double *rotation, double *position, const double *r, const double *p){
+    double result[9];
+    for(int i=0;i<3;i++){
+      for(int j=0;j<3;j++){
+	result[i*3+j] = rotation[i*3]*r[j] + rotation[i*3+1]*r[3+j] + rotation[i*3+2]*r[6+j];
+      }
+      position[i] += rotation[i*3]*p[0] + rotation[i*3+1]*p[1] + rotation[i*3+2]*p[2];
+    }
+    for(int i=0;i<9;i++) rotation[i]=result[i];
+  }
+
+
+  // body of the generated function. Consecutive fixed transforms are composed at
+  // generation time (pending), and applied to the frame only before a joint
+  static void _write_body(const flat_chain &chain, bool jacobian, std::ostream &out){
+
+    code_writer writer(out);
+    int nb_joints = chain.get_nb_joints();
+
+    double pending_rotation[9];
+    double pending_position[3];
+    for(int i=0;i<9;i++) pending_rotation[i] = chain.base_rotation[i];
+    for(int i=0;i<3;i++) pending_position[i] = chain.base_position[i];
+
+    std::vector<expression> axis(3*nb_joints);
+    std::vector<expression> origin(3*nb_joints);
+
+    for(int j=0;j<nb_joints;j++){
+
+      const flat_joint &joint = chain.joints[j];
+      std::string index = _number(j);
+      std::string q = "q["+index+"]";
+
+      out << std::endl << "    // joint " << j << std::endl;
+
+      double identity[9];
+      double zero[3];
+      _identity(identity,zero);
+      _compose(pending_rotation,pending_position,identity,joint.origin);
+      writer.compose(pending_rotation,pending_position);
+
+      if(jacobian){
+	writer.rotate(joint.axis,"z"+index,&axis[j*3]);
+	for(int i=0;i<3;i++) origin[j*3+i] = writer.position[i];
+      }
+
+      if(joint.type==REVOLUTE_JOINT){
+
+	out << "    const double c" << j << " = cos(" << q << ");" << std::endl
+	    << "    const double s" << j << " = sin(" << q << ");" << std::endl;
+
+	// rotation of the joint (Rodrigues): A + c*(I-A) + s*K,
+	// with A = a*transpose(a) and K the cross product matrix of a
+	const double *a = joint.axis;
+	double K[9] = {    0, -a[2],  a[1],
+			a[2],     0, -a[0],
+		       -a[1],  a[0],     0 };
+	expression R[9];
+	expression P[3];
+	for(int r=0;r<3;r++){
+	  for(int c=0;c<3;c++){
+	    double A = a[r]*a[c];
+	    expression e = _constant(A);
+	    e = _sum(e,_product(_constant((r==c ? 1 : 0)-A),_variable("c"+index)));
+	    e = _sum(e,_product(_constant(K[r*3+c]),_variable("s"+index)));
+	    R[r*3+c] = writer.declare("j"+index+"_"+_number(r*3+c),e);
+	  }
+	}
+	writer.compose(R,P);
+
+      } else {
+
+	expression R[9];
+	expression P[3];
+	for(int i=0;i<9;i++) R[i] = _constant(i%4==0 ? 1 : 0);
+	for(int i=0;i<3;i++) P[i] = _product(_constant(joint.axis[i]),_variable(q));
+	writer.compose(R,P);
+
+      }
+
+      for(int i=0;i<9;i++) pending_rotation[i] = joint.rotation[i];
+      for(int i=0;i<3;i++) pending_position[i] = joint.position[i];
+
+    }
+
+    out << std::endl << "    // end effector" << std::endl;
+    writer.compose(pending_rotation,pending_position);
+
+    out << std::endl;
+    for(int i=0;i<3;i++) out << "    get_position[" << i << "] = " << _to_string(writer.position[i]) << ";" << std::endl;
+    for(int i=0;i<9;i++) out << "    get_rotation[" << i << "] = " << _to_string(writer.rotation[i]) << ";" << std::endl;
+
+    if(!jacobian) return;
+
+    // revolute: linear z x (end - origin), angular z. prismatic: linear z, angular 0
+    out << std::endl;
+    for(int j=0;j<nb_joints;j++){
+      const expression *z = &axis[j*3];
+      expression linear[3];
+      if(chain.joints[j].type==REVOLUTE_JOINT){
+	expression d[3];
+	for(int i=0;i<3;i++) d[i] = _sum(writer.position[i],_product(_constant(-1),origin[j*3+i]));
+	for(int i=0;i<3;i++){
+	  int a = (i+1)%3;
+	  int b = (i+2)%3;
+	  linear[i] = _sum(_product(z[a],d[b]),_product(_constant(-1),_product(z[b],d[a])));
+	}
+      } else {
+	for(int i=0;i<3;i++) linear[i] = z[i];
+      }
+      for(int i=0;i<3;i++){
+	out << "    get_jacobian[" << i*nb_joints+j << "] = " << _to_string(linear[i]) << ";" << std::endl;
+      }
+      for(int i=0;i<3;i++){
+	expression angular = chain.joints[j].type==REVOLUTE_JOINT ? z[i] : expression();
+	out << "    get_jacobian[" << (3+i)*nb_joints+j << "] = " << _to_string(angular) << ";" << std::endl;
+      }
+    }
+
+  }
+
+
+  static bool _is_identifier(const std::string &name){
+    if(name.empty() || isdigit(name[0])) return false;
+    for(int i=0;i<name.size();i++){
+      if(!isalnum(name[i]) && name[i]!='_') return false;
+    }
+    return true;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  bool generate_fk_header(const flat_chain &chain, const std::string &name,
+			  const std::string &source, bool jacobian, std::ostream &out){
+
+    if(!_is_identifier(name)){
+      std::cerr << "playful kinematics: generate_fk_header: invalid name: " << name << std::endl;
+      return false;
+    }
+
+    out << "// generated by playful_kinematics_fk_code_generator, do not edit" << std::endl
+	<< "// " << source << std::endl
+	<< "// see include/playful_kinematics/fk_codegen.h" << std::endl
+	<< std::endl
+	<< "#pragma once" << std::endl
+	<< std::endl
+	<< "#include <cmath>" << std::endl
+	<< std::endl
+	<< "namespace playful_kinematics {" << std::endl
+	<< "namespace generated {" << std::endl
+	<< "namespace " << name << " {" << std::endl
+	<< std::endl
+	<< std::endl
+	<< "  constexpr int NB_DOFS = " << chain.get_nb_joints() << ";" << std::endl
+	<< std::endl
+	<< std::endl
+	<< "  inline void forward_kinematics(const double *q, double *get_position, double *get_rotation){" << std::endl;
+    _write_body(chain,false,out);
+    out << std::endl
+	<< "  }" << std::endl
+	<< std::endl;
+
+    if(jacobian){
+      out << std::endl
+	  << "  inline void jacobian(const double *q, double *get_position, double *get_rotation, double *get_jacobian){" << std::endl;
+      _write_body(chain,true,out);
+      out << std::endl
+	  << "  }" << std::endl
+	  << std::endl;
+    }
+
+    out << std::endl
+	<< "}" << std::endl
+	<< "}" << std::endl
+	<< "}" << std::endl;
+
+    return out.good();
+
+  }
+
+
+}
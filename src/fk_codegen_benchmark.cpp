@@ -0,0 +1,116 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Compares the forward kinematics of KDL with the forward kinematics generated
+// from the urdf at build time (fk_generated.h), on random postures of the left
+// arm within the joint limits. Reports the duration per posture, the largest
+// difference between both (position and roll, pitch, yaw), and the duration of
+// the generated jacobian.
+//
+// usage: pepper_fk_codegen_benchmark [number of postures] [number of runs]
+
+
+#include "playful_kinematics/fk.h"
+#include "playful_kinematics/fk_generated.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static double _angle_difference(double a, double b){
+  return std::abs(atan2(sin(a-b),cos(a-b)));
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_postures = argc>1 ? atoi(argv[1]) : 100000;
+  int nb_runs = argc>2 ? atoi(argv[2]) : 10;
+  const int nb_joints = pepper::NB_DOFS;
+
+  boost::shared_ptr<const robot_model> model = get_robot_model();
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  std::vector<double> postures(nb_joints*nb_postures);
+  for(int i=0;i<nb_postures;i++){
+    for(int j=0;j<nb_joints;j++){
+      postures[i*nb_joints+j] = pepper::LEFT_MIN[j]+uniform(generator)*(pepper::LEFT_MAX[j]-pepper::LEFT_MIN[j]);
+    }
+  }
+
+  std::vector<double> kdl(6*nb_postures);
+  std::vector<double> generated(6*nb_postures);
+  std::vector<double> jacobian(6*nb_joints);
+
+  sample_stats kdl_time;
+  sample_stats generated_time;
+  sample_stats jacobian_time;
+
+  for(int run=0;run<nb_runs;run++){
+
+    clock_type::time_point start = clock_type::now();
+    for(int i=0;i<nb_postures;i++){
+      double *c = &kdl[i*6];
+      model->forward_kinematics(true,&postures[i*nb_joints],&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    }
+    kdl_time.add(std::chrono::duration<double,std::nano>(clock_type::now()-start).count()/nb_postures);
+
+    start = clock_type::now();
+    for(int i=0;i<nb_postures;i++){
+      double *c = &generated[i*6];
+      generated_forward_kinematics(true,&postures[i*nb_joints],&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    }
+    generated_time.add(std::chrono::duration<double,std::nano>(clock_type::now()-start).count()/nb_postures);
+
+    start = clock_type::now();
+    for(int i=0;i<nb_postures;i++) generated_jacobian(true,&postures[i*nb_joints],&jacobian[0]);
+    jacobian_time.add(std::chrono::duration<double,std::nano>(clock_type::now()-start).count()/nb_postures);
+
+  }
+
+  double position_error = 0;
+  double angle_error = 0;
+  for(int i=0;i<nb_postures;i++){
+    for(int k=0;k<3;k++){
+      position_error = std::max(position_error,std::abs(generated[i*6+k]-kdl[i*6+k]));
+      angle_error = std::max(angle_error,_angle_difference(generated[i*6+3+k],kdl[i*6+3+k]));
+    }
+  }
+
+  std::cout << nb_postures << " postures, " << nb_joints << " joints, " << nb_runs << " runs" << std::endl;
+  kdl_time.print("kdl","ns per posture");
+  generated_time.print("generated","ns per posture");
+  jacobian_time.print("generated jacobian","ns per posture");
+  std::cout << "speed up: " << kdl_time.mean()/generated_time.mean() << std::endl
+	    << "largest difference with kdl: " << position_error << " (position) "
+	    << angle_error << " (angles)" << std::endl;
+
+  return 0;
+
+}
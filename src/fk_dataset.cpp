@@ -0,0 +1,338 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/fk_dataset.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <limits>
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static const int MAX_QUASI_RANDOM_DIMENSIONS = 16;
+
+  // first primes, bases of the Halton sequence
+  static const int HALTON_PRIMES[MAX_QUASI_RANDOM_DIMENSIONS] =
+    {2,3,5,7,11,13,17,19,23,29,31,37,41,43,47,53};
+
+  // Sobol direction numbers (Joe and Kuo, new-joe-kuo-6.21201) for dimensions 2 to 16:
+  // degree s, coefficients a, initial direction numbers m
+  static const int SOBOL_S[MAX_QUASI_RANDOM_DIMENSIONS-1] = {1,2,3,3,4,4,5,5,5,5,5,5,6,6,6};
+  static const int SOBOL_A[MAX_QUASI_RANDOM_DIMENSIONS-1] = {0,1,1,2,1,4,2,4,7,11,13,14,1,13,16};
+  static const int SOBOL_M[MAX_QUASI_RANDOM_DIMENSIONS-1][6] = {
+    {1},{1,3},{1,3,1},{1,1,1},{1,1,3,3},{1,3,5,13},{1,1,5,5,17},{1,1,5,5,5},
+    {1,1,7,11,19},{1,1,5,1,1},{1,1,1,3,11},{1,3,5,5,31},{1,3,3,9,7,49},
+    {1,1,1,15,21,21},{1,3,1,13,27,49}
+  };
+
+
+  static std::vector<uint32_t> _sobol_directions(int dimension){
+
+    std::vector<uint32_t> v(32);
+
+    if(dimension==0){
+      for(int k=0;k<32;k++) v[k] = 1u << (31-k);
+      return v;
+    }
+
+    int s = SOBOL_S[dimension-1];
+    int a = SOBOL_A[dimension-1];
+    const int *m = SOBOL_M[dimension-1];
+
+    for(int k=0;k<s;k++) v[k] = ((uint32_t)m[k]) << (31-k);
+    for(int k=s;k<32;k++){
+      v[k] = v[k-s] ^ (v[k-s] >> s);
+      for(int j=1;j<s;j++){
+	if((a >> (s-1-j)) & 1) v[k] ^= v[k-j];
+      }
+    }
+
+    return v;
+
+  }
+
+
+  // counter based random numbers: same (seed,index) always gives the same value
+  static uint64_t _splitmix64(uint64_t x){
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+
+  static double _radical_inverse(uint64_t index, int base){
+    double inverse_base = 1.0/base;
+    double factor = inverse_base;
+    double r = 0;
+    while(index>0){
+      r += (index % base)*factor;
+      index /= base;
+      factor *= inverse_base;
+    }
+    return r;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  posture_sampler::posture_sampler(posture_sampling sampling,
+				   const std::vector<double> &min,
+				   const std::vector<double> &max,
+				   uint64_t seed)
+    : sampling(sampling), min(min), max(max), seed(seed) {
+
+    if(sampling!=UNIFORM_SAMPLING && min.size()>MAX_QUASI_RANDOM_DIMENSIONS){
+      std::cerr << "posture_sampler: quasi random sampling supports up to "
+		<< MAX_QUASI_RANDOM_DIMENSIONS << " joints, using uniform sampling" << std::endl;
+      this->sampling = UNIFORM_SAMPLING;
+    }
+
+    if(this->sampling==SOBOL_SAMPLING){
+      for(int i=0;i<min.size();i++) this->sobol_directions.push_back(_sobol_directions(i));
+    }
+
+  }
+
+
+  int posture_sampler::get_nb_joints() const {
+    return this->min.size();
+  }
+
+
+  posture_sampling posture_sampler::get_sampling() const {
+    return this->sampling;
+  }
+
+
+  uint64_t posture_sampler::get_seed() const {
+    return this->seed;
+  }
+
+
+  const std::vector<double>& posture_sampler::get_min() const {
+    return this->min;
+  }
+
+
+  const std::vector<double>& posture_sampler::get_max() const {
+    return this->max;
+  }
+
+
+  double posture_sampler::_unit(uint64_t index, int dimension) const {
+
+    if(this->sampling==HALTON_SAMPLING){
+      // index 0 would be the lower corner
+      return _radical_inverse(index+1,HALTON_PRIMES[dimension]);
+    }
+
+    if(this->sampling==SOBOL_SAMPLING){
+      uint64_t gray = (index+1) ^ ((index+1) >> 1);
+      uint32_t x = 0;
+      const std::vector<uint32_t> &v = this->sobol_directions[dimension];
+      for(int k=0; gray>0 && k<32; k++, gray>>=1){
+	if(gray & 1) x ^= v[k];
+      }
+      return x / 4294967296.0;
+    }
+
+    uint64_t r = _splitmix64(this->seed ^ _splitmix64(index*this->min.size()+dimension));
+    return (r >> 11) * (1.0/9007199254740992.0);
+
+  }
+
+
+  void posture_sampler::sample(uint64_t index, double *get_posture) const {
+
+    for(int i=0;i<this->min.size();i++){
+      get_posture[i] = this->min[i] + this->_unit(index,i)*(this->max[i]-this->min[i]);
+    }
+
+  }
+
+
+  class dataset_job {
+  public:
+    int fd;
+    bool left;
+    const posture_sampler *sampler;
+    long nb_samples;
+    int chunk_size;
+    int nb_joints;
+    int nb_columns;
+    long nb_chunks;
+    std::atomic<long> next_chunk;
+    std::atomic<long> nb_written;
+    std::atomic<bool> failed;
+    std::mutex progress_mutex;
+    fk_dataset_progress progress;
+    void *user_data;
+  };
+
+
+  static bool _pwrite_all(int fd, const char *data, size_t size, off_t offset){
+    while(size>0){
+      ssize_t written = pwrite(fd,data,size,offset);
+      if(written<0){
+	if(errno==EINTR) continue;
+	return false;
+      }
+      data += written;
+      size -= written;
+      offset += written;
+    }
+    return true;
+  }
+
+
+  static void _dataset_worker(dataset_job *job){
+
+    std::vector<float> chunk(job->nb_columns*job->chunk_size);
+    std::vector<double> q(job->nb_joints);
+    double c[6];
+
+    while(!job->failed){
+
+      long chunk_index = job->next_chunk++;
+      if(chunk_index>=job->nb_chunks) return;
+
+      long first = chunk_index*job->chunk_size;
+      int nb = std::min((long)job->chunk_size,job->nb_samples-first);
+
+      for(int s=0;s<job->chunk_size;s++){
+
+	if(s>=nb){
+	  for(int col=0;col<job->nb_columns;col++) chunk[col*job->chunk_size+s] = 0;
+	  continue;
+	}
+
+	job->sampler->sample(first+s,&q[0]);
+	bool success = forward_kinematics(job->left,&q[0],&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+	if(!success) for(int i=0;i<6;i++) c[i] = std::numeric_limits<double>::quiet_NaN();
+
+	for(int j=0;j<job->nb_joints;j++) chunk[j*job->chunk_size+s] = q[j];
+	for(int i=0;i<6;i++) chunk[(job->nb_joints+i)*job->chunk_size+s] = c[i];
+
+      }
+
+      // chunk offsets are known in advance: chunks are written in whatever order they are done
+      size_t size = chunk.size()*sizeof(float);
+      off_t offset = FK_DATASET_DATA_OFFSET + chunk_index*(off_t)size;
+      if(!_pwrite_all(job->fd,(const char*)&chunk[0],size,offset)){
+	std::cerr << "generate_fk_dataset: failed to write: " << strerror(errno) << std::endl;
+	job->failed = true;
+	return;
+      }
+
+      long nb_written = (job->nb_written += nb);
+
+      if(job->progress){
+	std::lock_guard<std::mutex> lock(job->progress_mutex);
+	if(!job->progress(nb_written,job->nb_samples,job->user_data)) job->failed = true;
+      }
+
+    }
+
+  }
+
+
+  bool generate_fk_dataset(const std::string &path, bool left,
+			   const posture_sampler &sampler,
+			   long nb_samples, int chunk_size,
+			   int nb_threads,
+			   fk_dataset_progress progress, void *user_data){
+
+    if(nb_threads<=0) nb_threads = std::thread::hardware_concurrency();
+    if(nb_threads<=0) nb_threads = 1;
+    if(chunk_size<=0) chunk_size = 65536;
+
+    int fd = open(path.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd<0){
+      std::cerr << "generate_fk_dataset: failed to open " << path << ": " << strerror(errno) << std::endl;
+      return false;
+    }
+
+    int nb_joints = sampler.get_nb_joints();
+
+    fk_dataset_header header;
+    memset(&header,0,sizeof(header));
+    header.magic = FK_DATASET_MAGIC;
+    header.version = 1;
+    header.nb_samples = nb_samples;
+    header.nb_joints = nb_joints;
+    header.nb_columns = nb_joints+6;
+    header.chunk_size = chunk_size;
+    header.nb_chunks = (nb_samples+chunk_size-1)/chunk_size;
+    header.data_offset = FK_DATASET_DATA_OFFSET;
+    header.left = left;
+    header.sampling = sampler.get_sampling();
+    header.seed = sampler.get_seed();
+
+    std::vector<char> header_block(FK_DATASET_DATA_OFFSET,0);
+    memcpy(&header_block[0],&header,sizeof(header));
+    std::vector<double> limits(sampler.get_min());
+    limits.insert(limits.end(),sampler.get_max().begin(),sampler.get_max().end());
+    if(!limits.empty()) memcpy(&header_block[128],&limits[0],limits.size()*sizeof(double));
+
+    dataset_job job;
+    job.fd = fd;
+    job.left = left;
+    job.sampler = &sampler;
+    job.nb_samples = nb_samples;
+    job.chunk_size = chunk_size;
+    job.nb_joints = nb_joints;
+    job.nb_columns = header.nb_columns;
+    job.nb_chunks = header.nb_chunks;
+    job.next_chunk = 0;
+    job.nb_written = 0;
+    job.failed = false;
+    job.progress = progress;
+    job.user_data = user_data;
+
+    bool success = _pwrite_all(fd,&header_block[0],header_block.size(),0);
+
+    if(success){
+      std::vector<std::thread> workers;
+      for(int i=0;i<nb_threads;i++) workers.push_back(std::thread(_dataset_worker,&job));
+      for(int i=0;i<workers.size();i++) workers[i].join();
+      success = !job.failed;
+    } else {
+      std::cerr << "generate_fk_dataset: failed to write " << path << ": " << strerror(errno) << std::endl;
+    }
+
+    if(close(fd)<0) success = false;
+
+    return success;
+
+  }
+
+
+}
@@ -0,0 +1,89 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Generates a (posture -> cartesian pose) dataset using forward kinematics,
+// see fk_dataset.h for the file format and scripts/playful_kinematics/fk_dataset.py
+// to load it from python.
+//
+// usage: pepper_fk_dataset_generator output_file number_of_samples
+//                                    [uniform|sobol|halton] [left|right] [seed] [number of threads] [chunk size]
+
+
+#include "playful_kinematics/fk_dataset.h"
+#include "playful_kinematics/pepper_configuration.h"
+
+#include <chrono>
+#include <cstdlib>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+static clock_type::time_point start;
+
+
+static bool _progress(long nb_written, long nb_samples, void *){
+  double elapsed = std::chrono::duration<double>(clock_type::now()-start).count();
+  std::cerr << "\r  " << nb_written << "/" << nb_samples
+	    << "  (" << (long)(nb_written/elapsed) << " samples/s)   " << std::flush;
+  return true;
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  if(argc<3){
+    std::cerr << "usage: " << argv[0] << " output_file number_of_samples "
+	      << "[uniform|sobol|halton] [left|right] [seed] [number of threads] [chunk size]" << std::endl;
+    return 1;
+  }
+
+  std::string path = argv[1];
+  long nb_samples = atol(argv[2]);
+
+  posture_sampling sampling = UNIFORM_SAMPLING;
+  if(argc>3 && std::string(argv[3])=="sobol") sampling = SOBOL_SAMPLING;
+  if(argc>3 && std::string(argv[3])=="halton") sampling = HALTON_SAMPLING;
+
+  bool left = !(argc>4 && std::string(argv[4])=="right");
+  uint64_t seed = argc>5 ? strtoull(argv[5],NULL,10) : 0;
+  int nb_threads = argc>6 ? atoi(argv[6]) : 0;
+  int chunk_size = argc>7 ? atoi(argv[7]) : 65536;
+
+  const float *min = left ? pepper::LEFT_MIN : pepper::RIGHT_MIN;
+  const float *max = left ? pepper::LEFT_MAX : pepper::RIGHT_MAX;
+
+  posture_sampler sampler(sampling,
+			  std::vector<double>(min,min+pepper::NB_DOFS),
+			  std::vector<double>(max,max+pepper::NB_DOFS),
+			  seed);
+
+  start = clock_type::now();
+  bool success = generate_fk_dataset(path,left,sampler,nb_samples,chunk_size,nb_threads,_progress);
+  double elapsed = std::chrono::duration<double>(clock_type::now()-start).count();
+  std::cerr << std::endl;
+
+  if(!success) return 1;
+
+  double megabytes = (nb_samples*(pepper::NB_DOFS+6)*sizeof(float))/1e6;
+  std::cout << nb_samples << " samples written to " << path << " in " << elapsed << " s ("
+	    << (long)(nb_samples/elapsed) << " samples/s, " << megabytes/elapsed << " MB/s)" << std::endl;
+
+  return 0;
+
+}
@@ -0,0 +1,72 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/fk_generated.h"
+#include "playful_kinematics/fk_simd.h"
+#include "playful_kinematics/trace.h"
+
+// generated at build time, see playful_kinematics_generate_fk in CMakeLists.txt
+#include "playful_kinematics/generated/left_fk.h"
+#include "playful_kinematics/generated/right_fk.h"
+
+namespace playful_kinematics {
+
+
+  static_assert(generated::left::NB_DOFS==NB_JOINTS && generated::right::NB_DOFS==NB_JOINTS,
+		"playful kinematics: the generated forward kinematics does not have NB_JOINTS joints");
+
+
+  bool generated_forward_kinematics(bool left, const double *q,
+				    double *x, double *y, double *z,
+				    double *alpha, double *beta, double *gamma){
+
+    PLAYFUL_KINEMATICS_TRACE("generated_forward_kinematics");
+
+    double position[3];
+    double rotation[9];
+
+    if(left) generated::left::forward_kinematics(q,position,rotation);
+    else generated::right::forward_kinematics(q,position,rotation);
+
+    *x = position[0];
+    *y = position[1];
+    *z = position[2];
+    get_rpy(rotation,alpha,beta,gamma);
+
+    return true;
+
+  }
+
+
+  bool generated_jacobian(bool left, const double *q, double *get_jacobian){
+
+    PLAYFUL_KINEMATICS_TRACE("generated_jacobian");
+
+    double position[3];
+    double rotation[9];
+
+    if(left) generated::left::jacobian(q,position,rotation,get_jacobian);
+    else generated::right::jacobian(q,position,rotation,get_jacobian);
+
+    return true;
+
+  }
+
+
+}
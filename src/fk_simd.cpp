@@ -0,0 +1,425 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/fk_simd_kernel.h"
+#include "playful_kinematics/trace.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PLAYFUL_KINEMATICS_X86
+#endif
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static void _identity(double *rotation, double *position){
+    for(int i=0;i<9;i++) rotation[i] = (i%4==0) ? 1 : 0;
+    for(int i=0;i<3;i++) position[i] = 0;
+  }
+
+
+  // (rotation,position) <- (rotation,position)*(r,p)
+  static void _compose(double *rotation, double *position, const double *r, const double *p){
+    double result[9];
+    for(int i=0;i<3;i++){
+      for(int j=0;j<3;j++){
+	result[i*3+j] = rotation[i*3]*r[j] + rotation[i*3+1]*r[3+j] + rotation[i*3+2]*r[6+j];
+      }
+      position[i] += rotation[i*3]*p[0] + rotation[i*3+1]*p[1] + rotation[i*3+2]*p[2];
+    }
+    for(int i=0;i<9;i++) rotation[i]=result[i];
+  }
+
+
+  // m*v, m*r
+  static void _multiply(const double *m, const double *v, double *get){
+    for(int i=0;i<3;i++) get[i] = m[i*3]*v[0] + m[i*3+1]*v[1] + m[i*3+2]*v[2];
+  }
+
+  static void _multiply_rotation(const double *m, const double *r, double *get){
+    for(int i=0;i<3;i++){
+      for(int j=0;j<3;j++){
+	get[i*3+j] = m[i*3]*r[j] + m[i*3+1]*r[3+j] + m[i*3+2]*r[6+j];
+      }
+    }
+  }
+
+
+  // transform of the joint at position q (without the fixed transform which follows it)
+  static void _joint_transform(const flat_joint &joint, double q, double *rotation, double *position){
+
+    const double *a = joint.axis;
+
+    if(joint.type==PRISMATIC_JOINT){
+      _identity(rotation,position);
+      for(int i=0;i<3;i++) position[i] = joint.origin[i]+q*a[i];
+      return;
+    }
+
+    // Rodrigues: c*I + s*K + (1-c)*a*transpose(a)
+    double c = cos(q), s = sin(q);
+    double K[9] = {    0, -a[2],  a[1],
+		    a[2],     0, -a[0],
+		   -a[1],  a[0],     0 };
+    for(int i=0;i<3;i++){
+      for(int j=0;j<3;j++){
+	rotation[i*3+j] = (i==j ? c : 0) + s*K[i*3+j] + (1-c)*a[i]*a[j];
+      }
+      position[i] = joint.origin[i];
+    }
+
+  }
+
+
+  flat_chain::flat_chain(){
+    _identity(this->base_rotation,this->base_position);
+  }
+
+
+  flat_chain::flat_chain(const KDL::Chain &chain){
+
+    _identity(this->base_rotation,this->base_position);
+
+    for(unsigned int s=0;s<chain.getNrOfSegments();s++){
+
+      const KDL::Segment &segment = chain.getSegment(s);
+      const KDL::Joint &joint = segment.getJoint();
+      KDL::Frame frame = segment.pose(0);
+
+      double rotation[9];
+      double position[3];
+      for(int i=0;i<3;i++){
+	for(int j=0;j<3;j++) rotation[i*3+j] = frame.M(i,j);
+	position[i] = frame.p(i);
+      }
+
+      int type;
+      switch(joint.getType()){
+      case KDL::Joint::RotAxis:
+      case KDL::Joint::RotX:
+      case KDL::Joint::RotY:
+      case KDL::Joint::RotZ:
+	type = REVOLUTE_JOINT;
+	break;
+      case KDL::Joint::TransAxis:
+      case KDL::Joint::TransX:
+      case KDL::Joint::TransY:
+      case KDL::Joint::TransZ:
+	type = PRISMATIC_JOINT;
+	break;
+      default:
+	this->add_fixed(rotation,position);
+	continue;
+      }
+
+      KDL::Vector axis_ = joint.JointAxis();
+      KDL::Vector origin_ = joint.JointOrigin();
+      double axis[3];
+      double origin[3];
+      for(int i=0;i<3;i++){
+	axis[i] = axis_(i);
+	origin[i] = origin_(i);
+      }
+      this->add_joint(type,axis,origin);
+
+      // the pose of the segment at 0 is the pose of the joint at 0 (origin) followed
+      // by the fixed transform
+      for(int i=0;i<3;i++) position[i] -= origin[i];
+      this->add_fixed(rotation,position);
+
+    }
+
+  }
+
+
+  void flat_chain::add_joint(int type, const double *axis, const double *origin){
+
+    flat_joint joint;
+    joint.type = type;
+    double norm = sqrt(axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2]);
+    for(int i=0;i<3;i++){
+      joint.axis[i] = norm>0 ? axis[i]/norm : 0;
+      joint.origin[i] = origin[i];
+    }
+    _identity(joint.rotation,joint.position);
+
+    this->joints.push_back(joint);
+    this->coefficients.resize(this->joints.size()*NB_COEFFICIENTS);
+    this->_update_coefficients(this->joints.size()-1);
+
+  }
+
+
+  void flat_chain::add_fixed(const double *rotation, const double *position){
+
+    if(this->joints.empty()){
+      _compose(this->base_rotation,this->base_position,rotation,position);
+      return;
+    }
+
+    flat_joint &joint = this->joints.back();
+    _compose(joint.rotation,joint.position,rotation,position);
+    this->_update_coefficients(this->joints.size()-1);
+
+  }
+
+
+  int flat_chain::get_nb_joints() const {
+    return this->joints.size();
+  }
+
+
+  flat_chain flat_chain::fold_joints(const std::vector<bool> &fold, const double *q) const {
+
+    flat_chain chain;
+    chain.add_fixed(this->base_rotation,this->base_position);
+
+    for(int j=0;j<this->joints.size();j++){
+
+      const flat_joint &joint = this->joints[j];
+
+      if(j<fold.size() && fold[j]){
+	double rotation[9];
+	double position[3];
+	_joint_transform(joint,q[j],rotation,position);
+	_compose(rotation,position,joint.rotation,joint.position);
+	chain.add_fixed(rotation,position);
+	continue;
+      }
+
+      chain.add_joint(joint.type,joint.axis,joint.origin);
+      chain.add_fixed(joint.rotation,joint.position);
+
+    }
+
+    return chain;
+
+  }
+
+
+  void flat_chain::_update_coefficients(int index){
+
+    const flat_joint &joint = this->joints[index];
+    double *m = &this->coefficients[index*NB_COEFFICIENTS];
+    for(int i=0;i<NB_COEFFICIENTS;i++) m[i]=0;
+
+    const double *a = joint.axis;
+
+    if(joint.type==PRISMATIC_JOINT){
+      for(int i=0;i<9;i++) m[i] = joint.rotation[i];
+      for(int i=0;i<3;i++){
+	m[27+i] = joint.position[i]+joint.origin[i];
+	m[30+i] = a[i];
+      }
+      return;
+    }
+
+    // rotation of the joint (Rodrigues): c*I + s*K + (1-c)*A,
+    // with A = a*transpose(a) and K the cross product matrix of a
+    double A[9];
+    for(int i=0;i<3;i++) for(int j=0;j<3;j++) A[i*3+j] = a[i]*a[j];
+    double K[9] = {    0, -a[2],  a[1],
+		    a[2],     0, -a[0],
+		   -a[1],  a[0],     0 };
+
+    double AR[9], KR[9], Ap[3], Kp[3];
+    _multiply_rotation(A,joint.rotation,AR);
+    _multiply_rotation(K,joint.rotation,KR);
+    _multiply(A,joint.position,Ap);
+    _multiply(K,joint.position,Kp);
+
+    for(int i=0;i<9;i++){
+      m[i] = AR[i];
+      m[9+i] = joint.rotation[i]-AR[i];
+      m[18+i] = KR[i];
+    }
+    for(int i=0;i<3;i++){
+      m[27+i] = Ap[i]+joint.origin[i];
+      m[30+i] = joint.position[i]-Ap[i];
+      m[33+i] = Kp[i];
+    }
+
+  }
+
+
+  static simd_level _detect_simd_level(){
+#ifdef PLAYFUL_KINEMATICS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  simd_level get_simd_level(){
+    static simd_level level = _detect_simd_level();
+    return level;
+  }
+
+
+  int get_simd_lanes(simd_level level){
+    switch(level){
+    case SIMD_AVX2: return 4;
+    case SIMD_AVX512: return 8;
+    case SIMD_AUTO: return get_simd_lanes(get_simd_level());
+    default: return 1;
+    }
+  }
+
+
+  std::string get_simd_name(simd_level level){
+    switch(level){
+    case SIMD_AVX2: return "avx2";
+    case SIMD_AVX512: return "avx512";
+    case SIMD_AUTO: return get_simd_name(get_simd_level());
+    default: return "scalar";
+    }
+  }
+
+
+  void forward_kinematics_lanes(const flat_chain &chain, int nb_postures,
+				const double *q,
+				double *get_positions, double *get_rotations,
+				simd_level level){
+
+    PLAYFUL_KINEMATICS_TRACE("forward_kinematics_lanes");
+
+    level = std::min(level,get_simd_level());
+
+#ifdef PLAYFUL_KINEMATICS_X86
+    if(level==SIMD_AVX512){
+      _forward_kinematics_avx512(chain,nb_postures,q,get_positions,get_rotations);
+      return;
+    }
+    if(level==SIMD_AVX2){
+      _forward_kinematics_avx2(chain,nb_postures,q,get_positions,get_rotations);
+      return;
+    }
+#endif
+
+    _forward_kinematics_all<double,1>(chain,nb_postures,q,get_positions,get_rotations);
+
+  }
+
+
+  template<int N>
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation){
+    PLAYFUL_KINEMATICS_TRACE("forward_kinematics");
+    _forward_kinematics_lanes<double,1,N>(chain,1,q,get_position,get_rotation);
+  }
+
+
+  template<int N>
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation,
+			  double *get_frame_positions){
+    PLAYFUL_KINEMATICS_TRACE("forward_kinematics");
+    _forward_kinematics_lanes<double,1,N,true>(chain,1,q,get_position,get_rotation,get_frame_positions);
+  }
+
+
+#define PLAYFUL_KINEMATICS_INSTANTIATE_FK(N)				\
+  template void forward_kinematics<N>(const flat_chain &chain, const double *q, \
+				      double *get_position, double *get_rotation); \
+  template void forward_kinematics<N>(const flat_chain &chain, const double *q, \
+				      double *get_position, double *get_rotation, \
+				      double *get_frame_positions);
+
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(1)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(2)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(3)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(4)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(5)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(6)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(7)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(8)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(9)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(10)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(11)
+  PLAYFUL_KINEMATICS_INSTANTIATE_FK(12)
+
+#undef PLAYFUL_KINEMATICS_INSTANTIATE_FK
+
+
+  typedef void (*fixed_fk_function)(const flat_chain &chain, const double *q,
+				    double *get_position, double *get_rotation);
+
+  // indexed by number of joints
+  static const fixed_fk_function fixed_fk_functions[] = {
+    NULL,
+    &forward_kinematics<1>, &forward_kinematics<2>, &forward_kinematics<3>, &forward_kinematics<4>,
+    &forward_kinematics<5>, &forward_kinematics<6>, &forward_kinematics<7>, &forward_kinematics<8>,
+    &forward_kinematics<9>, &forward_kinematics<10>, &forward_kinematics<11>, &forward_kinematics<12>
+  };
+
+  static_assert(sizeof(fixed_fk_functions)/sizeof(fixed_fk_function)==MAX_FIXED_DOFS+1,
+		"playful kinematics: fixed_fk_functions does not match MAX_FIXED_DOFS");
+
+
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation){
+
+    int nb_joints = chain.get_nb_joints();
+
+    if(nb_joints>0 && nb_joints<=MAX_FIXED_DOFS){
+      fixed_fk_functions[nb_joints](chain,q,get_position,get_rotation);
+      return;
+    }
+
+    PLAYFUL_KINEMATICS_TRACE("forward_kinematics");
+    _forward_kinematics_lanes<double,1>(chain,1,q,get_position,get_rotation);
+
+  }
+
+
+  void forward_kinematics(const flat_chain &chain, const double *q,
+			  double *get_position, double *get_rotation,
+			  double *get_frame_positions){
+    PLAYFUL_KINEMATICS_TRACE("forward_kinematics");
+    _forward_kinematics_lanes<double,1,0,true>(chain,1,q,get_position,get_rotation,get_frame_positions);
+  }
+
+
+  void get_rpy(const double *rotation, double *roll, double *pitch, double *yaw){
+
+    const double epsilon = 1e-12;
+    const double *d = rotation;
+
+    *pitch = atan2(-d[6],sqrt(d[0]*d[0]+d[3]*d[3]));
+    if(fabs(*pitch) > (M_PI/2.0-epsilon)){
+      *yaw = atan2(-d[1],d[4]);
+      *roll = 0.0;
+    } else {
+      *roll = atan2(d[7],d[8]);
+      *yaw = atan2(d[3],d[0]);
+    }
+
+  }
+
+
+}
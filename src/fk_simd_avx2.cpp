@@ -0,0 +1,39 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// compiled with -mavx2 -mfma on x86 (see CMakeLists.txt),
+// called only if the running machine supports it (see get_simd_level)
+
+
+#include "playful_kinematics/fk_simd_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+namespace playful_kinematics {
+
+
+  void _forward_kinematics_avx2(const flat_chain &chain, int nb_postures,
+				const double *q,
+				double *get_positions, double *get_rotations){
+    _forward_kinematics_all<v4d,4>(chain,nb_postures,q,get_positions,get_rotations);
+  }
+
+
+}
+
+#endif
@@ -0,0 +1,131 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Compares the forward kinematics of KDL (one posture at a time) with the
+// lane parallel forward kinematics of fk_simd.h, for each instruction set
+// supported by the machine, on random postures of the left arm within the
+// joint limits. Reports the postures computed per second and the largest
+// difference with KDL (position and roll, pitch, yaw).
+//
+// usage: pepper_fk_simd_benchmark [number of postures] [number of runs]
+
+
+#include "playful_kinematics/fk.h"
+#include "playful_kinematics/fk_simd.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static double _angle_difference(double a, double b){
+  return std::abs(atan2(sin(a-b),cos(a-b)));
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_postures = argc>1 ? atoi(argv[1]) : 100000;
+  int nb_runs = argc>2 ? atoi(argv[2]) : 10;
+
+  boost::shared_ptr<const robot_model> model = get_robot_model();
+  flat_chain chain(model->get_chain(true));
+  int nb_joints = chain.get_nb_joints();
+
+  if(nb_joints!=model->get_nb_joints(true)){
+    std::cerr << "playful kinematics: fk_simd_benchmark: flat chain of " << nb_joints
+	      << " joints, expected " << model->get_nb_joints(true) << std::endl;
+    return 1;
+  }
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  // structure of arrays (fk_simd.h) and array of structures (KDL)
+  std::vector<double> q(nb_joints*nb_postures);
+  std::vector<double> postures(nb_joints*nb_postures);
+  for(int i=0;i<nb_postures;i++){
+    for(int j=0;j<nb_joints;j++){
+      double v = pepper::LEFT_MIN[j]+uniform(generator)*(pepper::LEFT_MAX[j]-pepper::LEFT_MIN[j]);
+      q[j*nb_postures+i] = v;
+      postures[i*nb_joints+j] = v;
+    }
+  }
+
+  std::vector<double> kdl(6*nb_postures);
+  sample_stats kdl_time;
+  for(int run=0;run<nb_runs;run++){
+    clock_type::time_point start = clock_type::now();
+    for(int i=0;i<nb_postures;i++){
+      double *c = &kdl[i*6];
+      model->forward_kinematics(true,&postures[i*nb_joints],&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    }
+    kdl_time.add(std::chrono::duration<double,std::milli>(clock_type::now()-start).count());
+  }
+
+  std::cout << nb_postures << " postures, " << nb_joints << " joints, " << nb_runs << " runs" << std::endl
+	    << "best instruction set: " << get_simd_name(get_simd_level()) << std::endl;
+  kdl_time.print("kdl","ms");
+  std::cout << "kdl: " << (long)(nb_postures/(kdl_time.mean()/1000.0)) << " postures per second" << std::endl;
+
+  std::vector<double> positions(3*nb_postures);
+  std::vector<double> rotations(9*nb_postures);
+
+  for(int level=SIMD_SCALAR;level<=get_simd_level();level++){
+
+    std::string name = get_simd_name((simd_level)level);
+
+    sample_stats time;
+    for(int run=0;run<nb_runs;run++){
+      clock_type::time_point start = clock_type::now();
+      forward_kinematics_lanes(chain,nb_postures,&q[0],&positions[0],&rotations[0],(simd_level)level);
+      time.add(std::chrono::duration<double,std::milli>(clock_type::now()-start).count());
+    }
+
+    double position_error = 0;
+    double angle_error = 0;
+    for(int i=0;i<nb_postures;i++){
+      double rotation[9];
+      for(int k=0;k<9;k++) rotation[k] = rotations[k*nb_postures+i];
+      double rpy[3];
+      get_rpy(rotation,&rpy[0],&rpy[1],&rpy[2]);
+      for(int k=0;k<3;k++){
+	position_error = std::max(position_error,std::abs(positions[k*nb_postures+i]-kdl[i*6+k]));
+	angle_error = std::max(angle_error,_angle_difference(rpy[k],kdl[i*6+3+k]));
+      }
+    }
+
+    time.print(name,"ms");
+    std::cout << name << ": " << (long)(nb_postures/(time.mean()/1000.0)) << " postures per second, "
+	      << "speed up " << kdl_time.mean()/time.mean() << std::endl
+	      << name << ": largest difference with kdl: " << position_error << " (position) "
+	      << angle_error << " (angles)" << std::endl;
+
+  }
+
+  return 0;
+
+}
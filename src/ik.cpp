@@ -19,6 +19,7 @@
 
 
 #include "playful_kinematics/ik.h"
+#include "playful_kinematics/capture.h"
 
 namespace playful_kinematics {
 
@@ -45,24 +46,451 @@ namespace playful_kinematics {
   }
 
 
+  // replaces get_posture by the best of the nb_seeds postures of the atlas closest
+  // to the target (clamped to the joint limits), if better than get_posture
+  template<class Posture>
+  static void _seed_from_atlas(posture_atlas &atlas, int nb_seeds,
+			       const std::vector<bool> &mask,
+			       const std::vector<float> &min,
+			       const std::vector<float> &max,
+			       const float *target,
+			       cartesian_score &score,
+			       Posture &get_posture){
+
+    PLAYFUL_KINEMATICS_TRACE("seed_from_atlas");
+
+    int nb_joints = get_posture.size();
+    if(atlas.get_nb_joints()!=nb_joints) return;
+
+    std::vector<float> seeds;
+    int nb_found = atlas.query(target,mask,nb_seeds,seeds);
+    if(nb_found==0) return;
+
+    float best_score = score(get_posture);
+
+    Posture seed(get_posture);
+
+    for(int s=0;s<nb_found;s++){
+
+      for(int i=0;i<nb_joints;i++) seed[i]=std::min(max[i],std::max(min[i],seeds[s*nb_joints+i]));
+
+      float seed_score = score(seed);
+      if(seed_score<best_score){
+	best_score = seed_score;
+	get_posture = seed;
+      }
+
+    }
+
+  }
+
+
+  // limits of all joints, joints without limit being unbounded
+  static void _atlas_limits(const std::map<int,float> &limits, int nb_joints, float unbounded,
+			    std::vector<float> &get){
+    get.assign(nb_joints,unbounded);
+    for(std::map<int,float>::const_iterator it=limits.begin();it!=limits.end();it++){
+      if(it->first>=0 && it->first<nb_joints) get[it->first]=it->second;
+    }
+  }
+
+
+  // minimization with the engine and parameters of the profile, from get_posture
+  template<class Posture>
+  static bool _minimize(const ik_plan &plan, const Posture &min, const Posture &max,
+			cartesian_score &score, Posture &get_posture, float &get_score){
+
+    const solver_profile &profile = plan.profile;
+
+    if(profile.engine==CMAES_ENGINE){
+      return playful_kinematics::minimize(get_posture,min,max,
+					  profile.target_score,score,get_score,profile.cmaes);
+    }
+
+    return playful_kinematics::minimize(get_posture,
+					plan.minimization_order,
+					min,max,
+					profile.target_score,profile.max_step,profile.min_step,
+					profile.max_iteration,score,get_score,plan.search);
+
+  }
+
+
+  // plan of the current configuration for this side and mask.
+  // The plan is pinned for the whole solve, concurrent setters do not affect it. If the side
+  // or the mask differ, a local copy of the plan is solved: the configuration is not changed
+  static boost::shared_ptr<const ik_plan> _get_plan(const std::vector<bool> &mask, bool left){
+
+    boost::shared_ptr<const ik_plan> plan = playful_kinematics::get_ik_plan();
+
+    if(plan->left!=left || plan->mask!=mask){
+      boost::shared_ptr<ik_plan> local(new ik_plan(*plan));
+      // the free chain is the one of the side of the configuration
+      if(local->left!=left) local->free_chain.reset();
+      local->left = left;
+      local->mask = mask;
+      plan = local;
+    }
+
+    return plan;
+
+  }
+
+
   bool _ik(boost::shared_ptr< std::vector<bool> > mask, bool left, 
 	   float target_x, float target_y, float target_z, 
 	   float target_alpha, float target_gamma, float target_beta,
 	   std::vector<float> &get_posture, float &get_score){
 
-    playful_kinematics::set_target_cartesian_position(target_x,target_y,target_z,
-						      target_alpha,target_beta,target_gamma);
-    playful_kinematics::set_kinematics_side(left);
-    playful_kinematics::set_kinematics_mask(*mask);
-    playful_kinematics::get_kinematics_joints(get_posture);
+    boost::shared_ptr<const ik_plan> plan = _get_plan(*mask,left);
+
+    return ik(*plan,
+	      target_x,target_y,target_z,
+	      target_alpha,target_beta,target_gamma,
+	      get_posture,get_score);
+
+  }
+
+
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  std::vector<float> &get_posture,float &get_score){
+
+    cartesian_score score(plan.left,plan.mask,
+			  target_x,target_y,target_z,
+			  target_alpha,target_beta,target_gamma);
+
+    return ik(plan,
+	      target_x,target_y,target_z,
+	      target_alpha,target_beta,target_gamma,
+	      score,get_posture,get_score);
+
+  }
+
+
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  cartesian_score &score,
+	  std::vector<float> &get_posture,float &get_score){
+
+    PLAYFUL_KINEMATICS_TRACE("ik");
+
+    score.set_target(plan.left,plan.mask,
+		     target_x,target_y,target_z,
+		     target_alpha,target_beta,target_gamma);
+
+    get_posture = plan.reference_posture;
+    for(int i=0;i<get_posture.size();i++){
+      if(is_frozen(plan,i)) get_posture[i]=plan.min[i];
+    }
+
+    int nb_seeds;
+    boost::shared_ptr<posture_atlas> atlas = get_ik_atlas(plan.left,nb_seeds);
+    if(atlas){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      _seed_from_atlas(*atlas,nb_seeds,plan.mask,plan.min,plan.max,target,score,get_posture);
+    }
+
+    return _minimize(plan,plan.min,plan.max,score,get_posture,get_score);
+
+  }
+
+
+  template<int N>
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  fixed_posture<N> &get_posture,float &get_score){
+
+    cartesian_score score(plan.left,plan.mask,
+			  target_x,target_y,target_z,
+			  target_alpha,target_beta,target_gamma);
+
+    return ik<N>(plan,
+		 target_x,target_y,target_z,
+		 target_alpha,target_beta,target_gamma,
+		 score,get_posture,get_score);
+
+  }
+
+
+  template<int N>
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  cartesian_score &score,
+	  fixed_posture<N> &get_posture,float &get_score){
+
+    PLAYFUL_KINEMATICS_TRACE("ik");
+
+    if(plan.reference_posture.size()!=N){
+      std::cerr << "playful kinematics: inverse kinematics for " << N << " joints called with a plan for "
+		<< plan.reference_posture.size() << " joints" << std::endl;
+      get_score = std::numeric_limits<float>::max();
+      return false;
+    }
+
+    score.set_target(plan.left,plan.mask,
+		     target_x,target_y,target_z,
+		     target_alpha,target_beta,target_gamma);
+
+    // frozen joints folded into the chain, the forward kinematics runs over the free joints only
+    if(plan.free_chain) score.set_free_chain(plan.free_chain.get(),plan.free_joints);
+
+    fixed_posture<N> min;
+    fixed_posture<N> max;
+    for(int i=0;i<N;i++){
+      get_posture[i] = is_frozen(plan,i) ? plan.min[i] : plan.reference_posture[i];
+      min[i] = plan.min[i];
+      max[i] = plan.max[i];
+    }
+
+    int nb_seeds;
+    boost::shared_ptr<posture_atlas> atlas = get_ik_atlas(plan.left,nb_seeds);
+    if(atlas){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      _seed_from_atlas(*atlas,nb_seeds,plan.mask,plan.min,plan.max,target,score,get_posture);
+    }
+
+    return _minimize(plan,min,max,score,get_posture,get_score);
+
+  }
+
+
+#define PLAYFUL_KINEMATICS_INSTANTIATE_IK(N)				\
+  template bool ik<N>(const ik_plan &plan,				\
+		      float target_x, float target_y, float target_z,	\
+		      float target_alpha, float target_beta, float target_gamma, \
+		      fixed_posture<N> &get_posture,float &get_score);	\
+  template bool ik<N>(const ik_plan &plan,				\
+		      float target_x, float target_y, float target_z,	\
+		      float target_alpha, float target_beta, float target_gamma, \
+		      cartesian_score &score,				\
+		      fixed_posture<N> &get_posture,float &get_score);
+
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(1)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(2)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(3)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(4)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(5)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(6)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(7)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(8)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(9)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(10)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(11)
+  PLAYFUL_KINEMATICS_INSTANTIATE_IK(12)
+
+#undef PLAYFUL_KINEMATICS_INSTANTIATE_IK
+
+
+  typedef bool (*fixed_ik_function)(const ik_plan &plan, const float *target,
+				    cartesian_score &score,
+				    float *get_posture, float &get_score);
+
+  template<int N>
+  static bool _fixed_ik(const ik_plan &plan, const float *target,
+			cartesian_score &score,
+			float *get_posture, float &get_score){
+    fixed_posture<N> posture;
+    bool success = ik<N>(plan,
+			 target[0],target[1],target[2],
+			 target[3],target[4],target[5],
+			 score,posture,get_score);
+    for(int i=0;i<N;i++) get_posture[i]=posture[i];
+    return success;
+  }
+
+  // fixed size ik, indexed by number of joints
+  static const fixed_ik_function fixed_ik_functions[] = {
+    NULL,
+    &_fixed_ik<1>, &_fixed_ik<2>, &_fixed_ik<3>, &_fixed_ik<4>,
+    &_fixed_ik<5>, &_fixed_ik<6>, &_fixed_ik<7>, &_fixed_ik<8>,
+    &_fixed_ik<9>, &_fixed_ik<10>, &_fixed_ik<11>, &_fixed_ik<12>
+  };
+
+  static_assert(sizeof(fixed_ik_functions)/sizeof(fixed_ik_function)==MAX_FIXED_DOFS+1,
+		"playful kinematics: fixed_ik_functions does not match MAX_FIXED_DOFS");
+
+
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  float *get_posture,float &get_score){
+
+    cartesian_score score(plan.left,plan.mask,
+			  target_x,target_y,target_z,
+			  target_alpha,target_beta,target_gamma);
+
+    return ik(plan,
+	      target_x,target_y,target_z,
+	      target_alpha,target_beta,target_gamma,
+	      score,get_posture,get_score);
+
+  }
+
+
+  bool ik(const ik_plan &plan,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  cartesian_score &score,
+	  float *get_posture,float &get_score){
+
+    int nb_joints = plan.reference_posture.size();
+
+    if(nb_joints>0 && nb_joints<=MAX_FIXED_DOFS){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      return fixed_ik_functions[nb_joints](plan,target,score,get_posture,get_score);
+    }
+
+    std::vector<float> posture;
+    bool success = ik(plan,
+		      target_x,target_y,target_z,
+		      target_alpha,target_beta,target_gamma,
+		      score,posture,get_score);
+    for(int i=0;i<posture.size();i++) get_posture[i]=posture[i];
+    return success;
+
+  }
+
+
+  // starting posture of ik_from: frozen joints at their value, others within their limits
+  template<class Posture>
+  static void _start_from(const ik_plan &plan, const float *start_posture, Posture &get_posture){
+    for(int i=0;i<get_posture.size();i++){
+      if(is_frozen(plan,i)) get_posture[i] = plan.min[i];
+      else get_posture[i] = std::min(plan.max[i],std::max(plan.min[i],start_posture[i]));
+    }
+  }
+
+
+  typedef bool (*fixed_ik_from_function)(const ik_plan &plan, const float *target,
+					 cartesian_score &score, const float *start_posture,
+					 float *get_posture, float &get_score);
+
+  template<int N>
+  static bool _fixed_ik_from(const ik_plan &plan, const float *target,
+			     cartesian_score &score, const float *start_posture,
+			     float *get_posture, float &get_score){
+
+    score.set_target(plan.left,plan.mask,
+		     target[0],target[1],target[2],
+		     target[3],target[4],target[5]);
+    if(plan.free_chain) score.set_free_chain(plan.free_chain.get(),plan.free_joints);
+
+    fixed_posture<N> posture;
+    fixed_posture<N> min;
+    fixed_posture<N> max;
+    _start_from(plan,start_posture,posture);
+    for(int i=0;i<N;i++){
+      min[i] = plan.min[i];
+      max[i] = plan.max[i];
+    }
+
+    bool success = _minimize(plan,min,max,score,posture,get_score);
+    for(int i=0;i<N;i++) get_posture[i]=posture[i];
+    return success;
+
+  }
+
+  // fixed size ik_from, indexed by number of joints
+  static const fixed_ik_from_function fixed_ik_from_functions[] = {
+    NULL,
+    &_fixed_ik_from<1>, &_fixed_ik_from<2>, &_fixed_ik_from<3>, &_fixed_ik_from<4>,
+    &_fixed_ik_from<5>, &_fixed_ik_from<6>, &_fixed_ik_from<7>, &_fixed_ik_from<8>,
+    &_fixed_ik_from<9>, &_fixed_ik_from<10>, &_fixed_ik_from<11>, &_fixed_ik_from<12>
+  };
+
+  static_assert(sizeof(fixed_ik_from_functions)/sizeof(fixed_ik_from_function)==MAX_FIXED_DOFS+1,
+		"playful kinematics: fixed_ik_from_functions does not match MAX_FIXED_DOFS");
+
+
+  bool ik_from(const ik_plan &plan,
+	       float target_x, float target_y, float target_z, 
+	       float target_alpha, float target_beta, float target_gamma, 
+	       cartesian_score &score,
+	       const float *start_posture,
+	       float *get_posture,float &get_score){
+
+    PLAYFUL_KINEMATICS_TRACE("ik_from");
+
+    int nb_joints = plan.reference_posture.size();
+
+    if(nb_joints>0 && nb_joints<=MAX_FIXED_DOFS){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      return fixed_ik_from_functions[nb_joints](plan,target,score,start_posture,get_posture,get_score);
+    }
+
+    score.set_target(plan.left,plan.mask,
+		     target_x,target_y,target_z,
+		     target_alpha,target_beta,target_gamma);
+
+    std::vector<float> posture(nb_joints);
+    _start_from(plan,start_posture,posture);
+    bool success = _minimize(plan,plan.min,plan.max,score,posture,get_score);
+    for(int i=0;i<nb_joints;i++) get_posture[i]=posture[i];
+    return success;
+
+  }
+
+
+  bool ik(bool left, const std::vector<bool> &mask,
+	  const std::vector<float> &reference_posture,
+	  const std::vector<int> &minimization_priority,
+	  const std::map<int,float> &min,
+	  const std::map<int,float> &max,
+	  float target_x, float target_y, float target_z, 
+	  float target_alpha, float target_beta, float target_gamma, 
+	  std::vector<float> &get_posture,float &get_score,
+	  line_search search,
+	  const solver_profile &profile){
+
+    PLAYFUL_KINEMATICS_TRACE("ik");
+
+    cartesian_score score(left,mask,
+			  target_x,target_y,target_z,
+			  target_alpha,target_beta,target_gamma);
+
+    // frozen joints: equal min and max
+    get_posture = reference_posture;
+    for(int i=0;i<get_posture.size();i++){
+      std::map<int,float>::const_iterator it_min = min.find(i);
+      std::map<int,float>::const_iterator it_max = max.find(i);
+      if(it_min!=min.end() && it_max!=max.end() && it_min->second==it_max->second){
+	get_posture[i] = it_min->second;
+      }
+    }
+
+    int nb_seeds;
+    boost::shared_ptr<posture_atlas> atlas = get_ik_atlas(left,nb_seeds);
+    if(atlas){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      std::vector<float> min_limits,max_limits;
+      _atlas_limits(min,get_posture.size(),-std::numeric_limits<float>::max(),min_limits);
+      _atlas_limits(max,get_posture.size(),std::numeric_limits<float>::max(),max_limits);
+      _seed_from_atlas(*atlas,nb_seeds,mask,min_limits,max_limits,target,score,get_posture);
+    }
+
+    if(profile.engine==CMAES_ENGINE){
+      // joints without limits kept at their value
+      std::vector<float> min_limits(get_posture), max_limits(get_posture);
+      for(int i=0;i<get_posture.size();i++){
+	if(min.count(i) && max.count(i)){
+	  min_limits[i] = min.find(i)->second;
+	  max_limits[i] = max.find(i)->second;
+	}
+      }
+      return playful_kinematics::minimize(get_posture,min_limits,max_limits,
+					  profile.target_score,score,get_score,profile.cmaes);
+    }
 
-    std::vector<int> minimization_priority = playful_kinematics::get_minimization_priority(get_posture.size());
-    
     bool success = playful_kinematics::minimize(get_posture,
 						minimization_priority,
-						playful_kinematics::get_kinematics_joint_min_limit(),
-						playful_kinematics::get_kinematics_joint_max_limit(),
-						0.001,0.1,0.001,15,&(playful_kinematics::at_desired_cartesian_position),get_score);
+						min,max,
+						profile.target_score,profile.max_step,profile.min_step,
+						profile.max_iteration,score,get_score,search);
 
     return success;
 
@@ -116,137 +544,46 @@ extern "C" {
   }
 
 
-  bool ik_8dofs(bool left, float target_x, float target_y, float target_z, 
-		float target_alpha, float target_gamma, float target_beta, 
-		float *arm_1_joint, float *arm_2_joint, float *arm_3_joint, 
-		float *arm_4_joint, float *arm_5_joint, float *arm_6_joint,  
-		float *arm_7_joint,  float *arm_8_joint,
-		float *get_score){
-
-    std::vector<float> ik_joints;
-
-    ik_joints.push_back(*arm_1_joint);
-    ik_joints.push_back(*arm_2_joint);
-    ik_joints.push_back(*arm_3_joint);
-    ik_joints.push_back(*arm_4_joint);
-    ik_joints.push_back(*arm_5_joint);
-    ik_joints.push_back(*arm_6_joint);
-    ik_joints.push_back(*arm_7_joint);
-    ik_joints.push_back(*arm_8_joint);
-
-    playful_kinematics::set_kinematics_joints(ik_joints);
-    std::vector<float> get_posture;
-    bool success = playful_kinematics::ik(left,target_x,target_y,target_z,
-					  target_alpha,target_gamma,target_beta,
-					  get_posture,*get_score);
-
-    *arm_1_joint = get_posture[0];
-    *arm_2_joint = get_posture[1];
-    *arm_3_joint = get_posture[2];
-    *arm_4_joint = get_posture[3];
-    *arm_5_joint = get_posture[4];
-    *arm_6_joint = get_posture[5];
-    *arm_7_joint = get_posture[6];
-    *arm_8_joint = get_posture[7];
+  // posture: reference posture of the nb_dofs joints, replaced by the posture found
+  bool ik_ndofs(bool left, float target_x, float target_y, float target_z, 
+		float target_alpha, float target_beta, float target_gamma, 
+		int nb_dofs, float *posture, float *get_score){
 
-    return success;
-  }		
+    if(!playful_kinematics::applied_mask) playful_kinematics::_init_masks();
 
+    // the mask set by set_mask is captured with the call rather than by set_mask
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_IK_NDOFS);
+    if(record.is_active()){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      bool mask[6];
+      for(int i=0;i<6;i++) mask[i] = playful_kinematics::applied_mask->at(i);
+      record.add(left);
+      record.add_fixed(6,target);
+      record.add_fixed(6,mask);
+      record.add(nb_dofs,posture);
+    }
 
-  bool ik_7dofs(bool left, float target_x, float target_y, float target_z, 
-		float target_alpha, float target_gamma, float target_beta, 
-		float *arm_1_joint, float *arm_2_joint, float *arm_3_joint, 
-		float *arm_4_joint, float *arm_5_joint, float *arm_6_joint,  
-		float *arm_7_joint,
-		float *get_score){
-
-    std::vector<float> ik_joints;
-
-    ik_joints.push_back(*arm_1_joint);
-    ik_joints.push_back(*arm_2_joint);
-    ik_joints.push_back(*arm_3_joint);
-    ik_joints.push_back(*arm_4_joint);
-    ik_joints.push_back(*arm_5_joint);
-    ik_joints.push_back(*arm_6_joint);
-    ik_joints.push_back(*arm_7_joint);
-
-    playful_kinematics::set_kinematics_joints(ik_joints);
-    std::vector<float> get_posture;
-    bool success = playful_kinematics::ik(left,target_x,target_y,target_z,
-					  target_alpha,target_gamma,target_beta,
-					  get_posture,*get_score);
-
-    *arm_1_joint = get_posture[0];
-    *arm_2_joint = get_posture[1];
-    *arm_3_joint = get_posture[2];
-    *arm_4_joint = get_posture[3];
-    *arm_5_joint = get_posture[4];
-    *arm_6_joint = get_posture[5];
-    *arm_7_joint = get_posture[6];
-
-    return success;
-
-  }		
-
-
-  bool ik_6dofs(bool left, float target_x, float target_y, float target_z, 
-		float target_alpha, float target_gamma, float target_beta, 
-		float *arm_1_joint, float *arm_2_joint, float *arm_3_joint, 
-		float *arm_4_joint, float *arm_5_joint, float *arm_6_joint,
-		float *get_score){
-
-    std::vector<float> ik_joints;
-
-    ik_joints.push_back(*arm_1_joint);
-    ik_joints.push_back(*arm_2_joint);
-    ik_joints.push_back(*arm_3_joint);
-    ik_joints.push_back(*arm_4_joint);
-    ik_joints.push_back(*arm_5_joint);
-    ik_joints.push_back(*arm_6_joint);
-
-    playful_kinematics::set_kinematics_joints(ik_joints);
-    std::vector<float> get_posture;
-    bool success = playful_kinematics::ik(left,target_x,target_y,target_z,
-					  target_alpha,target_gamma,target_beta,
-					  get_posture,*get_score);
-
-    *arm_1_joint = get_posture[0];
-    *arm_2_joint = get_posture[1];
-    *arm_3_joint = get_posture[2];
-    *arm_4_joint = get_posture[3];
-    *arm_5_joint = get_posture[4];
-    *arm_6_joint = get_posture[5];
-
-    return success;
-
-  }		
-
+    bool success = false;
+
+    if(nb_dofs!=playful_kinematics::get_nb_joints(left)){
+      std::cerr << "playful kinematics: ik_ndofs: " << nb_dofs << " joints, the end effector has "
+		<< playful_kinematics::get_nb_joints(left) << std::endl;
+      *get_score = std::numeric_limits<float>::max();
+    } else {
+      // the posture is the reference posture of this call only: concurrent calls do not share it
+      boost::shared_ptr<const playful_kinematics::ik_plan> plan =
+	playful_kinematics::make_ik_plan(left,*playful_kinematics::applied_mask,
+					 std::vector<float>(posture,posture+nb_dofs));
+      success = playful_kinematics::ik(*plan,
+				       target_x,target_y,target_z,
+				       target_alpha,target_beta,target_gamma,
+				       posture,*get_score);
+    }
 
-  bool ik_5dofs(bool left, float target_x, float target_y, float target_z, 
-		float target_alpha, float target_gamma, float target_beta, 
-		float *arm_1_joint, float *arm_2_joint, float *arm_3_joint, 
-		float *arm_4_joint, float *arm_5_joint,
-		float *get_score){
-    
-    std::vector<float> ik_joints;
-
-    ik_joints.push_back(*arm_1_joint);
-    ik_joints.push_back(*arm_2_joint);
-    ik_joints.push_back(*arm_3_joint);
-    ik_joints.push_back(*arm_4_joint);
-    ik_joints.push_back(*arm_5_joint);
-
-    playful_kinematics::set_kinematics_joints(ik_joints);
-    std::vector<float> get_posture;
-    bool success = playful_kinematics::ik(left,target_x,target_y,target_z,
-					  target_alpha,target_gamma,target_beta,
-					  get_posture,*get_score);
-
-    *arm_1_joint = get_posture[0];
-    *arm_2_joint = get_posture[1];
-    *arm_3_joint = get_posture[2];
-    *arm_4_joint = get_posture[3];
-    *arm_5_joint = get_posture[4];
+    record.add(success);
+    record.add(*get_score);
+    record.add(nb_dofs,posture);
+    record.commit();
 
     return success;
 
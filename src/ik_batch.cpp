@@ -0,0 +1,334 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/ik_batch.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdint.h>
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  // range of target indexes [begin,end) owned by a worker, packed in a single
+  // 64 bits word so that the owner (taking from the front) and thieves (taking
+  // the back half) can update it with a single compare and swap
+  class work_range {
+
+  public:
+
+    void set(uint32_t begin, uint32_t end){
+      this->range.store(_pack(begin,end));
+    }
+
+    // owner: takes the first index of the range
+    bool take(uint32_t &get_index){
+      uint64_t current = this->range.load();
+      while(true){
+	uint32_t begin = _begin(current);
+	uint32_t end = _end(current);
+	if(begin>=end) return false;
+	if(this->range.compare_exchange_weak(current,_pack(begin+1,end))){
+	  get_index = begin;
+	  return true;
+	}
+      }
+    }
+
+    // thief: takes the back half of the range
+    bool steal(uint32_t &get_begin, uint32_t &get_end){
+      uint64_t current = this->range.load();
+      while(true){
+	uint32_t begin = _begin(current);
+	uint32_t end = _end(current);
+	if(end-begin<2 || begin>=end) return false;
+	uint32_t middle = begin+(end-begin)/2;
+	if(this->range.compare_exchange_weak(current,_pack(begin,middle))){
+	  get_begin = middle;
+	  get_end = end;
+	  return true;
+	}
+      }
+    }
+
+    uint32_t size() const {
+      uint64_t current = this->range.load();
+      if(_begin(current)>=_end(current)) return 0;
+      return _end(current)-_begin(current);
+    }
+
+  private:
+
+    static uint64_t _pack(uint32_t begin, uint32_t end){
+      return (((uint64_t)begin)<<32) | end;
+    }
+
+    static uint32_t _begin(uint64_t range){
+      return (uint32_t)(range>>32);
+    }
+
+    static uint32_t _end(uint64_t range){
+      return (uint32_t)(range & 0xffffffff);
+    }
+
+    std::atomic<uint64_t> range;
+
+    // one range per cache line
+    char padding[64-sizeof(std::atomic<uint64_t>)];
+
+  };
+
+
+  class batch_job {
+  public:
+    const ik_plan *plan;
+    const std::vector<float> *targets;
+    std::vector<float> *postures;
+    std::vector<float> *scores;
+    std::vector<char> success;
+    std::vector<work_range> ranges;
+    std::atomic<long> nb_solved;
+    const std::atomic<bool> *cancelled;
+    bool work_stealing;
+    int nb_joints;
+    int nb_workers_running;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+
+  static void _solve(batch_job &job, uint32_t index){
+
+    const float *target = &(*job.targets)[6*index];
+
+    std::vector<float> posture;
+    float score;
+
+    bool success = playful_kinematics::ik(*job.plan,
+					  target[0],target[1],target[2],
+					  target[3],target[4],target[5],
+					  posture,score);
+
+    for(int i=0;i<job.nb_joints;i++) (*job.postures)[index*job.nb_joints+i]=posture[i];
+    (*job.scores)[index] = score;
+    job.success[index] = success;
+
+  }
+
+
+  // steals from the worker with the most remaining targets
+  static bool _steal(batch_job &job, int thief){
+
+    while(true){
+
+      int victim = -1;
+      uint32_t largest = 1;
+      for(int i=0;i<job.ranges.size();i++){
+	uint32_t size = job.ranges[i].size();
+	if(i!=thief && size>largest){
+	  largest = size;
+	  victim = i;
+	}
+      }
+
+      if(victim<0) return false;
+
+      uint32_t begin,end;
+      if(job.ranges[victim].steal(begin,end)){
+	job.ranges[thief].set(begin,end);
+	return true;
+      }
+
+    }
+
+  }
+
+
+  static void _worker(batch_job *job, int id){
+
+    uint32_t index;
+
+    while(!job->cancelled->load()){
+
+      if(job->ranges[id].take(index)){
+	_solve(*job,index);
+	job->nb_solved++;
+	continue;
+      }
+
+      if(!job->work_stealing || !_steal(*job,id)) break;
+
+    }
+
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->nb_workers_running--;
+    if(job->nb_workers_running==0) job->done.notify_all();
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  ik_batch::ik_batch(const ik_batch_configuration &configuration,
+		     int nb_threads, bool work_stealing)
+    : plan(make_ik_plan(configuration.left,configuration.mask,
+			configuration.reference_posture,
+			configuration.minimization_priority,
+			configuration.min,configuration.max)),
+      nb_threads(nb_threads),
+      work_stealing(work_stealing),
+      cancelled(false) {
+
+    if(this->nb_threads<=0) this->nb_threads = std::thread::hardware_concurrency();
+    if(this->nb_threads<=0) this->nb_threads = 1;
+
+  }
+
+
+  ik_batch::ik_batch(boost::shared_ptr<const ik_plan> plan,
+		     int nb_threads, bool work_stealing)
+    : plan(plan),
+      nb_threads(nb_threads),
+      work_stealing(work_stealing),
+      cancelled(false) {
+
+    if(this->nb_threads<=0) this->nb_threads = std::thread::hardware_concurrency();
+    if(this->nb_threads<=0) this->nb_threads = 1;
+
+  }
+
+
+  int ik_batch::get_nb_threads() const {
+    return this->nb_threads;
+  }
+
+
+  void ik_batch::cancel(){
+    this->cancelled = true;
+  }
+
+
+  long ik_batch::solve(const std::vector<float> &targets,
+		       std::vector<float> &get_postures,
+		       std::vector<float> &get_scores,
+		       std::vector<bool> &get_success,
+		       ik_batch_progress progress, void *user_data,
+		       int progress_period_ms){
+
+    this->cancelled = false;
+
+    long nb_targets = targets.size()/6;
+    int nb_joints = this->plan->reference_posture.size();
+
+    get_postures.assign(nb_targets*nb_joints,0);
+    get_scores.assign(nb_targets,std::numeric_limits<float>::max());
+
+    batch_job job;
+    job.plan = this->plan.get();
+    job.targets = &targets;
+    job.postures = &get_postures;
+    job.scores = &get_scores;
+    job.success.assign(nb_targets,false);
+    job.ranges = std::vector<work_range>(this->nb_threads);
+    job.nb_solved = 0;
+    job.cancelled = &this->cancelled;
+    job.work_stealing = this->work_stealing;
+    job.nb_joints = nb_joints;
+
+    for(int i=0;i<this->nb_threads;i++){
+      job.ranges[i].set((uint32_t)((nb_targets*i)/this->nb_threads),
+			(uint32_t)((nb_targets*(i+1))/this->nb_threads));
+    }
+
+    job.nb_workers_running = this->nb_threads;
+
+    std::vector<std::thread> workers;
+    for(int i=0;i<this->nb_threads;i++) workers.push_back(std::thread(_worker,&job,i));
+
+    {
+      std::unique_lock<std::mutex> lock(job.mutex);
+      while(job.nb_workers_running>0){
+	if(!progress){
+	  job.done.wait(lock);
+	  continue;
+	}
+	job.done.wait_for(lock,std::chrono::milliseconds(progress_period_ms));
+	if(job.nb_workers_running==0) break;
+	lock.unlock();
+	if(!progress(job.nb_solved,nb_targets,user_data)) this->cancel();
+	lock.lock();
+      }
+    }
+
+    for(int i=0;i<workers.size();i++) workers[i].join();
+
+    if(progress) progress(job.nb_solved,nb_targets,user_data);
+
+    get_success.assign(job.success.begin(),job.success.end());
+
+    return job.nb_solved;
+
+  }
+
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+  // solves nb_targets targets (6 floats each) using the current configuration (see kinematic_config.h)
+  // and the mask (6 bools). postures (nb_targets*nb_joints floats), scores and success (nb_targets each)
+  // are written in input order. nb_threads: 0 for the number of cores.
+  long ik_batch(bool left, bool *mask, int nb_targets, float *targets,
+		float *postures, float *scores, bool *success,
+		int nb_threads){
+
+    // one consistent configuration for the whole batch, with this side and mask
+    boost::shared_ptr<playful_kinematics::ik_plan> plan(new playful_kinematics::ik_plan(*playful_kinematics::get_ik_plan()));
+    plan->left = left;
+    plan->mask.assign(mask,mask+6);
+
+    std::vector<float> t(targets,targets+6*nb_targets);
+    std::vector<float> p,s;
+    std::vector<bool> b;
+
+    playful_kinematics::ik_batch batch(plan,nb_threads);
+    long nb_solved = batch.solve(t,p,s,b);
+
+    for(int i=0;i<p.size();i++) postures[i]=p[i];
+    for(int i=0;i<nb_targets;i++){
+      scores[i]=s[i];
+      success[i]=b[i];
+    }
+
+    return nb_solved;
+
+  }
+
+}
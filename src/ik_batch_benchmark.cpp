@@ -0,0 +1,137 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Scaling of ik_batch over the number of threads, on a mixed workload:
+// most targets are reachable (cartesian position of random postures, solved quickly),
+// a contiguous block of targets is unreachable (solver runs until max iterations).
+// Compares static split of the targets with work stealing.
+//
+// usage: pepper_ik_batch_benchmark [number of targets] [ratio of unreachable targets]
+
+
+#include "playful_kinematics/ik_batch.h"
+#include "playful_kinematics/pepper_configuration.h"
+
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+
+static bool _progress(long nb_solved, long nb_targets, void *){
+  std::cerr << "\r  " << nb_solved << "/" << nb_targets << "   \r" << std::flush;
+  return true;
+}
+
+
+static double _run(const playful_kinematics::ik_batch_configuration &configuration,
+		   const std::vector<float> &targets,
+		   int nb_threads, bool work_stealing, int &get_nb_success){
+
+  std::vector<float> postures,scores;
+  std::vector<bool> success;
+
+  playful_kinematics::ik_batch batch(configuration,nb_threads,work_stealing);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  batch.solve(targets,postures,scores,success,_progress,NULL,1000);
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  get_nb_success = 0;
+  for(int i=0;i<success.size();i++) if(success[i]) get_nb_success++;
+
+  return std::chrono::duration<double>(end-start).count();
+
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_targets = 2000;
+  double unreachable_ratio = 0.1;
+  if(argc>1) nb_targets = atoi(argv[1]);
+  if(argc>2) unreachable_ratio = atof(argv[2]);
+
+  ik_batch_configuration configuration;
+  configuration.left = true;
+  configuration.mask = std::vector<bool>(6,false);
+  for(int i=0;i<3;i++) configuration.mask[i]=true;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    configuration.reference_posture.push_back(pepper::LEFT_REFERENCE[i]);
+    configuration.minimization_priority.push_back(pepper::MINIMIZATION_PRIORITY[i]);
+    configuration.min[i] = pepper::LEFT_MIN[i];
+    configuration.max[i] = pepper::LEFT_MAX[i];
+  }
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  int nb_unreachable = (int)(nb_targets*unreachable_ratio);
+  int first_unreachable = nb_targets/4;
+
+  std::vector<float> targets;
+  for(int t=0;t<nb_targets;t++){
+    double q[pepper::NB_DOFS];
+    for(int i=0;i<pepper::NB_DOFS;i++){
+      q[i] = pepper::LEFT_MIN[i]+uniform(generator)*(pepper::LEFT_MAX[i]-pepper::LEFT_MIN[i]);
+    }
+    double x,y,z,alpha,beta,gamma;
+    forward_kinematics(true,q,&x,&y,&z,&alpha,&beta,&gamma);
+    if(t>=first_unreachable && t<first_unreachable+nb_unreachable) x+=2.0;
+    targets.push_back(x); targets.push_back(y); targets.push_back(z);
+    targets.push_back(0); targets.push_back(0); targets.push_back(0);
+  }
+
+  int nb_cores = std::thread::hardware_concurrency();
+  if(nb_cores<1) nb_cores = 1;
+
+  std::cout << nb_targets << " targets, " << nb_unreachable << " unreachable, "
+	    << nb_cores << " cores" << std::endl;
+  std::cout << std::setw(8) << "threads"
+	    << std::setw(14) << "static (s)" << std::setw(10) << "speedup"
+	    << std::setw(14) << "stealing (s)" << std::setw(10) << "speedup"
+	    << std::setw(12) << "targets/s" << std::setw(10) << "solved" << std::endl;
+
+  // 1, 2, 4, ... and the number of cores
+  std::vector<int> nb_threads_sweep;
+  for(int nb_threads=1; nb_threads<nb_cores; nb_threads*=2) nb_threads_sweep.push_back(nb_threads);
+  nb_threads_sweep.push_back(nb_cores);
+
+  double reference_time = -1;
+
+  for(int s=0; s<nb_threads_sweep.size(); s++){
+
+    int nb_threads = nb_threads_sweep[s];
+
+    int nb_success;
+    double static_time = _run(configuration,targets,nb_threads,false,nb_success);
+    double stealing_time = _run(configuration,targets,nb_threads,true,nb_success);
+    if(reference_time<0) reference_time = stealing_time;
+
+    std::cout << std::fixed << std::setprecision(3)
+	      << std::setw(8) << nb_threads
+	      << std::setw(14) << static_time << std::setw(10) << reference_time/static_time
+	      << std::setw(14) << stealing_time << std::setw(10) << reference_time/stealing_time
+	      << std::setw(12) << std::setprecision(0) << nb_targets/stealing_time
+	      << std::setw(10) << nb_success << std::endl;
+
+  }
+
+}
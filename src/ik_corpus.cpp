@@ -0,0 +1,476 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/ik_corpus.h"
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/fk.h"
+#include "playful_kinematics/fk_dataset.h"
+#include "playful_kinematics/kinematic_config.h"
+#include "playful_kinematics/score_functions.h"
+#include <kdl/chainiksolverpos_nr_jl.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static const char *IK_CORPUS_HEADER = "playful_kinematics_ik_corpus";
+
+  // target score used by ik (see ik.cpp)
+  static const float IK_TARGET_SCORE = 0.001;
+
+  static const int NB_CORPUS_MASKS = 3;
+
+  // all, position only, position and alpha
+  static const bool CORPUS_MASKS[NB_CORPUS_MASKS][6] = { {true,true,true,true,true,true},
+							  {true,true,true,false,false,false},
+							  {true,true,true,true,false,false} };
+
+  typedef std::chrono::steady_clock clock_type;
+
+
+  // target pushed by offset (meters) further from the base of the robot
+  static void _push(float *target, double offset){
+    double norm = std::sqrt(target[0]*target[0]+target[1]*target[1]+target[2]*target[2]);
+    if(norm==0) return;
+    for(int i=0;i<3;i++) target[i] = (float)(target[i]*(norm+offset)/norm);
+  }
+
+
+  static void _generate_target(const robot_model &model, const posture_sampler &sampler,
+			       uint64_t index, ik_corpus_entry &entry){
+
+    int nb_joints = sampler.get_nb_joints();
+    std::vector<double> q(nb_joints);
+    sampler.sample(index,q.data());
+
+    // all joints at their closest limit
+    if(entry.kind==BORDERLINE_TARGET){
+      for(int i=0;i<nb_joints;i++){
+	double middle = 0.5*(sampler.get_min()[i]+sampler.get_max()[i]);
+	q[i] = q[i]<middle ? sampler.get_min()[i] : sampler.get_max()[i];
+      }
+    }
+
+    double x,y,z,alpha,beta,gamma;
+    model.forward_kinematics(entry.left,q.data(),&x,&y,&z,&alpha,&beta,&gamma);
+    float target[6] = {(float)x,(float)y,(float)z,(float)alpha,(float)beta,(float)gamma};
+
+    if(entry.kind==BORDERLINE_TARGET) _push(target,0.01);
+    if(entry.kind==UNREACHABLE_TARGET) _push(target,1.0);
+
+    for(int i=0;i<6;i++) entry.target[i]=target[i];
+
+  }
+
+
+  template<class T>
+  static void _write_values(std::ostream &out, const char *name, const std::vector<T> &values){
+    out << name << " " << values.size();
+    for(int i=0;i<values.size();i++) out << " " << values[i];
+    out << "\n";
+  }
+
+
+  template<class T>
+  static bool _read_values(std::istream &in, const char *name, std::vector<T> &get_values){
+    std::string read_name;
+    int size;
+    if(!(in >> read_name >> size) || read_name!=name || size<0) return false;
+    get_values.resize(size);
+    for(int i=0;i<size;i++){
+      if(!(in >> get_values[i])) return false;
+    }
+    return true;
+  }
+
+
+  static std::map<int,float> _limits(const std::vector<float> &limits){
+    std::map<int,float> map;
+    for(int i=0;i<limits.size();i++) map[i]=limits[i];
+    return map;
+  }
+
+
+  static float _not_solved(){
+    return std::numeric_limits<float>::quiet_NaN();
+  }
+
+
+  static bool _is_full(const std::vector<bool> &mask){
+    for(int i=0;i<mask.size();i++){
+      if(!mask[i]) return false;
+    }
+    return true;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  void generate_ik_corpus(int nb_targets, uint64_t seed, ik_corpus &corpus){
+
+    boost::shared_ptr<const robot_model> model = get_robot_model();
+
+    std::vector<posture_sampler> samplers;
+    for(int side=0;side<2;side++){
+      const ik_corpus_side &s = corpus.sides[side];
+      samplers.push_back(posture_sampler(UNIFORM_SAMPLING,
+					 std::vector<double>(s.min.begin(),s.min.end()),
+					 std::vector<double>(s.max.begin(),s.max.end()),
+					 seed+side));
+    }
+
+    corpus.version = IK_CORPUS_VERSION;
+    corpus.seed = seed;
+    corpus.entries.assign(nb_targets,ik_corpus_entry());
+
+    for(int t=0;t<nb_targets;t++){
+      ik_corpus_entry &entry = corpus.entries[t];
+      entry.kind = t%NB_IK_TARGET_KINDS;
+      entry.left = ((t/NB_IK_TARGET_KINDS)%2)==1;
+      const bool *mask = CORPUS_MASKS[(t/(2*NB_IK_TARGET_KINDS))%NB_CORPUS_MASKS];
+      entry.mask.assign(mask,mask+6);
+      _generate_target(*model,samplers[entry.left ? 1 : 0],t,entry);
+    }
+
+  }
+
+
+  bool write_ik_corpus(const std::string &path, const ik_corpus &corpus){
+
+    std::ofstream out(path.c_str());
+    if(!out){
+      std::cerr << "playful kinematics: failed to open ik corpus file " << path << std::endl;
+      return false;
+    }
+
+    out.precision(std::numeric_limits<float>::max_digits10);
+
+    out << IK_CORPUS_HEADER << " " << corpus.version << "\n";
+    out << "seed " << corpus.seed << "\n";
+    _write_values(out,"minimization_priority",corpus.minimization_priority);
+    for(int side=0;side<2;side++){
+      _write_values(out,"reference_posture",corpus.sides[side].reference_posture);
+      _write_values(out,"min",corpus.sides[side].min);
+      _write_values(out,"max",corpus.sides[side].max);
+    }
+
+    // kind left mask[6] target[6] success score nb_evaluations nb_joints posture
+    out << "entries " << corpus.entries.size() << "\n";
+    for(int e=0;e<corpus.entries.size();e++){
+      const ik_corpus_entry &entry = corpus.entries[e];
+      out << entry.kind << " " << entry.left;
+      for(int i=0;i<6;i++) out << " " << entry.mask[i];
+      for(int i=0;i<6;i++) out << " " << entry.target[i];
+      out << " " << entry.golden.success << " " << entry.golden.score << " " << entry.golden.nb_evaluations
+	  << " " << entry.golden.posture.size();
+      for(int i=0;i<entry.golden.posture.size();i++) out << " " << entry.golden.posture[i];
+      out << "\n";
+    }
+
+    if(!out){
+      std::cerr << "playful kinematics: failed to write ik corpus file " << path << std::endl;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  bool read_ik_corpus(const std::string &path, ik_corpus &get_corpus){
+
+    std::ifstream in(path.c_str());
+    if(!in){
+      std::cerr << "playful kinematics: failed to open ik corpus file " << path << std::endl;
+      return false;
+    }
+
+    std::string header,name;
+    int nb_entries;
+    bool valid = (in >> header >> get_corpus.version) && header==IK_CORPUS_HEADER;
+    if(valid && get_corpus.version!=IK_CORPUS_VERSION){
+      std::cerr << "playful kinematics: ik corpus file " << path << " of version " << get_corpus.version
+		<< ", expected version " << IK_CORPUS_VERSION << std::endl;
+      return false;
+    }
+    valid = valid && (in >> name >> get_corpus.seed) && name=="seed";
+    valid = valid && _read_values(in,"minimization_priority",get_corpus.minimization_priority);
+    for(int side=0;side<2 && valid;side++){
+      valid = _read_values(in,"reference_posture",get_corpus.sides[side].reference_posture)
+	&& _read_values(in,"min",get_corpus.sides[side].min)
+	&& _read_values(in,"max",get_corpus.sides[side].max);
+    }
+    valid = valid && (in >> name >> nb_entries) && name=="entries" && nb_entries>=0;
+
+    if(valid) get_corpus.entries.assign(nb_entries,ik_corpus_entry());
+
+    for(int e=0;e<nb_entries && valid;e++){
+      ik_corpus_entry &entry = get_corpus.entries[e];
+      bool value;
+      int nb_joints;
+      valid = (bool)(in >> entry.kind >> entry.left);
+      for(int i=0;i<6 && valid;i++){
+	valid = (bool)(in >> value);
+	entry.mask.push_back(value);
+      }
+      for(int i=0;i<6 && valid;i++) valid = (bool)(in >> entry.target[i]);
+      valid = valid && (in >> entry.golden.success >> entry.golden.score >> entry.golden.nb_evaluations >> nb_joints);
+      valid = valid && nb_joints>=0 && entry.kind>=0 && entry.kind<NB_IK_TARGET_KINDS;
+      if(valid) entry.golden.posture.resize(nb_joints);
+      for(int i=0;i<nb_joints && valid;i++) valid = (bool)(in >> entry.golden.posture[i]);
+    }
+
+    if(!valid){
+      std::cerr << "playful kinematics: failed to read ik corpus file " << path << std::endl;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  void replay_ik_corpus(const ik_corpus &corpus, std::vector<ik_corpus_result> &get_results,
+			line_search search, const solver_profile &profile){
+
+    // one plan per end effector and mask
+    std::map< std::pair< bool,std::vector<bool> >, boost::shared_ptr<const ik_plan> > plans;
+
+    get_results.assign(corpus.entries.size(),ik_corpus_result());
+
+    for(int e=0;e<corpus.entries.size();e++){
+
+      const ik_corpus_entry &entry = corpus.entries[e];
+      const ik_corpus_side &side = corpus.sides[entry.left ? 1 : 0];
+
+      boost::shared_ptr<const ik_plan> &plan = plans[std::make_pair(entry.left,entry.mask)];
+      if(!plan){
+	plan = make_ik_plan(entry.left,entry.mask,side.reference_posture,
+			    corpus.minimization_priority,
+			    _limits(side.min),_limits(side.max),search,profile);
+      }
+
+      ik_corpus_result &result = get_results[e];
+      result.posture.resize(side.reference_posture.size());
+      const float *t = entry.target;
+
+      reset_nb_score_evaluations();
+      clock_type::time_point start = clock_type::now();
+      result.success = ik(*plan,t[0],t[1],t[2],t[3],t[4],t[5],result.posture.data(),result.score);
+      result.latency = std::chrono::duration<double,std::nano>(clock_type::now()-start).count();
+      result.nb_evaluations = get_nb_score_evaluations();
+
+    }
+
+  }
+
+
+  void replay_ik_corpus_kdl(const ik_corpus &corpus, std::vector<ik_corpus_result> &get_results,
+			    int max_iterations, double eps){
+
+    boost::shared_ptr<const robot_model> model = get_robot_model();
+
+    get_results.assign(corpus.entries.size(),ik_corpus_result());
+
+    // solvers of each side, built once (outside of the timed solves, as the plans of ik)
+    boost::shared_ptr<KDL::ChainFkSolverPos_recursive> fk_solvers[2];
+    boost::shared_ptr<KDL::ChainIkSolverVel_pinv> velocity_solvers[2];
+    boost::shared_ptr<KDL::ChainIkSolverPos_NR_JL> solvers[2];
+
+    for(int e=0;e<corpus.entries.size();e++){
+
+      const ik_corpus_entry &entry = corpus.entries[e];
+      int s = entry.left ? 1 : 0;
+      const ik_corpus_side &side = corpus.sides[s];
+      ik_corpus_result &result = get_results[e];
+
+      if(!_is_full(entry.mask)){
+	result.score = _not_solved();
+	continue;
+      }
+
+      const KDL::Chain &chain = model->get_chain(entry.left);
+      int nb_joints = side.reference_posture.size();
+      KDL::JntArray start(nb_joints), solution(nb_joints);
+      for(int i=0;i<nb_joints;i++) start(i) = side.reference_posture[i];
+
+      if(!solvers[s]){
+	KDL::JntArray min(nb_joints), max(nb_joints);
+	for(int i=0;i<nb_joints;i++){
+	  min(i) = side.min[i];
+	  max(i) = side.max[i];
+	}
+	fk_solvers[s].reset(new KDL::ChainFkSolverPos_recursive(chain));
+	velocity_solvers[s].reset(new KDL::ChainIkSolverVel_pinv(chain));
+	solvers[s].reset(new KDL::ChainIkSolverPos_NR_JL(chain,min,max,*fk_solvers[s],*velocity_solvers[s],
+							 max_iterations,eps));
+      }
+
+      const float *t = entry.target;
+      KDL::Frame target(KDL::Rotation::RPY(t[3],t[4],t[5]),KDL::Vector(t[0],t[1],t[2]));
+
+      clock_type::time_point start_time = clock_type::now();
+      solvers[s]->CartToJnt(start,target,solution);
+      result.latency = std::chrono::duration<double,std::nano>(clock_type::now()-start_time).count();
+
+      result.posture.resize(nb_joints);
+      for(int i=0;i<nb_joints;i++) result.posture[i] = solution(i);
+
+      cartesian_score score(entry.left,entry.mask,t[0],t[1],t[2],t[3],t[4],t[5]);
+      result.score = score(result.posture);
+      result.success = (result.score<=IK_TARGET_SCORE);
+
+    }
+
+  }
+
+
+  void get_ik_corpus_golden(const ik_corpus &corpus, std::vector<ik_corpus_result> &get_results){
+    get_results.clear();
+    for(int e=0;e<corpus.entries.size();e++) get_results.push_back(corpus.entries[e].golden);
+  }
+
+
+  void set_ik_corpus_golden(const std::vector<ik_corpus_result> &results, ik_corpus &corpus){
+    for(int e=0;e<corpus.entries.size() && e<results.size();e++) corpus.entries[e].golden = results[e];
+  }
+
+
+  ik_corpus_report::ik_corpus_report()
+    : nb_solved(0), nb_success(0), nb_lost(0), nb_worse(0) {
+    for(int k=0;k<NB_IK_TARGET_KINDS;k++){
+      this->nb_solved_per_kind[k] = 0;
+      this->nb_success_per_kind[k] = 0;
+    }
+  }
+
+
+  double ik_corpus_report::get_success_rate() const {
+    if(this->nb_solved==0) return 0;
+    return (double)this->nb_success/this->nb_solved;
+  }
+
+
+  double ik_corpus_report::get_success_rate(int kind) const {
+    if(this->nb_solved_per_kind[kind]==0) return 0;
+    return (double)this->nb_success_per_kind[kind]/this->nb_solved_per_kind[kind];
+  }
+
+
+  void ik_corpus_report::print(const std::string &label){
+    static const char *kinds[NB_IK_TARGET_KINDS] = {"reachable","borderline","unreachable"};
+    std::cout << std::fixed << std::setprecision(2)
+	      << label << ": " << this->nb_solved << " targets, success rate "
+	      << 100.0*this->get_success_rate() << " %";
+    for(int k=0;k<NB_IK_TARGET_KINDS;k++) std::cout << ", " << kinds[k] << " " << 100.0*this->get_success_rate(k) << " %";
+    std::cout << std::endl;
+    std::cout << "  worse than golden: " << this->nb_worse << ", golden success lost: " << this->nb_lost << std::endl;
+    this->scores.print("  score","cartesian score");
+    // latencies are not stored in corpus files
+    if(this->latencies.percentile(1.0)>0) this->latencies.print("  latency","us");
+    this->evaluations.print("  score evaluations","calls");
+  }
+
+
+  ik_corpus_report get_ik_corpus_report(const ik_corpus &corpus,
+					const std::vector<ik_corpus_result> &results,
+					const ik_corpus_tolerance &tolerance){
+
+    ik_corpus_report report;
+    report.scores.reserve(results.size());
+    report.latencies.reserve(results.size());
+    report.evaluations.reserve(results.size());
+
+    for(int e=0;e<corpus.entries.size() && e<results.size();e++){
+
+      const ik_corpus_entry &entry = corpus.entries[e];
+      const ik_corpus_result &result = results[e];
+      if(result.score!=result.score) continue;
+
+      report.nb_solved++;
+      report.nb_solved_per_kind[entry.kind]++;
+      if(result.success){
+	report.nb_success++;
+	report.nb_success_per_kind[entry.kind]++;
+      }
+      if(entry.golden.success && !result.success) report.nb_lost++;
+      if(result.score>entry.golden.score+tolerance.score) report.nb_worse++;
+
+      report.scores.add(result.score);
+      report.latencies.add(result.latency/1000.0);
+      report.evaluations.add(result.nb_evaluations);
+
+    }
+
+    return report;
+
+  }
+
+
+  bool check_ik_corpus_report(ik_corpus_report &report, ik_corpus_report &golden,
+			      const ik_corpus_tolerance &tolerance){
+
+    bool passed = true;
+
+    if(report.get_success_rate()<golden.get_success_rate()-tolerance.success_rate){
+      std::cerr << "playful kinematics: ik corpus: success rate " << report.get_success_rate()
+		<< ", golden " << golden.get_success_rate() << std::endl;
+      passed = false;
+    }
+
+    for(int k=0;k<NB_IK_TARGET_KINDS;k++){
+      if(report.get_success_rate(k)<golden.get_success_rate(k)-tolerance.success_rate){
+	std::cerr << "playful kinematics: ik corpus: success rate of targets of kind " << k << " "
+		  << report.get_success_rate(k) << ", golden " << golden.get_success_rate(k) << std::endl;
+	passed = false;
+      }
+    }
+
+    if(report.nb_worse>tolerance.worse_rate*report.nb_solved){
+      std::cerr << "playful kinematics: ik corpus: " << report.nb_worse << " scores worse than golden" << std::endl;
+      passed = false;
+    }
+
+    double percentiles[2] = {0.5,0.99};
+    for(int p=0;p<2 && tolerance.check_evaluations;p++){
+      double evaluations = report.evaluations.percentile(percentiles[p]);
+      double golden_evaluations = golden.evaluations.percentile(percentiles[p]);
+      if(evaluations>golden_evaluations*(1.0+tolerance.evaluations)){
+	std::cerr << "playful kinematics: ik corpus: percentile " << percentiles[p] << " of score evaluations "
+		  << evaluations << ", golden " << golden_evaluations << std::endl;
+	passed = false;
+      }
+    }
+
+    return passed;
+
+  }
+
+
+}
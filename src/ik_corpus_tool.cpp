@@ -0,0 +1,93 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Golden accuracy and latency corpus of the inverse kinematics of Pepper, see ik_corpus.h.
+//
+// generate: generates the targets, solves them with ik and writes them with their
+//           solutions as golden results (e.g. to tests/data/pepper_ik_corpus.txt,
+//           replayed by tests/ik_corpus_unit_tests.cpp)
+// replay:   solves the targets of the corpus with ik and with KDL's ChainIkSolverPos_NR_JL,
+//           prints the reports (success rates, score, latency and evaluations distributions),
+//           and exits with 1 if ik regressed compared to the golden results
+//
+// usage: pepper_ik_corpus generate corpus_file [number of targets] [seed]
+//        pepper_ik_corpus replay corpus_file
+
+
+#include "playful_kinematics/ik_corpus.h"
+#include "playful_kinematics/pepper_ik_corpus.h"
+
+#include <cstdlib>
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  if(argc<3 || (std::string(argv[1])!="generate" && std::string(argv[1])!="replay")){
+    std::cerr << "usage: " << argv[0] << " generate corpus_file [number of targets] [seed]" << std::endl
+	      << "       " << argv[0] << " replay corpus_file" << std::endl;
+    return 1;
+  }
+
+  std::string path = argv[2];
+  ik_corpus corpus;
+  std::vector<ik_corpus_result> results;
+
+  if(std::string(argv[1])=="generate"){
+
+    int nb_targets = argc>3 ? atoi(argv[3]) : 3000;
+    uint64_t seed = argc>4 ? strtoull(argv[4],NULL,10) : 0;
+
+    configure_pepper_ik_corpus(corpus);
+    generate_ik_corpus(nb_targets,seed,corpus);
+    replay_ik_corpus(corpus,results);
+    set_ik_corpus_golden(results,corpus);
+    if(!write_ik_corpus(path,corpus)) return 1;
+
+    ik_corpus_report report = get_ik_corpus_report(corpus,results);
+    report.print("golden");
+    std::cout << nb_targets << " targets written to " << path << std::endl;
+
+    return 0;
+
+  }
+
+  if(!read_ik_corpus(path,corpus)) return 1;
+
+  get_ik_corpus_golden(corpus,results);
+  ik_corpus_report golden = get_ik_corpus_report(corpus,results);
+  golden.print("golden");
+
+  replay_ik_corpus(corpus,results);
+  ik_corpus_report report = get_ik_corpus_report(corpus,results);
+  report.print("ik");
+
+  std::vector<ik_corpus_result> kdl_results;
+  replay_ik_corpus_kdl(corpus,kdl_results);
+  ik_corpus_report kdl_report = get_ik_corpus_report(corpus,kdl_results);
+  kdl_report.print("KDL ChainIkSolverPos_NR_JL (full masks only)");
+
+  if(!check_ik_corpus_report(report,golden)){
+    std::cout << "regression compared to the golden results" << std::endl;
+    return 1;
+  }
+
+  return 0;
+
+}
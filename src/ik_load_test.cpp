@@ -0,0 +1,353 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Load test of inverse and forward kinematics: threads solve requests for a given duration,
+// and the throughput, latency histograms (see latency_histogram in stats.h) and fairness
+// between threads (Jain's index of the number of requests per thread) are reported.
+//
+// closed loop: each thread sends its next request as soon as the previous one is solved
+//              (measures the maximal throughput)
+// open loop:   requests arrive at a fixed rate (spread over the threads), whether or not the
+//              previous ones are solved. Latencies are measured from the arrival time of the
+//              requests, so that time spent waiting behind a slow request is accounted for.
+// operations:  ik (Pepper's arms, see ik.h), fk (robot_model::forward_kinematics) or mix (half each)
+// targets:     reachable (forward kinematics of postures within the joint limits) or corpus
+//              (reachable, borderline and unreachable targets with various masks, see ik_corpus.h)
+// number of threads: 0 for a sweep over 1, 2, 4, ... threads up to the number of cores, reporting
+//              the parallel efficiency (throughput relative to the single thread throughput)
+// pin:         each thread pinned to its own core
+//
+// usage: pepper_ik_load_test [closed|open] [ik|fk|mix] [reachable|corpus] [number of threads]
+//                            [duration in s] [open loop rate, requests per s] [pin]
+// defaults: closed ik reachable 0 2 1000
+
+
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/ik_corpus.h"
+#include "playful_kinematics/fk_dataset.h"
+#include "playful_kinematics/kinematic_config.h"
+#include "playful_kinematics/pepper_ik_corpus.h"
+#include "playful_kinematics/stats.h"
+
+#include <pthread.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+static const int NB_TARGETS = 4096;
+
+
+enum operation {
+  IK_OPERATION = 0,
+  FK_OPERATION = 1,
+  MIX_OPERATION = 2
+};
+
+
+class request {
+public:
+  bool left;
+  const playful_kinematics::ik_plan *plan;
+  float target[6];
+  double posture[playful_kinematics::pepper::NB_DOFS];
+};
+
+
+class load_configuration {
+public:
+  bool open_loop;
+  operation op;
+  double duration;
+  double rate;
+  bool pin;
+  std::vector<request> requests;
+  // plans of the requests, shared by all threads (ik does not modify them)
+  std::map< std::pair< bool,std::vector<bool> >, boost::shared_ptr<const playful_kinematics::ik_plan> > plans;
+};
+
+
+class thread_result {
+public:
+  thread_result() : nb_requests(0), nb_success(0) {}
+  playful_kinematics::latency_histogram ik_latencies;
+  playful_kinematics::latency_histogram fk_latencies;
+  long nb_requests;
+  long nb_success;
+};
+
+
+class run_result {
+public:
+  int nb_threads;
+  double elapsed;
+  std::vector<thread_result> threads;
+  playful_kinematics::latency_histogram ik_latencies;
+  playful_kinematics::latency_histogram fk_latencies;
+  long nb_requests;
+  long nb_success;
+  double get_throughput() const { return this->nb_requests/this->elapsed; }
+  double get_fairness() const;
+};
+
+
+// Jain's fairness index of the number of requests per thread: 1 if all threads
+// solved as many requests, 1/n if one thread solved all of them
+double run_result::get_fairness() const {
+  double sum = 0, sum_squares = 0;
+  for(int t=0;t<this->threads.size();t++){
+    sum += this->threads[t].nb_requests;
+    sum_squares += (double)this->threads[t].nb_requests*this->threads[t].nb_requests;
+  }
+  if(sum_squares==0) return 1;
+  return sum*sum/(this->threads.size()*sum_squares);
+}
+
+
+static void _pin(int core){
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core,&set);
+  if(pthread_setaffinity_np(pthread_self(),sizeof(cpu_set_t),&set)!=0){
+    std::cerr << "failed to pin thread to core " << core << std::endl;
+  }
+}
+
+
+static void _work(const load_configuration &config, int index, int nb_threads,
+		  const std::atomic<bool> &go, clock_type::time_point &start,
+		  thread_result &result){
+
+  using namespace playful_kinematics;
+
+  if(config.pin) _pin(index%std::thread::hardware_concurrency());
+
+  cartesian_score score(true,std::vector<bool>(6,true),0,0,0,0,0,0);
+  float posture[pepper::NB_DOFS];
+  float ik_score;
+  double c[6];
+  boost::shared_ptr<const robot_model> model = get_robot_model();
+
+  // each thread starts at its own offset in the requests
+  int next = (index*config.requests.size())/nb_threads;
+  double interval = config.open_loop ? nb_threads/config.rate : 0;
+
+  while(!go.load(std::memory_order_acquire));
+  std::this_thread::sleep_until(start);
+  clock_type::time_point end = start+std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(config.duration));
+  // arrival time of the next request (open loop), each thread shifted by a fraction of the interval
+  clock_type::time_point arrival = start+std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(interval*index/nb_threads));
+
+  // counted locally: the results of the threads share cache lines
+  long nb_requests = 0;
+  long nb_success = 0;
+
+  for(long r=0;;r++){
+
+    if(config.open_loop){
+      if(arrival>=end) break;
+      std::this_thread::sleep_until(arrival);
+    }
+
+    clock_type::time_point begin = config.open_loop ? arrival : clock_type::now();
+    if(begin>=end) break;
+
+    const request &rq = config.requests[next];
+    next = (next+1)%config.requests.size();
+
+    bool ik_request = config.op==IK_OPERATION || (config.op==MIX_OPERATION && r%2==0);
+    if(ik_request){
+      const float *t = rq.target;
+      if(ik(*rq.plan,t[0],t[1],t[2],t[3],t[4],t[5],score,posture,ik_score)) nb_success++;
+    } else {
+      if(model->forward_kinematics(rq.left,rq.posture,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5])) nb_success++;
+    }
+
+    int64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now()-begin).count();
+    if(ik_request) result.ik_latencies.record(latency);
+    else result.fk_latencies.record(latency);
+    nb_requests++;
+
+    if(config.open_loop){
+      arrival += std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(interval));
+    }
+
+  }
+
+  result.nb_requests = nb_requests;
+  result.nb_success = nb_success;
+
+}
+
+
+static run_result _run(const load_configuration &config, int nb_threads){
+
+  run_result result;
+  result.nb_threads = nb_threads;
+  result.threads.resize(nb_threads);
+
+  std::atomic<bool> go(false);
+  clock_type::time_point start;
+  std::vector<std::thread> threads;
+  for(int t=0;t<nb_threads;t++){
+    threads.push_back(std::thread(_work,std::cref(config),t,nb_threads,std::cref(go),
+				  std::ref(start),std::ref(result.threads[t])));
+  }
+
+  // all threads created before the clock starts
+  start = clock_type::now()+std::chrono::milliseconds(10);
+  go.store(true,std::memory_order_release);
+  for(int t=0;t<nb_threads;t++) threads[t].join();
+  result.elapsed = std::chrono::duration<double>(clock_type::now()-start).count();
+
+  result.nb_requests = 0;
+  result.nb_success = 0;
+  for(int t=0;t<nb_threads;t++){
+    result.ik_latencies.merge(result.threads[t].ik_latencies);
+    result.fk_latencies.merge(result.threads[t].fk_latencies);
+    result.nb_requests += result.threads[t].nb_requests;
+    result.nb_success += result.threads[t].nb_success;
+  }
+
+  return result;
+
+}
+
+
+static void _print(const run_result &result){
+  std::cout << result.nb_threads << " threads: " << (long)result.get_throughput() << " requests/s, "
+	    << result.nb_requests << " requests, " << result.nb_success << " successes, fairness "
+	    << std::fixed << std::setprecision(3) << result.get_fairness() << std::endl;
+  if(result.ik_latencies.size()) result.ik_latencies.print("  ik latency");
+  if(result.fk_latencies.size()) result.fk_latencies.print("  fk latency");
+  long min = result.threads[0].nb_requests, max = min;
+  for(int t=1;t<result.threads.size();t++){
+    min = std::min(min,result.threads[t].nb_requests);
+    max = std::max(max,result.threads[t].nb_requests);
+  }
+  std::cout << "  requests per thread: min " << min << ", max " << max << std::endl;
+}
+
+
+// requests: the targets of a generated corpus, and postures within the joint limits
+static void _requests(bool reachable_only, load_configuration &config){
+
+  using namespace playful_kinematics;
+
+  ik_corpus corpus;
+  configure_pepper_ik_corpus(corpus);
+  generate_ik_corpus(NB_TARGETS,1,corpus);
+
+  const ik_corpus_side *sides = corpus.sides;
+  posture_sampler samplers[2] = {
+    posture_sampler(UNIFORM_SAMPLING,std::vector<double>(sides[0].min.begin(),sides[0].min.end()),
+		    std::vector<double>(sides[0].max.begin(),sides[0].max.end()),1),
+    posture_sampler(UNIFORM_SAMPLING,std::vector<double>(sides[1].min.begin(),sides[1].min.end()),
+		    std::vector<double>(sides[1].max.begin(),sides[1].max.end()),1)
+  };
+
+  for(int e=0;e<corpus.entries.size();e++){
+
+    const ik_corpus_entry &entry = corpus.entries[e];
+    if(reachable_only && entry.kind!=REACHABLE_TARGET) continue;
+
+    int side = entry.left ? 1 : 0;
+    boost::shared_ptr<const ik_plan> &plan = config.plans[std::make_pair(entry.left,entry.mask)];
+    if(!plan){
+      std::map<int,float> min,max;
+      for(int i=0;i<pepper::NB_DOFS;i++){
+	min[i] = sides[side].min[i];
+	max[i] = sides[side].max[i];
+      }
+      plan = make_ik_plan(entry.left,entry.mask,corpus.sides[side].reference_posture,
+			  corpus.minimization_priority,min,max);
+    }
+
+    request rq;
+    rq.left = entry.left;
+    rq.plan = plan.get();
+    for(int i=0;i<6;i++) rq.target[i] = entry.target[i];
+    samplers[side].sample(e,rq.posture);
+    config.requests.push_back(rq);
+
+  }
+
+}
+
+
+int main( int argc, char** argv ){
+
+  load_configuration config;
+  config.open_loop = argc>1 && std::string(argv[1])=="open";
+  config.op = IK_OPERATION;
+  if(argc>2 && std::string(argv[2])=="fk") config.op = FK_OPERATION;
+  if(argc>2 && std::string(argv[2])=="mix") config.op = MIX_OPERATION;
+  bool reachable_only = !(argc>3 && std::string(argv[3])=="corpus");
+  int nb_threads = argc>4 ? atoi(argv[4]) : 0;
+  config.duration = argc>5 ? atof(argv[5]) : 2.0;
+  config.rate = argc>6 ? atof(argv[6]) : 1000.0;
+  config.pin = argc>7 && std::string(argv[7])=="pin";
+
+  if(config.open_loop && config.rate<=0){
+    std::cerr << "open loop rate should be positive" << std::endl;
+    return 1;
+  }
+
+  _requests(reachable_only,config);
+
+  int nb_cores = std::thread::hardware_concurrency();
+  if(nb_cores<=0) nb_cores = 1;
+
+  std::cout << (config.open_loop ? "open loop " : "closed loop ")
+	    << (config.op==IK_OPERATION ? "ik" : config.op==FK_OPERATION ? "fk" : "ik and fk")
+	    << ", " << config.requests.size() << (reachable_only ? " reachable" : " corpus") << " targets, "
+	    << config.duration << " s per run";
+  if(config.open_loop) std::cout << ", " << config.rate << " requests/s";
+  if(config.pin) std::cout << ", threads pinned";
+  std::cout << ", " << nb_cores << " cores" << std::endl;
+
+  if(nb_threads>0){
+    _print(_run(config,nb_threads));
+    return 0;
+  }
+
+  // sweep: 1, 2, 4 ... threads, and the number of cores
+  std::vector<int> sweep;
+  for(int n=1;n<nb_cores;n*=2) sweep.push_back(n);
+  sweep.push_back(nb_cores);
+
+  double single_thread = 0;
+  for(int s=0;s<sweep.size();s++){
+    run_result result = _run(config,sweep[s]);
+    _print(result);
+    if(s==0) single_thread = result.get_throughput();
+    // in open loop, the throughput is the rate (unless saturated)
+    if(!config.open_loop){
+      std::cout << "  parallel efficiency: " << std::setprecision(1)
+		<< 100.0*result.get_throughput()/(single_thread*sweep[s]) << " %" << std::endl;
+    }
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,322 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+#include "playful_kinematics/ik_path.h"
+
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  // path being solved, shared by the workers
+  class path_job {
+  public:
+    // solves of the first waypoint of the segments
+    const ik_plan *plan;
+    // solves started from the posture of the previous waypoint
+    const ik_plan *warm_plan;
+    const float *waypoints;
+    int nb_joints;
+    float max_joint_step;
+    // first waypoint of each segment, then the number of waypoints
+    std::vector<long> segments;
+    float *postures;
+    float *scores;
+    std::vector<char> success;
+    // per boundary, number of waypoints solved again by the repair
+    std::vector<long> nb_blended;
+    // per boundary, difference not blended out by the repair (empty if none)
+    std::vector< std::vector<float> > leftovers;
+    std::atomic<int> next;
+  };
+
+
+  static float _largest_step(const float *a, const float *b, int nb_joints){
+    float largest = 0;
+    for(int i=0;i<nb_joints;i++) largest = std::max(largest,std::fabs(a[i]-b[i]));
+    return largest;
+  }
+
+
+  // runs task(job,index,workspace) for the indexes [0,nb), taken in order by nb_threads
+  // threads (the calling thread being one of them), each with its own score workspace
+  template<class Task>
+  static void _run(path_job &job, int nb_threads, int nb, Task task){
+
+    job.next = 0;
+
+    auto worker = [&job,nb,task](){
+      cartesian_score workspace(job.plan->left,job.plan->mask,0,0,0,0,0,0);
+      int index;
+      while((index=job.next++)<nb) task(job,index,workspace);
+    };
+
+    std::vector<std::thread> threads;
+    for(int i=1;i<std::min(nb_threads,nb);i++) threads.push_back(std::thread(worker));
+    worker();
+    for(int i=0;i<threads.size();i++) threads[i].join();
+
+  }
+
+
+  static void _solve_segment(path_job &job, int segment, cartesian_score &workspace){
+
+    long begin = job.segments[segment];
+    long end = job.segments[segment+1];
+    int nb_joints = job.nb_joints;
+
+    const float *t = job.waypoints+6*begin;
+    job.success[begin] = ik(*job.plan,t[0],t[1],t[2],t[3],t[4],t[5],
+			    workspace,job.postures+begin*nb_joints,job.scores[begin]);
+
+    for(long w=begin+1;w<end;w++){
+      t = job.waypoints+6*w;
+      float *posture = job.postures+w*nb_joints;
+      job.success[w] = ik_from(*job.warm_plan,t[0],t[1],t[2],t[3],t[4],t[5],
+			       workspace,posture-nb_joints,posture,job.scores[w]);
+    }
+
+  }
+
+
+  // the difference of the posture of the waypoint before w with the posture found by its segment
+  // is blended out over the waypoints [w,end): each one is solved from its posture in the segment
+  // plus the difference left at the previous waypoint, reduced by a quarter of max_joint_step (room
+  // left for the steps of the path and for the moves of the solve), until the difference is below
+  // this quarter. Returns the first waypoint not solved again, difference being what is left
+  static long _blend(path_job &job, long w, long end, std::vector<float> &difference,
+		     cartesian_score &workspace){
+
+    int nb_joints = job.nb_joints;
+    float reduction = 0.25*job.max_joint_step;
+    std::vector<float> start(nb_joints);
+    std::vector<float> solved(nb_joints);
+
+    for(;w<end;w++){
+      float largest = 0;
+      for(int i=0;i<nb_joints;i++) largest = std::max(largest,std::fabs(difference[i]));
+      if(largest<=reduction){
+	difference.clear();
+	break;
+      }
+      float *posture = job.postures+w*nb_joints;
+      float factor = 1.0-reduction/largest;
+      for(int i=0;i<nb_joints;i++) start[i] = posture[i]+factor*difference[i];
+      const float *t = job.waypoints+6*w;
+      float score;
+      job.success[w] = ik_from(*job.warm_plan,t[0],t[1],t[2],t[3],t[4],t[5],
+			       workspace,start.data(),solved.data(),score);
+      job.scores[w] = score;
+      for(int i=0;i<nb_joints;i++){
+	difference[i] = solved[i]-posture[i];
+	posture[i] = solved[i];
+      }
+    }
+
+    return w;
+
+  }
+
+
+  // boundary between segment-1 and segment. Only the waypoints of the segment before its last
+  // one are modified, so that boundaries are repaired independently. If the difference could
+  // not be blended out within these waypoints, what is left is kept in job.leftovers[segment]
+  static void _repair_boundary(path_job &job, int segment, cartesian_score &workspace){
+
+    long begin = job.segments[segment];
+    long end = job.segments[segment+1];
+    int nb_joints = job.nb_joints;
+
+    const float *previous = job.postures+(begin-1)*nb_joints;
+    float *first = job.postures+begin*nb_joints;
+    if(_largest_step(previous,first,nb_joints)<=job.max_joint_step) return;
+
+    // first posture of the segment, from the last posture of the previous segment
+    const float *t = job.waypoints+6*begin;
+    std::vector<float> repaired(nb_joints);
+    float score;
+    bool success = ik_from(*job.warm_plan,t[0],t[1],t[2],t[3],t[4],t[5],
+			   workspace,previous,repaired.data(),score);
+
+    // difference with the posture found by the segment
+    std::vector<float> difference(nb_joints);
+    for(int i=0;i<nb_joints;i++) difference[i] = repaired[i]-first[i];
+
+    for(int i=0;i<nb_joints;i++) first[i] = repaired[i];
+    job.scores[begin] = score;
+    job.success[begin] = success;
+
+    long w = _blend(job,begin+1,end-1,difference,workspace);
+    job.nb_blended[segment] = w-begin;
+    job.leftovers[segment] = difference;
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  long count_discontinuities(const std::vector<float> &postures, int nb_joints, float max_joint_step){
+    long nb = 0;
+    for(long w=1;(w+1)*nb_joints<=postures.size();w++){
+      if(_largest_step(&postures[(w-1)*nb_joints],&postures[w*nb_joints],nb_joints)>max_joint_step) nb++;
+    }
+    return nb;
+  }
+
+
+  bool solve_ik_path(const ik_plan &plan,
+		     const std::vector<float> &waypoints,
+		     std::vector<float> &get_postures,
+		     std::vector<float> &get_scores,
+		     std::vector<bool> &get_success,
+		     const ik_path_parameters &parameters,
+		     ik_path_statistics *get_statistics){
+
+    PLAYFUL_KINEMATICS_TRACE("solve_ik_path");
+
+    long nb_waypoints = waypoints.size()/6;
+    int nb_joints = plan.reference_posture.size();
+
+    get_postures.assign(nb_waypoints*nb_joints,0);
+    get_scores.assign(nb_waypoints,std::numeric_limits<float>::max());
+    get_success.assign(nb_waypoints,false);
+    if(nb_waypoints==0) return true;
+
+    int nb_threads = parameters.nb_threads;
+    if(nb_threads<=0) nb_threads = std::thread::hardware_concurrency();
+    if(nb_threads<=0) nb_threads = 1;
+
+    // segments of at least 2 waypoints, so that the repair of a boundary does not
+    // modify the last posture of the segment (the previous posture of the next boundary)
+    long nb_segments = parameters.nb_segments>0 ? parameters.nb_segments : 4*nb_threads;
+    nb_segments = std::min(nb_segments,nb_waypoints/std::max(2,parameters.min_segment_length));
+    nb_segments = std::max(1L,nb_segments);
+
+    ik_plan warm_plan(plan);
+    warm_plan.profile.max_step = std::min(plan.profile.max_step,parameters.warm_start_max_step);
+
+    path_job job;
+    job.plan = &plan;
+    job.warm_plan = &warm_plan;
+    job.waypoints = waypoints.data();
+    job.nb_joints = nb_joints;
+    job.max_joint_step = parameters.max_joint_step;
+    for(long s=0;s<=nb_segments;s++) job.segments.push_back((nb_waypoints*s)/nb_segments);
+    job.postures = get_postures.data();
+    job.scores = get_scores.data();
+    job.success.assign(nb_waypoints,false);
+    job.nb_blended.assign(nb_segments,0);
+    job.leftovers.assign(nb_segments,std::vector<float>());
+
+    _run(job,nb_threads,nb_segments,_solve_segment);
+
+    // boundaries: start of the segments 1 to nb_segments-1
+    _run(job,nb_threads,nb_segments-1,
+	 [](path_job &job, int index, cartesian_score &workspace){
+	   _repair_boundary(job,index+1,workspace);
+	 });
+
+    // differences left by the repair (segments too short for them, e.g. a large difference
+    // at a boundary of a short path) are blended out serially over the following waypoints,
+    // whichever segment they belong to
+    cartesian_score workspace(plan.left,plan.mask,0,0,0,0,0,0);
+    for(long s=1;s<nb_segments;s++){
+      std::vector<float> &difference = job.leftovers[s];
+      if(difference.empty()) continue;
+      long end = job.segments[s+1]-1;
+      job.nb_blended[s] += _blend(job,end,nb_waypoints,difference,workspace)-end;
+    }
+
+    get_success.assign(job.success.begin(),job.success.end());
+
+    ik_path_statistics statistics;
+    statistics.nb_threads = nb_threads;
+    statistics.nb_segments = nb_segments;
+    for(long s=0;s<nb_segments;s++){
+      if(job.nb_blended[s]>0) statistics.nb_repaired_boundaries++;
+      statistics.nb_blended_waypoints += job.nb_blended[s];
+    }
+    for(long w=0;w<nb_waypoints;w++){
+      if(!job.success[w]) statistics.nb_failures++;
+    }
+    statistics.nb_discontinuities = count_discontinuities(get_postures,nb_joints,parameters.max_joint_step);
+    if(get_statistics) *get_statistics = statistics;
+
+    return statistics.nb_failures==0 && statistics.nb_discontinuities==0;
+
+  }
+
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+  // solves the path of nb_waypoints waypoints (6 floats each) from the reference posture of the
+  // nb_dofs joints of the end effector, using the current configuration (see kinematic_config.h)
+  // and the mask (6 bools), see solve_ik_path. postures (nb_waypoints*nb_dofs floats), scores and
+  // success (nb_waypoints each) are written in path order. nb_threads: 0 for the number of cores.
+  // Returns true if all waypoints were reached with a continuous trajectory
+  bool ik_path(bool left, bool *mask, int nb_dofs, float *reference_posture,
+	       int nb_waypoints, float *waypoints,
+	       float *postures, float *scores, bool *success,
+	       int nb_threads){
+
+    if(nb_dofs!=playful_kinematics::get_nb_joints(left)){
+      std::cerr << "playful kinematics: ik_path: " << nb_dofs << " joints, the end effector has "
+		<< playful_kinematics::get_nb_joints(left) << std::endl;
+      for(int i=0;i<nb_waypoints;i++){
+	scores[i]=std::numeric_limits<float>::max();
+	success[i]=false;
+      }
+      return false;
+    }
+
+    boost::shared_ptr<const playful_kinematics::ik_plan> plan =
+      playful_kinematics::make_ik_plan(left,std::vector<bool>(mask,mask+6),
+				       std::vector<float>(reference_posture,reference_posture+nb_dofs));
+
+    std::vector<float> w(waypoints,waypoints+6*nb_waypoints);
+    std::vector<float> p,s;
+    std::vector<bool> b;
+
+    playful_kinematics::ik_path_parameters parameters;
+    parameters.nb_threads = nb_threads;
+    bool continuous = playful_kinematics::solve_ik_path(*plan,w,p,s,b,parameters);
+
+    for(int i=0;i<p.size();i++) postures[i]=p[i];
+    for(int i=0;i<nb_waypoints;i++){
+      scores[i]=s[i];
+      success[i]=b[i];
+    }
+
+    return continuous;
+
+  }
+
+}
@@ -0,0 +1,122 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Solves a cartesian path of the left hand (position only), the forward kinematics of a
+// smooth joint trajectory, with solve_ik_path (ik_path.h): serially (one segment, each
+// waypoint solved from the posture of the previous one), then with 2, 4, ... threads up to
+// the max number of threads. Prints the wall time, the speed up over the serial solve and
+// the statistics of the stitching of the segments.
+//
+// usage: pepper_ik_path_benchmark [number of waypoints] [max threads], defaults: 10000 number of cores
+
+
+#include "playful_kinematics/ik_path.h"
+#include "playful_kinematics/pepper_configuration.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <thread>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static double _run(const playful_kinematics::ik_plan &plan, const std::vector<float> &waypoints,
+		   const playful_kinematics::ik_path_parameters &parameters,
+		   playful_kinematics::ik_path_statistics &statistics){
+
+  std::vector<float> postures,scores;
+  std::vector<bool> success;
+
+  clock_type::time_point begin = clock_type::now();
+  playful_kinematics::solve_ik_path(plan,waypoints,postures,scores,success,parameters,&statistics);
+  return std::chrono::duration<double>(clock_type::now()-begin).count();
+
+}
+
+
+static void _print(const char *label, int nb_threads, double time, double serial_time,
+		   const playful_kinematics::ik_path_statistics &statistics){
+  std::cout << std::setw(8) << label << std::setw(4) << nb_threads << " threads: "
+	    << std::setw(10) << time << " s, speed up " << std::setw(6) << serial_time/time
+	    << ", " << statistics.nb_segments << " segments, "
+	    << statistics.nb_repaired_boundaries << " repaired boundaries, "
+	    << statistics.nb_blended_waypoints << " blended waypoints, "
+	    << statistics.nb_failures << " failures, "
+	    << statistics.nb_discontinuities << " discontinuities" << std::endl;
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_waypoints = 10000;
+  if(argc>1) nb_waypoints = atoi(argv[1]);
+  int max_threads = std::thread::hardware_concurrency();
+  if(argc>2) max_threads = atoi(argv[2]);
+  if(max_threads<=0) max_threads = 1;
+
+  std::vector<bool> mask(6,false);
+  for(int i=0;i<3;i++) mask[i]=true;
+
+  set_kinematics_side(true);
+  set_kinematics_mask(mask);
+  set_kinematics_joints(std::vector<float>(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS));
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    set_minimization_priority(i,pepper::MINIMIZATION_PRIORITY[i]);
+    set_kinematics_joint_limit(i,pepper::LEFT_MIN[i],pepper::LEFT_MAX[i]);
+  }
+  ik_plan plan(*get_ik_plan());
+
+  // each joint oscillates around the middle of its range, with its own period
+  std::vector<float> waypoints;
+  for(int w=0;w<nb_waypoints;w++){
+    double q[pepper::NB_DOFS];
+    double t = (double)w/nb_waypoints;
+    for(int i=0;i<pepper::NB_DOFS;i++){
+      double middle = 0.5*(pepper::LEFT_MIN[i]+pepper::LEFT_MAX[i]);
+      double amplitude = 0.25*(pepper::LEFT_MAX[i]-pepper::LEFT_MIN[i]);
+      q[i] = middle+amplitude*sin(2*M_PI*(1+i%3)*t+i);
+    }
+    double c[6];
+    forward_kinematics(true,q,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    waypoints.insert(waypoints.end(),c,c+6);
+  }
+
+  std::cout << nb_waypoints << " waypoints, "
+	    << std::thread::hardware_concurrency() << " cores" << std::endl;
+
+  ik_path_parameters parameters;
+  ik_path_statistics statistics;
+
+  parameters.nb_threads = 1;
+  parameters.nb_segments = 1;
+  double serial_time = _run(plan,waypoints,parameters,statistics);
+  _print("serial",1,serial_time,serial_time,statistics);
+
+  parameters.nb_segments = 0;
+  for(int nb_threads=1;nb_threads<=max_threads;nb_threads*=2){
+    parameters.nb_threads = nb_threads;
+    double time = _run(plan,waypoints,parameters,statistics);
+    _print("stitched",nb_threads,time,serial_time,statistics);
+  }
+
+}
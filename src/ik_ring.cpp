@@ -0,0 +1,228 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/ik_ring.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <chrono>
+#include <new>
+
+
+namespace playful_kinematics {
+
+
+  static const uint32_t IK_RING_MAGIC = 0x504b5231; // "PKR1"
+
+
+  static ik_ring_buffer* _map(int fd){
+
+    void *memory = mmap(NULL,sizeof(ik_ring_buffer),PROT_READ|PROT_WRITE,
+			fd<0 ? (MAP_PRIVATE|MAP_ANONYMOUS) : MAP_SHARED,
+			fd,0);
+    if(memory==MAP_FAILED) return NULL;
+    return static_cast<ik_ring_buffer*>(memory);
+
+  }
+
+
+  static void _init(ik_ring_buffer *buffer){
+
+    new (buffer) ik_ring_buffer;
+    buffer->targets.init();
+    buffer->postures.init();
+    std::atomic_thread_fence(std::memory_order_release);
+    buffer->magic = IK_RING_MAGIC;
+
+  }
+
+
+  ik_ring::ik_ring(){
+
+    this->owner = true;
+    this->buffer = _map(-1);
+    if(this->buffer) _init(this->buffer);
+
+  }
+
+
+  ik_ring::ik_ring(const std::string &name, bool create){
+
+    this->name = name;
+    this->owner = create;
+    this->buffer = NULL;
+
+    int flags = create ? (O_CREAT|O_RDWR) : O_RDWR;
+    int fd = shm_open(name.c_str(),flags,0600);
+    if(fd<0){
+      std::cerr << "ik_ring: failed to open shared memory " << name << ": " << strerror(errno) << std::endl;
+      return;
+    }
+
+    if(create && ftruncate(fd,sizeof(ik_ring_buffer))<0){
+      std::cerr << "ik_ring: failed to size shared memory " << name << ": " << strerror(errno) << std::endl;
+      close(fd);
+      return;
+    }
+
+    this->buffer = _map(fd);
+    close(fd);
+
+    if(!this->buffer){
+      std::cerr << "ik_ring: failed to map shared memory " << name << ": " << strerror(errno) << std::endl;
+      return;
+    }
+
+    if(create) {
+      _init(this->buffer);
+    } else if (this->buffer->magic!=IK_RING_MAGIC) {
+      std::cerr << "ik_ring: shared memory " << name << " is not an initialized ik ring" << std::endl;
+      munmap(this->buffer,sizeof(ik_ring_buffer));
+      this->buffer = NULL;
+    }
+
+  }
+
+
+  ik_ring::~ik_ring(){
+
+    if(this->buffer) munmap(this->buffer,sizeof(ik_ring_buffer));
+    if(this->owner && !this->name.empty()) shm_unlink(this->name.c_str());
+
+  }
+
+
+  bool ik_ring::is_valid() const {
+    return this->buffer!=NULL;
+  }
+
+
+  bool ik_ring::post(const ik_ring_target &target){
+    return this->buffer->targets.push(target);
+  }
+
+
+  bool ik_ring::poll(ik_ring_posture &get_posture){
+    return this->buffer->postures.pop(get_posture);
+  }
+
+
+  bool ik_ring::take(ik_ring_target &get_target){
+    return this->buffer->targets.pop(get_target);
+  }
+
+
+  bool ik_ring::give(const ik_ring_posture &posture){
+    return this->buffer->postures.push(posture);
+  }
+
+
+  ik_ring_worker::ik_ring_worker(ik_ring &ring)
+    : running(true),
+      thread(ik_ring_worker::run,std::ref(ring),std::ref(running)) {}
+
+
+  ik_ring_worker::~ik_ring_worker(){
+    this->stop();
+  }
+
+
+  void ik_ring_worker::stop(){
+    this->running = false;
+    if(this->thread.joinable()) this->thread.join();
+  }
+
+
+  void ik_ring_worker::run(ik_ring &ring, std::atomic<bool> &running){
+
+    ik_ring_target target;
+    ik_ring_posture posture;
+    int idle = 0;
+
+    while(running){
+
+      if(!ring.take(target)){
+	// spinning for a while to keep latency low when targets arrive
+	// in bursts, then backing off to avoid burning a core
+	idle++;
+	if(idle<1000) std::this_thread::yield();
+	else std::this_thread::sleep_for(std::chrono::microseconds(50));
+	continue;
+      }
+
+      idle = 0;
+      server_protocol::process(target,posture);
+
+      // only the control thread must never block: the worker
+      // waits for the posture ring to have some room
+      while(running && !ring.give(posture)){
+	std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+
+    }
+
+  }
+
+
+  bool set_ik_ring_target(ik_ring_target &target, uint32_t id, bool left,
+			  const bool mask[6], const float cartesian_target[6],
+			  int nb_joints, const float *reference_posture,
+			  const float *min, const float *max,
+			  const int *minimization_priority,
+			  line_search search){
+
+    // the target is a fixed size slot of the ring
+    if(nb_joints<0 || nb_joints>server_protocol::MAX_JOINTS){
+      std::cerr << "playful kinematics: ik ring target of " << nb_joints << " joints, max "
+		<< server_protocol::MAX_JOINTS << std::endl;
+      return false;
+    }
+
+    memset(&target,0,sizeof(target));
+    target.magic = server_protocol::MAGIC;
+    target.id = id;
+    target.type = server_protocol::IK_REQUEST;
+    target.left = left;
+    target.nb_joints = nb_joints;
+    target.line_search = search;
+
+    for(int i=0;i<6;i++){
+      target.mask[i] = mask[i];
+      target.target[i] = cartesian_target[i];
+    }
+
+    for(int i=0;i<nb_joints;i++){
+      target.posture[i] = reference_posture[i];
+      target.has_limit[i] = (min!=NULL && max!=NULL);
+      target.min[i] = min ? min[i] : 0;
+      target.max[i] = max ? max[i] : 0;
+      target.priority[i] = minimization_priority ? minimization_priority[i] : 1;
+    }
+
+    return true;
+
+  }
+
+
+}
@@ -0,0 +1,155 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Measures the latency of ik_ring::post and ik_ring::poll as seen by a control
+// thread, and checks they do not allocate memory.
+//
+// usage: pepper_ik_ring_latency [number of targets] [shared memory name]
+// if a shared memory name (e.g. /pepper_ik_ring) is given, the worker runs in a
+// forked process attached to the ring via shm_open/mmap, otherwise in a thread.
+
+
+#include "playful_kinematics/ik_ring.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+
+// counting the allocations performed by the control thread
+
+static thread_local bool count_allocations = false;
+static long nb_allocations = 0;
+
+void* operator new(std::size_t size){
+  if(count_allocations) nb_allocations++;
+  void *p = std::malloc(size ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+
+typedef std::chrono::steady_clock clock_type;
+
+static double _elapsed_ns(clock_type::time_point start, clock_type::time_point end){
+  return std::chrono::duration<double,std::nano>(end-start).count();
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_targets = 1000;
+  if(argc>1) nb_targets = atoi(argv[1]);
+
+  bool shared = argc>2;
+  pid_t worker_process = -1;
+
+  ik_ring *ring;
+  ik_ring_worker *worker = NULL;
+
+  if(shared){
+    ring = new ik_ring(argv[2],true);
+    if(!ring->is_valid()) return 1;
+    worker_process = fork();
+    if(worker_process==0){
+      ik_ring worker_ring(argv[2],false);
+      std::atomic<bool> running(true);
+      if(worker_ring.is_valid()) ik_ring_worker::run(worker_ring,running);
+      _exit(0);
+    }
+  } else {
+    ring = new ik_ring();
+    if(!ring->is_valid()) return 1;
+    worker = new ik_ring_worker(*ring);
+  }
+
+  bool mask[6] = {true,true,true,false,false,false};
+  float target[6] = {0.2,0.24,1.0,0,0,0};
+
+  sample_stats post_latency;
+  sample_stats poll_latency;
+  sample_stats round_trip;
+  post_latency.reserve(nb_targets);
+  poll_latency.reserve(nb_targets*1000);
+  round_trip.reserve(nb_targets);
+
+  ik_ring_target ik_target;
+  ik_ring_posture ik_posture;
+  int nb_success = 0;
+
+  count_allocations = true;
+
+  for(int i=0;i<nb_targets;i++){
+
+    target[0] = 0.15+0.1*(i%10)/10.0;
+    set_ik_ring_target(ik_target,i,true,mask,target,
+		       pepper::NB_DOFS,pepper::LEFT_REFERENCE,
+		       pepper::LEFT_MIN,pepper::LEFT_MAX,
+		       pepper::MINIMIZATION_PRIORITY);
+
+    clock_type::time_point start = clock_type::now();
+    bool posted = ring->post(ik_target);
+    clock_type::time_point end = clock_type::now();
+    post_latency.add(_elapsed_ns(start,end));
+    if(!posted) continue;
+
+    // a control loop would do other work between polls
+    while(true){
+      clock_type::time_point poll_start = clock_type::now();
+      bool polled = ring->poll(ik_posture);
+      clock_type::time_point poll_end = clock_type::now();
+      if(poll_latency.size()<nb_targets*1000) poll_latency.add(_elapsed_ns(poll_start,poll_end));
+      if(polled) {
+	round_trip.add(_elapsed_ns(start,poll_end)/1000.0);
+	if(ik_posture.success) nb_success++;
+	break;
+      }
+    }
+
+  }
+
+  count_allocations = false;
+
+  if(worker) delete worker;
+  if(worker_process>0){
+    kill(worker_process,SIGKILL);
+    waitpid(worker_process,NULL,0);
+  }
+  delete ring;
+
+  std::cout << "worker: " << (shared ? "separate process (shared memory)" : "thread") << std::endl;
+  post_latency.print("post","ns");
+  poll_latency.print("poll","ns");
+  round_trip.print("post to posture","us");
+  std::cout << "solved: " << nb_success << "/" << nb_targets << std::endl;
+  std::cout << "allocations by control thread during post/poll: " << nb_allocations << std::endl;
+
+  return nb_allocations==0 ? 0 : 1;
+
+}
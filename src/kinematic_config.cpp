@@ -18,10 +18,17 @@
 
 
 #include "playful_kinematics/kinematic_config.h"
+#include "playful_kinematics/fk.h"
+#include "playful_kinematics/capture.h"
+
+#include <mutex>
 
 namespace playful_kinematics {
 
 
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
   class kinematics_configuration {
 
   public :
@@ -33,112 +40,408 @@ namespace playful_kinematics {
     std::map<int,int> minimization_priority;
     std::map<int,float> min;
     std::map<int,float> max;
+    line_search search;
+    solver_profile profile;
     
     int nb_joints;
 
-    void set_side(bool left); 
-    void set_mask(std::vector<bool> max);
-    void set_min_max(int index,float min,float max);
-    void set_kinematics_joints(std::vector<float> reference_ik_joints);
-    void set_minimization_priority(int index, int priority);
+    // incremented each time a changed configuration is published
+    unsigned long version;
+
+    kinematics_configuration()
+      : left(true), search(FIXED_STEP_LINE_SEARCH), profile(get_default_solver_profile()),
+	nb_joints(0), version(0) {}
+
+    // the setters return false if the configuration did not change
+    bool set_side(bool left); 
+    bool set_mask(std::vector<bool> max);
+    bool set_min_max(int index,float min,float max);
+    bool set_kinematics_joints(std::vector<float> reference_ik_joints);
+    bool set_minimization_priority(int index, int priority);
+    bool set_search(line_search search);
+    bool set_profile(const solver_profile &profile);
+
+    std::vector<int> get_minimization_priority(int size) const;
     
   };
 
   
-  void kinematics_configuration::set_side(bool left){ 
+  bool kinematics_configuration::set_side(bool left){ 
+    if(this->left==left) return false;
     this->left=left;
+    return true;
   }
 
   
-  void kinematics_configuration::set_mask(std::vector<bool> mask){ 
+  bool kinematics_configuration::set_mask(std::vector<bool> mask){ 
+    if(this->mask==mask) return false;
     this->mask=mask;
+    return true;
   }
 
   
-  void kinematics_configuration::set_min_max(int index,float min,float max){
+  bool kinematics_configuration::set_min_max(int index,float min,float max){
+    std::map<int,float>::iterator it_min = this->min.find(index);
+    std::map<int,float>::iterator it_max = this->max.find(index);
+    if( it_min!=this->min.end() && it_min->second==min &&
+	it_max!=this->max.end() && it_max->second==max ) return false;
     this->min[index]=min;
     this->max[index]=max;
+    return true;
   }
 
   
-  void kinematics_configuration::set_kinematics_joints(std::vector<float> reference_ik_joints){
+  bool kinematics_configuration::set_kinematics_joints(std::vector<float> reference_ik_joints){
+    if(this->reference_ik_joints==reference_ik_joints) return false;
     this->nb_joints = reference_ik_joints.size();
     this->reference_ik_joints = reference_ik_joints;
+    return true;
   }
 
 
-  void kinematics_configuration::set_minimization_priority(int index, int priority){
+  bool kinematics_configuration::set_minimization_priority(int index, int priority){
+    std::map<int,int>::iterator it = this->minimization_priority.find(index);
+    if(it!=this->minimization_priority.end() && it->second==priority) return false;
     this->minimization_priority[index] = priority;
+    return true;
+  }
+
+
+  bool kinematics_configuration::set_search(line_search search){
+    if(this->search==search) return false;
+    this->search = search;
+    return true;
+  }
+
+
+  bool kinematics_configuration::set_profile(const solver_profile &profile){
+    if(this->profile==profile) return false;
+    this->profile = profile;
+    return true;
+  }
+
+
+  std::vector<int> kinematics_configuration::get_minimization_priority(int size) const {
+    std::vector<int> r;
+    for(int i=0;i<size;i++){
+      std::map<int,int>::const_iterator it = this->minimization_priority.find(i);
+      if(it==this->minimization_priority.end()) r.push_back(1);
+      else r.push_back(it->second);
+    }
+    return r;
+  }
+
+
+  static void _dense_limits(const std::map<int,float> &limits, int nb_joints, std::vector<float> &get){
+    get.assign(nb_joints,0);
+    for(std::map<int,float>::const_iterator it=limits.begin();it!=limits.end();it++){
+      if(it->first>=0 && it->first<nb_joints) get[it->first]=it->second;
+    }
+  }
+
+
+  void compile_frozen_joints(ik_plan &plan, const std::vector<int> &minimization_priority,
+			     const flat_chain *chain){
+
+    int nb_joints = plan.min.size();
+
+    std::vector<bool> frozen(nb_joints);
+    std::vector<double> q(nb_joints);
+    plan.free_joints.clear();
+    for(int i=0;i<nb_joints;i++){
+      frozen[i] = is_frozen(plan,i);
+      q[i] = plan.min[i];
+      if(!frozen[i]) plan.free_joints.push_back(i);
+    }
+
+    plan.minimization_order.clear();
+    std::vector< std::vector<int> > order = get_minimization_order(minimization_priority);
+    for(int g=0;g<order.size();g++){
+      std::vector<int> group;
+      for(int i=0;i<order[g].size();i++){
+	if(order[g][i]<nb_joints && !frozen[order[g][i]]) group.push_back(order[g][i]);
+      }
+      if(!group.empty()) plan.minimization_order.push_back(group);
+    }
+
+    plan.free_chain.reset();
+    if(chain && chain->get_nb_joints()==nb_joints && plan.free_joints.size()<nb_joints){
+      plan.free_chain.reset(new flat_chain(chain->fold_joints(frozen,q.data())));
+    }
+
   }
 
-  static boost::shared_ptr<kinematics_configuration> playful_kinematics_config;
+
+  static ik_plan* _compile(bool left, const std::vector<bool> &mask,
+			   const std::vector<float> &reference_posture,
+			   const std::vector<int> &minimization_priority,
+			   const std::map<int,float> &min,
+			   const std::map<int,float> &max,
+			   line_search search,
+			   const solver_profile &profile){
+
+    ik_plan *plan = new ik_plan();
+
+    int nb_joints = reference_posture.size();
+
+    plan->version = 0;
+    plan->left = left;
+    plan->mask = mask;
+    plan->reference_posture = reference_posture;
+    plan->search = search;
+    plan->profile = profile;
+
+    std::vector<int> priority(nb_joints,1);
+    for(int i=0;i<nb_joints && i<minimization_priority.size();i++) priority[i]=minimization_priority[i];
+
+    _dense_limits(min,nb_joints,plan->min);
+    _dense_limits(max,nb_joints,plan->max);
+
+    // the model is needed only to fold frozen joints
+    const flat_chain *chain = NULL;
+    for(int i=0;i<nb_joints && !chain;i++){
+      if(is_frozen(*plan,i)) chain = &get_robot_model()->get_flat_chain(left);
+    }
+    compile_frozen_joints(*plan,priority,chain);
+
+    return plan;
+
+  }
+
+
+  // Configurations are published as immutable snapshots (configuration and
+  // compiled plan). Readers pin the current snapshot (atomic load of the
+  // shared pointer), writers copy it, modify the copy and publish it (atomic
+  // store). A snapshot is deleted once the last reader pinning it releases it.
+  // Writers are serialized by writer_mutex, which readers never take.
+
+  class config_snapshot {
+  public:
+    kinematics_configuration config;
+    boost::shared_ptr<const ik_plan> plan;
+    // the configuration compiled for each side (right, left), with postures of the
+    // number of joints of the chain: the calls of make_ik_plan only swap in their
+    // mask and reference posture
+    boost::shared_ptr<const ik_plan> side_plans[2];
+  };
+
+
+  static boost::shared_ptr<const config_snapshot> published_snapshot;
+  static std::recursive_mutex writer_mutex;
+
+  // configuration being modified between begin_kinematics_config_update
+  // and end_kinematics_config_update (writer_mutex locked)
+  static boost::shared_ptr<kinematics_configuration> draft;
+  static bool draft_changed = false;
+  static int update_depth = 0;
+
+
+  static boost::shared_ptr<const config_snapshot> _snapshot(const kinematics_configuration &config,
+							    unsigned long version){
+
+    boost::shared_ptr<config_snapshot> snapshot(new config_snapshot());
+
+    snapshot->config = config;
+    snapshot->config.version = version;
+
+    ik_plan *plan = _compile(config.left,config.mask,config.reference_ik_joints,
+			     config.get_minimization_priority(config.nb_joints),
+			     config.min,config.max,config.search,config.profile);
+    plan->version = version;
+    snapshot->plan.reset(plan);
+
+    for(int side=0;side<2;side++){
+      bool left = (side==1);
+      int nb_joints = get_nb_joints(left);
+      if(left==config.left && nb_joints==plan->reference_posture.size()){
+	snapshot->side_plans[side] = snapshot->plan;
+	continue;
+      }
+      ik_plan *side_plan = _compile(left,config.mask,std::vector<float>(nb_joints,0),
+				    config.get_minimization_priority(nb_joints),
+				    config.min,config.max,config.search,config.profile);
+      side_plan->version = version;
+      snapshot->side_plans[side].reset(side_plan);
+    }
+
+    return snapshot;
+
+  }
+
+
+  static boost::shared_ptr<const config_snapshot> _pin(){
+
+    boost::shared_ptr<const config_snapshot> snapshot = boost::atomic_load(&published_snapshot);
+    if(snapshot) return snapshot;
+
+    // nothing published yet
+    static const boost::shared_ptr<const config_snapshot> default_snapshot = _snapshot(kinematics_configuration(),0);
+    return default_snapshot;
+
+  }
+
+
+  // called with writer_mutex locked
+  static void _publish(const kinematics_configuration &config){
+
+    boost::atomic_store(&published_snapshot,_snapshot(config,_pin()->config.version+1));
+
+  }
+
+
+  // applies the setter to the draft if an update is open, otherwise
+  // publishes a modified copy of the current configuration
+  template<class Setter>
+  static void _write(Setter setter){
+
+    std::lock_guard<std::recursive_mutex> lock(writer_mutex);
+
+    if(draft){
+      if(setter(*draft)) draft_changed = true;
+      return;
+    }
+
+    kinematics_configuration config(_pin()->config);
+    if(setter(config)) _publish(config);
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  void begin_kinematics_config_update(){
+
+    writer_mutex.lock();
+
+    if(update_depth==0){
+      draft.reset(new kinematics_configuration(_pin()->config));
+      draft_changed = false;
+    }
+    update_depth++;
+
+  }
+
+
+  void end_kinematics_config_update(){
+
+    if(update_depth<=0){
+      std::cerr << "playful kinematics: end_kinematics_config_update called without matching "
+		<< "begin_kinematics_config_update" << std::endl;
+      return;
+    }
+
+    update_depth--;
+    if(update_depth==0){
+      if(draft_changed) _publish(*draft);
+      draft.reset();
+    }
+
+    writer_mutex.unlock();
+
+  }
 
   
   void set_kinematics_joints(std::vector<float> reference_ik_joints){
 
-    if(!playful_kinematics_config) {
-      playful_kinematics_config.reset(new kinematics_configuration());
-    }
-    playful_kinematics_config->set_kinematics_joints(reference_ik_joints);
+    _write([&reference_ik_joints](kinematics_configuration &config){
+	return config.set_kinematics_joints(reference_ik_joints);
+      });
 
   }
 
   
   void set_kinematics_side(bool left){
 
-    if(!playful_kinematics_config) {
-      playful_kinematics_config.reset(new kinematics_configuration());
-    }
-    
-    playful_kinematics_config->set_side(left);
+    _write([left](kinematics_configuration &config){
+	return config.set_side(left);
+      });
 
   }
 
 
   void set_kinematics_mask(std::vector<bool> mask){
 
-    if(!playful_kinematics_config) {
-      playful_kinematics_config.reset(new kinematics_configuration());
-    }
-
-    playful_kinematics_config->set_mask(mask);
+    _write([&mask](kinematics_configuration &config){
+	return config.set_mask(mask);
+      });
 
   }
 
 
   void set_kinematics_joint_limit(int index, float min, float max){
 
-    if(!playful_kinematics_config){
-      playful_kinematics_config.reset(new kinematics_configuration());
-    }
-    
-    playful_kinematics_config->set_min_max(index,min,max);
+    _write([index,min,max](kinematics_configuration &config){
+	return config.set_min_max(index,min,max);
+      });
 
   }
 
 
   void set_minimization_priority(int index, int priority){
 
-    if(!playful_kinematics_config){
-      playful_kinematics_config.reset(new kinematics_configuration());
-    }
-    
-    playful_kinematics_config->set_minimization_priority(index,priority);
+    _write([index,priority](kinematics_configuration &config){
+	return config.set_minimization_priority(index,priority);
+      });
     
   }
 
 
+  void set_kinematics_line_search(line_search search){
+
+    _write([search](kinematics_configuration &config){
+	return config.set_search(search);
+      });
+
+  }
+
+
+  void set_kinematics_solver_profile(const solver_profile &profile){
+
+    _write([&profile](kinematics_configuration &config){
+	return config.set_profile(profile);
+      });
+
+  }
+
+
+  bool load_kinematics_solver_profile(const std::string &path){
+
+    solver_profile profile;
+    if(!read_solver_profile(path,profile)) return false;
+    set_kinematics_solver_profile(profile);
+    return true;
+
+  }
+
+
+  line_search get_kinematics_line_search(){
+
+    return _pin()->config.search;
+
+  }
+
+
+  solver_profile get_kinematics_solver_profile(){
+
+    return _pin()->config.profile;
+
+  }
+
+
   bool get_kinematics_side(){
 
-    return playful_kinematics_config->left;
+    return _pin()->config.left;
 
   }
 
   
   void get_kinematics_joints(std::vector<float> &get){
 
-    for(int i=0;i<playful_kinematics_config->nb_joints;i++){
-      get.push_back(playful_kinematics_config->reference_ik_joints[i]);
+    boost::shared_ptr<const config_snapshot> snapshot = _pin();
+
+    for(int i=0;i<snapshot->config.nb_joints;i++){
+      get.push_back(snapshot->config.reference_ik_joints[i]);
     }
 
   }
@@ -146,38 +449,80 @@ namespace playful_kinematics {
 
   std::vector<int> get_minimization_priority(int size){
 
-    std::vector<int> r;
-
-    for(int i=0;i<size;i++){
-      if ( playful_kinematics_config->minimization_priority.find(i) == playful_kinematics_config->minimization_priority.end() ) {
-	r.push_back(1);
-      } else {
-	r.push_back(playful_kinematics_config->minimization_priority[i]);
-      }
-    }
-
-    return r;
+    return _pin()->config.get_minimization_priority(size);
     
   }
 
   
-  std::vector<bool>& get_kinematics_mask(){
-    return playful_kinematics_config->mask;
+  std::vector<bool> get_kinematics_mask(){
+    return _pin()->config.mask;
   }
 
   
-  std::map<int,float>& get_kinematics_joint_min_limit(){
-    return playful_kinematics_config->min;
+  std::map<int,float> get_kinematics_joint_min_limit(){
+    return _pin()->config.min;
   }
 
   
-  std::map<int,float>& get_kinematics_joint_max_limit(){
-    return playful_kinematics_config->max;
+  std::map<int,float> get_kinematics_joint_max_limit(){
+    return _pin()->config.max;
   }
 
   
   int get_kinematics_nb_joints(){
-    return playful_kinematics_config->nb_joints;
+    return _pin()->config.nb_joints;
+  }
+
+
+  unsigned long get_kinematics_config_version(){
+
+    return _pin()->config.version;
+
+  }
+
+
+  boost::shared_ptr<const ik_plan> get_ik_plan(){
+
+    return _pin()->plan;
+
+  }
+
+
+  boost::shared_ptr<const ik_plan> make_ik_plan(bool left, const std::vector<bool> &mask,
+						const std::vector<float> &reference_posture,
+						const std::vector<int> &minimization_priority,
+						const std::map<int,float> &min,
+						const std::map<int,float> &max,
+						line_search search,
+						const solver_profile &profile){
+
+    return boost::shared_ptr<const ik_plan>(_compile(left,mask,reference_posture,
+						     minimization_priority,min,max,search,profile));
+
+  }
+
+
+  boost::shared_ptr<const ik_plan> make_ik_plan(bool left, const std::vector<bool> &mask,
+						const std::vector<float> &reference_posture){
+
+    boost::shared_ptr<const config_snapshot> snapshot = _pin();
+    const kinematics_configuration &config = snapshot->config;
+
+    // as many joints as the chain: limits and minimization order of the compiled plan are kept
+    const ik_plan &compiled = *snapshot->side_plans[left ? 1 : 0];
+    if(compiled.reference_posture.size()==reference_posture.size()){
+      ik_plan *plan = new ik_plan(compiled);
+      plan->mask = mask;
+      plan->reference_posture = reference_posture;
+      return boost::shared_ptr<const ik_plan>(plan);
+    }
+
+    ik_plan *plan = _compile(left,mask,reference_posture,
+			     config.get_minimization_priority(reference_posture.size()),
+			     config.min,config.max,config.search,config.profile);
+    plan->version = config.version;
+    return boost::shared_ptr<const ik_plan>(plan);
+
   }
 
 
@@ -192,41 +537,143 @@ extern "C" {
 
   void set_minimization_priority(int index, int priority){
 
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_MINIMIZATION_PRIORITY);
+    record.add(index);
+    record.add(priority);
+
     playful_kinematics::set_minimization_priority(index,priority);
+
+    record.commit();
     
   }
 
   
   void set_kinematics_side(bool left){
 
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_SIDE);
+    record.add(left);
+
     playful_kinematics::set_kinematics_side(left);
 
+    record.commit();
+
   }
 
   
   void set_kinematics_mask(bool *mask){
 
-    std::vector<bool> bmask;
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_MASK);
+    record.add_fixed(6,mask);
+
+    std::vector<bool> bmask(6);
     for(int i=0;i<6;i++) bmask[i] = mask[i];
     playful_kinematics::set_kinematics_mask(bmask);
 
+    record.commit();
+
   }
 
   
   void set_kinematics_joint_limit(int index, float min, float max){
 
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_JOINT_LIMIT);
+    record.add(index);
+    record.add(min);
+    record.add(max);
+
     playful_kinematics::set_kinematics_joint_limit(index,min,max);
 
+    record.commit();
+
+  }
+
+
+  void begin_kinematics_config_update(){
+
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_BEGIN_CONFIG_UPDATE);
+
+    playful_kinematics::begin_kinematics_config_update();
+
+    record.commit();
+
+  }
+
+
+  void end_kinematics_config_update(){
+
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_END_CONFIG_UPDATE);
+
+    playful_kinematics::end_kinematics_config_update();
+
+    record.commit();
+
+  }
+
+
+  // 0: fixed step line search, 1: adaptive line search
+  void set_kinematics_line_search(int search){
+
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_LINE_SEARCH);
+    record.add(search);
+
+    playful_kinematics::set_kinematics_line_search((playful_kinematics::line_search)search);
+
+    record.commit();
+
+  }
+
+  
+  // engine: 0 SOMA, 1 CMA-ES (the CMA-ES parameters are unchanged)
+  void set_kinematics_solver_profile(int engine, float target_score, float max_step,
+				     float min_step, int max_iteration){
+
+    playful_kinematics::solver_profile profile = playful_kinematics::get_kinematics_solver_profile();
+    profile.engine = (playful_kinematics::solver_engine)engine;
+    profile.target_score = target_score;
+    profile.max_step = max_step;
+    profile.min_step = min_step;
+    profile.max_iteration = max_iteration;
+
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_SOLVER_PROFILE);
+    playful_kinematics::add_solver_profile(record,profile);
+
+    playful_kinematics::set_kinematics_solver_profile(profile);
+
+    record.commit();
+
+  }
+
+
+  // recorded as the profile read from the file
+  bool load_kinematics_solver_profile(const char *path){
+
+    playful_kinematics::solver_profile profile;
+    if(!playful_kinematics::read_solver_profile(path,profile)) return false;
+
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_SOLVER_PROFILE);
+    playful_kinematics::add_solver_profile(record,profile);
+
+    playful_kinematics::set_kinematics_solver_profile(profile);
+
+    record.commit();
+
+    return true;
+
   }
 
   
   void set_kinematics_joints(int nb_joints,
 			     float * reference_ik_joints){
 
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_SET_KINEMATICS_JOINTS);
+    record.add(nb_joints,reference_ik_joints);
+
     std::vector<float> ik;
     for(int i=0;i<nb_joints;i++) ik.push_back(reference_ik_joints[i]);
     playful_kinematics::set_kinematics_joints(ik);
 
+    record.commit();
+
   }
 
 }
@@ -0,0 +1,379 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Client library exposing the same C interface as the kinematics library
+// (fk.cpp, ik.cpp, kinematic_config.cpp), but forwarding forward and inverse
+// kinematics to pepper_kinematics_server (kinematics_server.cpp).
+// The python wrapper can load it in place of the kinematics library.
+
+
+#include "playful_kinematics/server_protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <limits>
+#include <mutex>
+
+
+namespace playful_kinematics {
+
+  namespace sp = server_protocol;
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  class kinematics_client {
+
+  public:
+
+    kinematics_client();
+    ~kinematics_client();
+
+    bool request(sp::request &request, sp::reply &get_reply);
+    int get_nb_joints(bool left);
+
+    // configuration, sent along with each ik request
+    bool left;
+    bool mask[6];
+    std::map<int,float> min;
+    std::map<int,float> max;
+    std::map<int,int> minimization_priority;
+    std::vector<float> reference_ik_joints;
+    int line_search;
+    // held by the setters, and by begin/end_kinematics_config_update for the
+    // whole update. Not held during exchanges with the server
+    std::recursive_mutex config_mutex;
+
+    // held during exchanges with the server
+    std::mutex mutex;
+
+  private:
+
+    bool connect_server();
+    bool exchange(sp::request &request, sp::reply &get_reply);
+
+    int fd;
+    uint32_t id;
+    std::map<bool,int> nb_joints;
+
+  };
+
+
+  kinematics_client::kinematics_client(){
+    this->fd = -1;
+    this->id = 0;
+    this->left = true;
+    this->line_search = 0;
+    for(int i=0;i<6;i++) this->mask[i]=true;
+  }
+
+
+  kinematics_client::~kinematics_client(){
+    if(this->fd>=0) close(this->fd);
+  }
+
+
+  bool kinematics_client::connect_server(){
+
+    this->fd = socket(AF_UNIX,SOCK_SEQPACKET,0);
+    if(this->fd<0) return false;
+
+    std::string path = sp::get_socket_path();
+    struct sockaddr_un address;
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path,path.c_str(),sizeof(address.sun_path)-1);
+
+    if(connect(this->fd,(struct sockaddr*)&address,sizeof(address))<0){
+      std::cerr << "playful kinematics: failed to connect to kinematics server at "
+		<< path << ": " << strerror(errno) << std::endl;
+      close(this->fd);
+      this->fd = -1;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  bool kinematics_client::exchange(sp::request &request, sp::reply &get_reply){
+
+    if(this->fd<0 && !this->connect_server()) return false;
+
+    request.magic = sp::MAGIC;
+    request.id = ++this->id;
+
+    if(send(this->fd,&request,sizeof(request),MSG_NOSIGNAL)!=sizeof(request)){
+      close(this->fd);
+      this->fd = -1;
+      return false;
+    }
+
+    ssize_t size = recv(this->fd,&get_reply,sizeof(get_reply),0);
+    if(size!=sizeof(get_reply) || get_reply.magic!=sp::MAGIC || get_reply.id!=request.id){
+      close(this->fd);
+      this->fd = -1;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  // called with the mutex locked
+  bool kinematics_client::request(sp::request &request, sp::reply &get_reply){
+
+    // server may have been restarted: retrying once on a fresh connection
+    if(this->exchange(request,get_reply)) return true;
+    return this->exchange(request,get_reply);
+
+  }
+
+
+  // called with the mutex locked
+  int kinematics_client::get_nb_joints(bool left){
+
+    std::map<bool,int>::iterator it = this->nb_joints.find(left);
+    if(it!=this->nb_joints.end()) return it->second;
+
+    sp::request request;
+    sp::reply reply;
+    memset(&request,0,sizeof(request));
+    request.type = sp::NB_JOINTS_REQUEST;
+    request.left = left;
+
+    if(!this->request(request,reply)) return 0;
+
+    this->nb_joints[left] = reply.nb_joints;
+    return reply.nb_joints;
+
+  }
+
+
+  static kinematics_client client;
+
+
+  static bool _ik(bool left, float target_x, float target_y, float target_z,
+		  float target_alpha, float target_gamma, float target_beta,
+		  int nb_joints, float *posture, float *get_score){
+
+    if(nb_joints<0 || nb_joints>sp::MAX_JOINTS){
+      std::cerr << "playful kinematics client: " << nb_joints << " joints, at most "
+		<< sp::MAX_JOINTS << " supported by the server" << std::endl;
+      *get_score = std::numeric_limits<float>::max();
+      return false;
+    }
+
+    sp::request request;
+    sp::reply reply;
+    memset(&request,0,sizeof(request));
+
+    std::unique_lock<std::recursive_mutex> config_lock(client.config_mutex);
+
+    request.type = sp::IK_REQUEST;
+    request.left = left;
+    request.nb_joints = nb_joints;
+    request.line_search = client.line_search;
+    for(int i=0;i<6;i++) request.mask[i]=client.mask[i];
+
+    request.target[0]=target_x;
+    request.target[1]=target_y;
+    request.target[2]=target_z;
+    request.target[3]=target_alpha;
+    request.target[4]=target_gamma;
+    request.target[5]=target_beta;
+
+    for(int i=0;i<nb_joints;i++){
+      request.posture[i] = posture[i];
+      request.priority[i] = 1;
+      if(client.minimization_priority.find(i)!=client.minimization_priority.end()){
+	request.priority[i] = client.minimization_priority[i];
+      }
+      if(client.min.find(i)!=client.min.end()){
+	request.has_limit[i] = true;
+	request.min[i] = client.min[i];
+	request.max[i] = client.max[i];
+      }
+    }
+
+    config_lock.unlock();
+
+    std::lock_guard<std::mutex> lock(client.mutex);
+
+    if(!client.request(request,reply)){
+      *get_score = std::numeric_limits<float>::max();
+      return false;
+    }
+
+    for(int i=0;i<nb_joints;i++) posture[i] = reply.posture[i];
+    *get_score = reply.score;
+
+    return reply.success;
+
+  }
+
+  /* END OF BACK END FUNCTIONS */
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+
+  int get_nb_joints(bool left){
+
+    std::lock_guard<std::mutex> lock(playful_kinematics::client.mutex);
+    return playful_kinematics::client.get_nb_joints(left);
+
+  }
+
+
+  bool forward_kinematics(bool left, double *q,
+			  double *x, double *y, double *z,
+			  double *alpha, double *beta, double *gamma){
+
+    namespace sp = playful_kinematics::server_protocol;
+
+    std::lock_guard<std::mutex> lock(playful_kinematics::client.mutex);
+
+    int nb_joints = playful_kinematics::client.get_nb_joints(left);
+    if(nb_joints<=0 || nb_joints>sp::MAX_JOINTS) return false;
+
+    sp::request request;
+    sp::reply reply;
+    memset(&request,0,sizeof(request));
+    request.type = sp::FK_REQUEST;
+    request.left = left;
+    request.nb_joints = nb_joints;
+    for(int i=0;i<nb_joints;i++) request.posture[i]=q[i];
+
+    if(!playful_kinematics::client.request(request,reply)) return false;
+
+    if(reply.success){
+      *x = reply.cartesian[0];
+      *y = reply.cartesian[1];
+      *z = reply.cartesian[2];
+      *alpha = reply.cartesian[3];
+      *beta = reply.cartesian[4];
+      *gamma = reply.cartesian[5];
+    }
+
+    return reply.success;
+
+  }
+
+
+  void begin_kinematics_config_update(){
+
+    playful_kinematics::client.config_mutex.lock();
+
+  }
+
+
+  void end_kinematics_config_update(){
+
+    playful_kinematics::client.config_mutex.unlock();
+
+  }
+
+
+  void set_mask(bool x, bool y, bool z, bool alpha, bool beta, bool gamma){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    bool *mask = playful_kinematics::client.mask;
+    mask[0]=x; mask[1]=y; mask[2]=z;
+    mask[3]=alpha; mask[4]=beta; mask[5]=gamma;
+
+  }
+
+
+  void set_kinematics_mask(bool *mask){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    for(int i=0;i<6;i++) playful_kinematics::client.mask[i]=mask[i];
+
+  }
+
+
+  void set_kinematics_side(bool left){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    playful_kinematics::client.left = left;
+
+  }
+
+
+  void set_minimization_priority(int index, int priority){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    playful_kinematics::client.minimization_priority[index]=priority;
+
+  }
+
+
+  void set_kinematics_joint_limit(int index, float min, float max){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    playful_kinematics::client.min[index]=min;
+    playful_kinematics::client.max[index]=max;
+
+  }
+
+
+  void set_kinematics_line_search(int search){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    playful_kinematics::client.line_search = search;
+
+  }
+
+
+  void set_kinematics_joints(int nb_joints,
+			     float * reference_ik_joints){
+
+    std::lock_guard<std::recursive_mutex> lock(playful_kinematics::client.config_mutex);
+    playful_kinematics::client.reference_ik_joints.assign(reference_ik_joints,
+							  reference_ik_joints+nb_joints);
+
+  }
+
+
+  bool ik_ndofs(bool left, float target_x, float target_y, float target_z,
+		float target_alpha, float target_gamma, float target_beta,
+		int nb_dofs, float *posture, float *get_score){
+
+    return playful_kinematics::_ik(left,target_x,target_y,target_z,
+				   target_alpha,target_gamma,target_beta,
+				   nb_dofs,posture,get_score);
+
+  }
+
+}
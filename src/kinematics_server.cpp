@@ -0,0 +1,284 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Local server running forward and inverse kinematics on behalf of
+// several client processes (see kinematics_client.cpp), so that the urdf is
+// parsed only once and the solves of all clients share a single pool of workers.
+//
+// usage: pepper_kinematics_server [socket path] [number of workers]
+
+
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/server_protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace playful_kinematics {
+
+  namespace sp = server_protocol;
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  class connection {
+
+  public:
+    connection(int fd);
+    ~connection();
+    bool send_reply(const sp::reply &r);
+    int fd;
+
+  private:
+    std::mutex send_mutex;
+
+  };
+
+
+  connection::connection(int fd){
+    this->fd = fd;
+  }
+
+
+  connection::~connection(){
+    close(this->fd);
+  }
+
+
+  bool connection::send_reply(const sp::reply &r){
+    std::lock_guard<std::mutex> lock(this->send_mutex);
+    return send(this->fd,&r,sizeof(r),MSG_NOSIGNAL)==sizeof(r);
+  }
+
+
+  class job {
+  public:
+    boost::shared_ptr<connection> client;
+    sp::request request;
+  };
+
+
+  // requests of all clients are queued here, and consumed one at a
+  // time by the workers, so that a cheap job (e.g. forward kinematics)
+  // never waits behind inverse kinematics jobs taken by the same worker
+  class job_queue {
+
+  public:
+    job_queue();
+    void push(std::vector<job> &jobs);
+    bool pop(job &get_job);
+    void stop();
+
+  private:
+    std::deque<job> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopped;
+
+  };
+
+
+  job_queue::job_queue(){
+    this->stopped = false;
+  }
+
+
+  void job_queue::push(std::vector<job> &jobs){
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      for(int i=0;i<jobs.size();i++) this->jobs.push_back(jobs[i]);
+    }
+    this->condition.notify_all();
+  }
+
+
+  bool job_queue::pop(job &get_job){
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while(this->jobs.empty() && !this->stopped) this->condition.wait(lock);
+    if(this->jobs.empty()) return false;
+    get_job = this->jobs.front();
+    this->jobs.pop_front();
+    return true;
+  }
+
+
+  void job_queue::stop(){
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopped = true;
+    }
+    this->condition.notify_all();
+  }
+
+
+  static void _worker(job_queue *queue){
+
+    job j;
+    sp::reply reply;
+
+    while(queue->pop(j)){
+      sp::process(j.request,reply);
+      j.client->send_reply(reply);
+      // not keeping the connection alive until the next job
+      j.client.reset();
+    }
+
+  }
+
+
+  static volatile sig_atomic_t running = 1;
+
+  static void _stop(int){
+    running = 0;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  int run_kinematics_server(std::string socket_path, int nb_workers){
+
+    int listener = socket(AF_UNIX,SOCK_SEQPACKET,0);
+    if(listener<0){
+      std::cerr << "pepper_kinematics_server: failed to create socket: " << strerror(errno) << std::endl;
+      return 1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path,socket_path.c_str(),sizeof(address.sun_path)-1);
+    unlink(socket_path.c_str());
+
+    if( bind(listener,(struct sockaddr*)&address,sizeof(address))<0 || listen(listener,64)<0 ){
+      std::cerr << "pepper_kinematics_server: failed to listen on " << socket_path << ": " << strerror(errno) << std::endl;
+      close(listener);
+      return 1;
+    }
+
+    signal(SIGINT,_stop);
+    signal(SIGTERM,_stop);
+
+    // parsing the urdf before accepting any client
+    playful_kinematics::get_nb_joints(true);
+
+    job_queue queue;
+    std::vector<std::thread> workers;
+    for(int i=0;i<nb_workers;i++) workers.push_back(std::thread(_worker,&queue));
+
+    std::cout << "pepper_kinematics_server: listening on " << socket_path
+	      << " with " << nb_workers << " workers" << std::endl;
+
+    std::vector< boost::shared_ptr<connection> > clients;
+    std::vector<struct pollfd> fds;
+    std::vector<job> requests;
+
+    while(running){
+
+      fds.clear();
+      struct pollfd pfd;
+      pfd.fd = listener;
+      pfd.events = POLLIN;
+      fds.push_back(pfd);
+      for(int i=0;i<clients.size();i++){
+	pfd.fd = clients[i]->fd;
+	fds.push_back(pfd);
+      }
+
+      if(poll(&fds[0],fds.size(),200)<=0) continue;
+
+      // gathering the requests of all ready clients,
+      // then queuing them at once
+      requests.clear();
+      std::vector< boost::shared_ptr<connection> > alive;
+
+      for(int i=0;i<clients.size();i++){
+
+	short revents = fds[i+1].revents;
+	bool closed = (revents & (POLLHUP|POLLERR|POLLNVAL));
+
+	if(revents & POLLIN){
+	  job j;
+	  while(true){
+	    ssize_t size = recv(clients[i]->fd,&j.request,sizeof(j.request),MSG_DONTWAIT);
+	    if(size==0) { closed = true; break; }
+	    if(size<0){
+	      if(errno!=EAGAIN && errno!=EWOULDBLOCK) closed = true;
+	      break;
+	    }
+	    if(size!=sizeof(j.request) || j.request.magic!=sp::MAGIC){
+	      std::cerr << "pepper_kinematics_server: dropping malformed request" << std::endl;
+	      continue;
+	    }
+	    j.client = clients[i];
+	    requests.push_back(j);
+	  }
+	}
+
+	if(!closed) alive.push_back(clients[i]);
+
+      }
+
+      clients = alive;
+
+      if(!requests.empty()) queue.push(requests);
+
+      if(fds[0].revents & POLLIN){
+	int fd = accept(listener,NULL,NULL);
+	if(fd>=0) clients.push_back(boost::shared_ptr<connection>(new connection(fd)));
+      }
+
+    }
+
+    queue.stop();
+    for(int i=0;i<workers.size();i++) workers[i].join();
+
+    close(listener);
+    unlink(socket_path.c_str());
+
+    return 0;
+
+  }
+
+}
+
+
+int main( int argc, char** argv ){
+
+  std::string socket_path = playful_kinematics::server_protocol::get_socket_path();
+  int nb_workers = std::thread::hardware_concurrency();
+
+  if(argc>1) socket_path = argv[1];
+  if(argc>2) nb_workers = atoi(argv[2]);
+  if(nb_workers<1) nb_workers = 1;
+
+  return playful_kinematics::run_kinematics_server(socket_path,nb_workers);
+
+}
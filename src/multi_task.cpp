@@ -0,0 +1,236 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/multi_task.h"
+#include <cmath>
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static bool _same(const double *a, const double *b, int size){
+    for(int i=0;i<size;i++){
+      if(a[i]!=b[i]) return false;
+    }
+    return true;
+  }
+
+
+  // same transform of the joint itself
+  static bool _same_motion(const flat_joint &a, const flat_joint &b){
+    return a.type==b.type && _same(a.axis,b.axis,3) && _same(a.origin,b.origin,3);
+  }
+
+
+  // same fixed transform to the next joint
+  static bool _same_fixed(const flat_joint &a, const flat_joint &b){
+    return _same(a.rotation,b.rotation,9) && _same(a.position,b.position,3);
+  }
+
+
+  // number of first joints of b moving the frame of their segment as the ones of a.
+  // The fixed transform after the last of these joints may differ (the chains branch there)
+  static int _nb_common_joints(const flat_chain &a, const flat_chain &b){
+    if(!_same(a.base_rotation,b.base_rotation,9) || !_same(a.base_position,b.base_position,3)) return 0;
+    int nb = std::min(a.get_nb_joints(),b.get_nb_joints());
+    int common = 0;
+    while(common<nb && _same_motion(a.joints[common],b.joints[common])){
+      common++;
+      if(!_same_fixed(a.joints[common-1],b.joints[common-1])) break;
+    }
+    return common;
+  }
+
+
+  // forward kinematics, chains without joints included
+  static void _forward_kinematics(const flat_chain &chain, const double *q,
+				  double *get_position, double *get_rotation){
+    if(chain.get_nb_joints()==0){
+      for(int i=0;i<9;i++) get_rotation[i] = chain.base_rotation[i];
+      for(int i=0;i<3;i++) get_position[i] = chain.base_position[i];
+      return;
+    }
+    forward_kinematics(chain,q,get_position,get_rotation);
+  }
+
+
+  // frame (r1,p1) composed with (r2,p2), rotations row major
+  static void _compose(const double *r1, const double *p1,
+		       const double *r2, const double *p2,
+		       double *get_position, double *get_rotation){
+    for(int i=0;i<3;i++){
+      get_position[i] = p1[i];
+      for(int j=0;j<3;j++){
+	get_position[i] += r1[i*3+j]*p2[j];
+	get_rotation[i*3+j] = 0;
+	for(int k=0;k<3;k++) get_rotation[i*3+j] += r1[i*3+k]*r2[k*3+j];
+      }
+    }
+  }
+
+
+  static void _set_target(bool *mask, float *target, const std::vector<bool> &m,
+			  float x, float y, float z,
+			  float alpha, float beta, float gamma){
+    for(int i=0;i<6;i++) mask[i] = i<m.size() && m[i];
+    target[0]=x; target[1]=y; target[2]=z;
+    target[3]=alpha; target[4]=beta; target[5]=gamma;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  multi_task_score::multi_task_score()
+    : nb_joints(0) {}
+
+
+  int multi_task_score::add_task(const flat_chain &chain, const std::vector<bool> &mask,
+				 float x, float y, float z,
+				 float alpha, float beta, float gamma,
+				 float weight){
+    task t;
+    t.chain = chain;
+    _set_target(t.mask,t.target,mask,x,y,z,alpha,beta,gamma);
+    t.weight = weight;
+    this->tasks.push_back(t);
+    this->_update_layout();
+    return this->tasks.size()-1;
+  }
+
+
+  void multi_task_score::set_target(int task, const std::vector<bool> &mask,
+				    float x, float y, float z,
+				    float alpha, float beta, float gamma){
+    _set_target(this->tasks[task].mask,this->tasks[task].target,mask,x,y,z,alpha,beta,gamma);
+  }
+
+
+  void multi_task_score::set_weight(int task, float weight){
+    this->tasks[task].weight = weight;
+  }
+
+
+  int multi_task_score::get_nb_tasks() const {
+    return this->tasks.size();
+  }
+
+
+  int multi_task_score::get_nb_joints() const {
+    return this->nb_joints;
+  }
+
+
+  int multi_task_score::get_nb_shared_joints() const {
+    return this->prefix.get_nb_joints();
+  }
+
+
+  const std::vector<int>& multi_task_score::get_task_joints(int task) const {
+    return this->tasks[task].joints;
+  }
+
+
+  void multi_task_score::_update_layout(){
+
+    const flat_chain &first = this->tasks[0].chain;
+    int nb_shared = first.get_nb_joints();
+    for(int t=1;t<this->tasks.size();t++){
+      nb_shared = std::min(nb_shared,_nb_common_joints(first,this->tasks[t].chain));
+    }
+
+    // shared joints, without the fixed transform after the last one. Without shared joints,
+    // the prefix is the identity: the base of each chain is then in its suffix
+    this->prefix = flat_chain();
+    if(nb_shared>0) this->prefix.add_fixed(first.base_rotation,first.base_position);
+    for(int j=0;j<nb_shared;j++){
+      const flat_joint &joint = first.joints[j];
+      this->prefix.add_joint(joint.type,joint.axis,joint.origin);
+      if(j<nb_shared-1) this->prefix.add_fixed(joint.rotation,joint.position);
+    }
+
+    this->nb_joints = nb_shared;
+    for(int t=0;t<this->tasks.size();t++){
+
+      task &current = this->tasks[t];
+      const flat_chain &chain = current.chain;
+
+      current.suffix = flat_chain();
+      if(nb_shared>0){
+	const flat_joint &last = chain.joints[nb_shared-1];
+	current.suffix.add_fixed(last.rotation,last.position);
+      } else {
+	current.suffix.add_fixed(chain.base_rotation,chain.base_position);
+      }
+      for(int j=nb_shared;j<chain.get_nb_joints();j++){
+	const flat_joint &joint = chain.joints[j];
+	current.suffix.add_joint(joint.type,joint.axis,joint.origin);
+	current.suffix.add_fixed(joint.rotation,joint.position);
+      }
+
+      current.offset = this->nb_joints;
+      current.joints.clear();
+      for(int j=0;j<nb_shared;j++) current.joints.push_back(j);
+      for(int j=0;j<current.suffix.get_nb_joints();j++) current.joints.push_back(current.offset+j);
+      this->nb_joints += current.suffix.get_nb_joints();
+
+    }
+
+  }
+
+
+  float multi_task_score::evaluate(const double *q, float *get_errors) const {
+
+    double prefix_position[3];
+    double prefix_rotation[9];
+    _forward_kinematics(this->prefix,q,prefix_position,prefix_rotation);
+
+    float score = 0;
+
+    for(int t=0;t<this->tasks.size();t++){
+      const task &current = this->tasks[t];
+      double suffix_position[3], suffix_rotation[9];
+      _forward_kinematics(current.suffix,q+current.offset,suffix_position,suffix_rotation);
+      double position[3], rotation[9];
+      _compose(prefix_rotation,prefix_position,suffix_rotation,suffix_position,position,rotation);
+      float error = get_cartesian_distance(position,rotation,current.target,current.mask);
+      if(get_errors) get_errors[t] = error;
+      score += current.weight*error*error;
+    }
+
+    return sqrt(score);
+
+  }
+
+
+  void multi_task_score::get_pose(int task, const double *q,
+				  double *get_position, double *get_rotation) const {
+
+    const std::vector<int> &joints = this->tasks[task].joints;
+    std::vector<double> chain_q(joints.size());
+    for(int j=0;j<joints.size();j++) chain_q[j] = q[joints[j]];
+    _forward_kinematics(this->tasks[task].chain,chain_q.data(),get_position,get_rotation);
+
+  }
+
+
+}
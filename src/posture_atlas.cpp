@@ -0,0 +1,420 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/posture_atlas.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+#include <limits>
+
+
+#define V_PI 3.14159265358979323846
+#define V_2_PI 2.0*V_PI
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static const int64_t POSTURE_ATLAS_MAGIC = 0x3153414c5441; // "ATLAS1"
+
+
+  struct posture_atlas_header {
+    int64_t magic;
+    int64_t version;
+    int64_t left;
+    int64_t nb_joints;
+    int64_t nb_samples;
+    int64_t nb_indexes;
+  };
+
+
+  // same distances as score_functions.cpp
+  static inline float _rotation_diff(float a1, float a2){
+    return fabs( V_PI - std::fabs(std::fmod(std::fabs(a1 - a2), V_2_PI) - V_PI) );
+  }
+
+
+  static inline float _diff(int dimension, float v1, float v2){
+    if(dimension<3) return fabs(v1-v2);
+    return _rotation_diff(v1,v2);
+  }
+
+
+  static inline float _squared_distance(const float *pose, const float *target, uint8_t mask){
+    float distance = 0;
+    for(int i=0;i<6;i++){
+      if(mask & (1<<i)){
+	float diff = _diff(i,pose[i],target[i]);
+	distance += diff*diff;
+      }
+    }
+    return distance;
+  }
+
+
+  // lower bound of the distance (along dimension) between target and any pose on the
+  // other side of the split value. Angles being in [-pi,pi], the other side of the
+  // split may also be reached by wrapping around pi.
+  static inline float _split_bound(int dimension, float target, float split){
+    float bound = _diff(dimension,target,split);
+    if(dimension>=3) bound = std::min(bound,_rotation_diff(target,V_PI));
+    return bound;
+  }
+
+
+  static uint8_t _mask_bits(const std::vector<bool> &mask){
+    uint8_t bits = 0;
+    for(int i=0;i<6 && i<mask.size();i++) if(mask[i]) bits |= (1<<i);
+    return bits;
+  }
+
+
+  static void _build(posture_atlas_index &index, const std::vector<float> &poses,
+		     uint32_t begin, uint32_t end){
+
+    if(begin>=end) return;
+
+    // splitting along the masked dimension of largest spread
+    int dimension = 0;
+    float largest = -1;
+    for(int d=0;d<6;d++){
+      if(!(index.mask & (1<<d))) continue;
+      float min = std::numeric_limits<float>::max();
+      float max = -std::numeric_limits<float>::max();
+      for(uint32_t i=begin;i<end;i++){
+	float v = poses[6*index.order[i]+d];
+	min = std::min(min,v);
+	max = std::max(max,v);
+      }
+      if(max-min>largest){
+	largest = max-min;
+	dimension = d;
+      }
+    }
+
+    uint32_t middle = begin+(end-begin)/2;
+    std::nth_element(index.order.begin()+begin,
+		     index.order.begin()+middle,
+		     index.order.begin()+end,
+		     [&poses,dimension](uint32_t a, uint32_t b){
+		       return poses[6*a+dimension]<poses[6*b+dimension];
+		     });
+    index.split[middle] = dimension;
+
+    _build(index,poses,begin,middle);
+    _build(index,poses,middle+1,end);
+
+  }
+
+
+  class atlas_neighbour {
+  public:
+    float distance;
+    uint32_t sample;
+    bool operator<(const atlas_neighbour &other) const {
+      return this->distance<other.distance;
+    }
+  };
+
+
+  // neighbours is a max heap of the (at most k) closest samples found so far
+  static void _search(const posture_atlas_index &index, const std::vector<float> &poses,
+		      uint32_t begin, uint32_t end,
+		      const float *target, int k,
+		      std::vector<atlas_neighbour> &neighbours){
+
+    if(begin>=end) return;
+
+    uint32_t middle = begin+(end-begin)/2;
+    uint32_t sample = index.order[middle];
+    const float *pose = &poses[6*sample];
+
+    atlas_neighbour neighbour;
+    neighbour.distance = _squared_distance(pose,target,index.mask);
+    neighbour.sample = sample;
+
+    if(neighbours.size()<k){
+      neighbours.push_back(neighbour);
+      std::push_heap(neighbours.begin(),neighbours.end());
+    } else if(neighbour.distance<neighbours.front().distance){
+      std::pop_heap(neighbours.begin(),neighbours.end());
+      neighbours.back() = neighbour;
+      std::push_heap(neighbours.begin(),neighbours.end());
+    }
+
+    int dimension = index.split[middle];
+    bool lower = target[dimension]<pose[dimension];
+
+    if(lower) _search(index,poses,begin,middle,target,k,neighbours);
+    else _search(index,poses,middle+1,end,target,k,neighbours);
+
+    float bound = 0;
+    if(index.mask & (1<<dimension)) bound = _split_bound(dimension,target[dimension],pose[dimension]);
+
+    if(neighbours.size()<k || bound*bound<neighbours.front().distance){
+      if(lower) _search(index,poses,middle+1,end,target,k,neighbours);
+      else _search(index,poses,begin,middle,target,k,neighbours);
+    }
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  posture_atlas::posture_atlas()
+    : left(true), nb_joints(0) {}
+
+
+  posture_atlas::posture_atlas(bool left, const posture_sampler &sampler, long nb_samples)
+    : left(left), nb_joints(sampler.get_nb_joints()) {
+
+    std::vector<double> q(this->nb_joints);
+    double c[6];
+
+    this->postures.reserve(nb_samples*this->nb_joints);
+    this->poses.reserve(nb_samples*6);
+
+    for(long s=0;s<nb_samples;s++){
+      sampler.sample(s,&q[0]);
+      if(!forward_kinematics(left,&q[0],&c[0],&c[1],&c[2],&c[3],&c[4],&c[5])) continue;
+      for(int j=0;j<this->nb_joints;j++) this->postures.push_back(q[j]);
+      for(int i=0;i<6;i++) this->poses.push_back(c[i]);
+    }
+
+  }
+
+
+  posture_atlas::posture_atlas(bool left, int nb_joints,
+			       const std::vector<float> &postures,
+			       const std::vector<float> &poses)
+    : left(left), nb_joints(nb_joints), postures(postures), poses(poses) {}
+
+
+  bool posture_atlas::get_side() const {
+    return this->left;
+  }
+
+
+  int posture_atlas::get_nb_joints() const {
+    return this->nb_joints;
+  }
+
+
+  long posture_atlas::get_nb_samples() const {
+    return this->poses.size()/6;
+  }
+
+
+  boost::shared_ptr<posture_atlas_index> posture_atlas::_get_index(uint8_t mask){
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::map< uint8_t, boost::shared_ptr<posture_atlas_index> >::iterator it = this->indexes.find(mask);
+    if(it!=this->indexes.end()) return it->second;
+
+    uint32_t nb_samples = this->get_nb_samples();
+
+    boost::shared_ptr<posture_atlas_index> index(new posture_atlas_index());
+    index->mask = mask;
+    index->order.resize(nb_samples);
+    index->split.assign(nb_samples,0);
+    for(uint32_t i=0;i<nb_samples;i++) index->order[i]=i;
+    _build(*index,this->poses,0,nb_samples);
+
+    this->indexes[mask] = index;
+    return index;
+
+  }
+
+
+  void posture_atlas::build_index(const std::vector<bool> &mask){
+    this->_get_index(_mask_bits(mask));
+  }
+
+
+  int posture_atlas::query(const float *target, const std::vector<bool> &mask, int k,
+			   std::vector<float> &get_postures){
+
+    get_postures.clear();
+    if(k<=0 || this->get_nb_samples()==0) return 0;
+
+    boost::shared_ptr<posture_atlas_index> index = this->_get_index(_mask_bits(mask));
+
+    // angles of the samples are in [-pi,pi]
+    float t[6];
+    for(int i=0;i<6;i++) t[i]=target[i];
+    for(int i=3;i<6;i++) t[i] = std::remainder(t[i],(float)V_2_PI);
+
+    std::vector<atlas_neighbour> neighbours;
+    neighbours.reserve(k);
+    _search(*index,this->poses,0,index->order.size(),t,k,neighbours);
+    std::sort_heap(neighbours.begin(),neighbours.end());
+
+    for(int n=0;n<neighbours.size();n++){
+      const float *posture = &this->postures[neighbours[n].sample*this->nb_joints];
+      get_postures.insert(get_postures.end(),posture,posture+this->nb_joints);
+    }
+
+    return neighbours.size();
+
+  }
+
+
+  bool posture_atlas::save(const std::string &path){
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::ofstream file(path.c_str(),std::ios::binary|std::ios::trunc);
+    if(!file){
+      std::cerr << "posture_atlas: failed to open " << path << std::endl;
+      return false;
+    }
+
+    posture_atlas_header header;
+    header.magic = POSTURE_ATLAS_MAGIC;
+    header.version = 1;
+    header.left = this->left;
+    header.nb_joints = this->nb_joints;
+    header.nb_samples = this->poses.size()/6;
+    header.nb_indexes = this->indexes.size();
+
+    file.write((const char*)&header,sizeof(header));
+    file.write((const char*)this->postures.data(),this->postures.size()*sizeof(float));
+    file.write((const char*)this->poses.data(),this->poses.size()*sizeof(float));
+
+    std::map< uint8_t, boost::shared_ptr<posture_atlas_index> >::iterator it;
+    for(it=this->indexes.begin();it!=this->indexes.end();it++){
+      int64_t mask = it->first;
+      file.write((const char*)&mask,sizeof(mask));
+      file.write((const char*)it->second->order.data(),it->second->order.size()*sizeof(uint32_t));
+      file.write((const char*)it->second->split.data(),it->second->split.size());
+    }
+
+    if(!file){
+      std::cerr << "posture_atlas: failed to write " << path << std::endl;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  bool posture_atlas::load(const std::string &path){
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::ifstream file(path.c_str(),std::ios::binary);
+    if(!file){
+      std::cerr << "posture_atlas: failed to open " << path << std::endl;
+      return false;
+    }
+
+    posture_atlas_header header;
+    file.read((char*)&header,sizeof(header));
+    if(!file || header.magic!=POSTURE_ATLAS_MAGIC || header.version!=1){
+      std::cerr << "posture_atlas: " << path << " is not a posture atlas file" << std::endl;
+      return false;
+    }
+
+    std::vector<float> postures(header.nb_samples*header.nb_joints);
+    std::vector<float> poses(header.nb_samples*6);
+    file.read((char*)postures.data(),postures.size()*sizeof(float));
+    file.read((char*)poses.data(),poses.size()*sizeof(float));
+
+    std::map< uint8_t, boost::shared_ptr<posture_atlas_index> > indexes;
+    for(int64_t i=0;i<header.nb_indexes;i++){
+      int64_t mask;
+      file.read((char*)&mask,sizeof(mask));
+      boost::shared_ptr<posture_atlas_index> index(new posture_atlas_index());
+      index->mask = mask;
+      index->order.resize(header.nb_samples);
+      index->split.resize(header.nb_samples);
+      file.read((char*)index->order.data(),index->order.size()*sizeof(uint32_t));
+      file.read((char*)index->split.data(),index->split.size());
+      indexes[index->mask] = index;
+    }
+
+    if(!file){
+      std::cerr << "posture_atlas: " << path << " is truncated" << std::endl;
+      return false;
+    }
+
+    this->left = header.left;
+    this->nb_joints = header.nb_joints;
+    this->postures.swap(postures);
+    this->poses.swap(poses);
+    this->indexes.swap(indexes);
+
+    return true;
+
+  }
+
+
+  // atlas used by ik, per end effector (0: right, 1: left)
+  static std::mutex ik_atlas_mutex;
+  static boost::shared_ptr<posture_atlas> ik_atlas[2];
+  static int ik_atlas_nb_seeds[2] = {0,0};
+
+
+  void set_ik_atlas(bool left, boost::shared_ptr<posture_atlas> atlas, int nb_seeds){
+    std::lock_guard<std::mutex> lock(ik_atlas_mutex);
+    ik_atlas[left] = atlas;
+    ik_atlas_nb_seeds[left] = nb_seeds;
+  }
+
+
+  boost::shared_ptr<posture_atlas> get_ik_atlas(bool left, int &get_nb_seeds){
+    std::lock_guard<std::mutex> lock(ik_atlas_mutex);
+    get_nb_seeds = ik_atlas_nb_seeds[left];
+    return ik_atlas[left];
+  }
+
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+  // ik of the end effector will be seeded with the nb_seeds closest postures
+  // of the atlas file (see pepper_posture_atlas to create such file)
+  bool set_ik_atlas_file(bool left, char *path, int nb_seeds){
+    boost::shared_ptr<playful_kinematics::posture_atlas> atlas(new playful_kinematics::posture_atlas());
+    if(!atlas->load(path)) return false;
+    if(atlas->get_side()!=left){
+      std::cerr << "set_ik_atlas_file: " << path << " is an atlas of the other end effector" << std::endl;
+      return false;
+    }
+    playful_kinematics::set_ik_atlas(left,atlas,nb_seeds);
+    return true;
+  }
+
+  void clear_ik_atlas(bool left){
+    playful_kinematics::set_ik_atlas(left,boost::shared_ptr<playful_kinematics::posture_atlas>(),0);
+  }
+
+}
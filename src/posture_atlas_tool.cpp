@@ -0,0 +1,211 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Creates posture atlas files (see posture_atlas.h), and compares inverse kinematics
+// with and without atlas seeding: number of score evaluations, time and success
+// per solve, for reachable targets (cartesian pose of random postures).
+//
+// usage: pepper_posture_atlas build atlas_file number_of_samples [left|right]
+//        pepper_posture_atlas benchmark atlas_file [number of targets] [number of seeds]
+
+
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static int _build(const std::string &path, long nb_samples, bool left){
+
+  using namespace playful_kinematics;
+
+  const float *min = left ? pepper::LEFT_MIN : pepper::RIGHT_MIN;
+  const float *max = left ? pepper::LEFT_MAX : pepper::RIGHT_MAX;
+
+  posture_sampler sampler(HALTON_SAMPLING,
+			  std::vector<double>(min,min+pepper::NB_DOFS),
+			  std::vector<double>(max,max+pepper::NB_DOFS));
+
+  clock_type::time_point start = clock_type::now();
+
+  posture_atlas atlas(left,sampler,nb_samples);
+
+  // indexes of the masks used the most: position, and position + orientation
+  std::vector<bool> mask(6,true);
+  atlas.build_index(mask);
+  for(int i=3;i<6;i++) mask[i]=false;
+  atlas.build_index(mask);
+
+  double elapsed = std::chrono::duration<double>(clock_type::now()-start).count();
+
+  if(!atlas.save(path)) return 1;
+
+  std::cout << atlas.get_nb_samples() << " samples written to " << path
+	    << " in " << elapsed << " s" << std::endl;
+
+  return 0;
+
+}
+
+
+class solve_stats {
+public:
+  playful_kinematics::sample_stats evaluations;
+  playful_kinematics::sample_stats time;
+  playful_kinematics::sample_stats score;
+  int nb_success;
+};
+
+
+static void _solve_all(bool left, const std::vector<bool> &mask,
+		       const std::vector<float> &targets, solve_stats &stats){
+
+  using namespace playful_kinematics;
+
+  const float *min = left ? pepper::LEFT_MIN : pepper::RIGHT_MIN;
+  const float *max = left ? pepper::LEFT_MAX : pepper::RIGHT_MAX;
+  const float *reference = left ? pepper::LEFT_REFERENCE : pepper::RIGHT_REFERENCE;
+
+  std::vector<float> reference_posture(reference,reference+pepper::NB_DOFS);
+  std::vector<int> priority(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+  std::map<int,float> min_limits,max_limits;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    min_limits[i]=min[i];
+    max_limits[i]=max[i];
+  }
+
+  stats.nb_success = 0;
+
+  std::vector<float> posture;
+  float score;
+
+  for(int t=0;t<targets.size()/6;t++){
+
+    const float *target = &targets[6*t];
+
+    reset_nb_score_evaluations();
+    clock_type::time_point start = clock_type::now();
+    bool success = ik(left,mask,reference_posture,priority,min_limits,max_limits,
+		      target[0],target[1],target[2],target[3],target[4],target[5],
+		      posture,score);
+    clock_type::time_point end = clock_type::now();
+
+    stats.evaluations.add(get_nb_score_evaluations());
+    stats.time.add(std::chrono::duration<double,std::micro>(end-start).count());
+    stats.score.add(score);
+    if(success) stats.nb_success++;
+
+  }
+
+}
+
+
+static int _benchmark(const std::string &path, int nb_targets, int nb_seeds){
+
+  using namespace playful_kinematics;
+
+  boost::shared_ptr<posture_atlas> atlas(new posture_atlas());
+  if(!atlas->load(path)) return 1;
+
+  bool left = atlas->get_side();
+  const float *min = left ? pepper::LEFT_MIN : pepper::RIGHT_MIN;
+  const float *max = left ? pepper::LEFT_MAX : pepper::RIGHT_MAX;
+
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  std::vector<float> targets;
+  for(int t=0;t<nb_targets;t++){
+    double q[pepper::NB_DOFS];
+    for(int i=0;i<pepper::NB_DOFS;i++) q[i] = min[i]+uniform(generator)*(max[i]-min[i]);
+    double c[6];
+    forward_kinematics(left,q,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    for(int i=0;i<6;i++) targets.push_back(c[i]);
+  }
+
+  std::cout << nb_targets << " targets, atlas of " << atlas->get_nb_samples()
+	    << " samples, " << nb_seeds << " seeds" << std::endl;
+
+  for(int full=0;full<2;full++){
+
+    std::vector<bool> mask(6,true);
+    if(!full) for(int i=3;i<6;i++) mask[i]=false;
+
+    std::cout << std::endl << (full ? "position and orientation" : "position only") << std::endl;
+
+    // query time alone
+    sample_stats query_time;
+    std::vector<float> seeds;
+    for(int t=0;t<nb_targets;t++){
+      clock_type::time_point start = clock_type::now();
+      atlas->query(&targets[6*t],mask,nb_seeds,seeds);
+      clock_type::time_point end = clock_type::now();
+      if(t>0) query_time.add(std::chrono::duration<double,std::micro>(end-start).count());
+    }
+
+    solve_stats without_atlas,with_atlas;
+
+    set_ik_atlas(left,boost::shared_ptr<posture_atlas>());
+    _solve_all(left,mask,targets,without_atlas);
+
+    set_ik_atlas(left,atlas,nb_seeds);
+    _solve_all(left,mask,targets,with_atlas);
+
+    query_time.print("atlas query","us");
+    without_atlas.evaluations.print("evaluations (no atlas)","");
+    with_atlas.evaluations.print("evaluations (atlas)","");
+    without_atlas.time.print("solve (no atlas)","us");
+    with_atlas.time.print("solve (atlas)","us");
+    without_atlas.score.print("score (no atlas)","");
+    with_atlas.score.print("score (atlas)","");
+    std::cout << "success: " << without_atlas.nb_success << " (no atlas), "
+	      << with_atlas.nb_success << " (atlas)" << std::endl;
+
+  }
+
+  return 0;
+
+}
+
+
+int main( int argc, char** argv ){
+
+  std::string command = argc>1 ? argv[1] : "";
+
+  if(command=="build" && argc>3){
+    bool left = !(argc>4 && std::string(argv[4])=="right");
+    return _build(argv[2],atol(argv[3]),left);
+  }
+
+  if(command=="benchmark" && argc>2){
+    int nb_targets = argc>3 ? atoi(argv[3]) : 500;
+    int nb_seeds = argc>4 ? atoi(argv[4]) : 4;
+    return _benchmark(argv[2],nb_targets,nb_seeds);
+  }
+
+  std::cerr << "usage: " << argv[0] << " build atlas_file number_of_samples [left|right]" << std::endl
+	    << "       " << argv[0] << " benchmark atlas_file [number of targets] [number of seeds]" << std::endl;
+  return 1;
+
+}
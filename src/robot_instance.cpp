@@ -0,0 +1,388 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/robot_instance.h"
+#include "playful_kinematics/capture.h"
+#include <mutex>
+#include <algorithm>
+
+namespace playful_kinematics {
+
+
+  robot_instance::robot_instance(boost::shared_ptr<const robot_model> model)
+    : model(model),
+      workspace(true,std::vector<bool>(6,true),0,0,0,0,0,0) {
+
+    for(int side=0;side<2;side++){
+      int nb_joints = model->get_nb_joints(side==1);
+      ik_plan &plan = this->plans[side];
+      plan.version = 0;
+      plan.left = (side==1);
+      plan.mask.assign(6,true);
+      plan.reference_posture.assign(nb_joints,0);
+      plan.min.assign(nb_joints,0);
+      plan.max.assign(nb_joints,0);
+      plan.search = FIXED_STEP_LINE_SEARCH;
+      plan.profile = get_default_solver_profile();
+      this->priorities[side].assign(nb_joints,1);
+      compile_frozen_joints(plan,this->priorities[side],&model->get_flat_chain(side==1));
+    }
+
+  }
+
+
+  ik_plan& robot_instance::_plan(bool left){
+    return this->plans[left ? 1 : 0];
+  }
+
+
+  const ik_plan& robot_instance::get_plan(bool left) const {
+    return this->plans[left ? 1 : 0];
+  }
+
+
+  const robot_model& robot_instance::get_model() const {
+    return *this->model;
+  }
+
+
+  const std::vector<int>& robot_instance::get_minimization_priority(bool left) const {
+    return this->priorities[left ? 1 : 0];
+  }
+
+
+  void robot_instance::set_reference_posture(bool left, const std::vector<float> &posture){
+
+    ik_plan &plan = this->_plan(left);
+
+    if(posture.size()!=plan.reference_posture.size()){
+      std::cerr << "playful kinematics: robot_instance: reference posture of " << posture.size()
+		<< " joints, expected " << plan.reference_posture.size() << std::endl;
+      return;
+    }
+
+    plan.reference_posture = posture;
+    plan.version++;
+
+  }
+
+
+  void robot_instance::set_joint_limit(bool left, int index, float min, float max){
+
+    ik_plan &plan = this->_plan(left);
+    if(index<0 || index>=plan.min.size()) return;
+
+    bool was_frozen = is_frozen(plan,index);
+    plan.min[index] = min;
+    plan.max[index] = max;
+    // frozen values are folded into the free chain
+    if(was_frozen || is_frozen(plan,index)){
+      compile_frozen_joints(plan,this->priorities[left ? 1 : 0],&this->model->get_flat_chain(left));
+    }
+    plan.version++;
+
+  }
+
+
+  void robot_instance::set_minimization_priority(bool left, int index, int priority){
+
+    std::vector<int> &priorities = this->priorities[left ? 1 : 0];
+    if(index<0 || index>=priorities.size() || priorities[index]==priority) return;
+
+    priorities[index] = priority;
+    ik_plan &plan = this->_plan(left);
+    compile_frozen_joints(plan,priorities,&this->model->get_flat_chain(left));
+    plan.version++;
+
+  }
+
+
+  void robot_instance::set_mask(bool left, const std::vector<bool> &mask){
+
+    ik_plan &plan = this->_plan(left);
+    plan.mask = mask;
+    plan.version++;
+
+  }
+
+
+  void robot_instance::set_line_search(bool left, line_search search){
+
+    ik_plan &plan = this->_plan(left);
+    plan.search = search;
+    plan.version++;
+
+  }
+
+
+  void robot_instance::set_solver_profile(bool left, const solver_profile &profile){
+
+    ik_plan &plan = this->_plan(left);
+    plan.profile = profile;
+    plan.version++;
+
+  }
+
+
+  bool robot_instance::ik(bool left,
+			  float target_x, float target_y, float target_z,
+			  float target_alpha, float target_beta, float target_gamma,
+			  std::vector<float> &get_posture, float &get_score){
+
+    return playful_kinematics::ik(this->get_plan(left),
+				  target_x,target_y,target_z,
+				  target_alpha,target_beta,target_gamma,
+				  this->workspace,
+				  get_posture,get_score);
+
+  }
+
+
+  bool robot_instance::ik(bool left,
+			  float target_x, float target_y, float target_z,
+			  float target_alpha, float target_beta, float target_gamma,
+			  float *get_posture, float &get_score){
+
+    return playful_kinematics::ik(this->get_plan(left),
+				  target_x,target_y,target_z,
+				  target_alpha,target_beta,target_gamma,
+				  this->workspace,
+				  get_posture,get_score);
+
+  }
+
+
+  template<class T>
+  static size_t _heap(const std::vector<T> &v){
+    return v.capacity()*sizeof(T);
+  }
+
+
+  static size_t _heap(const std::vector<bool> &v){
+    return v.capacity()/8;
+  }
+
+
+  size_t robot_instance::get_footprint() const {
+
+    size_t bytes = sizeof(robot_instance);
+
+    for(int side=0;side<2;side++){
+      const ik_plan &plan = this->plans[side];
+      bytes += _heap(plan.mask);
+      bytes += _heap(plan.reference_posture);
+      bytes += _heap(plan.min);
+      bytes += _heap(plan.max);
+      bytes += _heap(plan.minimization_order);
+      for(int g=0;g<plan.minimization_order.size();g++) bytes += _heap(plan.minimization_order[g]);
+      bytes += _heap(this->priorities[side]);
+      bytes += _heap(plan.free_joints);
+      if(plan.free_chain){
+	bytes += sizeof(flat_chain) + _heap(plan.free_chain->joints) + _heap(plan.free_chain->coefficients);
+      }
+    }
+
+    bytes += this->workspace.get_heap_footprint();
+
+    return bytes;
+
+  }
+
+
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  // configuration of one end effector of the python wrapper, kept across inverse kinematics
+  // calls, so that only changes of limits and priorities are pushed. The solver profile is
+  // the one of the shared configuration (see set_kinematics_solver_profile in kinematic_config.h),
+  // checked at each call. Calls on a handle are serialized (ctypes releases the GIL during calls).
+  class kinematics_handle {
+
+  public:
+
+    kinematics_handle() : capture_session(0) {}
+
+    robot_instance instance;
+    std::mutex mutex;
+    // capture (see capture.h) during which the configuration of the handle was last recorded
+    unsigned long capture_session;
+
+  };
+
+
+  static kinematics_handle& _handle(void *handle){
+    return *static_cast<kinematics_handle*>(handle);
+  }
+
+
+  // records the configuration of the handle the first time it is used during a capture,
+  // so that handles created before the capture started can be replayed. Called with the
+  // mutex of the handle locked
+  static void _capture_handle(kinematics_handle &h){
+
+    if(!is_capturing()) return;
+    unsigned long session = get_capture_session();
+    if(h.capture_session==session) return;
+    h.capture_session = session;
+
+    capture_record record(CAPTURE_HANDLE_SNAPSHOT);
+    record.add((uint64_t)&h);
+    for(int side=0;side<2;side++){
+      const ik_plan &plan = h.instance.get_plan(side==1);
+      const std::vector<int> &priority = h.instance.get_minimization_priority(side==1);
+      record.add((int32_t)plan.search);
+      record.add(plan.min.size(),plan.min.data());
+      record.add(plan.max.size(),plan.max.data());
+      record.add(priority.size(),priority.data());
+    }
+    record.commit();
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+  void* create_kinematics_handle(){
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_CREATE_HANDLE);
+    playful_kinematics::kinematics_handle *h = new playful_kinematics::kinematics_handle();
+    // created with the default configuration: nothing to snapshot
+    h->capture_session = playful_kinematics::get_capture_session();
+    record.add((uint64_t)h);
+    record.commit();
+    return h;
+  }
+
+
+  void delete_kinematics_handle(void *handle){
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_DELETE_HANDLE);
+    record.add((uint64_t)handle);
+    delete static_cast<playful_kinematics::kinematics_handle*>(handle);
+    record.commit();
+  }
+
+
+  void handle_set_joint_limit(void *handle, bool left, int index, float min, float max){
+    playful_kinematics::kinematics_handle &h = playful_kinematics::_handle(handle);
+    std::lock_guard<std::mutex> lock(h.mutex);
+    playful_kinematics::_capture_handle(h);
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_HANDLE_SET_JOINT_LIMIT);
+    record.add((uint64_t)handle);
+    record.add(left);
+    record.add(index);
+    record.add(min);
+    record.add(max);
+    h.instance.set_joint_limit(left,index,min,max);
+    record.commit();
+  }
+
+
+  void handle_set_minimization_priority(void *handle, bool left, int index, int priority){
+    playful_kinematics::kinematics_handle &h = playful_kinematics::_handle(handle);
+    std::lock_guard<std::mutex> lock(h.mutex);
+    playful_kinematics::_capture_handle(h);
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_HANDLE_SET_MINIMIZATION_PRIORITY);
+    record.add((uint64_t)handle);
+    record.add(left);
+    record.add(index);
+    record.add(priority);
+    h.instance.set_minimization_priority(left,index,priority);
+    record.commit();
+  }
+
+
+  void handle_set_line_search(void *handle, bool left, int search){
+    playful_kinematics::kinematics_handle &h = playful_kinematics::_handle(handle);
+    std::lock_guard<std::mutex> lock(h.mutex);
+    playful_kinematics::_capture_handle(h);
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_HANDLE_SET_LINE_SEARCH);
+    record.add((uint64_t)handle);
+    record.add(left);
+    record.add(search);
+    h.instance.set_line_search(left,(playful_kinematics::line_search)search);
+    record.commit();
+  }
+
+
+  // mask: 6 values (x,y,z,alpha,beta,gamma)
+  // posture: reference posture of the nb_dofs joints, replaced by the posture found
+  bool handle_ik(void *handle, bool left,
+		 float target_x, float target_y, float target_z,
+		 float target_alpha, float target_beta, float target_gamma,
+		 bool *mask, int nb_dofs, float *posture, float *get_score){
+
+    playful_kinematics::kinematics_handle &h = playful_kinematics::_handle(handle);
+    std::lock_guard<std::mutex> lock(h.mutex);
+
+    playful_kinematics::_capture_handle(h);
+    playful_kinematics::capture_record record(playful_kinematics::CAPTURE_HANDLE_IK);
+    if(record.is_active()){
+      float target[6] = {target_x,target_y,target_z,target_alpha,target_beta,target_gamma};
+      record.add((uint64_t)handle);
+      record.add(left);
+      record.add_fixed(6,target);
+      record.add_fixed(6,mask);
+      record.add(nb_dofs,posture);
+    }
+
+    const playful_kinematics::ik_plan &plan = h.instance.get_plan(left);
+
+    bool success = false;
+
+    if(nb_dofs!=plan.reference_posture.size()){
+      std::cerr << "playful kinematics: handle_ik: " << nb_dofs << " joints, the end effector has "
+		<< plan.reference_posture.size() << std::endl;
+      *get_score = std::numeric_limits<float>::max();
+    } else {
+      if(!std::equal(mask,mask+6,plan.mask.begin())){
+	h.instance.set_mask(left,std::vector<bool>(mask,mask+6));
+      }
+      if(!std::equal(posture,posture+nb_dofs,plan.reference_posture.begin())){
+	h.instance.set_reference_posture(left,std::vector<float>(posture,posture+nb_dofs));
+      }
+      playful_kinematics::solver_profile profile = playful_kinematics::get_kinematics_solver_profile();
+      if(profile!=plan.profile){
+	h.instance.set_solver_profile(left,profile);
+      }
+      success = h.instance.ik(left,
+			      target_x,target_y,target_z,
+			      target_alpha,target_beta,target_gamma,
+			      posture,*get_score);
+    }
+
+    record.add(success);
+    record.add(*get_score);
+    record.add(nb_dofs,posture);
+    record.commit();
+
+    return success;
+
+  }
+
+}
@@ -0,0 +1,208 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Simulates a fleet of robots sharing one kinematic model (see robot_instance.h):
+// at each tick, the target of the left hand of each robot moves a little along
+// a circle, and the inverse kinematics of all robots are solved over all cores,
+// each robot starting from its previous solution.
+// Reports the memory footprint of the instances and the duration of the ticks.
+//
+// usage: pepper_robot_instances_benchmark [number of robots] [number of ticks] [number of threads]
+
+
+#include "playful_kinematics/robot_instance.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+
+class robot {
+public:
+  robot() {}
+  boost::shared_ptr<playful_kinematics::robot_instance> instance;
+  float center[3];
+  float phase;
+  std::vector<float> posture;
+  float score;
+  bool success;
+};
+
+
+// robots are solved by chunks, threads taking the next chunk until none is left
+static const int CHUNK = 16;
+
+
+class tick_pool {
+
+public:
+
+  tick_pool(std::vector<robot> &robots, int nb_threads)
+    : robots(robots), tick(0), nb_running(0), stop(false) {
+    for(int i=0;i<nb_threads;i++) this->threads.push_back(std::thread(&tick_pool::_work,this));
+  }
+
+  ~tick_pool(){
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stop = true;
+    }
+    this->start.notify_all();
+    for(int i=0;i<this->threads.size();i++) this->threads[i].join();
+  }
+
+  // solves all robots for the time t (blocking)
+  void run(float t){
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->time = t;
+    this->next = 0;
+    this->nb_running = this->threads.size();
+    this->tick++;
+    this->start.notify_all();
+    this->done.wait(lock,[this](){ return this->nb_running==0; });
+  }
+
+private:
+
+  void _solve(robot &r){
+    float angle = r.phase+this->time;
+    r.instance->set_reference_posture(true,r.posture);
+    r.success = r.instance->ik(true,
+			       r.center[0]+0.05*cos(angle),
+			       r.center[1]+0.05*sin(angle),
+			       r.center[2],
+			       0,0,0,
+			       r.posture,r.score);
+  }
+
+  void _work(){
+    long last_tick = 0;
+    while(true){
+      {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->start.wait(lock,[this,last_tick](){ return this->stop || this->tick!=last_tick; });
+	if(this->stop) return;
+	last_tick = this->tick;
+      }
+      long begin;
+      while( (begin=this->next.fetch_add(CHUNK)) < (long)this->robots.size() ){
+	long end = std::min(begin+CHUNK,(long)this->robots.size());
+	for(long i=begin;i<end;i++) this->_solve(this->robots[i]);
+      }
+      {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->nb_running--;
+      }
+      this->done.notify_one();
+    }
+  }
+
+  std::vector<robot> &robots;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  std::atomic<long> next;
+  long tick;
+  int nb_running;
+  float time;
+  bool stop;
+
+};
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_robots = argc>1 ? atoi(argv[1]) : 10000;
+  int nb_ticks = argc>2 ? atoi(argv[2]) : 20;
+  int nb_threads = argc>3 ? atoi(argv[3]) : 0;
+  if(nb_threads<=0) nb_threads = std::thread::hardware_concurrency();
+  if(nb_threads<=0) nb_threads = 1;
+
+  boost::shared_ptr<const robot_model> model = get_robot_model();
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<bool> mask(6,false);
+  for(int i=0;i<3;i++) mask[i]=true;
+
+  clock_type::time_point start = clock_type::now();
+
+  std::vector<robot> robots(nb_robots);
+  for(int r=0;r<nb_robots;r++){
+
+    robot &rb = robots[r];
+    rb.instance.reset(new robot_instance(model));
+    for(int i=0;i<pepper::NB_DOFS;i++){
+      rb.instance->set_joint_limit(true,i,pepper::LEFT_MIN[i],pepper::LEFT_MAX[i]);
+      rb.instance->set_minimization_priority(true,i,pepper::MINIMIZATION_PRIORITY[i]);
+    }
+    rb.instance->set_mask(true,mask);
+
+    // center of the circle: hand position of a random posture
+    double q[pepper::NB_DOFS];
+    for(int i=0;i<pepper::NB_DOFS;i++) q[i] = pepper::LEFT_MIN[i]+uniform(generator)*(pepper::LEFT_MAX[i]-pepper::LEFT_MIN[i]);
+    double c[6];
+    model->forward_kinematics(true,q,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    for(int i=0;i<3;i++) rb.center[i]=c[i];
+    rb.phase = 2*M_PI*uniform(generator);
+    rb.posture = reference;
+
+  }
+
+  double creation = std::chrono::duration<double>(clock_type::now()-start).count();
+
+  tick_pool pool(robots,nb_threads);
+
+  sample_stats tick_time;
+  long nb_success = 0;
+
+  for(int t=0;t<nb_ticks;t++){
+    clock_type::time_point tick_start = clock_type::now();
+    pool.run(0.1*t);
+    tick_time.add(std::chrono::duration<double,std::milli>(clock_type::now()-tick_start).count());
+    if(t==nb_ticks-1) for(int r=0;r<nb_robots;r++) if(robots[r].success) nb_success++;
+  }
+
+  size_t footprint = 0;
+  for(int r=0;r<nb_robots;r++) footprint += robots[r].instance->get_footprint();
+
+  std::cout << nb_robots << " robots, " << nb_ticks << " ticks, " << nb_threads << " threads" << std::endl
+	    << "instances created in " << creation << " s" << std::endl
+	    << "footprint: " << footprint/nb_robots << " bytes per instance, "
+	    << footprint/(1024.0*1024.0) << " MB in total" << std::endl;
+  tick_time.print("tick","ms");
+  std::cout << "solves per second: " << (long)(nb_robots/(tick_time.mean()/1000.0)) << std::endl
+	    << "success (last tick): " << nb_success << "/" << nb_robots << std::endl;
+
+  return 0;
+
+}
@@ -39,7 +39,8 @@ namespace playful_kinematics {
   
   // ! the first 3 indexes are x, y, z and use cartesian diff
   // ! the last 3 indexes are alpha, beta, gamma and use rotation_diff
-  static float _distance(float *cartesian_p1, float *cartesian_p2, std::vector<bool> &mask){
+  template<class Mask>
+  static float _distance(float *cartesian_p1, const float *cartesian_p2, const Mask &mask){
 
     float distance = 0;
     float diff;
@@ -87,7 +88,22 @@ namespace playful_kinematics {
   };
 
 
-  static boost::shared_ptr<target_cartesian_position> tcp;
+  class score_configuration {
+  public:
+    bool left;
+    std::vector<bool> mask;
+    void set(bool left, std::vector<bool> mask){
+      this->left = left;
+      this->mask = mask;
+    }
+  };
+
+
+  // target and configuration are kept per thread, so that
+  // several threads may run minimizations concurrently
+  static thread_local boost::shared_ptr<target_cartesian_position> tcp;
+  static thread_local boost::shared_ptr<score_configuration> scc;
+  static thread_local long nb_evaluations = 0;
 
 
   void set_target_cartesian_position(float x, float y, float z,
@@ -96,19 +112,50 @@ namespace playful_kinematics {
     tcp->set(x,y,z,alpha,beta,gamma);
   }
 
+
+  void set_configuration(bool left, std::vector<bool> mask){
+    if(!scc) scc.reset(new score_configuration());
+    scc->set(left,mask);
+  }
+
+  
+  float get_cartesian_distance(const double *position, const double *rotation,
+			       const float *target, const bool *mask){
+
+    double alpha,beta,gamma;
+    get_rpy(rotation,&alpha,&beta,&gamma);
+
+    float cartesian[6];
+    _get_position_array(cartesian,position[0],position[1],position[2],alpha,beta,gamma);
+
+    return _distance(cartesian,target,mask);
+
+  }
+
+
+  long get_nb_score_evaluations(){
+    return nb_evaluations;
+  }
+
+
+  void reset_nb_score_evaluations(){
+    nb_evaluations = 0;
+  }
+
   
   static void print_posture(std::vector<float> posture){
     for(int i=0;i<posture.size();i++) std::cout << posture[i] << "\t";
   }
 
   
-  float at_desired_cartesian_position(std::vector<float> &posture){
+  template<class Mask>
+  static float _score(bool left, double *q, float *cartesian_target, const Mask &mask){
 
-    double q[NB_JOINTS];
     double x,y,z,alpha,beta,gamma;
 
-    for(int i=0;i<posture.size();i++) q[i]=posture[i];
-    bool success = playful_kinematics::forward_kinematics(playful_kinematics::get_kinematics_side(),q,
+    nb_evaluations++;
+
+    bool success = playful_kinematics::forward_kinematics(left,q,
 							  &x,&y,&z,
 							  &alpha,&beta,&gamma);
     if (!success) {
@@ -116,15 +163,124 @@ namespace playful_kinematics {
     }
 
     float cartesian[6];
-    float cartesian_target[6];
 
     _get_position_array(cartesian,x,y,z,alpha,beta,gamma);
-    _get_position_array(cartesian_target,tcp->x,tcp->y,tcp->z,tcp->alpha,tcp->beta,tcp->gamma);
 
-    float distance = _distance(cartesian,cartesian_target,playful_kinematics::get_kinematics_mask());
+    float distance = _distance(cartesian,cartesian_target,mask);
 
     return distance;
 
   }
 
+
+  float at_desired_cartesian_position(std::vector<float> &posture){
+
+    if(!tcp){
+      std::cerr << "playful kinematics: at_desired_cartesian_position: no target set "
+		<< "by set_target_cartesian_position on this thread" << std::endl;
+      return std::numeric_limits<float>::max();
+    }
+
+    double q[NB_JOINTS];
+    for(int i=0;i<posture.size();i++) q[i]=posture[i];
+
+    float cartesian_target[6];
+    _get_position_array(cartesian_target,tcp->x,tcp->y,tcp->z,tcp->alpha,tcp->beta,tcp->gamma);
+
+    if(scc) return _score(scc->left,q,cartesian_target,scc->mask);
+
+    // set_configuration not called on this thread: side and mask of the configuration
+    return _score(playful_kinematics::get_kinematics_side(),q,cartesian_target,
+		  playful_kinematics::get_kinematics_mask());
+
+  }
+
+
+  cartesian_score::cartesian_score(bool left, const std::vector<bool> &mask,
+				   float x, float y, float z,
+				   float alpha, float beta, float gamma)
+    : left(left), chain(NULL), free_joints(NULL) {
+    this->set_target(left,mask,x,y,z,alpha,beta,gamma);
+  }
+
+
+  void cartesian_score::set_target(bool left, const std::vector<bool> &mask,
+				   float x, float y, float z,
+				   float alpha, float beta, float gamma){
+    if(this->chain==NULL || left!=this->left || this->free_joints){
+      this->chain = &get_robot_model()->get_flat_chain(left);
+    }
+    this->free_joints = NULL;
+    this->left = left;
+    for(int i=0;i<6;i++) this->mask[i] = i<mask.size() && mask[i];
+    _get_position_array(this->target,x,y,z,alpha,beta,gamma);
+  }
+
+
+  void cartesian_score::set_free_chain(const flat_chain *chain, const std::vector<int> &free_joints){
+    this->chain = chain;
+    this->free_joints = &free_joints;
+  }
+
+
+  size_t cartesian_score::get_heap_footprint() const {
+    return (this->q.capacity()+this->batch_q.capacity()
+	    +this->batch_positions.capacity()+this->batch_rotations.capacity())*sizeof(double);
+  }
+
+
+  float cartesian_score::evaluate(){
+    return _score(this->left,this->q.data(),this->target,this->mask);
+  }
+
+
+  float cartesian_score::evaluate(const double *position, const double *rotation){
+    nb_evaluations++;
+    return get_cartesian_distance(position,rotation,this->target,this->mask);
+  }
+
+
+
+  void cartesian_score::evaluate_batch(int nb, const double *q, float *get_scores){
+
+    if(nb<=0) return;
+
+    int nb_joints = this->free_joints ? this->free_joints->size() : this->chain ? this->chain->get_nb_joints() : 0;
+
+    // no flat chain (or not matching the postures): one posture at a time
+    if(this->chain==NULL || (this->free_joints==NULL && nb_joints!=get_nb_joints(this->left))){
+      int nb_values = get_nb_joints(this->left);
+      this->q.resize(nb_values);
+      for(int i=0;i<nb;i++){
+	for(int j=0;j<nb_values;j++) this->q[j] = q[j*nb+i];
+	get_scores[i] = this->evaluate();
+      }
+      return;
+    }
+
+    const double *chain_q = q;
+    if(this->free_joints){
+      this->batch_q.resize(nb_joints*nb);
+      for(int j=0;j<nb_joints;j++){
+	const double *row = &q[(*this->free_joints)[j]*nb];
+	std::copy(row,row+nb,&this->batch_q[j*nb]);
+      }
+      chain_q = this->batch_q.data();
+    }
+
+    this->batch_positions.resize(3*nb);
+    this->batch_rotations.resize(9*nb);
+    forward_kinematics_lanes(*this->chain,nb,chain_q,
+			     this->batch_positions.data(),this->batch_rotations.data());
+
+    double position[3];
+    double rotation[9];
+    for(int i=0;i<nb;i++){
+      for(int v=0;v<3;v++) position[v] = this->batch_positions[v*nb+i];
+      for(int v=0;v<9;v++) rotation[v] = this->batch_rotations[v*nb+i];
+      get_scores[i] = this->evaluate(position,rotation);
+    }
+
+  }
+
 }
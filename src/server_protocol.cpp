@@ -0,0 +1,100 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/server_protocol.h"
+#include "playful_kinematics/ik.h"
+
+#include <string.h>
+
+
+namespace playful_kinematics {
+
+  namespace server_protocol {
+
+
+    void process(const request &job, reply &get_reply){
+
+      memset(&get_reply,0,sizeof(get_reply));
+      get_reply.magic = MAGIC;
+      get_reply.id = job.id;
+      get_reply.success = false;
+      get_reply.nb_joints = job.nb_joints;
+      get_reply.score = std::numeric_limits<float>::max();
+
+      int nb_joints = std::min((int)job.nb_joints,MAX_JOINTS);
+
+      if(job.type==NB_JOINTS_REQUEST){
+	get_reply.nb_joints = playful_kinematics::get_nb_joints(job.left);
+	get_reply.success = true;
+	return;
+      }
+
+      if(job.type==FK_REQUEST){
+	// forward kinematics reads as many joints as the chain has
+	if(job.nb_joints>MAX_JOINTS || job.nb_joints!=playful_kinematics::get_nb_joints(job.left)) return;
+	double q[MAX_JOINTS];
+	for(int i=0;i<nb_joints;i++) q[i]=job.posture[i];
+	double *c = get_reply.cartesian;
+	get_reply.success = playful_kinematics::forward_kinematics(job.left,q,
+								   &c[0],&c[1],&c[2],
+								   &c[3],&c[4],&c[5]);
+	return;
+      }
+
+      if(job.type==IK_REQUEST){
+
+	// the score reads as many joints as the chain has
+	if(job.nb_joints>MAX_JOINTS || job.nb_joints!=playful_kinematics::get_nb_joints(job.left)) return;
+	if(job.line_search!=FIXED_STEP_LINE_SEARCH && job.line_search!=ADAPTIVE_LINE_SEARCH) return;
+
+	std::vector<bool> mask;
+	for(int i=0;i<6;i++) mask.push_back(job.mask[i]);
+
+	std::vector<float> reference_posture;
+	std::vector<int> minimization_priority;
+	std::map<int,float> min;
+	std::map<int,float> max;
+	for(int i=0;i<nb_joints;i++){
+	  reference_posture.push_back((float)job.posture[i]);
+	  minimization_priority.push_back(job.priority[i]);
+	  if(job.has_limit[i]){
+	    min[i]=job.min[i];
+	    max[i]=job.max[i];
+	  }
+	}
+
+	std::vector<float> posture;
+	float score;
+	get_reply.success = playful_kinematics::ik(job.left,mask,reference_posture,
+						   minimization_priority,min,max,
+						   job.target[0],job.target[1],job.target[2],
+						   job.target[3],job.target[4],job.target[5],
+						   posture,score,
+						   (playful_kinematics::line_search)job.line_search);
+	get_reply.score = score;
+	for(int i=0;i<nb_joints;i++) get_reply.posture[i]=posture[i];
+
+      }
+
+    }
+
+
+  }
+
+}
@@ -0,0 +1,172 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/solver_profile.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static const char* _engine_name(solver_engine engine){
+    return engine==CMAES_ENGINE ? "cmaes" : "soma";
+  }
+
+
+  static bool _read_engine(std::istream &in, solver_engine &get){
+    std::string name;
+    if(!(in >> name)) return false;
+    if(name=="soma") get = SOMA_ENGINE;
+    else if(name=="cmaes") get = CMAES_ENGINE;
+    else return false;
+    return true;
+  }
+
+
+  static solver_profile _load_default(){
+    solver_profile profile;
+    const char *path = std::getenv(SOLVER_PROFILE_ENV);
+    if(path && !read_solver_profile(path,profile)){
+      std::cerr << "playful kinematics: using the default solver profile" << std::endl;
+      profile = solver_profile();
+    }
+    return profile;
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  bool solver_profile::operator==(const solver_profile &other) const {
+    return this->engine==other.engine
+      && this->target_score==other.target_score
+      && this->max_step==other.max_step
+      && this->min_step==other.min_step
+      && this->max_iteration==other.max_iteration
+      && this->cmaes.population==other.cmaes.population
+      && this->cmaes.sigma==other.cmaes.sigma
+      && this->cmaes.max_generations==other.cmaes.max_generations
+      && this->cmaes.seed==other.cmaes.seed
+      && this->cmaes.nb_threads==other.cmaes.nb_threads;
+  }
+
+
+  bool solver_profile::operator!=(const solver_profile &other) const {
+    return !(*this==other);
+  }
+
+
+  bool write_solver_profile(const std::string &path, const solver_profile &profile,
+			    const std::string &comment){
+
+    std::ofstream out(path.c_str());
+    if(!out){
+      std::cerr << "playful kinematics: failed to open solver profile file " << path << std::endl;
+      return false;
+    }
+
+    out.precision(std::numeric_limits<float>::max_digits10);
+
+    out << SOLVER_PROFILE_HEADER << " " << SOLVER_PROFILE_VERSION << "\n";
+    std::istringstream lines(comment);
+    std::string line;
+    while(std::getline(lines,line)) out << "# " << line << "\n";
+    out << "engine " << _engine_name(profile.engine) << "\n"
+	<< "target_score " << profile.target_score << "\n"
+	<< "max_step " << profile.max_step << "\n"
+	<< "min_step " << profile.min_step << "\n"
+	<< "max_iteration " << profile.max_iteration << "\n"
+	<< "cmaes_population " << profile.cmaes.population << "\n"
+	<< "cmaes_sigma " << profile.cmaes.sigma << "\n"
+	<< "cmaes_max_generations " << profile.cmaes.max_generations << "\n"
+	<< "cmaes_seed " << profile.cmaes.seed << "\n"
+	<< "cmaes_nb_threads " << profile.cmaes.nb_threads << "\n";
+
+    if(!out){
+      std::cerr << "playful kinematics: failed to write solver profile file " << path << std::endl;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  bool read_solver_profile(const std::string &path, solver_profile &get_profile){
+
+    std::ifstream in(path.c_str());
+    if(!in){
+      std::cerr << "playful kinematics: failed to open solver profile file " << path << std::endl;
+      return false;
+    }
+
+    std::string header;
+    int version;
+    bool valid = (in >> header >> version) && header==SOLVER_PROFILE_HEADER;
+    if(valid && version!=SOLVER_PROFILE_VERSION){
+      std::cerr << "playful kinematics: solver profile file " << path << " of version " << version
+		<< ", expected version " << SOLVER_PROFILE_VERSION << std::endl;
+      return false;
+    }
+
+    solver_profile profile;
+    std::string line;
+    while(valid && std::getline(in,line)){
+      std::istringstream words(line);
+      std::string name;
+      if(!(words >> name) || name[0]=='#') continue;
+      if(name=="engine") valid = _read_engine(words,profile.engine);
+      else if(name=="target_score") valid = (bool)(words >> profile.target_score);
+      else if(name=="max_step") valid = (bool)(words >> profile.max_step);
+      else if(name=="min_step") valid = (bool)(words >> profile.min_step);
+      else if(name=="max_iteration") valid = (bool)(words >> profile.max_iteration);
+      else if(name=="cmaes_population") valid = (bool)(words >> profile.cmaes.population);
+      else if(name=="cmaes_sigma") valid = (bool)(words >> profile.cmaes.sigma);
+      else if(name=="cmaes_max_generations") valid = (bool)(words >> profile.cmaes.max_generations);
+      else if(name=="cmaes_seed") valid = (bool)(words >> profile.cmaes.seed);
+      else if(name=="cmaes_nb_threads") valid = (bool)(words >> profile.cmaes.nb_threads);
+      else {
+	std::cerr << "playful kinematics: unknown parameter " << name << " in solver profile file " << path << std::endl;
+	return false;
+      }
+    }
+
+    if(!valid){
+      std::cerr << "playful kinematics: failed to read solver profile file " << path << std::endl;
+      return false;
+    }
+
+    get_profile = profile;
+    return true;
+
+  }
+
+
+  const solver_profile& get_default_solver_profile(){
+    static const solver_profile profile = _load_default();
+    return profile;
+  }
+
+
+}
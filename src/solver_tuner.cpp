@@ -0,0 +1,241 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Offline tuning of the solver profile (see solver_profile.h) of the inverse kinematics of Pepper.
+// Solves a set of targets with a grid of SOMA and CMA-ES profiles (the default profile included):
+// either the targets of an ik corpus file (see ik_corpus.h, e.g. written by pepper_ik_corpus), or
+// the given number of targets generated as for an ik corpus (reachable, borderline and unreachable).
+// A target is solved if its score is below accuracy. For each profile: p50 and p99 latencies, success
+// rate and median score of the solved targets. Prints the Pareto frontier of the profiles (no other
+// profile being as fast, as successful and as accurate, and better on one of these) sorted by latency,
+// and writes to profile_file the fastest (p50) profile of the frontier whose success rate is at least
+// min_success (default: the success rate of the default profile). The library loads this file at
+// startup if PLAYFUL_KINEMATICS_SOLVER_PROFILE is set to its path.
+// Exits with 1 if no profile reaches min_success.
+//
+// usage: pepper_solver_tuner profile_file [corpus_file or number of targets] [accuracy] [min_success] [fixed|adaptive]
+//        defaults: 1000 targets, 0.001, success rate of the default profile, fixed
+
+
+#include "playful_kinematics/ik_corpus.h"
+#include "playful_kinematics/pepper_ik_corpus.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+
+
+// one profile and its results on the targets
+class candidate {
+
+public:
+
+  playful_kinematics::solver_profile profile;
+  double p50_latency;
+  double p99_latency;
+  double success_rate;
+  double median_score;
+
+  // as fast, successful and accurate, and better on one
+  bool dominates(const candidate &other) const {
+    bool as_good = this->p50_latency<=other.p50_latency
+      && this->success_rate>=other.success_rate
+      && this->median_score<=other.median_score;
+    bool better = this->p50_latency<other.p50_latency
+      || this->success_rate>other.success_rate
+      || this->median_score<other.median_score;
+    return as_good && better;
+  }
+
+  std::string describe() const {
+    std::ostringstream s;
+    if(this->profile.engine==playful_kinematics::CMAES_ENGINE){
+      s << "cmaes target " << this->profile.target_score
+	<< " population " << this->profile.cmaes.population
+	<< " generations " << this->profile.cmaes.max_generations;
+    } else {
+      s << "soma target " << this->profile.target_score
+	<< " steps " << this->profile.max_step << "/" << this->profile.min_step
+	<< " iterations " << this->profile.max_iteration;
+    }
+    return s.str();
+  }
+
+  std::string metrics() const {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(1)
+      << "p50 " << this->p50_latency << " us, p99 " << this->p99_latency << " us, success "
+      << std::setprecision(2) << 100*this->success_rate << " %, median score "
+      << std::scientific << std::setprecision(2) << this->median_score;
+    return s.str();
+  }
+
+};
+
+
+// the default profile first
+static std::vector<playful_kinematics::solver_profile> _grid(float accuracy){
+
+  using namespace playful_kinematics;
+
+  std::vector<solver_profile> profiles;
+  profiles.push_back(solver_profile());
+
+  float target_scores[] = {accuracy,accuracy/4};
+  float max_steps[] = {0.05,0.1,0.2,0.4};
+  float min_steps[] = {0.0001,0.001,0.005};
+  int max_iterations[] = {5,10,15,25};
+  for(float target_score: target_scores){
+    for(float max_step: max_steps){
+      for(float min_step: min_steps){
+	for(int max_iteration: max_iterations){
+	  solver_profile profile;
+	  profile.target_score = target_score;
+	  profile.max_step = max_step;
+	  profile.min_step = min_step;
+	  profile.max_iteration = max_iteration;
+	  if(profile!=profiles[0]) profiles.push_back(profile);
+	}
+      }
+    }
+  }
+
+  int populations[] = {0,16};
+  int max_generations[] = {50,100,200};
+  for(int population: populations){
+    for(int generations: max_generations){
+      solver_profile profile;
+      profile.engine = CMAES_ENGINE;
+      profile.target_score = accuracy;
+      profile.cmaes.population = population;
+      profile.cmaes.max_generations = generations;
+      profiles.push_back(profile);
+    }
+  }
+
+  return profiles;
+
+}
+
+
+static candidate _evaluate(const playful_kinematics::ik_corpus &corpus,
+			   const playful_kinematics::solver_profile &profile,
+			   playful_kinematics::line_search search,
+			   float accuracy){
+
+  using namespace playful_kinematics;
+
+  std::vector<ik_corpus_result> results;
+  replay_ik_corpus(corpus,results,search,profile);
+
+  sample_stats latencies, scores;
+  int nb_success = 0;
+  for(int r=0;r<results.size();r++){
+    latencies.add(results[r].latency/1000.0);
+    if(results[r].score<=accuracy){
+      nb_success++;
+      scores.add(results[r].score);
+    }
+  }
+
+  candidate c;
+  c.profile = profile;
+  c.p50_latency = latencies.percentile(0.5);
+  c.p99_latency = latencies.percentile(0.99);
+  c.success_rate = results.empty() ? 0 : (double)nb_success/results.size();
+  // no target solved: no accuracy
+  c.median_score = scores.size() ? scores.percentile(0.5) : std::numeric_limits<double>::infinity();
+  return c;
+
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  if(argc<2){
+    std::cerr << "usage: " << argv[0]
+	      << " profile_file [corpus_file or number of targets] [accuracy] [min_success] [fixed|adaptive]"
+	      << std::endl;
+    return 1;
+  }
+
+  std::string path = argv[1];
+  std::string targets = argc>2 ? argv[2] : "1000";
+  float accuracy = argc>3 ? atof(argv[3]) : 0.001;
+  double min_success = argc>4 ? atof(argv[4]) : -1;
+  line_search search = (argc>5 && std::string(argv[5])=="adaptive") ? ADAPTIVE_LINE_SEARCH : FIXED_STEP_LINE_SEARCH;
+
+  ik_corpus corpus;
+  char *end;
+  long nb_targets = strtol(targets.c_str(),&end,10);
+  if(*end=='\0' && nb_targets>0){
+    configure_pepper_ik_corpus(corpus);
+    generate_ik_corpus(nb_targets,0,corpus);
+  } else if(!read_ik_corpus(targets,corpus)){
+    return 1;
+  }
+
+  std::vector<solver_profile> profiles = _grid(accuracy);
+  std::cout << corpus.entries.size() << " targets, " << profiles.size() << " profiles, accuracy "
+	    << accuracy << std::endl;
+
+  std::vector<candidate> candidates;
+  for(int p=0;p<profiles.size();p++){
+    candidates.push_back(_evaluate(corpus,profiles[p],search,accuracy));
+  }
+  if(min_success<0) min_success = candidates[0].success_rate;
+  std::cout << "default profile: " << candidates[0].metrics() << std::endl << std::endl;
+
+  std::vector<candidate> frontier;
+  for(int c=0;c<candidates.size();c++){
+    bool dominated = false;
+    for(int o=0;o<candidates.size() && !dominated;o++) dominated = candidates[o].dominates(candidates[c]);
+    if(!dominated) frontier.push_back(candidates[c]);
+  }
+  std::sort(frontier.begin(),frontier.end(),
+	    [](const candidate &a, const candidate &b){ return a.p50_latency<b.p50_latency; });
+
+  std::cout << "Pareto frontier (latency, success rate, median score)" << std::endl;
+  const candidate *selected = NULL;
+  for(int c=0;c<frontier.size();c++){
+    bool eligible = frontier[c].success_rate>=min_success;
+    if(eligible && !selected) selected = &frontier[c];
+    std::cout << (selected==&frontier[c] ? " * " : "   ")
+	      << std::left << std::setw(52) << frontier[c].describe() << std::right
+	      << frontier[c].metrics() << std::endl;
+  }
+
+  if(!selected){
+    std::cout << "no profile with a success rate of at least " << 100*min_success << " %" << std::endl;
+    return 1;
+  }
+
+  std::ostringstream comment;
+  comment << "written by pepper_solver_tuner: " << corpus.entries.size() << " targets ("
+	  << (*end=='\0' ? "generated" : targets) << "), accuracy " << accuracy
+	  << ", " << (search==ADAPTIVE_LINE_SEARCH ? "adaptive" : "fixed step") << " line search\n"
+	  << selected->metrics() << "\n"
+	  << "default profile: " << candidates[0].metrics();
+  if(!write_solver_profile(path,selected->profile,comment.str())) return 1;
+
+  std::cout << std::endl << "profile written to " << path << std::endl;
+  return 0;
+
+}
@@ -0,0 +1,259 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+// Compares minimize called with a score function pointer (std::vector posture)
+// and the templated minimize called with inlinable functors (std::vector and
+// std::array and fixed_posture postures), on score functions of the unit tests
+// and on the inverse kinematics score. All versions must find the same postures
+// (for the inverse kinematics score, fixed_posture uses the forward kinematics
+// of the flat chain rather than KDL, and may differ by rounding).
+// Then reports the score computations avoided by the minimizer (current score
+// tracking and memoization, see soma_counters in soma.h) when solving inverse
+// kinematics for a fixed set of targets, with the fixed step and the adaptive
+// line searches.
+//
+// usage: pepper_soma_benchmark [number of runs]
+
+
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "playful_kinematics/stats.h"
+
+#include <array>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+
+typedef std::chrono::steady_clock clock_type;
+
+typedef std::array<float,playful_kinematics::pepper::NB_DOFS> array_posture;
+typedef playful_kinematics::fixed_posture<playful_kinematics::pepper::NB_DOFS> fixed_size_posture;
+
+
+// score functions of tests/soma_unit_tests.cpp
+
+static float abs_score_function(std::vector<float> &posture){
+  float sum = 0;
+  for(int i=0;i<posture.size();i++) sum += std::abs(posture[i]);
+  return sum;
+}
+
+static float targeting_sum_sixteen_score_function(std::vector<float> &posture){
+  float sum = 0;
+  for(int i=0;i<posture.size();i++) sum += std::abs(posture[i]);
+  return std::abs(sum-16.0);
+}
+
+
+// same, as functors
+
+class abs_score {
+public:
+  template<class Posture>
+  float operator()(const Posture &posture) const {
+    float sum = 0;
+    for(int i=0;i<posture.size();i++) sum += std::abs(posture[i]);
+    return sum;
+  }
+};
+
+class targeting_sum_sixteen_score {
+public:
+  template<class Posture>
+  float operator()(const Posture &posture) const {
+    float sum = 0;
+    for(int i=0;i<posture.size();i++) sum += std::abs(posture[i]);
+    return std::abs(sum-16.0);
+  }
+};
+
+
+static void _copy(const std::vector<float> &from, std::vector<float> &to){
+  to = from;
+}
+
+template<class Posture>
+static void _copy(const std::vector<float> &from, Posture &to){
+  for(int i=0;i<to.size();i++) to[i]=from[i];
+}
+
+
+// minimizes from each start posture, prints the time per minimization and
+// returns the sum of the final postures (to check all versions agree)
+template<class Posture, class Score>
+static double _run(const std::string &label,
+		   const std::vector< std::vector<float> > &starts,
+		   const std::vector<int> &priority,
+		   const std::map<int,float> &min, const std::map<int,float> &max,
+		   Score &&score){
+
+  playful_kinematics::sample_stats time;
+  double checksum = 0;
+
+  Posture posture;
+
+  for(int r=0;r<starts.size();r++){
+
+    _copy(starts[r],posture);
+
+    float final_score;
+    clock_type::time_point start = clock_type::now();
+    playful_kinematics::minimize(posture,priority,min,max,0.001,0.1,0.001,15,score,final_score);
+    clock_type::time_point end = clock_type::now();
+
+    time.add(std::chrono::duration<double,std::micro>(end-start).count());
+    for(int i=0;i<posture.size();i++) checksum += posture[i];
+
+  }
+
+  time.print(label,"us");
+  return checksum;
+
+}
+
+
+static void _check(const std::vector<double> &checksums){
+  for(int i=1;i<checksums.size();i++){
+    if(checksums[i]!=checksums[0]){
+      std::cout << "  ! versions found different postures" << std::endl;
+      return;
+    }
+  }
+}
+
+
+int main( int argc, char** argv ){
+
+  using namespace playful_kinematics;
+
+  int nb_runs = 200;
+  if(argc>1) nb_runs = atoi(argv[1]);
+
+  std::vector<int> priority(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+  std::map<int,float> min,max;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    min[i]=pepper::LEFT_MIN[i];
+    max[i]=pepper::LEFT_MAX[i];
+  }
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+
+  std::vector< std::vector<float> > starts;
+  std::vector<float> targets;
+  for(int r=0;r<nb_runs;r++){
+    std::vector<float> start;
+    double q[pepper::NB_DOFS];
+    for(int i=0;i<pepper::NB_DOFS;i++){
+      start.push_back(pepper::LEFT_MIN[i]+uniform(generator)*(pepper::LEFT_MAX[i]-pepper::LEFT_MIN[i]));
+      q[i] = pepper::LEFT_MIN[i]+uniform(generator)*(pepper::LEFT_MAX[i]-pepper::LEFT_MIN[i]);
+    }
+    starts.push_back(start);
+    double c[6];
+    forward_kinematics(true,q,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+    for(int i=0;i<6;i++) targets.push_back(c[i]);
+  }
+
+  std::vector<double> checksums;
+
+  std::cout << nb_runs << " minimizations per version" << std::endl << std::endl;
+
+  std::cout << "abs score" << std::endl;
+  checksums.push_back(_run< std::vector<float> >("function pointer",starts,priority,min,max,&abs_score_function));
+  checksums.push_back(_run< std::vector<float> >("functor, vector",starts,priority,min,max,abs_score()));
+  checksums.push_back(_run< array_posture >("functor, array",starts,priority,min,max,abs_score()));
+  checksums.push_back(_run< fixed_size_posture >("functor, fixed",starts,priority,min,max,abs_score()));
+  _check(checksums);
+
+  std::cout << std::endl << "targeting sum sixteen score" << std::endl;
+  checksums.clear();
+  checksums.push_back(_run< std::vector<float> >("function pointer",starts,priority,min,max,&targeting_sum_sixteen_score_function));
+  checksums.push_back(_run< std::vector<float> >("functor, vector",starts,priority,min,max,targeting_sum_sixteen_score()));
+  checksums.push_back(_run< array_posture >("functor, array",starts,priority,min,max,targeting_sum_sixteen_score()));
+  checksums.push_back(_run< fixed_size_posture >("functor, fixed",starts,priority,min,max,targeting_sum_sixteen_score()));
+  _check(checksums);
+
+  // inverse kinematics score: one target for all runs, position only
+  std::vector<bool> mask(6,false);
+  for(int i=0;i<3;i++) mask[i]=true;
+  set_target_cartesian_position(targets[0],targets[1],targets[2],targets[3],targets[4],targets[5]);
+  set_configuration(true,mask);
+  cartesian_score score(true,mask,targets[0],targets[1],targets[2],targets[3],targets[4],targets[5]);
+
+  std::cout << std::endl << "inverse kinematics score" << std::endl;
+  checksums.clear();
+  reset_nb_score_evaluations();
+  checksums.push_back(_run< std::vector<float> >("function pointer",starts,priority,min,max,&at_desired_cartesian_position));
+  long nb_evaluations = get_nb_score_evaluations();
+  checksums.push_back(_run< std::vector<float> >("functor, vector",starts,priority,min,max,score));
+  checksums.push_back(_run< array_posture >("functor, array",starts,priority,min,max,score));
+  checksums.push_back(_run< fixed_size_posture >("functor, fixed",starts,priority,min,max,score));
+  _check(checksums);
+  std::cout << "score evaluations per minimization: " << nb_evaluations/nb_runs << std::endl;
+
+  // fixed set of inverse kinematics targets, solved from the reference posture
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<float> posture;
+  float final_score;
+
+  for(int search=FIXED_STEP_LINE_SEARCH;search<=ADAPTIVE_LINE_SEARCH;search++){
+
+    for(int full=0;full<2;full++){
+
+      std::vector<bool> ik_mask(6,true);
+      if(!full) for(int i=3;i<6;i++) ik_mask[i]=false;
+
+      sample_stats time;
+      sample_stats scores;
+      int nb_success = 0;
+
+      get_soma_counters().reset();
+      for(int r=0;r<nb_runs;r++){
+	const float *t = &targets[6*r];
+	clock_type::time_point start = clock_type::now();
+	bool success = ik(true,ik_mask,reference,priority,min,max,t[0],t[1],t[2],t[3],t[4],t[5],
+			  posture,final_score,(line_search)search);
+	clock_type::time_point end = clock_type::now();
+	time.add(std::chrono::duration<double,std::micro>(end-start).count());
+	scores.add(final_score);
+	if(success) nb_success++;
+      }
+
+      const soma_counters &counters = get_soma_counters();
+      double per_solve = 1.0/counters.nb_minimizations;
+      std::cout << std::endl << "inverse kinematics, "
+		<< (search==ADAPTIVE_LINE_SEARCH ? "adaptive line search, " : "fixed step line search, ")
+		<< (full ? "position and orientation" : "position only") << std::endl;
+      time.print("solve","us");
+      scores.print("score","");
+      std::cout << "success: " << nb_success << "/" << nb_runs << std::endl
+		<< "per solve" << std::endl
+		<< std::fixed << std::setprecision(1)
+		<< "  score requests:    " << counters.nb_requests()*per_solve << std::endl
+		<< "  score evaluations: " << counters.nb_evaluations*per_solve << std::endl
+		<< "  memo hits:         " << counters.nb_memo_hits*per_solve << std::endl
+		<< "  known scores:      " << counters.nb_reused*per_solve << std::endl
+		<< "  evaluations saved: "
+		<< 100.0*(counters.nb_requests()-counters.nb_evaluations)/counters.nb_requests() << " %" << std::endl;
+
+    }
+
+  }
+
+}
@@ -0,0 +1,273 @@
+// Copyright  (C)  2018 Max Planck Gesellschaft
+// Autor : Vincent Berenz
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+
+#include "playful_kinematics/trace.h"
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace playful_kinematics {
+
+
+  /* BACK END FUNCTIONS AND CLASSES */
+
+
+  static const char *TRACE_ENV = "PLAYFUL_KINEMATICS_TRACE";
+
+
+  class trace_event {
+  public:
+    const char *name;
+    int64_t begin;
+    int64_t end;
+  };
+
+
+  // events of one thread: written by this thread (head), drained by write_trace (tail)
+  class trace_buffer {
+
+  public:
+
+    trace_buffer(int tid)
+      : tid(tid), events(TRACE_BUFFER_SIZE), head(0), tail(0), nb_dropped(0), finished(false) {}
+
+    int tid;
+    std::vector<trace_event> events;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<long> nb_dropped;
+    // set when the thread exits, the buffer is then removed once drained
+    std::atomic<bool> finished;
+
+  };
+
+
+  class trace_registry {
+
+  public:
+
+    trace_registry() : nb_threads(0), nb_dropped(0) {}
+
+    std::mutex mutex;
+    std::vector< boost::shared_ptr<trace_buffer> > buffers;
+    int nb_threads;
+    // dropped by the buffers already removed
+    long nb_dropped;
+
+  };
+
+
+  static bool _write_trace(const std::string &path);
+
+
+  static void _write_trace_at_exit(){
+    const char *path = std::getenv(TRACE_ENV);
+    if(path) _write_trace(path);
+  }
+
+
+  static trace_registry& _get_registry(){
+    static trace_registry registry;
+    static bool at_exit = (std::getenv(TRACE_ENV)!=NULL && std::atexit(_write_trace_at_exit)==0);
+    (void)at_exit;
+    return registry;
+  }
+
+
+  // buffer of the calling thread, created and registered on first use
+  class trace_buffer_handle {
+
+  public:
+
+    ~trace_buffer_handle(){
+      if(this->buffer) this->buffer->finished.store(true,std::memory_order_release);
+    }
+
+    trace_buffer& get(){
+      if(!this->buffer){
+	trace_registry &registry = _get_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	this->buffer.reset(new trace_buffer(registry.nb_threads++));
+	registry.buffers.push_back(this->buffer);
+      }
+      return *this->buffer;
+    }
+
+  private:
+
+    boost::shared_ptr<trace_buffer> buffer;
+
+  };
+
+
+  void trace_internal::record(const char *name, int64_t begin, int64_t end){
+
+    static thread_local trace_buffer_handle handle;
+    trace_buffer &buffer = handle.get();
+
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if(head-buffer.tail.load(std::memory_order_acquire) >= TRACE_BUFFER_SIZE){
+      buffer.nb_dropped.fetch_add(1,std::memory_order_relaxed);
+      return;
+    }
+
+    trace_event &event = buffer.events[head & (TRACE_BUFFER_SIZE-1)];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+    buffer.head.store(head+1,std::memory_order_release);
+
+  }
+
+
+  // calls function(tid,event) on the events not yet drained, and drains them.
+  // Buffers of exited threads are removed once drained.
+  template<class Function>
+  static void _drain(Function function){
+
+    trace_registry &registry = _get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for(int b=registry.buffers.size()-1;b>=0;b--){
+
+      trace_buffer &buffer = *registry.buffers[b];
+      bool finished = buffer.finished.load(std::memory_order_acquire);
+      uint64_t head = buffer.head.load(std::memory_order_acquire);
+      uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+
+      for(uint64_t i=tail;i<head;i++) function(buffer.tid,buffer.events[i & (TRACE_BUFFER_SIZE-1)]);
+      buffer.tail.store(head,std::memory_order_release);
+
+      if(finished){
+	registry.nb_dropped += buffer.nb_dropped.load(std::memory_order_relaxed);
+	registry.buffers.erase(registry.buffers.begin()+b);
+      }
+
+    }
+
+  }
+
+
+  static void _ignore(int, const trace_event &){}
+
+
+  // chrome trace event format: complete events ("ph":"X"), timestamps in micro seconds
+  class chrome_trace_writer {
+
+  public:
+
+    chrome_trace_writer(std::ostream &out)
+      : out(out), pid(getpid()), first(true) {}
+
+    void operator()(int tid, const trace_event &event){
+      if(!this->first) this->out << ",\n";
+      this->first = false;
+      this->out << "{\"name\":\"" << event.name << "\",\"cat\":\"playful_kinematics\",\"ph\":\"X\""
+		<< ",\"pid\":" << this->pid << ",\"tid\":" << tid
+		<< ",\"ts\":" << event.begin/1000.0
+		<< ",\"dur\":" << (event.end-event.begin)/1000.0 << "}";
+    }
+
+  private:
+
+    std::ostream &out;
+    int pid;
+    bool first;
+
+  };
+
+
+  static bool _write_trace(const std::string &path){
+
+    std::ofstream out(path.c_str());
+    if(!out){
+      std::cerr << "playful kinematics: failed to open trace file " << path << std::endl;
+      return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    _drain(chrome_trace_writer(out));
+    out << "\n]}\n";
+
+    if(!out){
+      std::cerr << "playful kinematics: failed to write trace file " << path << std::endl;
+      return false;
+    }
+
+    return true;
+
+  }
+
+
+  /* END OF BACK END FUNCTIONS */
+
+
+  bool is_tracing_enabled(){
+#ifdef PLAYFUL_KINEMATICS_TRACING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+
+  bool write_trace(const std::string &path){
+    if(!is_tracing_enabled()){
+      std::cerr << "playful kinematics: tracing not compiled in, see the PLAYFUL_KINEMATICS_TRACING cmake option" << std::endl;
+    }
+    return _write_trace(path);
+  }
+
+
+  void clear_trace(){
+    _drain(_ignore);
+  }
+
+
+  long get_nb_dropped_trace_events(){
+    trace_registry &registry = _get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    long nb_dropped = registry.nb_dropped;
+    for(int b=0;b<registry.buffers.size();b++){
+      nb_dropped += registry.buffers[b]->nb_dropped.load(std::memory_order_relaxed);
+    }
+    return nb_dropped;
+  }
+
+
+}
+
+
+/* INTERFACE FOR PYTHON WRAPPER */
+
+
+extern "C" {
+
+  bool write_kinematics_trace(char *path){
+    return playful_kinematics::write_trace(path);
+  }
+
+}
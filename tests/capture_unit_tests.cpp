@@ -0,0 +1,111 @@
+#include "playful_kinematics/capture.h"
+#include "playful_kinematics/fk.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <cstdio>
+
+
+// interface for the python wrapper (kinematic_config.cpp, fk.cpp, robot_instance.cpp)
+extern "C" {
+  void set_kinematics_joint_limit(int index, float min, float max);
+  bool forward_kinematics(bool left, double *q,
+			  double *x, double *y, double *z,
+			  double *alpha, double *beta, double *gamma);
+  void* create_kinematics_handle();
+  void delete_kinematics_handle(void *handle);
+  void handle_set_line_search(void *handle, bool left, int search);
+}
+
+
+class Capture_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+TEST_F(Capture_tests, calls_recorded_in_order){
+
+  using namespace playful_kinematics;
+
+  std::string path = "/tmp/playful_kinematics_capture_unit_tests.cap";
+
+  // handle created before the capture: recorded by a snapshot on first use
+  void *handle = create_kinematics_handle();
+
+  ASSERT_TRUE(start_capture(path));
+  ASSERT_FALSE(start_capture(path));
+  ASSERT_TRUE(is_capturing());
+
+  set_kinematics_joint_limit(2,-0.5,0.5);
+
+  int nb_joints = get_nb_joints(true);
+  std::vector<double> q(nb_joints,0.1);
+  double pose[6];
+  bool success = ::forward_kinematics(true,q.data(),&pose[0],&pose[1],&pose[2],&pose[3],&pose[4],&pose[5]);
+
+  handle_set_line_search(handle,false,1);
+  handle_set_line_search(handle,true,1);
+
+  // records of other threads
+  std::thread thread([](){ set_kinematics_joint_limit(3,-0.25,0.25); });
+  thread.join();
+
+  stop_capture();
+  ASSERT_FALSE(is_capturing());
+
+  // not recorded
+  set_kinematics_joint_limit(2,-1,1);
+  delete_kinematics_handle(handle);
+
+  std::vector<captured_call> calls;
+  ASSERT_TRUE(read_capture(path,calls));
+  std::remove(path.c_str());
+
+  uint32_t types[] = {CAPTURE_CONFIG_SNAPSHOT,
+		      CAPTURE_SET_KINEMATICS_JOINT_LIMIT,
+		      CAPTURE_FORWARD_KINEMATICS,
+		      CAPTURE_HANDLE_SNAPSHOT,
+		      CAPTURE_HANDLE_SET_LINE_SEARCH,
+		      CAPTURE_HANDLE_SET_LINE_SEARCH,
+		      CAPTURE_SET_KINEMATICS_JOINT_LIMIT};
+  ASSERT_EQ(calls.size(),7);
+  for(int c=0;c<calls.size();c++){
+    ASSERT_EQ(calls[c].header.type,types[c]);
+    ASSERT_EQ(calls[c].header.size,sizeof(capture_record_header)+calls[c].payload.size());
+    ASSERT_GE(calls[c].header.duration,0);
+    if(c>0){
+      ASSERT_GT(calls[c].header.sequence,calls[c-1].header.sequence);
+      ASSERT_GE(calls[c].header.begin,calls[c-1].header.begin);
+    }
+  }
+  ASSERT_EQ(calls[1].header.thread,calls[2].header.thread);
+  ASSERT_NE(calls[1].header.thread,calls[6].header.thread);
+
+  capture_payload limit(calls[1]);
+  ASSERT_EQ(limit.get<int32_t>(),2);
+  ASSERT_EQ(limit.get<float>(),-0.5f);
+  ASSERT_EQ(limit.get<float>(),0.5f);
+  ASSERT_TRUE(limit.is_valid());
+  limit.get<float>();
+  ASSERT_FALSE(limit.is_valid());
+
+  capture_payload fk(calls[2]);
+  ASSERT_TRUE(fk.get<bool>());
+  ASSERT_EQ(fk.get_array<double>(),q);
+  ASSERT_EQ(fk.get<bool>(),success);
+  double recorded_pose[6];
+  fk.get_fixed(6,recorded_pose);
+  for(int i=0;i<6;i++) ASSERT_EQ(recorded_pose[i],pose[i]);
+  ASSERT_TRUE(fk.is_valid());
+
+  capture_payload snapshot(calls[3]);
+  ASSERT_EQ(snapshot.get<uint64_t>(),(uint64_t)handle);
+
+  capture_payload search(calls[4]);
+  ASSERT_EQ(search.get<uint64_t>(),(uint64_t)handle);
+  ASSERT_FALSE(search.get<bool>());
+  ASSERT_EQ(search.get<int32_t>(),1);
+
+}
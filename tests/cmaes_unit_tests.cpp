@@ -0,0 +1,134 @@
+#include "playful_kinematics/cmaes.h"
+#include "gtest/gtest.h"
+#include <cmath>
+
+
+class Cmaes_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+// non smooth (abs) and rotated: coordinate descent gets little help from it
+class rotated_abs {
+public:
+  template<class Posture>
+  float operator()(const Posture &posture){
+    float score = 0;
+    for(int i=0;i+1<posture.size();i++) score += fabs(posture[i]+posture[i+1]-0.5);
+    return score + fabs(posture[0]-posture[posture.size()-1]);
+  }
+};
+
+
+// same score, also scoring batches of postures in structure of arrays layout
+class batch_rotated_abs : public rotated_abs {
+public:
+  batch_rotated_abs() : nb_batches(0) {}
+  void evaluate_batch(int nb, const double *q, float *get_scores){
+    nb_batches++;
+    std::vector<float> posture(nb_dims);
+    for(int i=0;i<nb;i++){
+      for(int j=0;j<nb_dims;j++) posture[j]=q[j*nb+i];
+      get_scores[i] = (*this)(posture);
+    }
+  }
+  static const int nb_dims = 4;
+  int nb_batches;
+};
+
+
+TEST_F(Cmaes_tests, reaches_target_within_limits){
+
+  using namespace playful_kinematics;
+
+  std::vector<float> posture(4,-0.8f), min(4,-1.0f), max(4,1.0f);
+  // frozen
+  min[3] = max[3] = 0.25f;
+
+  cmaes_parameters parameters;
+  parameters.seed = 3;
+  parameters.max_generations = 500;
+  float score;
+  bool success = minimize(posture,min,max,0.01f,rotated_abs(),score,parameters);
+
+  ASSERT_TRUE(success);
+  ASSERT_LE(score,0.01f);
+  ASSERT_NEAR(score,rotated_abs()(posture),1e-6);
+  ASSERT_EQ(posture[3],0.25f);
+  for(int i=0;i<4;i++){
+    ASSERT_GE(posture[i],min[i]);
+    ASSERT_LE(posture[i],max[i]);
+  }
+
+}
+
+
+TEST_F(Cmaes_tests, same_seed_same_result){
+
+  using namespace playful_kinematics;
+
+  std::vector<float> min(4,-1.0f), max(4,1.0f);
+  cmaes_parameters parameters;
+  parameters.seed = 7;
+  parameters.max_generations = 20;
+
+  std::vector<float> first(4,0.0f), second(4,0.0f), other(4,0.0f);
+  float first_score, second_score, other_score;
+  minimize(first,min,max,0,rotated_abs(),first_score,parameters);
+  minimize(second,min,max,0,rotated_abs(),second_score,parameters);
+  parameters.seed = 8;
+  minimize(other,min,max,0,rotated_abs(),other_score,parameters);
+
+  ASSERT_EQ(first_score,second_score);
+  ASSERT_EQ(first,second);
+  ASSERT_NE(first,other);
+
+}
+
+
+TEST_F(Cmaes_tests, batches_and_threads){
+
+  using namespace playful_kinematics;
+
+  std::vector<float> min(4,-1.0f), max(4,1.0f);
+  cmaes_parameters parameters;
+  parameters.seed = 11;
+  parameters.max_generations = 30;
+  parameters.population = 16;
+
+  // scored one posture at a time, by batches and over threads: same postures, same scores
+  std::vector<float> single(4,0.0f), batch(4,0.0f), threaded(4,0.0f);
+  float single_score, batch_score, threaded_score;
+
+  get_soma_counters().reset();
+  minimize(single,min,max,0,rotated_abs(),single_score,parameters);
+  long nb_evaluations = get_soma_counters().nb_evaluations;
+  ASSERT_EQ(nb_evaluations,1+16*30);
+
+  batch_rotated_abs score;
+  minimize(batch,min,max,0,score,batch_score,parameters);
+
+  parameters.nb_threads = 3;
+  minimize(threaded,min,max,0,batch_rotated_abs(),threaded_score,parameters);
+
+  ASSERT_EQ(single_score,batch_score);
+  ASSERT_EQ(single,batch);
+  ASSERT_EQ(single_score,threaded_score);
+  ASSERT_EQ(single,threaded);
+
+  // fixed size postures
+  fixed_posture<4> fixed, fixed_min, fixed_max;
+  for(int i=0;i<4;i++){
+    fixed[i]=0;
+    fixed_min[i]=-1;
+    fixed_max[i]=1;
+  }
+  float fixed_score;
+  parameters.nb_threads = 1;
+  minimize(fixed,fixed_min,fixed_max,0,rotated_abs(),fixed_score,parameters);
+  ASSERT_EQ(fixed_score,single_score);
+
+}
@@ -0,0 +1,81 @@
+#include "playful_kinematics/fk_generated.h"
+#include "playful_kinematics/fk.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <cmath>
+
+
+class Fk_generated_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+static void _random_posture(bool left, std::mt19937 &generator, double *q){
+  using namespace playful_kinematics;
+  std::uniform_real_distribution<double> uniform(0.0,1.0);
+  const float *min = left ? pepper::LEFT_MIN : pepper::RIGHT_MIN;
+  const float *max = left ? pepper::LEFT_MAX : pepper::RIGHT_MAX;
+  for(int i=0;i<pepper::NB_DOFS;i++) q[i] = min[i]+uniform(generator)*(max[i]-min[i]);
+}
+
+
+static double _angle_difference(double a, double b){
+  return std::abs(atan2(sin(a-b),cos(a-b)));
+}
+
+
+TEST_F(Fk_generated_tests, same_as_kdl){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(1);
+  boost::shared_ptr<const robot_model> model = get_robot_model();
+
+  for(int side=0;side<2;side++){
+    bool left = (side==1);
+    for(int sample=0;sample<1000;sample++){
+      double q[pepper::NB_DOFS];
+      _random_posture(left,generator,q);
+      double kdl[6];
+      double generated[6];
+      ASSERT_TRUE(model->forward_kinematics(left,q,&kdl[0],&kdl[1],&kdl[2],&kdl[3],&kdl[4],&kdl[5]));
+      ASSERT_TRUE(generated_forward_kinematics(left,q,&generated[0],&generated[1],&generated[2],
+					       &generated[3],&generated[4],&generated[5]));
+      for(int i=0;i<3;i++) ASSERT_NEAR(generated[i],kdl[i],1e-9);
+      for(int i=3;i<6;i++) ASSERT_LT(_angle_difference(generated[i],kdl[i]),1e-9);
+    }
+  }
+
+}
+
+
+// the linear part of the jacobian is the derivative of the position
+TEST_F(Fk_generated_tests, jacobian_finite_differences){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(2);
+  const int nb = pepper::NB_DOFS;
+  const double h = 1e-6;
+
+  for(int sample=0;sample<100;sample++){
+    double q[nb];
+    _random_posture(true,generator,q);
+    double jacobian[6*nb];
+    ASSERT_TRUE(generated_jacobian(true,q,jacobian));
+    for(int j=0;j<nb;j++){
+      double plus[6], minus[6];
+      q[j] += h;
+      generated_forward_kinematics(true,q,&plus[0],&plus[1],&plus[2],&plus[3],&plus[4],&plus[5]);
+      q[j] -= 2*h;
+      generated_forward_kinematics(true,q,&minus[0],&minus[1],&minus[2],&minus[3],&minus[4],&minus[5]);
+      q[j] += h;
+      for(int i=0;i<3;i++) ASSERT_NEAR(jacobian[i*nb+j],(plus[i]-minus[i])/(2*h),1e-6);
+    }
+  }
+
+}
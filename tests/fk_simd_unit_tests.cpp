@@ -0,0 +1,323 @@
+#include "playful_kinematics/fk_simd.h"
+#include "playful_kinematics/fk_simd_kernel.h"
+#include "gtest/gtest.h"
+#include <random>
+#include <cmath>
+
+
+class Fk_simd_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+// rotation (row major) of angle around the unit axis
+static void _rotation(const double *axis, double angle, double *get){
+  double c = cos(angle), s = sin(angle);
+  const double *a = axis;
+  double K[9] = { 0, -a[2], a[1], a[2], 0, -a[0], -a[1], a[0], 0 };
+  for(int i=0;i<3;i++){
+    for(int j=0;j<3;j++){
+      get[i*3+j] = (i==j ? c : 0) + s*K[i*3+j] + (1-c)*a[i]*a[j];
+    }
+  }
+}
+
+
+static void _compose(double *R, double *p, const double *r, const double *t){
+  double result[9];
+  for(int i=0;i<3;i++){
+    for(int j=0;j<3;j++) result[i*3+j] = R[i*3]*r[j]+R[i*3+1]*r[3+j]+R[i*3+2]*r[6+j];
+    p[i] += R[i*3]*t[0]+R[i*3+1]*t[1]+R[i*3+2]*t[2];
+  }
+  for(int i=0;i<9;i++) R[i]=result[i];
+}
+
+
+class synthetic_chain {
+public:
+  std::vector<int> types;
+  std::vector<std::vector<double> > axis, origin, tip_rotation, tip_position;
+  double base_rotation[9];
+  double base_position[3];
+};
+
+
+// random chain of revolute and prismatic joints along random axis, with fixed
+// transforms between them
+static synthetic_chain _random_chain(int nb_joints, std::mt19937 &generator,
+				     playful_kinematics::flat_chain &get_chain){
+
+  std::uniform_real_distribution<double> uniform(-1.0,1.0);
+  synthetic_chain chain;
+
+  double base_axis[3] = {0,0,1};
+  _rotation(base_axis,0.3,chain.base_rotation);
+  for(int i=0;i<3;i++) chain.base_position[i] = 0.1*(i+1);
+  double zero[3] = {0,0,0};
+  get_chain.add_fixed(chain.base_rotation,chain.base_position);
+
+  for(int j=0;j<nb_joints;j++){
+
+    int type = (j%4==3) ? playful_kinematics::PRISMATIC_JOINT : playful_kinematics::REVOLUTE_JOINT;
+    std::vector<double> a(3), o(3), r(9), p(3);
+    double norm = 0;
+    for(int i=0;i<3;i++){ a[i]=uniform(generator); norm+=a[i]*a[i]; }
+    for(int i=0;i<3;i++){ a[i]/=sqrt(norm); o[i]=0.2*uniform(generator); p[i]=0.2*uniform(generator); }
+    double tip_axis[3] = {uniform(generator),uniform(generator),uniform(generator)};
+    norm = sqrt(tip_axis[0]*tip_axis[0]+tip_axis[1]*tip_axis[1]+tip_axis[2]*tip_axis[2]);
+    for(int i=0;i<3;i++) tip_axis[i]/=norm;
+    _rotation(tip_axis,uniform(generator),&r[0]);
+
+    chain.types.push_back(type);
+    chain.axis.push_back(a);
+    chain.origin.push_back(o);
+    chain.tip_rotation.push_back(r);
+    chain.tip_position.push_back(p);
+
+    get_chain.add_joint(type,&a[0],&o[0]);
+    // the tip transform in two fixed transforms, to check they are merged
+    double identity[9] = {1,0,0,0,1,0,0,0,1};
+    get_chain.add_fixed(&r[0],zero);
+    double rt[9];
+    for(int i=0;i<3;i++) for(int k=0;k<3;k++) rt[i*3+k]=r[k*3+i];
+    double p_[3];
+    for(int i=0;i<3;i++) p_[i] = rt[i*3]*p[0]+rt[i*3+1]*p[1]+rt[i*3+2]*p[2];
+    get_chain.add_fixed(identity,p_);
+
+  }
+
+  return chain;
+
+}
+
+
+// forward kinematics with std::sin and std::cos, one transform at a time
+static void _reference(const synthetic_chain &chain, const double *q,
+		       double *get_position, double *get_rotation){
+
+  for(int i=0;i<9;i++) get_rotation[i]=chain.base_rotation[i];
+  for(int i=0;i<3;i++) get_position[i]=chain.base_position[i];
+
+  for(int j=0;j<chain.types.size();j++){
+    double r[9] = {1,0,0,0,1,0,0,0,1};
+    double p[3];
+    if(chain.types[j]==playful_kinematics::REVOLUTE_JOINT){
+      _rotation(&chain.axis[j][0],q[j],r);
+      for(int i=0;i<3;i++) p[i]=chain.origin[j][i];
+    } else {
+      for(int i=0;i<3;i++) p[i]=chain.origin[j][i]+q[j]*chain.axis[j][i];
+    }
+    _compose(get_rotation,get_position,r,p);
+    _compose(get_rotation,get_position,&chain.tip_rotation[j][0],&chain.tip_position[j][0]);
+  }
+
+}
+
+
+TEST_F(Fk_simd_tests, sincos){
+
+  using namespace playful_kinematics;
+
+  double max_error = 0;
+  for(double x=-20;x<20;x+=0.000731){
+    double s,c;
+    _sincos<double,1>(x,s,c);
+    max_error = std::max(max_error,fabs(s-sin(x)));
+    max_error = std::max(max_error,fabs(c-cos(x)));
+  }
+  ASSERT_LT(max_error,1e-15);
+
+}
+
+
+TEST_F(Fk_simd_tests, scalar_matches_reference){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(-M_PI,M_PI);
+
+  flat_chain chain;
+  synthetic_chain reference = _random_chain(8,generator,chain);
+  ASSERT_EQ(chain.get_nb_joints(),8);
+
+  int nb = 50;
+  std::vector<double> q(8*nb);
+  for(int i=0;i<q.size();i++) q[i]=uniform(generator);
+  std::vector<double> positions(3*nb), rotations(9*nb);
+  forward_kinematics_lanes(chain,nb,&q[0],&positions[0],&rotations[0],SIMD_SCALAR);
+
+  for(int i=0;i<nb;i++){
+    double qi[8], p[3], r[9];
+    for(int j=0;j<8;j++) qi[j]=q[j*nb+i];
+    _reference(reference,qi,p,r);
+    for(int k=0;k<3;k++) ASSERT_NEAR(positions[k*nb+i],p[k],1e-12);
+    for(int k=0;k<9;k++) ASSERT_NEAR(rotations[k*nb+i],r[k],1e-12);
+  }
+
+}
+
+
+TEST_F(Fk_simd_tests, lanes_match_scalar){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<double> uniform(-M_PI,M_PI);
+
+  flat_chain chain;
+  _random_chain(7,generator,chain);
+
+  // not a multiple of the number of lanes, for the remaining postures
+  int nb = 37;
+  std::vector<double> q(7*nb);
+  for(int i=0;i<q.size();i++) q[i]=uniform(generator);
+
+  std::vector<double> positions(3*nb), rotations(9*nb);
+  forward_kinematics_lanes(chain,nb,&q[0],&positions[0],&rotations[0],SIMD_SCALAR);
+
+  for(int level=SIMD_AVX2;level<=SIMD_AUTO;level++){
+    std::vector<double> p(3*nb), r(9*nb);
+    forward_kinematics_lanes(chain,nb,&q[0],&p[0],&r[0],(simd_level)level);
+    for(int i=0;i<p.size();i++) ASSERT_NEAR(p[i],positions[i],1e-13) << get_simd_name((simd_level)level);
+    for(int i=0;i<r.size();i++) ASSERT_NEAR(r[i],rotations[i],1e-13) << get_simd_name((simd_level)level);
+  }
+
+}
+
+
+TEST_F(Fk_simd_tests, fixed_size_matches_lanes){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<double> uniform(-M_PI,M_PI);
+
+  flat_chain chain;
+  _random_chain(6,generator,chain);
+
+  for(int r=0;r<10;r++){
+
+    double q[6];
+    for(int i=0;i<6;i++) q[i]=uniform(generator);
+
+    double positions[3], rotations[9];
+    forward_kinematics_lanes(chain,1,q,positions,rotations,SIMD_SCALAR);
+
+    double position[3], rotation[9];
+    forward_kinematics<6>(chain,q,position,rotation);
+
+    for(int i=0;i<3;i++) ASSERT_NEAR(position[i],positions[i],1e-14);
+    for(int i=0;i<9;i++) ASSERT_NEAR(rotation[i],rotations[i],1e-14);
+
+  }
+
+}
+
+
+TEST_F(Fk_simd_tests, folded_joints_match_full_chain){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(4);
+  std::uniform_real_distribution<double> uniform(-M_PI,M_PI);
+
+  flat_chain chain;
+  _random_chain(8,generator,chain);
+
+  // first, a middle revolute, the prismatic and the last joints frozen
+  bool folded[8] = {true,false,false,true,true,false,false,true};
+  std::vector<bool> fold(folded,folded+8);
+
+  double frozen[8];
+  for(int i=0;i<8;i++) frozen[i]=uniform(generator);
+  flat_chain free_chain = chain.fold_joints(fold,frozen);
+  ASSERT_EQ(free_chain.get_nb_joints(),4);
+
+  for(int r=0;r<10;r++){
+
+    double q[8], q_free[4];
+    int nb_free = 0;
+    for(int i=0;i<8;i++){
+      q[i] = fold[i] ? frozen[i] : uniform(generator);
+      if(!fold[i]) q_free[nb_free++]=q[i];
+    }
+
+    double position[3], rotation[9];
+    forward_kinematics<8>(chain,q,position,rotation);
+
+    double free_position[3], free_rotation[9];
+    forward_kinematics(free_chain,q_free,free_position,free_rotation);
+
+    for(int i=0;i<3;i++) ASSERT_NEAR(position[i],free_position[i],1e-12);
+    for(int i=0;i<9;i++) ASSERT_NEAR(rotation[i],free_rotation[i],1e-12);
+
+  }
+
+}
+
+
+TEST_F(Fk_simd_tests, frames_match_sub_chains){
+
+  using namespace playful_kinematics;
+
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<double> uniform(-M_PI,M_PI);
+
+  flat_chain chain;
+  synthetic_chain reference = _random_chain(7,generator,chain);
+
+  double q[7];
+  for(int i=0;i<7;i++) q[i]=uniform(generator);
+
+  double position[3], rotation[9], frames[21];
+  forward_kinematics<7>(chain,q,position,rotation,frames);
+
+  double dynamic_position[3], dynamic_rotation[9], dynamic_frames[21];
+  forward_kinematics(chain,q,dynamic_position,dynamic_rotation,dynamic_frames);
+
+  double plain_position[3], plain_rotation[9];
+  forward_kinematics<7>(chain,q,plain_position,plain_rotation);
+  for(int i=0;i<3;i++) ASSERT_EQ(position[i],plain_position[i]);
+  for(int i=0;i<9;i++) ASSERT_EQ(rotation[i],plain_rotation[i]);
+
+  // frame j: end effector of the chain of the first j+1 joints
+  for(int j=0;j<7;j++){
+    synthetic_chain sub = reference;
+    sub.types.resize(j+1);
+    double p[3], r[9];
+    _reference(sub,q,p,r);
+    for(int i=0;i<3;i++) ASSERT_NEAR(frames[j*3+i],p[i],1e-12);
+    for(int i=0;i<3;i++) ASSERT_EQ(dynamic_frames[j*3+i],frames[j*3+i]);
+  }
+  for(int i=0;i<3;i++) ASSERT_EQ(frames[18+i],position[i]);
+
+}
+
+
+TEST_F(Fk_simd_tests, rpy){
+
+  using namespace playful_kinematics;
+
+  double x[3] = {1,0,0}, y[3] = {0,1,0}, z[3] = {0,0,1};
+  double roll = 0.3, pitch = -0.7, yaw = 1.9;
+
+  // as KDL::Rotation::RPY: rotation around z (yaw), then y (pitch), then x (roll)
+  double rotation[9], r[9];
+  double position[3] = {0,0,0}, t[3] = {0,0,0};
+  _rotation(z,yaw,rotation);
+  _rotation(y,pitch,r);
+  _compose(rotation,position,r,t);
+  _rotation(x,roll,r);
+  _compose(rotation,position,r,t);
+
+  double get_roll, get_pitch, get_yaw;
+  get_rpy(rotation,&get_roll,&get_pitch,&get_yaw);
+  ASSERT_NEAR(get_roll,roll,1e-12);
+  ASSERT_NEAR(get_pitch,pitch,1e-12);
+  ASSERT_NEAR(get_yaw,yaw,1e-12);
+
+}
@@ -0,0 +1,141 @@
+#include "playful_kinematics/fused_score.h"
+#include "gtest/gtest.h"
+#include <cmath>
+
+
+class Fused_score_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+static const double LINK_LENGTH = 0.3;
+
+
+// planar arm of 3 revolute joints around z, links of LINK_LENGTH along x
+static playful_kinematics::flat_chain _planar_arm(){
+  playful_kinematics::flat_chain chain;
+  double axis[3] = {0,0,1};
+  double origin[3] = {0,0,0};
+  double identity[9] = {1,0,0,0,1,0,0,0,1};
+  double link[3] = {LINK_LENGTH,0,0};
+  for(int j=0;j<3;j++){
+    chain.add_joint(playful_kinematics::REVOLUTE_JOINT,axis,origin);
+    chain.add_fixed(identity,link);
+  }
+  return chain;
+}
+
+
+static playful_kinematics::ik_plan _plan(const std::vector<float> &reference){
+  using namespace playful_kinematics;
+  ik_plan plan;
+  plan.left = true;
+  plan.mask = std::vector<bool>(6,false);
+  plan.mask[0] = plan.mask[1] = true;
+  plan.reference_posture = reference;
+  plan.min.assign(3,-M_PI);
+  plan.max.assign(3,M_PI);
+  plan.search = ADAPTIVE_LINE_SEARCH;
+  compile_frozen_joints(plan,std::vector<int>(3,1),NULL);
+  return plan;
+}
+
+
+TEST_F(Fused_score_tests, terms){
+
+  using namespace playful_kinematics;
+
+  flat_chain chain = _planar_arm();
+  std::vector<bool> mask(6,false);
+  mask[0] = mask[1] = true;
+
+  fused_score<POSE_TERM|POSTURE_TERM|LIMIT_TERM|LINK_TERM> score(true,mask,0.9,0,0,0,0,0);
+  score.set_chain(&chain);
+  score.set_pose_weight(2);
+  score.set_posture_term(std::vector<float>(3,0.1f),0.5);
+  score.set_limit_term(std::vector<float>(3,-1),std::vector<float>(3,1),0.2,3);
+  // frame of the first link at (LINK_LENGTH*cos(q0),LINK_LENGTH*sin(q0)), 0.05 from the point
+  link_penalty penalty = {0,{LINK_LENGTH,0.05,0},{LINK_LENGTH,0.05,0},0.1,4};
+  score.add_link_penalty(penalty);
+
+  // first joint 0.1 from its limit
+  std::vector<float> posture(3,0);
+  posture[0] = 0.9;
+  fused_score_terms terms;
+  float value = score.get_terms(posture,terms);
+
+  double x = LINK_LENGTH*(cos(0.9)+2*cos(0.9)), y = LINK_LENGTH*(sin(0.9)+2*sin(0.9));
+  double pose_error = sqrt((x-0.9)*(x-0.9)+y*y);
+  ASSERT_NEAR(score.get_pose_error(posture),pose_error,1e-5);
+  ASSERT_NEAR(terms.pose,2*pose_error,1e-5);
+  ASSERT_NEAR(terms.posture,0.5*(0.8*0.8+0.1*0.1+0.1*0.1),1e-5);
+  ASSERT_NEAR(terms.limit,3*0.5*0.5,1e-5);
+  double ex = LINK_LENGTH*cos(0.9)-LINK_LENGTH, ey = LINK_LENGTH*sin(0.9)-0.05;
+  double d = sqrt(ex*ex+ey*ey);
+  ASSERT_NEAR(terms.link,d<0.1 ? 4*pow((0.1-d)/0.1,2) : 0,1e-5);
+  ASSERT_NEAR(value,terms.pose+terms.posture+terms.limit+terms.link,1e-5);
+
+  // first link on the point
+  posture[0] = atan2(0.05,LINK_LENGTH);
+  score.get_terms(posture,terms);
+  ASSERT_NEAR(terms.link,4*pow((0.1-(sqrt(LINK_LENGTH*LINK_LENGTH+0.05*0.05)-LINK_LENGTH))/0.1,2),1e-5);
+
+  // fixed size postures: same score
+  fixed_posture<3> fixed;
+  for(int i=0;i<3;i++) fixed[i]=posture[i];
+  fused_score_terms fixed_terms;
+  ASSERT_NEAR(score.get_terms(fixed,fixed_terms),score(posture),1e-6);
+  ASSERT_NEAR(fixed_terms.link,terms.link,1e-6);
+
+}
+
+
+TEST_F(Fused_score_tests, secondary_objectives){
+
+  using namespace playful_kinematics;
+
+  flat_chain chain = _planar_arm();
+  std::vector<float> reference(3,0.3f);
+  ik_plan plan = _plan(reference);
+
+  // reachable by many postures of the (redundant) arm
+  float target_x = 0.5, target_y = 0.4;
+
+  fused_score<POSE_TERM> pose(true,plan.mask,target_x,target_y,0,0,0,0);
+  pose.set_chain(&chain);
+  std::vector<float> posture(3);
+  float value;
+  ASSERT_TRUE(ik(plan,pose,posture,value));
+
+  fused_score<POSE_TERM|POSTURE_TERM> regularized(true,plan.mask,target_x,target_y,0,0,0,0);
+  regularized.set_chain(&chain);
+  regularized.set_posture_term(reference,0.001);
+  fixed_posture<3> regularized_posture;
+  ASSERT_TRUE(ik(plan,regularized,regularized_posture,value));
+
+  double distance = 0, regularized_distance = 0;
+  for(int i=0;i<3;i++){
+    distance += pow(posture[i]-reference[i],2);
+    regularized_distance += pow(regularized_posture[i]-reference[i],2);
+  }
+  ASSERT_LE(regularized_distance,distance+1e-6);
+
+  // the frame of the second link (the "elbow") moved out of the penalty region
+  fused_score<LINK_TERM> away(true,plan.mask,target_x,target_y,0,0,0,0);
+  away.set_chain(&chain);
+  double elbow[2] = {LINK_LENGTH*(cos(0.3)+cos(0.6)),LINK_LENGTH*(sin(0.3)+sin(0.6))};
+  link_penalty penalty = {1,{elbow[0]+0.02,elbow[1],-1},{elbow[0]+0.02,elbow[1],1},0.1,1};
+  away.add_link_penalty(penalty);
+  fused_score_terms terms;
+  std::vector<float> away_posture(reference);
+  away.get_terms(away_posture,terms);
+  ASSERT_GT(terms.link,0.5);
+  playful_kinematics::minimize(away_posture,plan.minimization_order,plan.min,plan.max,
+			       0.001,0.1,0.001,15,away,value,plan.search);
+  away.get_terms(away_posture,terms);
+  ASSERT_LT(terms.link,0.001);
+
+}
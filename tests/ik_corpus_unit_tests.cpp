@@ -0,0 +1,154 @@
+#include "playful_kinematics/ik_corpus.h"
+#include "playful_kinematics/pepper_ik_corpus.h"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <limits>
+
+
+class IK_corpus_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+TEST_F(IK_corpus_tests, seeded_targets_written_exactly){
+
+  using namespace playful_kinematics;
+
+  ik_corpus corpus, same;
+  configure_pepper_ik_corpus(corpus);
+  configure_pepper_ik_corpus(same);
+  generate_ik_corpus(36,7,corpus);
+  generate_ik_corpus(36,7,same);
+
+  int nb_kinds[NB_IK_TARGET_KINDS] = {0,0,0};
+  int nb_left = 0, nb_full = 0;
+  for(int e=0;e<corpus.entries.size();e++){
+    const ik_corpus_entry &entry = corpus.entries[e];
+    nb_kinds[entry.kind]++;
+    if(entry.left) nb_left++;
+    if(entry.mask[3] && entry.mask[4] && entry.mask[5]) nb_full++;
+    for(int i=0;i<6;i++) ASSERT_EQ(entry.target[i],same.entries[e].target[i]);
+    corpus.entries[e].golden.success = (e%2==0);
+    corpus.entries[e].golden.score = 0.1f/(e+1);
+    corpus.entries[e].golden.nb_evaluations = e;
+    corpus.entries[e].golden.posture.assign(pepper::NB_DOFS,1.0f/(e+3));
+  }
+  for(int k=0;k<NB_IK_TARGET_KINDS;k++) ASSERT_EQ(nb_kinds[k],12);
+  ASSERT_EQ(nb_left,18);
+  ASSERT_EQ(nb_full,12);
+
+  std::string path = "/tmp/playful_kinematics_ik_corpus_unit_tests.txt";
+  ASSERT_TRUE(write_ik_corpus(path,corpus));
+  ik_corpus read;
+  ASSERT_TRUE(read_ik_corpus(path,read));
+  std::remove(path.c_str());
+
+  ASSERT_EQ(read.version,IK_CORPUS_VERSION);
+  ASSERT_EQ(read.seed,7);
+  ASSERT_EQ(read.minimization_priority,corpus.minimization_priority);
+  for(int side=0;side<2;side++){
+    ASSERT_EQ(read.sides[side].reference_posture,corpus.sides[side].reference_posture);
+    ASSERT_EQ(read.sides[side].min,corpus.sides[side].min);
+    ASSERT_EQ(read.sides[side].max,corpus.sides[side].max);
+  }
+  ASSERT_EQ(read.entries.size(),corpus.entries.size());
+  for(int e=0;e<corpus.entries.size();e++){
+    const ik_corpus_entry &entry = corpus.entries[e];
+    ASSERT_EQ(read.entries[e].kind,entry.kind);
+    ASSERT_EQ(read.entries[e].left,entry.left);
+    ASSERT_EQ(read.entries[e].mask,entry.mask);
+    for(int i=0;i<6;i++) ASSERT_EQ(read.entries[e].target[i],entry.target[i]);
+    ASSERT_EQ(read.entries[e].golden.success,entry.golden.success);
+    ASSERT_EQ(read.entries[e].golden.score,entry.golden.score);
+    ASSERT_EQ(read.entries[e].golden.nb_evaluations,entry.golden.nb_evaluations);
+    ASSERT_EQ(read.entries[e].golden.posture,entry.golden.posture);
+  }
+
+}
+
+
+TEST_F(IK_corpus_tests, report_detects_regressions){
+
+  using namespace playful_kinematics;
+
+  ik_corpus corpus;
+  configure_pepper_ik_corpus(corpus);
+  generate_ik_corpus(30,0,corpus);
+
+  std::vector<ik_corpus_result> results(corpus.entries.size());
+  for(int e=0;e<results.size();e++){
+    results[e].success = (corpus.entries[e].kind==REACHABLE_TARGET);
+    results[e].score = results[e].success ? 0.0005f : 0.5f;
+    results[e].nb_evaluations = 100;
+  }
+  set_ik_corpus_golden(results,corpus);
+
+  ik_corpus_report golden = get_ik_corpus_report(corpus,results);
+  ASSERT_EQ(golden.nb_solved,30);
+  ASSERT_NEAR(golden.get_success_rate(),1.0/3.0,1e-9);
+  ASSERT_EQ(golden.get_success_rate(REACHABLE_TARGET),1.0);
+  ASSERT_TRUE(check_ik_corpus_report(golden,golden));
+
+  // one reachable target lost
+  std::vector<ik_corpus_result> lost(results);
+  lost[0].success = false;
+  lost[0].score = 0.01f;
+  ik_corpus_report report = get_ik_corpus_report(corpus,lost);
+  ASSERT_EQ(report.nb_lost,1);
+  ASSERT_EQ(report.nb_worse,1);
+  ASSERT_FALSE(check_ik_corpus_report(report,golden));
+
+  // evaluations growing beyond the tolerance
+  std::vector<ik_corpus_result> slower(results);
+  for(int e=0;e<slower.size();e++) slower[e].nb_evaluations = 120;
+  report = get_ik_corpus_report(corpus,slower);
+  ASSERT_FALSE(check_ik_corpus_report(report,golden));
+  ik_corpus_tolerance reported_only;
+  reported_only.check_evaluations = false;
+  ASSERT_TRUE(check_ik_corpus_report(report,golden,reported_only));
+
+  // targets not solved (e.g. masks not supported by the KDL baseline) are not reported
+  results[1].score = std::numeric_limits<float>::quiet_NaN();
+  report = get_ik_corpus_report(corpus,results);
+  ASSERT_EQ(report.nb_solved,29);
+
+}
+
+
+// replays the golden corpus (see pepper_ik_corpus, src/ik_corpus_tool.cpp)
+TEST_F(IK_corpus_tests, golden_corpus){
+
+  using namespace playful_kinematics;
+
+  // the corpus is versioned with the sources: generate it again with
+  // pepper_ik_corpus generate (only) when a change of ik is intended
+  std::string path = IK_CORPUS_PATH;
+  ik_corpus corpus;
+  ASSERT_TRUE(read_ik_corpus(path,corpus)) << "no golden ik corpus at " << path;
+  ASSERT_GT(corpus.entries.size(),0);
+
+  std::vector<ik_corpus_result> results;
+  get_ik_corpus_golden(corpus,results);
+  ik_corpus_report golden = get_ik_corpus_report(corpus,results);
+  golden.print("golden");
+
+  replay_ik_corpus(corpus,results);
+  ik_corpus_report report = get_ik_corpus_report(corpus,results);
+  report.print("ik");
+
+  std::vector<ik_corpus_result> kdl_results;
+  replay_ik_corpus_kdl(corpus,kdl_results);
+  ik_corpus_report kdl_report = get_ik_corpus_report(corpus,kdl_results);
+  kdl_report.print("KDL ChainIkSolverPos_NR_JL (full masks only)");
+
+  // the golden results were not computed with the KDL and kdl_parser of this build
+  // (see README.md): the evaluation counts, which depend on the exact path of each
+  // minimization, are only reported
+  ik_corpus_tolerance tolerance;
+  tolerance.check_evaluations = false;
+  ASSERT_TRUE(check_ik_corpus_report(report,golden,tolerance));
+
+}
@@ -0,0 +1,145 @@
+#include "playful_kinematics/ik_path.h"
+#include "gtest/gtest.h"
+#include <cmath>
+
+
+// interface for the python wrapper (ik_path.cpp)
+extern "C" {
+  bool ik_path(bool left, bool *mask, int nb_dofs, float *reference_posture,
+	       int nb_waypoints, float *waypoints,
+	       float *postures, float *scores, bool *success,
+	       int nb_threads);
+}
+
+
+class Ik_path_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+// planar arm of 3 revolute joints around z, links of 0.3 along x
+static boost::shared_ptr<const playful_kinematics::flat_chain> _planar_arm(){
+  playful_kinematics::flat_chain *chain = new playful_kinematics::flat_chain();
+  double axis[3] = {0,0,1};
+  double origin[3] = {0,0,0};
+  double identity[9] = {1,0,0,0,1,0,0,0,1};
+  double link[3] = {0.3,0,0};
+  for(int j=0;j<3;j++){
+    chain->add_joint(playful_kinematics::REVOLUTE_JOINT,axis,origin);
+    chain->add_fixed(identity,link);
+  }
+  return boost::shared_ptr<const playful_kinematics::flat_chain>(chain);
+}
+
+
+// plan of the planar arm (x and y), the arm being scored as the free chain of the
+// plan instead of the chain of the robot
+static playful_kinematics::ik_plan _plan(){
+  using namespace playful_kinematics;
+  ik_plan plan;
+  plan.left = true;
+  plan.mask = std::vector<bool>(6,false);
+  plan.mask[0] = plan.mask[1] = true;
+  plan.reference_posture.assign(3,0.5);
+  plan.min.assign(3,-M_PI);
+  plan.max.assign(3,M_PI);
+  plan.search = FIXED_STEP_LINE_SEARCH;
+  compile_frozen_joints(plan,std::vector<int>(3,1),NULL);
+  plan.free_chain = _planar_arm();
+  return plan;
+}
+
+
+// circle of nb waypoints around (0.45,0.2)
+static std::vector<float> _circle(int nb){
+  std::vector<float> waypoints;
+  for(int w=0;w<nb;w++){
+    float a = 2*M_PI*w/nb;
+    float target[6] = {0.45f+0.2f*(float)cos(a),0.2f+0.2f*(float)sin(a),0,0,0,0};
+    waypoints.insert(waypoints.end(),target,target+6);
+  }
+  return waypoints;
+}
+
+
+TEST_F(Ik_path_tests, count_discontinuities){
+
+  float postures[8] = {0,0, 0.01,0, 0.2,0, 0.2,-0.2};
+  std::vector<float> p(postures,postures+8);
+  ASSERT_EQ(playful_kinematics::count_discontinuities(p,2,0.05),2);
+  ASSERT_EQ(playful_kinematics::count_discontinuities(p,2,0.5),0);
+
+}
+
+
+TEST_F(Ik_path_tests, continuous_trajectory){
+
+  using namespace playful_kinematics;
+
+  ik_plan plan = _plan();
+  std::vector<float> waypoints = _circle(1000);
+
+  // serial: each waypoint from the posture of the previous one
+  ik_path_parameters serial;
+  serial.nb_threads = 1;
+  serial.nb_segments = 1;
+  std::vector<float> postures, scores;
+  std::vector<bool> success;
+  ik_path_statistics statistics;
+  ASSERT_TRUE(solve_ik_path(plan,waypoints,postures,scores,success,serial,&statistics));
+  ASSERT_EQ(statistics.nb_segments,1);
+  ASSERT_EQ(statistics.nb_repaired_boundaries,0);
+  ASSERT_EQ(postures.size(),3*1000);
+
+  // segments solved in parallel, each starting from the reference posture: the
+  // boundaries are repaired
+  ik_path_parameters parallel;
+  parallel.nb_threads = 4;
+  parallel.nb_segments = 16;
+  ASSERT_TRUE(solve_ik_path(plan,waypoints,postures,scores,success,parallel,&statistics));
+  ASSERT_EQ(statistics.nb_threads,4);
+  ASSERT_EQ(statistics.nb_segments,16);
+  ASSERT_GT(statistics.nb_repaired_boundaries,0);
+  ASSERT_EQ(statistics.nb_failures,0);
+  ASSERT_EQ(count_discontinuities(postures,3,parallel.max_joint_step),0);
+  for(int w=0;w<1000;w++){
+    ASSERT_TRUE(success[w]);
+    ASSERT_LE(scores[w],plan.profile.target_score);
+  }
+
+  // short path: a single segment
+  std::vector<float> short_path(waypoints.begin(),waypoints.begin()+6*10);
+  ASSERT_TRUE(solve_ik_path(plan,short_path,postures,scores,success,parallel,&statistics));
+  ASSERT_EQ(statistics.nb_segments,1);
+  ASSERT_EQ(success.size(),10);
+
+}
+
+
+TEST_F(Ik_path_tests, interface_reference_posture){
+
+  using namespace playful_kinematics;
+
+  int nb_dofs = get_nb_joints(true);
+  bool mask[6] = {true,true,true,false,false,false};
+  std::vector<float> waypoints = _circle(4);
+  std::vector<float> reference(nb_dofs,0);
+  std::vector<float> postures(4*nb_dofs,1);
+  float scores[4];
+  bool success[4];
+
+  // limits of the configuration not set: the joints stay at the reference posture
+  ik_path(true,mask,nb_dofs,reference.data(),4,waypoints.data(),postures.data(),scores,success,1);
+  for(int i=0;i<postures.size();i++) ASSERT_EQ(postures[i],0);
+
+  // another number of joints than the end effector
+  ASSERT_FALSE(ik_path(true,mask,nb_dofs-1,reference.data(),4,waypoints.data(),postures.data(),scores,success,1));
+  for(int w=0;w<4;w++){
+    ASSERT_FALSE(success[w]);
+    ASSERT_EQ(scores[w],std::numeric_limits<float>::max());
+  }
+
+}
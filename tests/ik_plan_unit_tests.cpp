@@ -0,0 +1,291 @@
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <atomic>
+
+
+// interface for the python wrapper (ik.cpp)
+extern "C" {
+  bool ik_ndofs(bool left, float target_x, float target_y, float target_z,
+		float target_alpha, float target_beta, float target_gamma,
+		int nb_dofs, float *posture, float *get_score);
+}
+
+
+class IK_plan_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+static void _configure(){
+
+  using namespace playful_kinematics;
+
+  set_kinematics_joints(std::vector<float>(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS));
+  set_kinematics_side(true);
+  set_kinematics_mask(std::vector<bool>(6,true));
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    set_kinematics_joint_limit(i,pepper::LEFT_MIN[i],pepper::LEFT_MAX[i]);
+    set_minimization_priority(i,pepper::MINIMIZATION_PRIORITY[i]);
+  }
+
+}
+
+
+TEST_F(IK_plan_tests, compiled_configuration){
+
+  using namespace playful_kinematics;
+
+  _configure();
+
+  boost::shared_ptr<const ik_plan> plan = get_ik_plan();
+  ASSERT_EQ(plan->version,get_kinematics_config_version());
+  ASSERT_TRUE(plan->left);
+  ASSERT_EQ(plan->reference_posture.size(),pepper::NB_DOFS);
+  ASSERT_EQ(plan->min.size(),pepper::NB_DOFS);
+  ASSERT_EQ(plan->max.size(),pepper::NB_DOFS);
+
+  int nb_indexes = 0;
+  int previous_priority = -1;
+  for(int g=0;g<plan->minimization_order.size();g++){
+    int priority = pepper::MINIMIZATION_PRIORITY[plan->minimization_order[g][0]];
+    ASSERT_TRUE(priority>previous_priority);
+    for(int i=0;i<plan->minimization_order[g].size();i++){
+      int index = plan->minimization_order[g][i];
+      ASSERT_EQ(pepper::MINIMIZATION_PRIORITY[index],priority);
+      ASSERT_EQ(plan->min[index],pepper::LEFT_MIN[index]);
+      ASSERT_EQ(plan->max[index],pepper::LEFT_MAX[index]);
+      nb_indexes++;
+    }
+    previous_priority = priority;
+  }
+  ASSERT_EQ(nb_indexes,pepper::NB_DOFS);
+
+}
+
+
+TEST_F(IK_plan_tests, plan_of_a_call){
+
+  using namespace playful_kinematics;
+
+  _configure();
+  unsigned long version = get_kinematics_config_version();
+
+  // other side, mask and reference posture, the configuration being unchanged
+  std::vector<bool> mask(6,false);
+  mask[0] = true;
+  std::vector<float> reference(pepper::NB_DOFS,0.1);
+  boost::shared_ptr<const ik_plan> plan = make_ik_plan(false,mask,reference);
+  ASSERT_FALSE(plan->left);
+  ASSERT_EQ(plan->mask,mask);
+  ASSERT_EQ(plan->reference_posture,reference);
+  ASSERT_EQ(plan->min,get_ik_plan()->min);
+  ASSERT_EQ(plan->minimization_order,get_ik_plan()->minimization_order);
+  ASSERT_EQ(get_kinematics_config_version(),version);
+  ASSERT_TRUE(get_ik_plan()->left);
+  ASSERT_EQ(get_ik_plan()->reference_posture[0],pepper::LEFT_REFERENCE[0]);
+
+  // fewer joints: compiled with the limits of these joints
+  reference.resize(3);
+  plan = make_ik_plan(true,mask,reference);
+  ASSERT_EQ(plan->reference_posture.size(),3);
+  ASSERT_EQ(plan->min.size(),3);
+  for(int i=0;i<3;i++) ASSERT_EQ(plan->max[i],pepper::LEFT_MAX[i]);
+  ASSERT_EQ(get_kinematics_config_version(),version);
+
+}
+
+
+TEST_F(IK_plan_tests, plan_of_a_call_compiled_once){
+
+  using namespace playful_kinematics;
+
+  _configure();
+  set_kinematics_joint_limit(1,0.2,0.2);
+
+  // the plan of the side is compiled when the configuration is published
+  std::vector<float> reference(pepper::NB_DOFS,0.1);
+  boost::shared_ptr<const ik_plan> first = make_ik_plan(false,std::vector<bool>(6,true),reference);
+  boost::shared_ptr<const ik_plan> second = make_ik_plan(false,std::vector<bool>(6,true),reference);
+  ASSERT_EQ(first->free_joints.size(),pepper::NB_DOFS-1);
+  ASSERT_EQ(first->free_chain.get(),second->free_chain.get());
+
+  // postures of another number of joints than the chain are rejected
+  float posture[3] = {0,0,0};
+  float score = 0;
+  ASSERT_FALSE(ik_ndofs(false,0.2,-0.15,0.9,0,0,0,3,posture,&score));
+  ASSERT_EQ(score,std::numeric_limits<float>::max());
+
+  set_kinematics_joint_limit(1,pepper::LEFT_MIN[1],pepper::LEFT_MAX[1]);
+
+}
+
+
+TEST_F(IK_plan_tests, score_function_of_the_configuration){
+
+  using namespace playful_kinematics;
+
+  _configure();
+
+  // new thread: neither target nor score configuration set on it
+  std::vector<float> posture(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  float unset_score = 0;
+  float score = -1;
+  std::thread thread([&posture,&unset_score,&score](){
+      unset_score = at_desired_cartesian_position(posture);
+      double q[pepper::NB_DOFS];
+      for(int i=0;i<pepper::NB_DOFS;i++) q[i]=posture[i];
+      double c[6];
+      forward_kinematics(true,q,&c[0],&c[1],&c[2],&c[3],&c[4],&c[5]);
+      set_target_cartesian_position(c[0],c[1],c[2],c[3],c[4],c[5]);
+      score = at_desired_cartesian_position(posture);
+    });
+  thread.join();
+
+  ASSERT_EQ(unset_score,std::numeric_limits<float>::max());
+  ASSERT_NEAR(score,0,1e-4);
+
+}
+
+
+TEST_F(IK_plan_tests, compiled_only_on_change){
+
+  using namespace playful_kinematics;
+
+  _configure();
+
+  boost::shared_ptr<const ik_plan> plan = get_ik_plan();
+  unsigned long version = get_kinematics_config_version();
+
+  // same configuration: same plan
+  _configure();
+  ASSERT_EQ(get_kinematics_config_version(),version);
+  ASSERT_EQ(get_ik_plan().get(),plan.get());
+
+  // each change: new version and new plan
+  set_kinematics_joint_limit(0,pepper::LEFT_MIN[0],0);
+  ASSERT_TRUE(get_kinematics_config_version()>version);
+  boost::shared_ptr<const ik_plan> changed = get_ik_plan();
+  ASSERT_NE(changed.get(),plan.get());
+  ASSERT_EQ(changed->max[0],0);
+  // the previous plan is not modified
+  ASSERT_EQ(plan->max[0],pepper::LEFT_MAX[0]);
+
+  version = get_kinematics_config_version();
+  set_minimization_priority(0,10);
+  ASSERT_TRUE(get_kinematics_config_version()>version);
+  changed = get_ik_plan();
+  ASSERT_EQ(changed->minimization_order.back().size(),1);
+  ASSERT_EQ(changed->minimization_order.back()[0],0);
+
+  version = get_kinematics_config_version();
+  set_kinematics_line_search(ADAPTIVE_LINE_SEARCH);
+  ASSERT_TRUE(get_kinematics_config_version()>version);
+  ASSERT_EQ(get_ik_plan()->search,ADAPTIVE_LINE_SEARCH);
+  set_kinematics_line_search(FIXED_STEP_LINE_SEARCH);
+
+}
+
+
+TEST_F(IK_plan_tests, same_solution_as_explicit_configuration){
+
+  using namespace playful_kinematics;
+
+  _configure();
+
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<int> priority(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+  std::map<int,float> min,max;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    min[i]=pepper::LEFT_MIN[i];
+    max[i]=pepper::LEFT_MAX[i];
+  }
+
+  boost::shared_ptr<const ik_plan> plan = get_ik_plan();
+
+  float targets[3][6] = { {0.2,0.15,0.9,0,0,0},
+			  {0.1,0.3,0.7,0.5,0,0},
+			  {0.25,0.0,1.0,0,0.3,0} };
+
+  for(int t=0;t<3;t++){
+
+    const float *c = targets[t];
+
+    std::vector<float> posture,plan_posture;
+    float score,plan_score;
+
+    bool success = ik(true,plan->mask,reference,priority,min,max,
+		      c[0],c[1],c[2],c[3],c[4],c[5],posture,score);
+    bool plan_success = ik(*plan,c[0],c[1],c[2],c[3],c[4],c[5],plan_posture,plan_score);
+
+    ASSERT_EQ(success,plan_success);
+    ASSERT_EQ(score,plan_score);
+    for(int i=0;i<pepper::NB_DOFS;i++) ASSERT_EQ(posture[i],plan_posture[i]);
+
+  }
+
+}
+
+
+TEST_F(IK_plan_tests, concurrent_updates){
+
+  using namespace playful_kinematics;
+
+  _configure();
+  set_kinematics_joint_limit(0,0,0);
+  set_kinematics_joint_limit(1,0,0);
+
+  std::atomic<bool> running(true);
+
+  // each update sets the same limits to joints 0 and 1, and publishes them at once
+  std::thread writer([&running](){
+      for(int u=1;u<=2000;u++){
+	float value = 0.0001*u;
+	begin_kinematics_config_update();
+	set_kinematics_joint_limit(0,-value,value);
+	set_kinematics_joint_limit(1,-value,value);
+	end_kinematics_config_update();
+      }
+      running = false;
+    });
+
+  long nb_plans = 0;
+  long nb_inconsistent = 0;
+  long nb_modified = 0;
+  long nb_older = 0;
+  unsigned long previous_version = 0;
+
+  while(running){
+
+    boost::shared_ptr<const ik_plan> plan = get_ik_plan();
+
+    // never partially updated
+    if(plan->max[0]!=plan->max[1] || plan->min[0]!=-plan->max[0]) nb_inconsistent++;
+
+    // pinned plan not modified by later updates
+    float max = plan->max[0];
+    std::this_thread::yield();
+    if(plan->max[0]!=max) nb_modified++;
+
+    if(plan->version<previous_version) nb_older++;
+    previous_version = plan->version;
+    nb_plans++;
+
+  }
+
+  writer.join();
+
+  ASSERT_TRUE(nb_plans>0);
+  ASSERT_EQ(nb_inconsistent,0);
+  ASSERT_EQ(nb_modified,0);
+  ASSERT_EQ(nb_older,0);
+  ASSERT_NEAR(get_ik_plan()->max[0],0.2,1e-6);
+
+  _configure();
+
+}
@@ -0,0 +1,148 @@
+#include "playful_kinematics/ik_ring.h"
+#include "playful_kinematics/ik.h"
+#include "gtest/gtest.h"
+
+
+class IK_ring_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+typedef playful_kinematics::spsc_ring<int,8> int_ring;
+
+
+TEST_F(IK_ring_tests, full_and_empty){
+
+  int_ring ring;
+  ring.init();
+
+  int value;
+  ASSERT_FALSE(ring.pop(value));
+
+  for(int i=0;i<8;i++) ASSERT_TRUE(ring.push(i));
+  ASSERT_FALSE(ring.push(8));
+  ASSERT_EQ(ring.size(),8);
+
+  for(int i=0;i<8;i++){
+    ASSERT_TRUE(ring.pop(value));
+    ASSERT_EQ(value,i);
+  }
+  ASSERT_FALSE(ring.pop(value));
+
+}
+
+
+TEST_F(IK_ring_tests, concurrent_order){
+
+  int_ring ring;
+  ring.init();
+
+  const int nb = 200000;
+
+  std::thread producer([&ring,nb](){
+      for(int i=0;i<nb;i++){
+	while(!ring.push(i)) std::this_thread::yield();
+      }
+    });
+
+  int expected = 0;
+  int value;
+  while(expected<nb){
+    if(ring.pop(value)){
+      ASSERT_EQ(value,expected);
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  ASSERT_EQ(ring.size(),0);
+
+}
+
+
+TEST_F(IK_ring_tests, shared_memory){
+
+  playful_kinematics::ik_ring created("/playful_kinematics_unit_tests",true);
+  ASSERT_TRUE(created.is_valid());
+
+  playful_kinematics::ik_ring opened("/playful_kinematics_unit_tests",false);
+  ASSERT_TRUE(opened.is_valid());
+
+  playful_kinematics::ik_ring_target target;
+  target.id = 42;
+  ASSERT_TRUE(created.post(target));
+
+  playful_kinematics::ik_ring_target taken;
+  ASSERT_TRUE(opened.take(taken));
+  ASSERT_EQ(taken.id,(uint32_t)42);
+  ASSERT_FALSE(opened.take(taken));
+
+}
+
+
+TEST_F(IK_ring_tests, target){
+
+  using namespace playful_kinematics;
+
+  bool mask[6] = {true,true,true,false,false,false};
+  float cartesian[6] = {0.2,0.2,1.0,0,0,0};
+  float reference[3] = {0.1,0.2,0.3};
+
+  // garbage left by a previous use of the slot is cleared
+  ik_ring_target target;
+  memset(&target,0xff,sizeof(target));
+  ASSERT_TRUE(set_ik_ring_target(target,7,true,mask,cartesian,3,reference,NULL,NULL,NULL));
+  ASSERT_EQ(target.id,7);
+  ASSERT_EQ(target.line_search,FIXED_STEP_LINE_SEARCH);
+  ASSERT_EQ(target.nb_joints,3);
+  ASSERT_FALSE(target.has_limit[0]);
+  ASSERT_EQ(target.priority[2],1);
+  ASSERT_EQ(target.posture[3],0);
+
+  set_ik_ring_target(target,8,true,mask,cartesian,3,reference,NULL,NULL,NULL,ADAPTIVE_LINE_SEARCH);
+  ASSERT_EQ(target.line_search,ADAPTIVE_LINE_SEARCH);
+
+  // more joints than a slot holds
+  float large[server_protocol::MAX_JOINTS+1] = {0};
+  ASSERT_FALSE(set_ik_ring_target(target,9,true,mask,cartesian,server_protocol::MAX_JOINTS+1,
+				  large,NULL,NULL,NULL));
+  ASSERT_EQ(target.id,8);
+
+}
+
+
+TEST_F(IK_ring_tests, rejected_requests){
+
+  using namespace playful_kinematics;
+
+  server_protocol::request job;
+  memset(&job,0,sizeof(job));
+  job.magic = server_protocol::MAGIC;
+  job.type = server_protocol::IK_REQUEST;
+  job.left = true;
+  for(int i=0;i<3;i++) job.mask[i]=true;
+
+  server_protocol::reply reply;
+
+  // fewer joints than the chain has
+  job.nb_joints = 0;
+  server_protocol::process(job,reply);
+  ASSERT_FALSE(reply.success);
+
+  // more joints than a request holds
+  job.nb_joints = server_protocol::MAX_JOINTS+1;
+  server_protocol::process(job,reply);
+  ASSERT_FALSE(reply.success);
+
+  // unknown line search
+  job.nb_joints = get_nb_joints(true);
+  job.line_search = 2;
+  server_protocol::process(job,reply);
+  ASSERT_FALSE(reply.success);
+
+}
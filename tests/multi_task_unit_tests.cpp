@@ -0,0 +1,206 @@
+#include "playful_kinematics/multi_task.h"
+#include "gtest/gtest.h"
+#include <cmath>
+
+
+class Multi_task_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+// two joints around z (a torso), then a branch of nb_joints joints, links of length
+// 0.3 rotated by angle around z: the branches share the torso but not its last
+// fixed transform
+static playful_kinematics::flat_chain _branch(double angle, int nb_joints){
+  playful_kinematics::flat_chain chain;
+  double z[3] = {0,0,1};
+  double y[3] = {0,1,0};
+  double origin[3] = {0,0,0};
+  double identity[9] = {1,0,0,0,1,0,0,0,1};
+  double up[3] = {0,0,0.2};
+  double base[3] = {0,0,0.1};
+  chain.add_fixed(identity,base);
+  chain.add_joint(playful_kinematics::REVOLUTE_JOINT,z,origin);
+  chain.add_fixed(identity,up);
+  chain.add_joint(playful_kinematics::REVOLUTE_JOINT,y,origin);
+  double c = cos(angle), s = sin(angle);
+  double rotation[9] = {c,-s,0,s,c,0,0,0,1};
+  double link[3] = {0.3,0,0};
+  chain.add_fixed(rotation,up);
+  for(int j=0;j<nb_joints;j++){
+    chain.add_joint(playful_kinematics::REVOLUTE_JOINT,j%2 ? y : z,origin);
+    chain.add_fixed(identity,link);
+  }
+  return chain;
+}
+
+
+TEST_F(Multi_task_tests, shared_joints){
+
+  using namespace playful_kinematics;
+
+  flat_chain left = _branch(M_PI/2,3);
+  flat_chain right = _branch(-M_PI/2,3);
+  flat_chain head = _branch(0,1);
+
+  std::vector<bool> mask(6,true);
+  multi_task_score score;
+  score.add_task(left,mask,0,0,0,0,0,0);
+  ASSERT_EQ(score.get_nb_shared_joints(),5);
+  score.add_task(right,mask,0,0,0,0,0,0);
+  score.add_task(head,mask,0,0,0,0,0,0);
+
+  // the torso joints, then 3+3+1 joints
+  ASSERT_EQ(score.get_nb_tasks(),3);
+  ASSERT_EQ(score.get_nb_shared_joints(),2);
+  ASSERT_EQ(score.get_nb_joints(),9);
+  int expected[5] = {0,1,5,6,7};
+  ASSERT_EQ(score.get_task_joints(1).size(),5);
+  for(int j=0;j<5;j++) ASSERT_EQ(score.get_task_joints(1)[j],expected[j]);
+  ASSERT_EQ(score.get_task_joints(2).back(),8);
+
+  // the pose of each end effector is the one of its whole chain
+  const flat_chain *chains[3] = {&left,&right,&head};
+  double q[9] = {0.3,-0.2,0.5,-0.4,0.1,0.7,0.2,-0.6,0.4};
+  for(int t=0;t<3;t++){
+    const std::vector<int> &joints = score.get_task_joints(t);
+    double chain_q[5];
+    for(int j=0;j<joints.size();j++) chain_q[j] = q[joints[j]];
+    double position[3], rotation[9];
+    forward_kinematics(*chains[t],chain_q,position,rotation);
+    double roll, pitch, yaw;
+    get_rpy(rotation,&roll,&pitch,&yaw);
+    score.set_target(t,mask,position[0],position[1],position[2],roll,pitch,yaw);
+    double task_position[3], task_rotation[9];
+    score.get_pose(t,q,task_position,task_rotation);
+    for(int i=0;i<3;i++) ASSERT_NEAR(task_position[i],position[i],1e-12);
+  }
+  ASSERT_NEAR(score.evaluate(q),0,1e-4);
+
+  // weighted squared distances of the tasks
+  std::vector<float> posture(q,q+9);
+  posture[3] += 0.1;
+  std::vector<float> errors;
+  score.get_errors(posture,errors);
+  ASSERT_GT(errors[0],0.01);
+  ASSERT_NEAR(errors[1],0,1e-4);
+  ASSERT_NEAR(errors[2],0,1e-4);
+  score.set_weight(0,2);
+  ASSERT_NEAR(score(posture),sqrt(2*errors[0]*errors[0]+errors[1]*errors[1]+errors[2]*errors[2]),1e-6);
+
+  // wrong size
+  posture.pop_back();
+  ASSERT_EQ(score(posture),std::numeric_limits<float>::max());
+
+}
+
+
+TEST_F(Multi_task_tests, no_shared_joints){
+
+  using namespace playful_kinematics;
+
+  // one joint chains above the same base, around different axes: no joint is shared
+  double z[3] = {0,0,1};
+  double y[3] = {0,1,0};
+  double origin[3] = {0,0,0};
+  double identity[9] = {1,0,0,0,1,0,0,0,1};
+  double base[3] = {0,0,0.5};
+  double link[3] = {0.3,0,0};
+  flat_chain first, second;
+  first.add_fixed(identity,base);
+  first.add_joint(REVOLUTE_JOINT,z,origin);
+  first.add_fixed(identity,link);
+  second.add_fixed(identity,base);
+  second.add_joint(REVOLUTE_JOINT,y,origin);
+  second.add_fixed(identity,link);
+
+  std::vector<bool> mask(6,true);
+  multi_task_score score;
+  score.add_task(first,mask,0,0,0,0,0,0);
+  score.add_task(second,mask,0,0,0,0,0,0);
+  ASSERT_EQ(score.get_nb_shared_joints(),0);
+  ASSERT_EQ(score.get_nb_joints(),2);
+
+  // the base of the chains is applied once
+  double q[2] = {0.4,-0.3};
+  for(int t=0;t<2;t++){
+    double position[3], rotation[9];
+    score.get_pose(t,q,position,rotation);
+    double roll, pitch, yaw;
+    get_rpy(rotation,&roll,&pitch,&yaw);
+    score.set_target(t,mask,position[0],position[1],position[2],roll,pitch,yaw);
+  }
+  float errors[2];
+  ASSERT_NEAR(score.evaluate(q,errors),0,1e-4);
+  ASSERT_NEAR(errors[0],0,1e-4);
+  ASSERT_NEAR(errors[1],0,1e-4);
+
+}
+
+
+TEST_F(Multi_task_tests, both_hands_and_gaze){
+
+  using namespace playful_kinematics;
+
+  flat_chain left = _branch(M_PI/2,3);
+  flat_chain right = _branch(-M_PI/2,3);
+  flat_chain head = _branch(0,1);
+
+  // targets reached by a posture
+  double q[9] = {0.2,0.1,0.4,-0.3,0.2,-0.5,0.3,0.1,-0.3};
+  std::vector<bool> position_mask(6,false);
+  position_mask[0] = position_mask[1] = position_mask[2] = true;
+  // gaze: yaw of the head
+  std::vector<bool> gaze_mask(6,false);
+  gaze_mask[5] = true;
+
+  multi_task_score score;
+  score.add_task(left,position_mask,0,0,0,0,0,0);
+  score.add_task(right,position_mask,0,0,0,0,0,0);
+  score.add_task(head,gaze_mask,0,0,0,0,0,0);
+  for(int t=0;t<3;t++){
+    double position[3], rotation[9];
+    score.get_pose(t,q,position,rotation);
+    double roll, pitch, yaw;
+    get_rpy(rotation,&roll,&pitch,&yaw);
+    score.set_target(t,t==2 ? gaze_mask : position_mask,position[0],position[1],position[2],roll,pitch,yaw);
+  }
+
+  std::vector<float> min(9,-M_PI), max(9,M_PI);
+  // first torso joint frozen
+  min[0] = max[0] = 0.2;
+
+  // SOMA: coordinate descent, not expected to reach all the targets of this chain from
+  // any posture, but trading the tasks against each other
+  solver_profile soma;
+  soma.target_score = 0.003;
+  soma.max_iteration = 100;
+  std::vector<float> posture(9,0);
+  float start_score = score(posture);
+  float final_score;
+  ik(score,std::vector<int>(),min,max,posture,final_score,soma,ADAPTIVE_LINE_SEARCH);
+  ASSERT_LT(final_score,start_score/10);
+  ASSERT_FLOAT_EQ(final_score,score(posture));
+  ASSERT_FLOAT_EQ(posture[0],0.2);
+
+  solver_profile cmaes;
+  cmaes.engine = CMAES_ENGINE;
+  cmaes.target_score = 0.003;
+  cmaes.cmaes.max_generations = 2000;
+  cmaes.cmaes.seed = 1;
+  fixed_posture<9> fixed, fixed_min, fixed_max;
+  for(int i=0;i<9;i++){
+    fixed[i] = 0;
+    fixed_min[i] = min[i];
+    fixed_max[i] = max[i];
+  }
+  ASSERT_TRUE(ik(score,std::vector<int>(),fixed_min,fixed_max,fixed,final_score,cmaes));
+  ASSERT_FLOAT_EQ(fixed[0],0.2);
+  std::vector<float> errors;
+  score.get_errors(fixed,errors);
+  for(int t=0;t<3;t++) ASSERT_LE(errors[t],cmaes.target_score);
+
+}
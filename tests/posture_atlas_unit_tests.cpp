@@ -0,0 +1,152 @@
+#include "playful_kinematics/posture_atlas.h"
+#include "gtest/gtest.h"
+
+#include <random>
+#include <cstdio>
+#include <unistd.h>
+
+
+#define V_PI 3.14159265358979323846
+
+
+class Posture_atlas_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+// random atlas, the posture of a sample being its index (one joint)
+static boost::shared_ptr<playful_kinematics::posture_atlas> _random_atlas(int nb_samples,
+									  std::vector<float> &get_poses){
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> position(-1.0,1.0);
+  std::uniform_real_distribution<float> angle(-V_PI,V_PI);
+
+  std::vector<float> postures;
+  get_poses.clear();
+  for(int s=0;s<nb_samples;s++){
+    postures.push_back(s);
+    for(int i=0;i<3;i++) get_poses.push_back(position(generator));
+    for(int i=0;i<3;i++) get_poses.push_back(angle(generator));
+  }
+
+  return boost::shared_ptr<playful_kinematics::posture_atlas>(new playful_kinematics::posture_atlas(true,1,postures,get_poses));
+
+}
+
+
+static float _distance(const float *pose, const float *target, const std::vector<bool> &mask){
+  float d = 0;
+  for(int i=0;i<6;i++){
+    if(!mask[i]) continue;
+    float diff = fabs(pose[i]-target[i]);
+    if(i>=3) diff = fabs(V_PI - std::fabs(std::fmod(diff,2*V_PI) - V_PI));
+    d += diff*diff;
+  }
+  return d;
+}
+
+
+static void _check_queries(playful_kinematics::posture_atlas &atlas,
+			   const std::vector<float> &poses,
+			   const std::vector<bool> &mask){
+
+  std::mt19937 generator(2);
+  std::uniform_real_distribution<float> position(-1.2,1.2);
+  // targets angles possibly outside [-pi,pi]
+  std::uniform_real_distribution<float> angle(-4.0,4.0);
+
+  int k = 5;
+  int nb_samples = poses.size()/6;
+
+  for(int t=0;t<200;t++){
+
+    float target[6];
+    for(int i=0;i<3;i++) target[i]=position(generator);
+    for(int i=3;i<6;i++) target[i]=angle(generator);
+
+    std::vector<float> distances;
+    for(int s=0;s<nb_samples;s++) distances.push_back(_distance(&poses[6*s],target,mask));
+    std::vector<float> sorted(distances);
+    std::sort(sorted.begin(),sorted.end());
+
+    std::vector<float> found;
+    ASSERT_EQ(atlas.query(target,mask,k,found),k);
+    ASSERT_EQ(found.size(),k);
+
+    for(int n=0;n<k;n++){
+      int sample = (int)found[n];
+      ASSERT_NEAR(distances[sample],sorted[n],1e-5);
+    }
+
+  }
+
+}
+
+
+TEST_F(Posture_atlas_tests, nearest_neighbours){
+
+  std::vector<float> poses;
+  boost::shared_ptr<playful_kinematics::posture_atlas> atlas = _random_atlas(3000,poses);
+
+  std::vector<bool> full(6,true);
+  _check_queries(*atlas,poses,full);
+
+  std::vector<bool> position(6,false);
+  for(int i=0;i<3;i++) position[i]=true;
+  _check_queries(*atlas,poses,position);
+
+  std::vector<bool> orientation(6,false);
+  orientation[0]=true;
+  orientation[4]=true;
+  _check_queries(*atlas,poses,orientation);
+
+}
+
+
+TEST_F(Posture_atlas_tests, fewer_samples_than_k){
+
+  std::vector<float> poses;
+  boost::shared_ptr<playful_kinematics::posture_atlas> atlas = _random_atlas(3,poses);
+
+  float target[6] = {0,0,0,0,0,0};
+  std::vector<float> found;
+  ASSERT_EQ(atlas->query(target,std::vector<bool>(6,true),10,found),3);
+
+  playful_kinematics::posture_atlas empty;
+  ASSERT_EQ(empty.query(target,std::vector<bool>(6,true),10,found),0);
+
+}
+
+
+TEST_F(Posture_atlas_tests, save_and_load){
+
+  std::vector<float> poses;
+  boost::shared_ptr<playful_kinematics::posture_atlas> atlas = _random_atlas(1000,poses);
+
+  std::vector<bool> full(6,true);
+  atlas->build_index(full);
+
+  char path[] = "/tmp/posture_atlas_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd,0);
+  close(fd);
+
+  ASSERT_TRUE(atlas->save(path));
+
+  playful_kinematics::posture_atlas loaded;
+  ASSERT_TRUE(loaded.load(path));
+  remove(path);
+
+  ASSERT_EQ(loaded.get_nb_samples(),1000);
+  ASSERT_EQ(loaded.get_nb_joints(),1);
+  ASSERT_TRUE(loaded.get_side());
+
+  _check_queries(loaded,poses,full);
+
+  ASSERT_FALSE(loaded.load("/tmp/posture_atlas_does_not_exist"));
+
+}
@@ -0,0 +1,202 @@
+#include "playful_kinematics/robot_instance.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "gtest/gtest.h"
+
+
+// interface for the python wrapper (robot_instance.cpp)
+extern "C" {
+  void* create_kinematics_handle();
+  void delete_kinematics_handle(void *handle);
+  void handle_set_joint_limit(void *handle, bool left, int index, float min, float max);
+  bool handle_ik(void *handle, bool left,
+		 float target_x, float target_y, float target_z,
+		 float target_alpha, float target_beta, float target_gamma,
+		 bool *mask, int nb_dofs, float *posture, float *get_score);
+}
+
+
+class Robot_instance_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+static void _configure(playful_kinematics::robot_instance &instance){
+
+  using namespace playful_kinematics;
+
+  instance.set_reference_posture(true,std::vector<float>(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS));
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    instance.set_joint_limit(true,i,pepper::LEFT_MIN[i],pepper::LEFT_MAX[i]);
+    instance.set_minimization_priority(true,i,pepper::MINIMIZATION_PRIORITY[i]);
+  }
+
+}
+
+
+TEST_F(Robot_instance_tests, shared_model_and_own_configuration){
+
+  using namespace playful_kinematics;
+
+  robot_instance first;
+  robot_instance second;
+
+  ASSERT_EQ(&first.get_model(),&second.get_model());
+  ASSERT_EQ(first.get_plan(true).reference_posture.size(),first.get_model().get_nb_joints(true));
+
+  _configure(first);
+  ASSERT_EQ(first.get_plan(true).max[0],pepper::LEFT_MAX[0]);
+  ASSERT_EQ(second.get_plan(true).max[0],0);
+  // the other side is not affected
+  ASSERT_EQ(first.get_plan(false).max[0],0);
+
+}
+
+
+TEST_F(Robot_instance_tests, same_solution_as_plan){
+
+  using namespace playful_kinematics;
+
+  robot_instance instance;
+  _configure(instance);
+
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<int> priority(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+  std::map<int,float> min,max;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    min[i]=pepper::LEFT_MIN[i];
+    max[i]=pepper::LEFT_MAX[i];
+  }
+  boost::shared_ptr<const ik_plan> plan = make_ik_plan(true,std::vector<bool>(6,true),
+						       reference,priority,min,max);
+
+  float targets[3][6] = { {0.2,0.15,0.9,0,0,0},
+			  {0.1,0.3,0.7,0.5,0,0},
+			  {0.25,0.0,1.0,0,0.3,0} };
+
+  // the workspace of the instance is reused over solves
+  for(int t=0;t<3;t++){
+
+    const float *c = targets[t];
+
+    std::vector<float> posture,instance_posture;
+    float score,instance_score;
+
+    bool success = ik(*plan,c[0],c[1],c[2],c[3],c[4],c[5],posture,score);
+    bool instance_success = instance.ik(true,c[0],c[1],c[2],c[3],c[4],c[5],instance_posture,instance_score);
+
+    ASSERT_EQ(success,instance_success);
+    ASSERT_EQ(score,instance_score);
+    for(int i=0;i<pepper::NB_DOFS;i++) ASSERT_EQ(posture[i],instance_posture[i]);
+
+  }
+
+  ASSERT_TRUE(instance.get_footprint()>sizeof(robot_instance));
+
+}
+
+
+TEST_F(Robot_instance_tests, posture_array_same_as_fixed_posture){
+
+  using namespace playful_kinematics;
+
+  robot_instance instance;
+  _configure(instance);
+
+  float targets[2][6] = { {0.2,0.15,0.9,0,0,0},
+			  {0.1,0.3,0.7,0.5,0,0} };
+
+  for(int t=0;t<2;t++){
+
+    const float *c = targets[t];
+
+    fixed_posture<pepper::NB_DOFS> posture;
+    float score;
+    bool success = ik<pepper::NB_DOFS>(instance.get_plan(true),c[0],c[1],c[2],c[3],c[4],c[5],posture,score);
+
+    float instance_posture[pepper::NB_DOFS];
+    float instance_score;
+    bool instance_success = instance.ik(true,c[0],c[1],c[2],c[3],c[4],c[5],instance_posture,instance_score);
+
+    ASSERT_EQ(success,instance_success);
+    ASSERT_EQ(score,instance_score);
+    for(int i=0;i<pepper::NB_DOFS;i++) ASSERT_EQ(posture[i],instance_posture[i]);
+
+  }
+
+}
+
+
+TEST_F(Robot_instance_tests, frozen_joints_not_moved){
+
+  using namespace playful_kinematics;
+
+  robot_instance instance;
+  _configure(instance);
+  ASSERT_FALSE(instance.get_plan(true).free_chain);
+
+  // joint 1 blocked at a value other than its reference
+  float blocked = 0.5*(pepper::LEFT_MIN[1]+pepper::LEFT_MAX[1]);
+  instance.set_joint_limit(true,1,blocked,blocked);
+
+  const ik_plan &plan = instance.get_plan(true);
+  ASSERT_EQ(plan.free_joints.size(),pepper::NB_DOFS-1);
+  for(int g=0;g<plan.minimization_order.size();g++){
+    for(int i=0;i<plan.minimization_order[g].size();i++) ASSERT_NE(plan.minimization_order[g][i],1);
+  }
+
+  float c[6] = {0.2,0.15,0.9,0,0,0};
+
+  // folded chain (fixed size) and full chain (vector posture) give the same solution
+  float posture[pepper::NB_DOFS];
+  float score;
+  instance.ik(true,c[0],c[1],c[2],c[3],c[4],c[5],posture,score);
+
+  std::vector<float> full_posture;
+  float full_score;
+  instance.ik(true,c[0],c[1],c[2],c[3],c[4],c[5],full_posture,full_score);
+
+  ASSERT_EQ(posture[1],blocked);
+  ASSERT_EQ(full_posture[1],blocked);
+  ASSERT_NEAR(score,full_score,1e-4);
+  for(int i=0;i<pepper::NB_DOFS;i++) ASSERT_NEAR(posture[i],full_posture[i],1e-3);
+
+  // unblocked: the joint is free again
+  instance.set_joint_limit(true,1,pepper::LEFT_MIN[1],pepper::LEFT_MAX[1]);
+  ASSERT_FALSE(instance.get_plan(true).free_chain);
+  ASSERT_EQ(instance.get_plan(true).free_joints.size(),pepper::NB_DOFS);
+
+}
+
+
+TEST_F(Robot_instance_tests, handle_uses_shared_solver_profile){
+
+  using namespace playful_kinematics;
+
+  void *handle = create_kinematics_handle();
+  for(int i=0;i<pepper::NB_DOFS;i++) handle_set_joint_limit(handle,true,i,pepper::LEFT_MIN[i],pepper::LEFT_MAX[i]);
+
+  bool mask[6] = {true,true,true,false,false,false};
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<float> posture(reference);
+  float score;
+
+  handle_ik(handle,true,0.2,0.15,0.9,0,0,0,mask,pepper::NB_DOFS,posture.data(),&score);
+  ASSERT_NE(posture,reference);
+
+  // any posture is good enough: the minimization stops at the reference posture
+  solver_profile previous = get_kinematics_solver_profile();
+  solver_profile satisfied;
+  satisfied.target_score = std::numeric_limits<float>::max();
+  set_kinematics_solver_profile(satisfied);
+
+  posture = reference;
+  ASSERT_TRUE(handle_ik(handle,true,0.2,0.15,0.9,0,0,0,mask,pepper::NB_DOFS,posture.data(),&score));
+  ASSERT_EQ(posture,reference);
+
+  set_kinematics_solver_profile(previous);
+  delete_kinematics_handle(handle);
+
+}
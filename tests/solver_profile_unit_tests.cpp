@@ -0,0 +1,129 @@
+#include "playful_kinematics/ik.h"
+#include "playful_kinematics/pepper_configuration.h"
+#include "gtest/gtest.h"
+#include <fstream>
+#include <cstdio>
+
+
+class Solver_profile_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+
+TEST_F(Solver_profile_tests, file_round_trip){
+
+  using namespace playful_kinematics;
+
+  std::string path = "/tmp/playful_kinematics_solver_profile_unit_tests.txt";
+
+  solver_profile profile;
+  profile.engine = CMAES_ENGINE;
+  profile.target_score = 0.0003;
+  profile.max_step = 0.37;
+  profile.min_step = 0.0007;
+  profile.max_iteration = 9;
+  profile.cmaes.population = 12;
+  profile.cmaes.sigma = 0.21;
+  profile.cmaes.max_generations = 77;
+  profile.cmaes.seed = 5;
+  profile.cmaes.nb_threads = 2;
+  ASSERT_TRUE(write_solver_profile(path,profile,"tuned\non 100 targets"));
+
+  solver_profile read;
+  ASSERT_TRUE(read_solver_profile(path,read));
+  ASSERT_TRUE(read==profile);
+
+  // parameters not in the file keep their default value
+  {
+    std::ofstream out(path.c_str());
+    out << SOLVER_PROFILE_HEADER << " " << SOLVER_PROFILE_VERSION << "\n# comment\nmax_iteration 4\n";
+  }
+  ASSERT_TRUE(read_solver_profile(path,read));
+  solver_profile expected;
+  expected.max_iteration = 4;
+  ASSERT_TRUE(read==expected);
+
+  // unknown parameter: not read
+  {
+    std::ofstream out(path.c_str());
+    out << SOLVER_PROFILE_HEADER << " " << SOLVER_PROFILE_VERSION << "\nmax_iterations 4\n";
+  }
+  ASSERT_FALSE(read_solver_profile(path,read));
+  ASSERT_TRUE(read==expected);
+
+  std::remove(path.c_str());
+  ASSERT_FALSE(read_solver_profile(path,read));
+
+}
+
+
+TEST_F(Solver_profile_tests, profile_of_the_plan){
+
+  using namespace playful_kinematics;
+
+  // the configuration publishes a new plan with the profile
+  solver_profile previous = get_kinematics_solver_profile();
+  unsigned long version = get_kinematics_config_version();
+  solver_profile profile;
+  profile.max_iteration = 3;
+  set_kinematics_solver_profile(profile);
+  ASSERT_TRUE(get_ik_plan()->profile==profile);
+  ASSERT_EQ(get_kinematics_config_version(),version+(profile!=previous ? 1 : 0));
+  set_kinematics_solver_profile(previous);
+
+  std::vector<float> reference(pepper::LEFT_REFERENCE,pepper::LEFT_REFERENCE+pepper::NB_DOFS);
+  std::vector<int> priority(pepper::MINIMIZATION_PRIORITY,pepper::MINIMIZATION_PRIORITY+pepper::NB_DOFS);
+  std::map<int,float> min,max;
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    min[i]=pepper::LEFT_MIN[i];
+    max[i]=pepper::LEFT_MAX[i];
+  }
+  std::vector<bool> mask(6,false);
+  mask[0] = mask[1] = mask[2] = true;
+  float t[6] = {0.2,0.15,0.9,0,0,0};
+
+  solver_profile soma;
+  solver_profile short_soma;
+  short_soma.max_iteration = 1;
+  solver_profile cmaes;
+  cmaes.engine = CMAES_ENGINE;
+  cmaes.cmaes.max_generations = 5;
+  cmaes.cmaes.population = 8;
+
+  std::vector<float> posture;
+  float score;
+
+  // fewer passes over the joints, fewer evaluations
+  boost::shared_ptr<const ik_plan> plan = make_ik_plan(true,mask,reference,priority,min,max,
+						       FIXED_STEP_LINE_SEARCH,soma);
+  get_soma_counters().reset();
+  ik(*plan,t[0],t[1],t[2],t[3],t[4],t[5],posture,score);
+  long nb_evaluations = get_soma_counters().nb_evaluations;
+  ik_plan short_plan(*plan);
+  short_plan.profile = short_soma;
+  get_soma_counters().reset();
+  ik(short_plan,t[0],t[1],t[2],t[3],t[4],t[5],posture,score);
+  ASSERT_LE(get_soma_counters().nb_evaluations,nb_evaluations);
+
+  // CMA-ES: at most one evaluation of the start posture, and population * generations
+  ik_plan cmaes_plan(*plan);
+  cmaes_plan.profile = cmaes;
+  fixed_posture<pepper::NB_DOFS> fixed;
+  get_soma_counters().reset();
+  ik<pepper::NB_DOFS>(cmaes_plan,t[0],t[1],t[2],t[3],t[4],t[5],fixed,score);
+  ASSERT_LE(get_soma_counters().nb_evaluations,1+8*5);
+  for(int i=0;i<pepper::NB_DOFS;i++){
+    ASSERT_GE(fixed[i],pepper::LEFT_MIN[i]);
+    ASSERT_LE(fixed[i],pepper::LEFT_MAX[i]);
+  }
+
+  // same with the configuration as arguments
+  get_soma_counters().reset();
+  ik(true,mask,reference,priority,min,max,t[0],t[1],t[2],t[3],t[4],t[5],posture,score,
+     FIXED_STEP_LINE_SEARCH,cmaes);
+  ASSERT_LE(get_soma_counters().nb_evaluations,1+8*5);
+
+}
@@ -0,0 +1,65 @@
+# Copyright  (C)  2018 Max Planck Gesellschaft
+# Author : Vincent Berenz
+
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+
+import os,tempfile,unittest
+from playful_kinematics.playful_kinematics import IK
+
+
+def _write_profile(lines):
+
+    descriptor,path = tempfile.mkstemp(suffix=".txt")
+    with os.fdopen(descriptor,"w") as f:
+        f.write("playful_kinematics_solver_profile 1\n")
+        for line in lines:
+            f.write(line+"\n")
+    return path
+
+
+class Solver_profile_tests(unittest.TestCase):
+
+
+    def test_loaded_profile_changes_solve(self):
+
+        ik = IK("pepper")
+
+        joints,limits = ik.get_params(True)
+        reference = {joint:0.5*(limits[joint][0]+limits[joint][1]) for joint in joints}
+        ik.set_reference_posture(True,reference)
+
+        success,score,posture = ik.get_posture(True,[0.2,0.15,0.9],[None,None,None])
+        moved = [joint for joint in joints if abs(posture[joint]-reference[joint])>1e-5]
+        self.assertTrue(moved)
+
+        # any posture is good enough: the minimization stops at the reference posture
+        satisfied = _write_profile(["target_score 1e30"])
+        default = _write_profile([])
+
+        try :
+
+            self.assertTrue(ik.load_solver_profile(satisfied))
+            success,score,posture = ik.get_posture(True,[0.2,0.15,0.9],[None,None,None])
+            self.assertTrue(success)
+            for joint in joints:
+                self.assertAlmostEqual(posture[joint],reference[joint],places=5)
+
+        finally :
+
+            ik.load_solver_profile(default)
+            os.remove(satisfied)
+            os.remove(default)
+
@@ -1,6 +1,8 @@
 #include "playful_kinematics/soma.h"
 #include "gtest/gtest.h"
 
+#include <array>
+
 
 class SOMA_tests : public ::testing::Test {
 
@@ -78,6 +80,8 @@ TEST_F(SOMA_tests, basic_test){
 				target_score,max_step,min_step,
 				max_iterations,&abs_score_function,final_score);
 
+  // the best score (1, the min of the third joint) is above the target score
+  ASSERT_FALSE(success);
   ASSERT_NEAR(posture[0],0.0,target_score);
   ASSERT_NEAR(posture[1],0.0,target_score);
   ASSERT_NEAR(posture[2],1.0,target_score);  
@@ -118,6 +122,7 @@ TEST_F(SOMA_tests, minimization_order_test){
 					      target_score,max_step,min_step,
 					      max_iterations,&targeting_one_score_function,final_score);
 
+  ASSERT_TRUE(success);
   ASSERT_NEAR(posture[0],8.0,target_score);
   ASSERT_NEAR(posture[1],8.0,target_score);
   ASSERT_NEAR(posture[2],1.0,target_score);  
@@ -162,6 +167,7 @@ TEST_F(SOMA_tests, minimization_order_test_2){
 					      target_score,max_step,min_step,
 					      max_iterations,&targeting_sum_sixteen_score_function,final_score);
 
+  ASSERT_TRUE(success);
   ASSERT_NEAR(posture[0],0.0,target_score);
   ASSERT_NEAR(posture[1],8.0,target_score);
   ASSERT_NEAR(posture[2],0.0,target_score);
@@ -208,6 +214,7 @@ TEST_F(SOMA_tests, minimization_order_test_3){
 					      target_score,max_step,min_step,
 					      max_iterations,&targeting_sum_sixteen_score_function,final_score);
 
+  ASSERT_TRUE(success);
   ASSERT_NEAR(posture[0],2.0,target_score);
   ASSERT_NEAR(posture[1],6.0,target_score);
   ASSERT_NEAR(posture[2],0.0,target_score);
@@ -216,3 +223,201 @@ TEST_F(SOMA_tests, minimization_order_test_3){
 
 }
 
+
+
+class targeting_value_score {
+public:
+  targeting_value_score(float value) : value(value) {}
+  template<class Posture>
+  float operator()(const Posture &posture) const {
+    float sum = 0;
+    for(int i=0;i<posture.size();i++) sum += std::abs(posture[i]);
+    return std::abs(sum-this->value);
+  }
+private:
+  float value;
+};
+
+
+TEST_F(SOMA_tests, templated_minimize){
+
+  std::map<int,float> min;
+  std::map<int,float> max;
+  for(int i=0;i<4;i++){
+    min[i]=0;
+    max[i]=10;
+  }
+
+  std::vector<int> minimization_priority;
+  minimization_priority.push_back(1);
+  minimization_priority.push_back(2);
+  minimization_priority.push_back(1);
+  minimization_priority.push_back(2);
+
+  float target_score = 0.001;
+  float final_score;
+
+  // function pointer and functor versions find the same posture
+  std::vector<float> posture(4,8.0);
+  playful_kinematics::minimize(posture,minimization_priority,min,max,
+			       target_score,0.1,target_score,10,
+			       &targeting_sum_sixteen_score_function,final_score);
+
+  std::vector<float> functor_posture(4,8.0);
+  playful_kinematics::minimize(functor_posture,minimization_priority,min,max,
+			       target_score,0.1,target_score,10,
+			       targeting_value_score(16.0),final_score);
+
+  std::array<float,4> array_posture;
+  array_posture.fill(8.0);
+  playful_kinematics::minimize(array_posture,minimization_priority,min,max,
+			       target_score,0.1,target_score,10,
+			       targeting_value_score(16.0),final_score);
+
+  playful_kinematics::fixed_posture<4> fixed_posture;
+  for(int i=0;i<4;i++) fixed_posture[i]=8.0;
+  playful_kinematics::minimize(fixed_posture,minimization_priority,min,max,
+			       target_score,0.1,target_score,10,
+			       targeting_value_score(16.0),final_score);
+
+  for(int i=0;i<4;i++){
+    ASSERT_EQ(functor_posture[i],posture[i]);
+    ASSERT_EQ(array_posture[i],posture[i]);
+    ASSERT_EQ(fixed_posture[i],posture[i]);
+  }
+
+  // lambda carrying its own state
+  int nb_calls = 0;
+  std::vector<float> lambda_posture(4,8.0);
+  bool success = playful_kinematics::minimize(lambda_posture,min,max,
+					      target_score,0.1,target_score,10,
+					      [&nb_calls](std::vector<float> &p){
+						nb_calls++;
+						float sum = 0;
+						for(int i=0;i<p.size();i++) sum += std::abs(p[i]);
+						return sum;
+					      },
+					      final_score);
+
+  ASSERT_TRUE(success);
+  ASSERT_TRUE(nb_calls>0);
+  for(int i=0;i<4;i++) ASSERT_NEAR(lambda_posture[i],0.0,target_score);
+
+}
+
+
+TEST_F(SOMA_tests, score_reuse){
+
+  std::map<int,float> min;
+  std::map<int,float> max;
+  for(int i=0;i<4;i++){
+    min[i]=0;
+    max[i]=10;
+  }
+
+  float target_score = 0.001;
+  float final_score = -1;
+
+  playful_kinematics::get_soma_counters().reset();
+
+  std::vector<float> posture(4,8.0);
+  playful_kinematics::minimize(posture,min,max,
+			       target_score,0.1,target_score,10,
+			       &targeting_sum_sixteen_score_function,final_score);
+
+  const playful_kinematics::soma_counters &counters = playful_kinematics::get_soma_counters();
+  ASSERT_EQ(counters.nb_minimizations,1);
+  ASSERT_TRUE(counters.nb_evaluations>0);
+  ASSERT_TRUE(counters.nb_evaluations<counters.nb_requests());
+  ASSERT_NEAR(final_score,targeting_sum_sixteen_score_function(posture),1e-6);
+
+  // no better posture: final score is still the score of the posture
+  std::vector<float> blocked(4,8.0);
+  final_score = -1;
+  bool success = playful_kinematics::minimize(blocked,min,min,
+					      target_score,0.1,target_score,10,
+					      &targeting_sum_sixteen_score_function,final_score);
+  ASSERT_FALSE(success);
+  ASSERT_NEAR(final_score,targeting_sum_sixteen_score_function(blocked),1e-6);
+
+}
+
+
+TEST_F(SOMA_tests, adaptive_line_search){
+
+  playful_kinematics::line_search adaptive = playful_kinematics::ADAPTIVE_LINE_SEARCH;
+
+  float target_score = 0.001;
+  float final_score;
+
+  // same expectations as basic_test
+  std::vector<float> posture;
+  posture.push_back(1.0);
+  posture.push_back(-10.0);
+  posture.push_back(3.1);
+
+  std::map<int,float> min;
+  min[0]=-10;
+  min[1]=-10;
+  min[2]=1;
+
+  std::map<int,float> max;
+  max[0]=10;
+  max[1]=10;
+  max[2]=10;
+
+  playful_kinematics::minimize(posture,min,max,
+			       target_score,0.1,target_score,10,
+			       &abs_score_function,final_score,adaptive);
+
+  ASSERT_NEAR(posture[0],0.0,target_score);
+  ASSERT_NEAR(posture[1],0.0,target_score);
+  ASSERT_NEAR(posture[2],1.0,target_score);
+
+  // same expectations as minimization_order_test
+  std::vector<float> ordered(3,8.0);
+  min[2]=-10;
+  std::vector<int> minimization_priority;
+  minimization_priority.push_back(2);
+  minimization_priority.push_back(2);
+  minimization_priority.push_back(1);
+
+  bool success = playful_kinematics::minimize(ordered,minimization_priority,min,max,
+					      target_score,0.1,target_score,10,
+					      &targeting_one_score_function,final_score,adaptive);
+
+  ASSERT_TRUE(success);
+  ASSERT_NEAR(ordered[0],8.0,target_score);
+  ASSERT_NEAR(ordered[1],8.0,target_score);
+  ASSERT_NEAR(ordered[2],1.0,target_score);
+
+  // long moves: far fewer score evaluations than with fixed steps
+  std::map<int,float> wide_min;
+  std::map<int,float> wide_max;
+  for(int i=0;i<4;i++){
+    wide_min[i]=-100;
+    wide_max[i]=100;
+  }
+
+  playful_kinematics::soma_counters &counters = playful_kinematics::get_soma_counters();
+
+  std::vector<float> fixed_posture(4,-60.0);
+  counters.reset();
+  playful_kinematics::minimize(fixed_posture,wide_min,wide_max,
+			       target_score,0.1,target_score,1000,
+			       &abs_score_function,final_score);
+  long fixed_evaluations = counters.nb_evaluations;
+
+  std::vector<float> adaptive_posture(4,-60.0);
+  counters.reset();
+  success = playful_kinematics::minimize(adaptive_posture,wide_min,wide_max,
+					 target_score,0.1,target_score,1000,
+					 &abs_score_function,final_score,adaptive);
+  long adaptive_evaluations = counters.nb_evaluations;
+
+  ASSERT_TRUE(success);
+  for(int i=0;i<4;i++) ASSERT_NEAR(adaptive_posture[i],0.0,target_score);
+  ASSERT_NEAR(final_score,abs_score_function(adaptive_posture),1e-6);
+  ASSERT_TRUE(adaptive_evaluations*10<fixed_evaluations);
+
+}
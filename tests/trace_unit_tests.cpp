@@ -0,0 +1,85 @@
+// tracing compiled in for these tests, whatever the PLAYFUL_KINEMATICS_TRACING option
+#ifndef PLAYFUL_KINEMATICS_TRACING
+#define PLAYFUL_KINEMATICS_TRACING
+#endif
+
+#include "playful_kinematics/trace.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+
+class Trace_tests : public ::testing::Test {
+
+protected:
+  void SetUp() {
+    playful_kinematics::clear_trace();
+  }
+  void TearDown() {}
+};
+
+
+static std::string _read(const std::string &path){
+  std::ifstream in(path.c_str());
+  std::stringstream content;
+  content << in.rdbuf();
+  return content.str();
+}
+
+
+static int _count(const std::string &content, const std::string &pattern){
+  int nb = 0;
+  for(size_t i=content.find(pattern);i!=std::string::npos;i=content.find(pattern,i+1)) nb++;
+  return nb;
+}
+
+
+static void _traced(int nb){
+  for(int i=0;i<nb;i++){
+    PLAYFUL_KINEMATICS_TRACE("outer");
+    PLAYFUL_KINEMATICS_TRACE("inner");
+  }
+}
+
+
+TEST_F(Trace_tests, events_of_all_threads_written_once){
+
+  std::string path = "/tmp/playful_kinematics_trace_unit_tests.json";
+
+  // events of a thread which exited are kept until written
+  std::thread thread(_traced,10);
+  thread.join();
+  _traced(5);
+
+  ASSERT_TRUE(playful_kinematics::write_trace(path));
+  std::string content = _read(path);
+  ASSERT_EQ(_count(content,"\"name\":\"outer\""),15);
+  ASSERT_EQ(_count(content,"\"name\":\"inner\""),15);
+  ASSERT_EQ(_count(content,"\"ph\":\"X\""),30);
+  ASSERT_EQ(content.find("{\"displayTimeUnit\""),0);
+
+  // events already written are not written again
+  ASSERT_TRUE(playful_kinematics::write_trace(path));
+  content = _read(path);
+  ASSERT_EQ(_count(content,"\"ph\":\"X\""),0);
+
+  std::remove(path.c_str());
+
+}
+
+
+TEST_F(Trace_tests, full_buffer_drops_events){
+
+  long nb_dropped = playful_kinematics::get_nb_dropped_trace_events();
+
+  // two events per iteration
+  _traced(playful_kinematics::TRACE_BUFFER_SIZE/2+5);
+  ASSERT_EQ(playful_kinematics::get_nb_dropped_trace_events(),nb_dropped+10);
+
+  playful_kinematics::clear_trace();
+  _traced(1);
+  ASSERT_EQ(playful_kinematics::get_nb_dropped_trace_events(),nb_dropped+10);
+
+}